@@ -29,12 +29,14 @@ SOURCES += subsurface-mobile-main.cpp \
 	core/plannernotes.c \
 	core/uemis-downloader.c \
 	core/applicationstate.cpp \
+	core/arena.c \
 	core/qthelper.cpp \
 	core/checkcloudconnection.cpp \
 	core/color.cpp \
 	core/configuredivecomputer.cpp \
 	core/divelogexportlogic.cpp \
 	core/divesitehelpers.cpp \
+	core/divesiteindex.cpp \
 	core/errorhelper.c \
 	core/exif.cpp \
 	core/format.cpp \
@@ -45,6 +47,7 @@ SOURCES += subsurface-mobile-main.cpp \
 	core/windowtitleupdate.cpp \
 	core/file.c \
 	core/fulltext.cpp \
+	core/idindex.cpp \
 	core/subsurfacestartup.c \
 	core/pref.c \
 	core/profile.c \
@@ -53,12 +56,14 @@ SOURCES += subsurface-mobile-main.cpp \
 	core/divecomputer.c \
 	core/divefilter.cpp \
 	core/event.c \
+	core/eventindex.c \
 	core/filterconstraint.cpp \
 	core/filterpreset.cpp \
 	core/divelist.c \
 	core/gas-model.c \
 	core/gaspressures.c \
 	core/git-access.c \
+	core/git-snapshot.c \
 	core/liquivision.c \
 	core/load-git.c \
 	core/parse-xml.c \
@@ -80,6 +85,7 @@ SOURCES += subsurface-mobile-main.cpp \
 	core/save-git.c \
 	core/datatrak.c \
 	core/ostctools.c \
+	core/packedsamples.c \
 	core/planner.c \
 	core/save-xml.c \
 	core/cochran.c \
@@ -91,6 +97,7 @@ SOURCES += subsurface-mobile-main.cpp \
 	core/selection.cpp \
 	core/sha1.c \
 	core/string-format.cpp \
+	core/stringpool.c \
 	core/strtod.c \
 	core/tag.c \
 	core/taxonomy.c \
@@ -202,8 +209,10 @@ HEADERS += \
 	core/dive.h \
 	core/divecomputer.h \
 	core/event.h \
+	core/eventindex.h \
 	core/extradata.h \
 	core/git-access.h \
+	core/git-snapshot.h \
 	core/gpslocation.h \
 	core/pref.h \
 	core/profile.h \
@@ -212,6 +221,8 @@ HEADERS += \
 	core/statistics.h \
 	core/units.h \
 	core/version.h \
+	core/packedsamples.h \
+	core/arena.h \
 	core/picture.h \
 	core/pictureobj.h \
 	core/planner.h \
@@ -229,9 +240,11 @@ HEADERS += \
 	core/divelist.h \
 	core/divelogexportlogic.h \
 	core/divesitehelpers.h \
+	core/divesiteindex.h \
 	core/exif.h \
 	core/file.h \
 	core/fulltext.h \
+	core/idindex.h \
 	core/gaspressures.h \
 	core/gettext.h \
 	core/gettextfromc.h \
@@ -243,6 +256,7 @@ HEADERS += \
 	core/sha1.h \
 	core/strndup.h \
 	core/string-format.h \
+	core/stringpool.h \
 	core/subsurfacestartup.h \
 	core/subsurfacesysinfo.h \
 	core/taxonomy.h \
@@ -2,6 +2,7 @@
 
 #include "command_divesite.h"
 #include "core/divesite.h"
+#include "core/fulltext.h"
 #include "core/subsurface-qt/divelistnotifier.h"
 #include "core/qthelper.h"
 #include "core/subsurface-string.h"
@@ -199,6 +200,7 @@ bool EditDiveSiteName::workToBeDone()
 void EditDiveSiteName::redo()
 {
 	swap(ds->name, value);
+	fulltext_register_site(ds); // Update the fulltext cache
 	emit diveListNotifier.diveSiteChanged(ds, LocationInformationModel::NAME); // Inform frontend of changed dive site.
 }
 
@@ -296,7 +298,9 @@ bool EditDiveSiteLocation::workToBeDone()
 
 void EditDiveSiteLocation::redo()
 {
-	std::swap(value, ds->location);
+	location_t old = ds->location;
+	set_dive_site_location(ds, &value);
+	value = old;
 	emit diveListNotifier.diveSiteChanged(ds, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 }
 
@@ -405,7 +409,7 @@ ApplyGPSFixes::ApplyGPSFixes(const std::vector<DiveAndLocation> &fixes)
 			}
 		} else {
 			ds = create_dive_site(qPrintable(dl.name), &dive_site_table);
-			ds->location = dl.location;
+			set_dive_site_location(ds, &dl.location);
 			add_dive_to_dive_site(dl.d, ds);
 			dl.d->dive_site = nullptr; // This will be set on redo()
 			sitesToAdd.emplace_back(ds);
@@ -421,7 +425,9 @@ bool ApplyGPSFixes::workToBeDone()
 void ApplyGPSFixes::editDiveSites()
 {
 	for (SiteAndLocation &sl: siteLocations) {
-		std::swap(sl.location, sl.ds->location);
+		location_t old = sl.ds->location;
+		set_dive_site_location(sl.ds, &sl.location);
+		sl.location = old;
 		emit diveListNotifier.diveSiteChanged(sl.ds, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 	}
 }
@@ -382,7 +382,7 @@ static struct dive_site *createDiveSite(const QString &name)
 	if (current_dive) {
 		location_t loc = dive_get_gps_location(current_dive);
 		if (has_location(&loc))
-			ds->location = loc;
+			set_dive_site_location(ds, &loc);
 	}
 
 	ds->name = copy_qstring(name);
@@ -1234,9 +1234,8 @@ EditCylinder::EditCylinder(int index, cylinder_t cylIn, EditCylinderType typeIn,
 	for (int i = 0; i < (int)indexes.size(); ++i) {
 		switch (type) {
 		case EditCylinderType::TYPE:
-			free((void *)cyl[i].type.description);
 			cyl[i].type = cylIn.type;
-			cyl[i].type.description = copy_qstring(description);
+			cyl[i].type.description = intern_qstring(description);
 			cyl[i].cylinder_use = cylIn.cylinder_use;
 			break;
 		case EditCylinderType::PRESSURE:
@@ -1405,7 +1404,9 @@ void EditDive::exchangeDives()
 void EditDive::editDs()
 {
 	if (siteToEdit) {
-		std::swap(siteToEdit->location, dsLocation);
+		location_t old = siteToEdit->location;
+		set_dive_site_location(siteToEdit, &dsLocation);
+		dsLocation = old;
 		emit diveListNotifier.diveSiteChanged(siteToEdit, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 	}
 }
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0
 
 #include "command_edit_trip.h"
+#include "core/fulltext.h"
 #include "core/qthelper.h"
 #include "core/selection.h"
 
@@ -41,6 +42,7 @@ void EditTripLocation::set(dive_trip *t, const QString &s) const
 {
 	free(t->location);
 	t->location = copy_qstring(s);
+	fulltext_register_trip(t); // Update the fulltext cache
 }
 
 QString EditTripLocation::data(dive_trip *t) const
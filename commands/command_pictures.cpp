@@ -205,7 +205,9 @@ void AddPictures::swapDiveSites()
 	}
 
 	for (DiveSiteEditEntry &entry: sitesToEdit) {
-		std::swap(entry.ds->location, entry.location);
+		location_t old = entry.ds->location;
+		set_dive_site_location(entry.ds, &entry.location);
+		entry.location = old;
 		emit diveListNotifier.diveSiteChanged(entry.ds, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 	}
 }
@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "arena.h"
+#include "qthelper.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The first chunk is small, because the git loader uses one arena per dive.
+ * Each following chunk is twice as large as the previous one, up to a limit.
+ * Larger allocations get a chunk of their own.
+ */
+#define FIRST_CHUNK_SIZE 4096
+#define MAX_CHUNK_SIZE (1024 * 1024)
+#define ALIGNMENT 16
+
+struct chunk {
+	struct chunk *next;
+	size_t size, used;
+	unsigned char *data;
+};
+
+struct arena {
+	int refcount;
+	bool sealed;
+	size_t next_chunk_size;
+	size_t allocated;
+	struct chunk *chunks;	/* the current chunk first */
+	void *last;		/* the last allocation in the current chunk */
+};
+
+static size_t align(size_t size)
+{
+	return (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+}
+
+struct arena *arena_new(void)
+{
+	struct arena *arena = calloc(1, sizeof(*arena));
+	if (!arena)
+		return NULL;
+	arena->refcount = 1;
+	arena->next_chunk_size = FIRST_CHUNK_SIZE;
+	return arena;
+}
+
+struct arena *arena_ref(struct arena *arena)
+{
+	if (arena) {
+		lock_arena();
+		arena->refcount++;
+		unlock_arena();
+	}
+	return arena;
+}
+
+static void free_arena(struct arena *arena)
+{
+	struct chunk *chunk = arena->chunks;
+
+	while (chunk) {
+		struct chunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	free(arena);
+}
+
+void arena_unref(struct arena *arena)
+{
+	int refcount;
+
+	if (!arena)
+		return;
+	lock_arena();
+	refcount = --arena->refcount;
+	unlock_arena();
+	if (!refcount)
+		free_arena(arena);
+}
+
+void arena_seal(struct arena *arena)
+{
+	if (arena)
+		arena->sealed = true;
+}
+
+bool arena_sealed(const struct arena *arena)
+{
+	return arena && arena->sealed;
+}
+
+static struct chunk *new_chunk(struct arena *arena, size_t size)
+{
+	struct chunk *chunk;
+	size_t header = align(sizeof(struct chunk));
+
+	if (size < arena->next_chunk_size)
+		size = arena->next_chunk_size;
+	chunk = malloc(header + size);
+	if (!chunk)
+		return NULL;
+	chunk->size = size;
+	chunk->used = 0;
+	chunk->data = (unsigned char *)chunk + header;
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+	arena->allocated += size;
+	if (arena->next_chunk_size < MAX_CHUNK_SIZE)
+		arena->next_chunk_size *= 2;
+	return chunk;
+}
+
+/*
+ * Grow the current chunk, which contains only the last allocation. Since
+ * nothing else points into the chunk, it may be moved like a heap allocation.
+ */
+static void *realloc_chunk(struct arena *arena, size_t size)
+{
+	struct chunk *chunk = arena->chunks;
+	size_t header = align(sizeof(struct chunk));
+	size_t old_size = chunk->size, new_size = align(size + size / 2);
+
+	chunk = realloc(chunk, header + new_size);
+	if (!chunk)
+		return NULL;
+	chunk->size = new_size;
+	chunk->used = size;
+	chunk->data = (unsigned char *)chunk + header;
+	arena->chunks = chunk;
+	arena->allocated += new_size - old_size;
+	arena->last = chunk->data;
+	return arena->last;
+}
+
+/* If a new chunk is needed, make room for at least reserve bytes */
+static void *alloc_reserve(struct arena *arena, size_t size, size_t reserve)
+{
+	struct chunk *chunk = arena->chunks;
+
+	size = align(size ? size : 1);
+	if (!chunk || chunk->size - chunk->used < size) {
+		chunk = new_chunk(arena, reserve > size ? reserve : size);
+		if (!chunk)
+			return NULL;
+	}
+	arena->last = chunk->data + chunk->used;
+	chunk->used += size;
+	return arena->last;
+}
+
+void *arena_alloc(struct arena *arena, size_t size)
+{
+	return alloc_reserve(arena, size, 0);
+}
+
+void *arena_realloc(struct arena *arena, void *ptr, size_t old_size, size_t size)
+{
+	struct chunk *chunk = arena->chunks;
+	void *res;
+
+	if (!ptr)
+		return arena_alloc(arena, size);
+	if (ptr == arena->last) {
+		size_t start = (unsigned char *)ptr - chunk->data;
+		size_t new_size = align(size ? size : 1);
+		if (chunk->size - start >= new_size) {
+			chunk->used = start + new_size;
+			return ptr;
+		}
+		if (start == 0)
+			return realloc_chunk(arena, new_size);
+	}
+	if (size <= old_size)
+		return ptr;
+	/* Growing arrays are moved to a chunk where they can grow further */
+	res = alloc_reserve(arena, size, 2 * size);
+	if (res)
+		memcpy(res, ptr, old_size);
+	return res;
+}
+
+char *arena_strdup(struct arena *arena, const char *s)
+{
+	size_t len;
+	char *res;
+
+	if (!s)
+		return NULL;
+	len = strlen(s) + 1;
+	res = arena_alloc(arena, len);
+	if (res)
+		memcpy(res, s, len);
+	return res;
+}
+
+size_t arena_size(const struct arena *arena)
+{
+	return arena ? arena->allocated : 0;
+}
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-2.0
+
+// A simple region allocator for data that is created while loading a log and
+// that doesn't change size afterwards. Allocations are carved out of large
+// chunks and are never freed individually. Instead, the whole arena is freed
+// when its last user drops its reference. Thus, loading doesn't call malloc()
+// for every small object and closing a log doesn't call free() for them.
+//
+// Once loading is finished, the arena is sealed. The users of a sealed arena
+// must move the data they want to change onto the heap and drop their
+// reference, see unshare_dc_arena() in divecomputer.c.
+//
+// Allocating from an arena is not thread safe. Only the reference counting is.
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct arena;
+
+extern struct arena *arena_new(void); // Has one reference
+extern struct arena *arena_ref(struct arena *arena);
+extern void arena_unref(struct arena *arena);
+extern void arena_seal(struct arena *arena);
+extern bool arena_sealed(const struct arena *arena);
+
+extern void *arena_alloc(struct arena *arena, size_t size);
+// Resize an allocation. The last allocation of an arena is resized in place if possible.
+extern void *arena_realloc(struct arena *arena, void *ptr, size_t old_size, size_t size);
+extern char *arena_strdup(struct arena *arena, const char *s); // NULL for NULL
+extern size_t arena_size(const struct arena *arena); // Allocated bytes
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -16,6 +16,7 @@
 #include "dive.h"
 #include "file.h"
 #include "sample.h"
+#include "stringpool.h"
 #include "subsurface-time.h"
 #include "units.h"
 #include "sha1.h"
@@ -678,7 +679,7 @@ static void cochran_parse_dive(const unsigned char *decode, unsigned mod,
 	case TYPE_COMMANDER:
 		if (config.type == TYPE_GEMINI) {
 			cylinder_t cyl = empty_cylinder;
-			dc->model = "Gemini";
+			dc->model = intern_string("Gemini");
 			dc->deviceid = buf[0x18c] * 256 + buf[0x18d];	// serial no
 			fill_default_cylinder(dive, &cyl);
 			cyl.gasmix.o2.permille = (log[CMD_O2_PERCENT] / 256
@@ -686,7 +687,7 @@ static void cochran_parse_dive(const unsigned char *decode, unsigned mod,
 			cyl.gasmix.he.permille = 0;
 			add_cylinder(&dive->cylinders, 0, cyl);
 		} else {
-			dc->model = "Commander";
+			dc->model = intern_string("Commander");
 			dc->deviceid = array_uint32_le(buf + 0x31e);	// serial no
 			for (g = 0; g < 2; g++) {
 				cylinder_t cyl = empty_cylinder;
@@ -730,7 +731,7 @@ static void cochran_parse_dive(const unsigned char *decode, unsigned mod,
 
 		break;
 	case TYPE_EMC:
-		dc->model = "EMC";
+		dc->model = intern_string("EMC");
 		dc->deviceid = array_uint32_le(buf + 0x31e);	// serial no
 		for (g = 0; g < 4; g++) {
 			cylinder_t cyl = empty_cylinder;
@@ -12,6 +12,7 @@
 #include "gettext.h"
 #include "datatrak.h"
 #include "subsurface-string.h"
+#include "stringpool.h"
 #include "units.h"
 #include "device.h"
 #include "file.h"
@@ -338,7 +339,7 @@ static unsigned char *dt_dive_parser(unsigned char *runner, struct dive *dt_dive
 	if (tmp_2bytes != 0x7FFF) {
 		cylinder_t cyl = empty_cylinder;
 		cyl.type.size.mliter = tmp_2bytes * 10;
-		cyl.type.description = cyl_type_by_size(tmp_2bytes * 10);
+		cyl.type.description = intern_string(cyl_type_by_size(tmp_2bytes * 10));
 		cyl.start.mbar = 200000;
 		cyl.gasmix.he.permille = 0;
 		cyl.gasmix.o2.permille = 210;
@@ -521,7 +522,7 @@ static unsigned char *dt_dive_parser(unsigned char *runner, struct dive *dt_dive
 	libdc_model = dtrak_prepare_data(tmp_1byte, devdata);
 	if (!libdc_model)
 		report_error(translate("gettextFromC", "[Warning] Manual dive # %d\n"), dt_dive->number);
-	dt_dive->dc.model = copy_string(devdata->model);
+	dt_dive->dc.model = intern_string(devdata->model);
 
 	/*
 	 * Air usage, unknown use. Probably allows or deny manually entering gas
@@ -700,8 +701,7 @@ int datatrak_import(struct memblock *mem, struct memblock *wl_mem, struct dive_t
 		int compl_dives_n = wlog_header_parser(wl_mem);
 		if (compl_dives_n != numdives) {
 			report_error("ERROR: Not the same number of dives in .log %d and .add file %d.\nWill not parse .add file", numdives , compl_dives_n);
-			free(wl_mem->buffer);
-			wl_mem->buffer = NULL;
+			free_memblock(wl_mem);
 			wl_mem = NULL;
 		}
 	}
@@ -10,14 +10,16 @@
  *
  * add_segment()	- add <seconds> at the given pressure, breathing gasmix
  * deco_allowed_depth() - ceiling based on lead tissue, surface pressure, 3m increments or smooth
- * set_gf()		- set Buehlmann gradient factors
- * set_vpmb_conservatism() - set VPM-B conservatism value
+ * set_gf()		- set default Buehlmann gradient factors
+ * set_vpmb_conservatism() - set default VPM-B conservatism value
+ * init_deco_config()	- get the deco model settings for a calculation
  * clear_deco()
  * cache_deco_state()
  * restore_deco_state()
  * dump_tissues()
  */
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
@@ -28,7 +30,7 @@
 #include "subsurface-string.h"
 #include "errorhelper.h"
 #include "planner.h"
-#include "qthelper.h"
+#include "pref.h"
 
 #define cube(x) (x * x * x)
 
@@ -38,21 +40,18 @@
 #define subsurface_conservatism_factor 1.0
 
 //! Option structure for Buehlmann decompression.
+//! The gradient factors are user settings and stored in struct deco_config.
 struct buehlmann_config {
 	double satmult;			//! safety at inert gas accumulation as percentage of effect (more than 100).
 	double desatmult;		//! safety at inert gas depletion as percentage of effect (less than 100).
 	int last_deco_stop_in_mtr;	//! depth of last_deco_stop.
-	double gf_high;			//! gradient factor high (at surface).
-	double gf_low;			//! gradient factor low (at bottom/start of deco calculation).
 	double gf_low_position_min;	//! gf_low_position below surface_min_shallow.
 };
 
-struct buehlmann_config buehlmann_config = {
+static const struct buehlmann_config buehlmann_config = {
 	.satmult = 1.0,
 	.desatmult = 1.0,
 	.last_deco_stop_in_mtr =  0,
-	.gf_high = 0.75,
-	.gf_low = 0.35,
 	.gf_low_position_min = 1.0,
 };
 
@@ -66,10 +65,9 @@ struct vpmb_config {
 	double skin_compression_gammaC;   //! Skin compression gammaC (N / bar = m2).
 	double regeneration_time;         //! Time needed for the bubble to regenerate to the start radius (min).
 	double other_gases_pressure;      //! Always present pressure of other gasses in tissues (bar).
-	short conservatism;		  //! VPM-B conservatism level (0-4)
 };
 
-static struct vpmb_config vpmb_config = {
+static const struct vpmb_config vpmb_config = {
 	.crit_radius_N2 = 0.55,
 	.crit_radius_He = 0.45,
 	.crit_volume_lambda = 199.58,
@@ -78,7 +76,16 @@ static struct vpmb_config vpmb_config = {
 	.skin_compression_gammaC = 2.6040525,	// = 0.257 N/msw
 	.regeneration_time = 20160.0,
 	.other_gases_pressure = 0.1359888,
-	.conservatism = 3
+};
+
+/* The settings used for new calculations, unless overridden by the caller.
+ * Set from the preferences via set_gf() and set_vpmb_conservatism(). */
+static struct deco_config default_deco_config = {
+	.gf_low = 0.35,
+	.gf_high = 0.75,
+	.vpmb_conservatism = 3,
+	.deco_mode = BUEHLMANN,
+	.in_planner = false
 };
 
 static const double buehlmann_N2_a[] = { 1.1696, 1.0, 0.8618, 0.7562,
@@ -155,17 +162,22 @@ static const double vpmb_conservatism_lvls[] = { 1.0, 1.05, 1.12, 1.22, 1.35 };
 
 #define TISSUE_ARRAY_SZ sizeof(ds->tissue_n2_sat)
 
-static double get_crit_radius_He()
+static double water_vapour_pressure(const struct deco_state *ds)
 {
-	if (vpmb_config.conservatism <= 4)
-		return vpmb_config.crit_radius_He * vpmb_conservatism_lvls[vpmb_config.conservatism] * subsurface_conservatism_factor;
+	return ds->config.in_planner && ds->config.deco_mode == VPMB ? WV_PRESSURE_SCHREINER : WV_PRESSURE;
+}
+
+static double get_crit_radius_He(const struct deco_state *ds)
+{
+	if (ds->config.vpmb_conservatism >= 0 && ds->config.vpmb_conservatism <= 4)
+		return vpmb_config.crit_radius_He * vpmb_conservatism_lvls[ds->config.vpmb_conservatism] * subsurface_conservatism_factor;
 	return vpmb_config.crit_radius_He;
 }
 
-static double get_crit_radius_N2()
+static double get_crit_radius_N2(const struct deco_state *ds)
 {
-	if (vpmb_config.conservatism <= 4)
-		return vpmb_config.crit_radius_N2 * vpmb_conservatism_lvls[vpmb_config.conservatism] * subsurface_conservatism_factor;
+	if (ds->config.vpmb_conservatism >= 0 && ds->config.vpmb_conservatism <= 4)
+		return vpmb_config.crit_radius_N2 * vpmb_conservatism_lvls[ds->config.vpmb_conservatism] * subsurface_conservatism_factor;
 	return vpmb_config.crit_radius_N2;
 }
 
@@ -221,8 +233,8 @@ double tissue_tolerance_calc(struct deco_state *ds, const struct dive *dive, dou
 {
 	int ci = -1;
 	double ret_tolerance_limit_ambient_pressure = 0.0;
-	double gf_high = buehlmann_config.gf_high;
-	double gf_low = buehlmann_config.gf_low;
+	double gf_high = ds->config.gf_high;
+	double gf_low = ds->config.gf_low;
 	double surface = get_surface_pressure_in_mbar(dive, true) / 1000.0;
 	double lowest_ceiling = 0.0;
 	double tissue_lowest_ceiling[16];
@@ -232,32 +244,40 @@ double tissue_tolerance_calc(struct deco_state *ds, const struct dive *dive, dou
 		ds->buehlmann_inertgas_b[ci] = ((buehlmann_N2_b[ci] * ds->tissue_n2_sat[ci]) + (buehlmann_He_b[ci] * ds->tissue_he_sat[ci])) / ds->tissue_inertgas_saturation[ci];
 	}
 
-	if (decoMode() != VPMB) {
+	if (ds->config.deco_mode != VPMB) {
+		double gf_low_pressure;
+		double tissue_tolerated[16];
+		bool tissue_use_gf[16];
+
+		/* The loops over the tissues are split into branch-free parts, which can be
+		 * vectorized by the compiler, and the search for the leading tissue. */
 		for (ci = 0; ci < 16; ci++) {
 
 			/* tolerated = (tissue_inertgas_saturation - buehlmann_inertgas_a) * buehlmann_inertgas_b; */
 
 			tissue_lowest_ceiling[ci] = (ds->buehlmann_inertgas_b[ci] * ds->tissue_inertgas_saturation[ci] - gf_low * ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci]) /
 						     ((1.0 - ds->buehlmann_inertgas_b[ci]) * gf_low + ds->buehlmann_inertgas_b[ci]);
+		}
+		for (ci = 0; ci < 16; ci++) {
 			if (tissue_lowest_ceiling[ci] > lowest_ceiling)
 				lowest_ceiling = tissue_lowest_ceiling[ci];
-			if (lowest_ceiling > ds->gf_low_pressure_this_dive)
-				ds->gf_low_pressure_this_dive = lowest_ceiling;
 		}
-		for (ci = 0; ci < 16; ci++) {
-			double tolerated;
-
-			if ((surface / ds->buehlmann_inertgas_b[ci] + ds->buehlmann_inertgas_a[ci] - surface) * gf_high + surface <
-			    (ds->gf_low_pressure_this_dive / ds->buehlmann_inertgas_b[ci] + ds->buehlmann_inertgas_a[ci] - ds->gf_low_pressure_this_dive) * gf_low + ds->gf_low_pressure_this_dive)
-				tolerated = (-ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci] * (gf_high * ds->gf_low_pressure_this_dive - gf_low * surface) -
-					     (1.0 - ds->buehlmann_inertgas_b[ci]) * (gf_high - gf_low) * ds->gf_low_pressure_this_dive * surface +
-					     ds->buehlmann_inertgas_b[ci] * (ds->gf_low_pressure_this_dive - surface) * ds->tissue_inertgas_saturation[ci]) /
-					    (-ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci] * (gf_high - gf_low) +
-					     (1.0 - ds->buehlmann_inertgas_b[ci]) * (gf_low * ds->gf_low_pressure_this_dive - gf_high * surface) +
-					     ds->buehlmann_inertgas_b[ci] * (ds->gf_low_pressure_this_dive - surface));
-			else
-				tolerated = ret_tolerance_limit_ambient_pressure;
+		if (lowest_ceiling > ds->gf_low_pressure_this_dive)
+			ds->gf_low_pressure_this_dive = lowest_ceiling;
 
+		gf_low_pressure = ds->gf_low_pressure_this_dive;
+		for (ci = 0; ci < 16; ci++) {
+			tissue_use_gf[ci] = (surface / ds->buehlmann_inertgas_b[ci] + ds->buehlmann_inertgas_a[ci] - surface) * gf_high + surface <
+					    (gf_low_pressure / ds->buehlmann_inertgas_b[ci] + ds->buehlmann_inertgas_a[ci] - gf_low_pressure) * gf_low + gf_low_pressure;
+			tissue_tolerated[ci] = (-ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci] * (gf_high * gf_low_pressure - gf_low * surface) -
+						(1.0 - ds->buehlmann_inertgas_b[ci]) * (gf_high - gf_low) * gf_low_pressure * surface +
+						ds->buehlmann_inertgas_b[ci] * (gf_low_pressure - surface) * ds->tissue_inertgas_saturation[ci]) /
+					       (-ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci] * (gf_high - gf_low) +
+						(1.0 - ds->buehlmann_inertgas_b[ci]) * (gf_low * gf_low_pressure - gf_high * surface) +
+						ds->buehlmann_inertgas_b[ci] * (gf_low_pressure - surface));
+		}
+		for (ci = 0; ci < 16; ci++) {
+			double tolerated = tissue_use_gf[ci] ? tissue_tolerated[ci] : ret_tolerance_limit_ambient_pressure;
 
 			ds->tolerated_by_tissue[ci] = tolerated;
 
@@ -290,27 +310,32 @@ double tissue_tolerance_calc(struct deco_state *ds, const struct dive *dive, dou
 }
 
 /*
- * Return Buehlmann factor for a particular period and tissue index.
+ * Fill the Buehlmann factors for a particular period for all tissues.
+ * Since consecutive calls to add_segment() usually use the same period,
+ * the factors are cached in the deco state.
  */
-static double factor(int period_in_seconds, int ci, enum gas_component gas)
+static void update_factors(struct deco_state *ds, int period_in_seconds)
 {
+	int ci;
+
+	if (ds->factor_period == period_in_seconds)
+		return;
 	if (period_in_seconds == 1) {
-		if (gas == N2)
-			return buehlmann_N2_factor_expositon_one_second[ci];
-		else
-			return buehlmann_He_factor_expositon_one_second[ci];
+		memcpy(ds->n2_factor, buehlmann_N2_factor_expositon_one_second, sizeof(ds->n2_factor));
+		memcpy(ds->he_factor, buehlmann_He_factor_expositon_one_second, sizeof(ds->he_factor));
+	} else {
+		// ln(2)/60 = 1.155245301e-02
+		for (ci = 0; ci < 16; ci++) {
+			ds->n2_factor[ci] = 1.0 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_N2_t_halflife[ci]);
+			ds->he_factor[ci] = 1.0 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_He_t_halflife[ci]);
+		}
 	}
-
-	// ln(2)/60 = 1.155245301e-02
-	if (gas == N2)
-		return 1.0 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_N2_t_halflife[ci]);
-	else
-		return 1.0 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_He_t_halflife[ci]);
+	ds->factor_period = period_in_seconds;
 }
 
-static double calc_surface_phase(double surface_pressure, double he_pressure, double n2_pressure, double he_time_constant, double n2_time_constant)
+static double calc_surface_phase(const struct deco_state *ds, double surface_pressure, double he_pressure, double n2_pressure, double he_time_constant, double n2_time_constant)
 {
-	double inspired_n2 = (surface_pressure - ((in_planner() && (decoMode() == VPMB)) ? WV_PRESSURE_SCHREINER : WV_PRESSURE)) * NITROGEN_FRACTION;
+	double inspired_n2 = (surface_pressure - water_vapour_pressure(ds)) * NITROGEN_FRACTION;
 
 	if (n2_pressure > inspired_n2)
 		return (he_pressure / he_time_constant + (n2_pressure - inspired_n2) / n2_time_constant) / (he_pressure + n2_pressure - inspired_n2);
@@ -343,7 +368,7 @@ void vpmb_next_gradient(struct deco_state *ds, double deco_time, double surface_
 	deco_time /= 60.0;
 
 	for (ci = 0; ci < 16; ++ci) {
-		desat_time = deco_time + calc_surface_phase(surface_pressure, ds->tissue_he_sat[ci], ds->tissue_n2_sat[ci], log(2.0) / buehlmann_He_t_halflife[ci], log(2.0) / buehlmann_N2_t_halflife[ci]);
+		desat_time = deco_time + calc_surface_phase(ds, surface_pressure, ds->tissue_he_sat[ci], ds->tissue_n2_sat[ci], log(2.0) / buehlmann_He_t_halflife[ci], log(2.0) / buehlmann_N2_t_halflife[ci]);
 
 		n2_b = ds->initial_n2_gradient[ci] + (vpmb_config.crit_volume_lambda * vpmb_config.surface_tension_gamma) / (vpmb_config.skin_compression_gammaC * desat_time);
 		he_b = ds->initial_he_gradient[ci] + (vpmb_config.crit_volume_lambda * vpmb_config.surface_tension_gamma) / (vpmb_config.skin_compression_gammaC * desat_time);
@@ -385,13 +410,15 @@ void nuclear_regeneration(struct deco_state *ds, double time)
 	time /= 60.0;
 	int ci;
 	double crushing_radius_N2, crushing_radius_He;
+	double crit_radius_N2 = get_crit_radius_N2(ds);
+	double crit_radius_He = get_crit_radius_He(ds);
 	for (ci = 0; ci < 16; ++ci) {
 		//rm
-		crushing_radius_N2 = 1.0 / (ds->max_n2_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / get_crit_radius_N2());
-		crushing_radius_He = 1.0 / (ds->max_he_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / get_crit_radius_He());
+		crushing_radius_N2 = 1.0 / (ds->max_n2_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / crit_radius_N2);
+		crushing_radius_He = 1.0 / (ds->max_he_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / crit_radius_He);
 		//rs
-		ds->n2_regen_radius[ci] = crushing_radius_N2 + (get_crit_radius_N2() - crushing_radius_N2) * (1.0 - exp (-time / vpmb_config.regeneration_time));
-		ds->he_regen_radius[ci] = crushing_radius_He + (get_crit_radius_He() - crushing_radius_He) * (1.0 - exp (-time / vpmb_config.regeneration_time));
+		ds->n2_regen_radius[ci] = crushing_radius_N2 + (crit_radius_N2 - crushing_radius_N2) * (1.0 - exp (-time / vpmb_config.regeneration_time));
+		ds->he_regen_radius[ci] = crushing_radius_He + (crit_radius_He - crushing_radius_He) * (1.0 - exp (-time / vpmb_config.regeneration_time));
 	}
 }
 
@@ -431,8 +458,8 @@ void calc_crushing_pressure(struct deco_state *ds, double pressure)
 			if (ds->max_ambient_pressure >= pressure)
 				return;
 
-			n2_inner_pressure = calc_inner_pressure(get_crit_radius_N2(), ds->crushing_onset_tension[ci], pressure);
-			he_inner_pressure = calc_inner_pressure(get_crit_radius_He(), ds->crushing_onset_tension[ci], pressure);
+			n2_inner_pressure = calc_inner_pressure(get_crit_radius_N2(ds), ds->crushing_onset_tension[ci], pressure);
+			he_inner_pressure = calc_inner_pressure(get_crit_radius_He(ds), ds->crushing_onset_tension[ci], pressure);
 
 			n2_crushing_pressure = pressure - n2_inner_pressure;
 			he_crushing_pressure = pressure - he_inner_pressure;
@@ -450,28 +477,34 @@ void add_segment(struct deco_state *ds, double pressure, struct gasmix gasmix, i
 	int ci;
 	struct gas_pressures pressures;
 	bool icd = false;
-	fill_pressures(&pressures, pressure - ((in_planner() && (decoMode() == VPMB)) ? WV_PRESSURE_SCHREINER : WV_PRESSURE),
+	double satmult = buehlmann_config.satmult;
+	double desatmult = buehlmann_config.desatmult;
+	fill_pressures(&pressures, pressure - water_vapour_pressure(ds),
 		       gasmix, (double) ccpo2 / 1000.0, divemode);
+	update_factors(ds, period_in_seconds);
 
-	for (ci = 0; ci < 16; ci++) {
+	// Report ICD if N2 is more on-gasing than He off-gasing in leading tissue
+	ci = ds->ci_pointing_to_guiding_tissue;
+	if (ci >= 0 && ci < 16) {
 		double pn2_oversat = pressures.n2 - ds->tissue_n2_sat[ci];
 		double phe_oversat = pressures.he - ds->tissue_he_sat[ci];
-		double n2_f = factor(period_in_seconds, ci, N2);
-		double he_f = factor(period_in_seconds, ci, HE);
-		double n2_satmult = pn2_oversat > 0 ? buehlmann_config.satmult : buehlmann_config.desatmult;
-		double he_satmult = phe_oversat > 0 ? buehlmann_config.satmult : buehlmann_config.desatmult;
-
-		// Report ICD if N2 is more on-gasing than He off-gasing in leading tissue
-		if (ci == ds->ci_pointing_to_guiding_tissue && pn2_oversat > 0.0 && phe_oversat < 0.0 &&
-		    pn2_oversat * n2_satmult * n2_f + phe_oversat * he_satmult * he_f > 0)
+		if (pn2_oversat > 0.0 && phe_oversat < 0.0 &&
+		    pn2_oversat * satmult * ds->n2_factor[ci] + phe_oversat * desatmult * ds->he_factor[ci] > 0)
 			icd = true;
+	}
 
-		ds->tissue_n2_sat[ci] += n2_satmult * pn2_oversat * n2_f;
-		ds->tissue_he_sat[ci] += he_satmult * phe_oversat * he_f;
-		ds->tissue_inertgas_saturation[ci] = ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci];
+	// No branches and no function calls in this loop, so that the compiler can vectorize it
+	for (ci = 0; ci < 16; ci++) {
+		double pn2_oversat = pressures.n2 - ds->tissue_n2_sat[ci];
+		double phe_oversat = pressures.he - ds->tissue_he_sat[ci];
+		double n2_satmult = pn2_oversat > 0 ? satmult : desatmult;
+		double he_satmult = phe_oversat > 0 ? satmult : desatmult;
 
+		ds->tissue_n2_sat[ci] += n2_satmult * pn2_oversat * ds->n2_factor[ci];
+		ds->tissue_he_sat[ci] += he_satmult * phe_oversat * ds->he_factor[ci];
+		ds->tissue_inertgas_saturation[ci] = ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci];
 	}
-	if (decoMode() == VPMB)
+	if (ds->config.deco_mode == VPMB)
 		calc_crushing_pressure(ds, pressure);
 	ds->icd_warning = icd;
 	return;
@@ -503,19 +536,22 @@ void clear_vpmb_state(struct deco_state *ds)
 	ds->max_bottom_ceiling_pressure.mbar = 0;
 }
 
-void clear_deco(struct deco_state *ds, double surface_pressure)
+/* Note: config may point to the config of ds itself */
+void clear_deco(struct deco_state *ds, double surface_pressure, const struct deco_config *config)
 {
 	int ci;
+	struct deco_config new_config = *config;
 
 	memset(ds, 0, sizeof(*ds));
+	ds->config = new_config;
 	clear_vpmb_state(ds);
 	for (ci = 0; ci < 16; ci++) {
-		ds->tissue_n2_sat[ci] = (surface_pressure - ((in_planner() && (decoMode() == VPMB)) ? WV_PRESSURE_SCHREINER : WV_PRESSURE)) * N2_IN_AIR / 1000;
+		ds->tissue_n2_sat[ci] = (surface_pressure - water_vapour_pressure(ds)) * N2_IN_AIR / 1000;
 		ds->tissue_he_sat[ci] = 0.0;
 		ds->max_n2_crushing_pressure[ci] = 0.0;
 		ds->max_he_crushing_pressure[ci] = 0.0;
-		ds->n2_regen_radius[ci] = get_crit_radius_N2();
-		ds->he_regen_radius[ci] = get_crit_radius_He();
+		ds->n2_regen_radius[ci] = get_crit_radius_N2(ds);
+		ds->he_regen_radius[ci] = get_crit_radius_He(ds);
 	}
 	ds->gf_low_pressure_this_dive = surface_pressure + buehlmann_config.gf_low_position_min;
 	ds->max_ambient_pressure = 0.0;
@@ -569,29 +605,59 @@ int deco_allowed_depth(double tissues_tolerance, double surface_pressure, const
 	return depth;
 }
 
-void set_gf(short gflow, short gfhigh)
+void set_deco_config_gf(struct deco_config *config, short gflow, short gfhigh)
 {
 	if (gflow != -1)
-		buehlmann_config.gf_low = (double)gflow / 100.0;
+		config->gf_low = (double)gflow / 100.0;
 	if (gfhigh != -1)
-		buehlmann_config.gf_high = (double)gfhigh / 100.0;
+		config->gf_high = (double)gfhigh / 100.0;
 }
 
-void set_vpmb_conservatism(short conservatism)
+void set_deco_config_vpmb_conservatism(struct deco_config *config, short conservatism)
 {
 	if (conservatism < 0)
-		vpmb_config.conservatism = 0;
+		config->vpmb_conservatism = 0;
 	else if (conservatism > 4)
-		vpmb_config.conservatism = 4;
+		config->vpmb_conservatism = 4;
 	else
-		vpmb_config.conservatism = conservatism;
+		config->vpmb_conservatism = conservatism;
+}
+
+void set_gf(short gflow, short gfhigh)
+{
+	set_deco_config_gf(&default_deco_config, gflow, gfhigh);
+}
+
+void set_vpmb_conservatism(short conservatism)
+{
+	set_deco_config_vpmb_conservatism(&default_deco_config, conservatism);
+}
+
+/* Fill out the settings of the deco model for a new calculation.
+ * This accesses global state and therefore should be called from
+ * the UI thread. The resulting settings are passed to clear_deco()
+ * and become part of the deco state. */
+void init_deco_config(struct deco_config *config, bool in_planner)
+{
+	*config = default_deco_config;
+	config->in_planner = in_planner;
+	config->deco_mode = in_planner ? prefs.planner_deco_mode : prefs.display_deco_mode;
+}
+
+bool same_deco_config(const struct deco_config *a, const struct deco_config *b)
+{
+	return a->gf_low == b->gf_low &&
+	       a->gf_high == b->gf_high &&
+	       a->vpmb_conservatism == b->vpmb_conservatism &&
+	       a->deco_mode == b->deco_mode &&
+	       a->in_planner == b->in_planner;
 }
 
 double get_gf(struct deco_state *ds, double ambpressure_bar, const struct dive *dive)
 {
 	double surface_pressure_bar = get_surface_pressure_in_mbar(dive, true) / 1000.0;
-	double gf_low = buehlmann_config.gf_low;
-	double gf_high = buehlmann_config.gf_high;
+	double gf_low = ds->config.gf_low;
+	double gf_high = ds->config.gf_high;
 	double gf;
 	if (ds->gf_low_pressure_this_dive > surface_pressure_bar)
 		gf = MAX((double)gf_low, (ambpressure_bar - surface_pressure_bar) /
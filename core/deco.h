@@ -5,6 +5,7 @@
 #include "units.h"
 #include "gas.h"
 #include "divemode.h"
+#include "pref.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,7 +15,18 @@ struct dive;
 struct divecomputer;
 struct decostop;
 
+/* Settings of the deco model. These are part of the deco state, so that the
+ * deco calculations don't depend on global state and can run in parallel. */
+struct deco_config {
+	double gf_low;			// gradient factor low (at bottom/start of deco calculation)
+	double gf_high;			// gradient factor high (at surface)
+	short vpmb_conservatism;	// VPM-B conservatism level (0-4)
+	enum deco_mode deco_mode;
+	bool in_planner;		// VPM-B in the planner uses the Schreiner value for water vapour
+};
+
 struct deco_state {
+	struct deco_config config;
 	double tissue_n2_sat[16];
 	double tissue_he_sat[16];
 	double tolerated_by_tissue[16];
@@ -45,6 +57,11 @@ struct deco_state {
 	long sumx, sumxx;
 	double sumy, sumxy;
 	int plot_depth;
+
+	/* Buehlmann factors for the last period passed to add_segment() */
+	int factor_period;
+	double n2_factor[16];
+	double he_factor[16];
 };
 
 extern const double buehlmann_N2_t_halflife[];
@@ -52,10 +69,14 @@ extern const double buehlmann_N2_t_halflife[];
 extern int deco_allowed_depth(double tissues_tolerance, double surface_pressure, const struct dive *dive, bool smooth);
 
 double get_gf(struct deco_state *ds, double ambpressure_bar, const struct dive *dive);
-extern void clear_deco(struct deco_state *ds, double surface_pressure);
+extern void clear_deco(struct deco_state *ds, double surface_pressure, const struct deco_config *config);
 extern void dump_tissues(struct deco_state *ds);
 extern void set_gf(short gflow, short gfhigh);
 extern void set_vpmb_conservatism(short conservatism);
+extern void init_deco_config(struct deco_config *config, bool in_planner);
+extern void set_deco_config_gf(struct deco_config *config, short gflow, short gfhigh);
+extern void set_deco_config_vpmb_conservatism(struct deco_config *config, short conservatism);
+extern bool same_deco_config(const struct deco_config *a, const struct deco_config *b);
 extern void cache_deco_state(struct deco_state *source, struct deco_state **datap);
 extern void restore_deco_state(struct deco_state *data, struct deco_state *target, bool keep_vpmb_state);
 extern void nuclear_regeneration(struct deco_state *ds, double time);
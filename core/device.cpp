@@ -5,6 +5,7 @@
 #include "device.h"
 #include "errorhelper.h" // for verbose flag
 #include "selection.h"
+#include "stringpool.h"
 #include "core/settings/qPrefDiveComputer.h"
 #include <QString> // for QString::number
 
@@ -67,14 +68,10 @@ extern "C" void set_dc_deviceid(struct divecomputer *dc, unsigned int deviceid,
 	if (!node)
 		return;
 
-	if (!node->serialNumber.empty() && empty_string(dc->serial)) {
-		free((void *)dc->serial);
-		dc->serial = strdup(node->serialNumber.c_str());
-	}
-	if (!node->firmware.empty() && empty_string(dc->fw_version)) {
-		free((void *)dc->fw_version);
-		dc->fw_version = strdup(node->firmware.c_str());
-	}
+	if (!node->serialNumber.empty() && empty_string(dc->serial))
+		dc->serial = intern_string(node->serialNumber.c_str());
+	if (!node->firmware.empty() && empty_string(dc->fw_version))
+		dc->fw_version = intern_string(node->firmware.c_str());
 }
 
 void device::showchanges(const std::string &n, const std::string &s, const std::string &f) const
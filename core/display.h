@@ -3,6 +3,7 @@
 #define DISPLAY_H
 
 #include "libdivecomputer.h"
+#include "pref.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,6 +25,10 @@ struct plot_info {
 	bool waypoint_above_ceiling;
 	struct plot_data *entry;
 	struct plot_pressure_data *pressures; /* cylinders.nr blocks of nr entries. */
+	enum deco_mode deco_mode; /* the deco model of the ceilings and tissues */
+	unsigned int channels; /* optional data, see enum plot_channel */
+	struct plot_tissue_data *tissues; /* nr entries if PLOT_CHANNEL_TISSUES is set, otherwise NULL */
+	struct plot_gas_depth_data *gas_depths; /* nr entries if PLOT_CHANNEL_GAS_DEPTHS is set, otherwise NULL */
 };
 
 extern struct divecomputer *select_dc(struct dive *);
@@ -14,16 +14,19 @@
 #include "divesite.h"
 #include "errorhelper.h"
 #include "event.h"
+#include "eventindex.h"
 #include "extradata.h"
 #include "interpolate.h"
 #include "qthelper.h"
 #include "membuffer.h"
 #include "picture.h"
 #include "sample.h"
+#include "stringpool.h"
 #include "tag.h"
 #include "trip.h"
 #include "structured_list.h"
 #include "fulltext.h"
+#include "idindex.h"
 
 /* one could argue about the best place to have this variable -
  * it's used in the UI, but it seems to make the most sense to have it
@@ -57,10 +60,11 @@ static int calculate_depth_to_mbar(int depth, pressure_t surface_pressure, int s
 int legacy_format_o2pressures(const struct dive *dive, const struct divecomputer *dc)
 {
 	int i, o2sensor;
+	const struct sample *samples = get_dc_samples(dc);
 
 	o2sensor = (dc->divemode == CCR) ? get_cylinder_idx_by_use(dive, OXYGEN) : -1;
 	for (i = 0; i < dc->samples; i++) {
-		const struct sample *s = dc->sample + i;
+		const struct sample *s = samples + i;
 		int seen_pressure = 0, idx;
 
 		for (idx = 0; idx < MAX_SENSORS; idx++) {
@@ -71,11 +75,14 @@ int legacy_format_o2pressures(const struct dive *dive, const struct divecomputer
 				continue;
 			if (sensor == o2sensor)
 				continue;
-			if (seen_pressure)
+			if (seen_pressure) {
+				put_dc_samples(dc, samples);
 				return -1;
+			}
 			seen_pressure = 1;
 		}
 	}
+	put_dc_samples(dc, samples);
 
 	/*
 	 * Use legacy mode: if we have no O2 sensor we return a
@@ -181,7 +188,7 @@ struct dive *alloc_dive(void)
 /* copy an element in a list of dive computer extra data */
 static void copy_extra_data(struct extra_data *sed, struct extra_data *ded)
 {
-	ded->key = copy_string(sed->key);
+	ded->key = sed->key;
 	ded->value = copy_string(sed->value);
 }
 
@@ -190,9 +197,8 @@ static void copy_extra_data(struct extra_data *sed, struct extra_data *ded)
 static void copy_dc(const struct divecomputer *sdc, struct divecomputer *ddc)
 {
 	*ddc = *sdc;
-	ddc->model = copy_string(sdc->model);
-	ddc->serial = copy_string(sdc->serial);
-	ddc->fw_version = copy_string(sdc->fw_version);
+	ddc->event_index = NULL;
+	ddc->arena = NULL;
 	copy_samples(sdc, ddc);
 	copy_events(sdc, ddc);
 	STRUCTURED_LIST_COPY(struct extra_data, sdc->extra_data, ddc->extra_data, copy_extra_data);
@@ -222,6 +228,7 @@ static void free_dive_structures(struct dive *d)
 	if (!d)
 		return;
 	fulltext_unregister(d);
+	free(d->deco_cache);
 	/* free the strings */
 	free(d->buddy);
 	free(d->divemaster);
@@ -270,6 +277,7 @@ static void copy_dive_nodc(const struct dive *s, struct dive *d)
 	memset(&d->weightsystems, 0, sizeof(d->weightsystems));
 	memset(&d->pictures, 0, sizeof(d->pictures));
 	d->full_text = NULL;
+	d->deco_cache = NULL;
 	invalidate_dive_cache(d);
 	d->buddy = copy_string(s->buddy);
 	d->divemaster = copy_string(s->divemaster);
@@ -290,6 +298,14 @@ void copy_dive(const struct dive *s, struct dive *d)
 	STRUCTURED_LIST_COPY(struct divecomputer, s->dc.next, d->dc.next, copy_dc);
 }
 
+void expand_dive_samples(const struct dive *dive)
+{
+	const struct divecomputer *dc;
+
+	for_each_dc(dive, dc)
+		expand_dc_samples(dc);
+}
+
 static void copy_dive_onedc(const struct dive *s, const struct divecomputer *sdc, struct dive *d)
 {
 	copy_dive_nodc(s, d);
@@ -613,7 +629,7 @@ int explicit_first_cylinder(const struct dive *dive, const struct divecomputer *
 	if (!dive->cylinders.nr)
 		return -1;
 	if (dc) {
-		const struct event *ev = get_next_event(dc->events, "gaschange");
+		const struct event *ev = get_first_dc_event(dc, EVENT_ID_GASCHANGE);
 		if (ev && ((dc->sample && ev->time.seconds == dc->sample[0].time.seconds) || ev->time.seconds <= 1))
 			res = get_cylinder_index(dive, ev);
 		else if (dc->divemode == CCR)
@@ -685,7 +701,7 @@ static void match_standard_cylinder(cylinder_type_t *type)
 	double cuft, bar;
 	int psi, len;
 	const char *fmt;
-	char buffer[40], *p;
+	char buffer[40];
 
 	/* Do we already have a cylinder description? */
 	if (type->description)
@@ -716,11 +732,7 @@ static void match_standard_cylinder(cylinder_type_t *type)
 		return;
 	}
 	len = snprintf(buffer, sizeof(buffer), fmt, (int)lrint(cuft));
-	p = malloc(len + 1);
-	if (!p)
-		return;
-	memcpy(p, buffer, len + 1);
-	type->description = p;
+	type->description = intern_string_len(buffer, len);
 }
 
 /*
@@ -930,6 +942,7 @@ static void fixup_dc_events(struct divecomputer *dc)
 			event = event->next;
 		}
 	}
+	invalidate_event_index(dc);
 }
 
 static int interpolate_depth(struct divecomputer *dc, int idx, int lastdepth, int lasttime, int now)
@@ -1174,6 +1187,7 @@ static void fixup_dc_gasswitch(struct dive *dive, struct divecomputer *dc)
 		/* Delete this event and try the next one */
 		*evp = event->next;
 	}
+	invalidate_event_index(dc);
 }
 
 static void fixup_no_o2sensors(struct divecomputer *dc)
@@ -1824,7 +1838,7 @@ static void merge_one_cylinder(cylinder_t *a, const cylinder_t *b)
 	if (!a->type.workingpressure.mbar)
 		a->type.workingpressure.mbar = b->type.workingpressure.mbar;
 	if (empty_string(a->type.description))
-		a->type.description = copy_string(b->type.description);
+		a->type.description = b->type.description;
 
 	/* If either cylinder has manually entered pressures, try to merge them.
 	 * Use pressures from divecomputer samples if only one cylinder has such a value.
@@ -2385,7 +2399,7 @@ static int might_be_same_device(const struct divecomputer *a, const struct divec
 		return 1;
 
 	/* Otherwise at least the model names have to match */
-	if (strcasecmp(a->model, b->model))
+	if (a->model != b->model && strcasecmp(a->model, b->model))
 		return 0;
 
 	/* No device ID? Match */
@@ -2434,13 +2448,13 @@ static const struct divecomputer *find_matching_computer(const struct divecomput
 static void copy_dive_computer(struct divecomputer *res, const struct divecomputer *a)
 {
 	*res = *a;
-	res->model = copy_string(a->model);
-	res->serial = copy_string(a->serial);
-	res->fw_version = copy_string(a->fw_version);
 	STRUCTURED_LIST_COPY(struct extra_data, a->extra_data, res->extra_data, copy_extra_data);
 	res->samples = res->alloc_samples = 0;
 	res->sample = NULL;
+	res->packed_samples = NULL;
 	res->events = NULL;
+	res->event_index = NULL;
+	res->arena = NULL;
 	res->next = NULL;
 }
 
@@ -2781,6 +2795,8 @@ static int split_dive_at(const struct dive *dive, int a, int b, struct dive **ou
 				event->time.seconds -= t;
 			}
 		}
+		invalidate_event_index(dc1);
+		invalidate_event_index(dc2);
 		dc1 = dc1->next;
 		dc2 = dc2->next;
 	}
@@ -3147,6 +3163,12 @@ fraction_t best_he(depth_t depth, const struct dive *dive, bool o2narcotic, frac
 void invalidate_dive_cache(struct dive *dive)
 {
 	memset(dive->git_id, 0, 20);
+	/* The cached tissue state of this dive is stale. The cached states of
+	 * the following dives in the chain are detected as such in init_decompression(). */
+	lock_deco_cache();
+	free(dive->deco_cache);
+	dive->deco_cache = NULL;
+	unlock_deco_cache();
 }
 
 bool dive_cache_is_valid(const struct dive *dive)
@@ -3322,13 +3344,7 @@ const struct divecomputer *get_dive_dc_const(const struct dive *dive, int nr)
 
 struct dive *get_dive_by_uniq_id(int id)
 {
-	int i;
-	struct dive *dive = NULL;
-
-	for_each_dive (i, dive) {
-		if (dive->id == id)
-			break;
-	}
+	struct dive *dive = id_index_get(ID_INDEX_DIVE, id);
 #ifdef DEBUG
 	if (dive == NULL) {
 		fprintf(stderr, "Invalid id %x passed to get_dive_by_diveid, try to fix the code\n", id);
@@ -3340,20 +3356,14 @@ struct dive *get_dive_by_uniq_id(int id)
 
 int get_idx_by_uniq_id(int id)
 {
-	int i;
-	struct dive *dive = NULL;
-
-	for_each_dive (i, dive) {
-		if (dive->id == id)
-			break;
-	}
+	struct dive *dive = id_index_get(ID_INDEX_DIVE, id);
 #ifdef DEBUG
 	if (dive == NULL) {
 		fprintf(stderr, "Invalid id %x passed to get_dive_by_diveid, try to fix the code\n", id);
 		exit(1);
 	}
 #endif
-	return i;
+	return dive ? get_idx_in_global_dive_table(dive) : dive_table.nr;
 }
 
 bool dive_site_has_gps_location(const struct dive_site *ds)
@@ -3429,7 +3439,7 @@ struct gasmix get_gasmix(const struct dive *dive, const struct divecomputer *dc,
 		/* on first invocation, get initial gas mix and first event (if any) */
 		int cyl = explicit_first_cylinder(dive, dc);
 		res = get_cylinder(dive, cyl)->gasmix;
-		ev = dc ? get_next_event(dc->events, "gaschange") : NULL;
+		ev = get_first_dc_event(dc, EVENT_ID_GASCHANGE);
 	} else {
 		res = gasmix;
 	}
@@ -3446,7 +3456,14 @@ struct gasmix get_gasmix(const struct dive *dive, const struct divecomputer *dc,
 /* If there is a gasswitch at that time, it returns the new gasmix */
 struct gasmix get_gasmix_at_time(const struct dive *d, const struct divecomputer *dc, duration_t time)
 {
-	const struct event *ev = NULL;
-	struct gasmix gasmix = gasmix_air;
-	return get_gasmix(d, dc, time.seconds, &ev, gasmix);
+	const struct event *ev;
+
+	/* if there is no cylinder, return air */
+	if (d->cylinders.nr <= 0)
+		return gasmix_air;
+
+	ev = get_last_dc_event_at(dc, EVENT_ID_GASCHANGE, time.seconds);
+	if (ev)
+		return get_gasmix_from_event(d, ev);
+	return get_cylinder(d, explicit_first_cylinder(d, dc))->gasmix;
 }
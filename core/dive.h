@@ -25,6 +25,7 @@ struct dive_site_table;
 struct dive_table;
 struct dive_trip;
 struct full_text_cache;
+struct deco_cache;
 struct event;
 struct trip_table;
 struct dive {
@@ -58,6 +59,7 @@ struct dive {
 	bool selected;
 	bool hidden_by_filter;
 	struct full_text_cache *full_text; /* word cache for full text search */
+	struct deco_cache *deco_cache; /* tissue state at surfacing, see init_decompression() */
 	bool invalid;
 };
 
@@ -168,6 +170,7 @@ extern void free_dive(struct dive *);
 extern void record_dive_to_table(struct dive *dive, struct dive_table *table);
 extern void clear_dive(struct dive *dive);
 extern void copy_dive(const struct dive *s, struct dive *d);
+extern void expand_dive_samples(const struct dive *dive);
 extern void selective_copy_dive(const struct dive *s, struct dive *d, struct dive_components what, bool clear);
 extern struct dive *move_dive(struct dive *s);
 
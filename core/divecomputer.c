@@ -1,10 +1,15 @@
 // SPDX-License-Identifier: GPL-2.0
 
 #include "divecomputer.h"
+#include "arena.h"
 #include "event.h"
+#include "eventindex.h"
 #include "extradata.h"
+#include "packedsamples.h"
 #include "pref.h"
+#include "qthelper.h"
 #include "sample.h"
+#include "stringpool.h"
 #include "structured_list.h"
 #include "subsurface-string.h"
 
@@ -205,7 +210,7 @@ enum divemode_t get_current_divemode(const struct divecomputer *dc, int time, co
 	if (dc) {
 		if (*divemode == UNDEF_COMP_TYPE) {
 			*divemode = dc->divemode;
-			ev = get_next_event(dc->events, "modechange");
+			ev = get_first_dc_event(dc, EVENT_ID_MODECHANGE);
 		}
 	} else {
 		ev = NULL;
@@ -218,6 +223,17 @@ enum divemode_t get_current_divemode(const struct divecomputer *dc, int time, co
 	return *divemode;
 }
 
+/* Find the divemode at time 'time' (in seconds) into the dive. Like get_current_divemode(),
+ * a divemode-change event only applies after the time of the event. */
+enum divemode_t get_divemode_at_time(const struct divecomputer *dc, int time)
+{
+	const struct event *ev;
+	if (!dc)
+		return UNDEF_COMP_TYPE;
+	ev = get_last_dc_event_at(dc, EVENT_ID_MODECHANGE, time - 1);
+	return ev ? (enum divemode_t) ev->value : dc->divemode;
+}
+
 
 /* helper function to make it easier to work with our structures
  * we don't interpolate here, just use the value from the last sample up to that time */
@@ -242,13 +258,160 @@ void free_dive_dcs(struct divecomputer *dc)
 	STRUCTURED_LIST_FREE(struct divecomputer, dc->next, free_dc);
 }
 
+/*
+ * Allocate the samples and the extra data of a dive computer that is being
+ * loaded from the arena of the loader. This is only done for dive computers
+ * that have neither, so that either all or none of them are in the arena.
+ */
+void set_dc_arena(struct divecomputer *dc, struct arena *arena)
+{
+	if (!arena || arena_sealed(arena) || dc->arena || dc->sample || dc->packed_samples || dc->extra_data)
+		return;
+	dc->arena = arena_ref(arena);
+}
+
+static void free_extra_data(struct extra_data *ed)
+{
+	free((void *)ed->value);
+}
+
+/*
+ * Move the samples and the extra data out of the arena before they are changed.
+ * The extra data is copied into a new list, which replaces the old one only if
+ * all allocations succeeded. Otherwise, the extra data is lost, like the samples,
+ * since nothing may point into the arena after it is released.
+ */
+static void unshare_dc_arena(struct divecomputer *dc)
+{
+	struct extra_data *ed, *extra_data = NULL, **p = &extra_data;
+
+	if (!dc->arena)
+		return;
+	if (dc->sample) {
+		struct sample *sample = malloc(dc->alloc_samples * sizeof(struct sample));
+		if (sample)
+			memcpy(sample, dc->sample, dc->samples * sizeof(struct sample));
+		else
+			dc->samples = dc->alloc_samples = 0;
+		dc->sample = sample;
+	}
+	for (ed = dc->extra_data; ed; ed = ed->next) {
+		*p = malloc(sizeof(struct extra_data));
+		if (!*p)
+			break;
+		(*p)->key = ed->key;
+		(*p)->value = copy_string(ed->value);
+		(*p)->next = NULL;
+		if (ed->value && !(*p)->value)
+			break;
+		p = &(*p)->next;
+	}
+	while (ed && extra_data) {
+		struct extra_data *next = extra_data->next;
+		free_extra_data(extra_data);
+		free(extra_data);
+		extra_data = next;
+	}
+	dc->extra_data = extra_data;
+	arena_unref(dc->arena);
+	dc->arena = NULL;
+}
+
+/* Replace the compressed samples by a normal sample array */
+static void unpack_dc_samples(struct divecomputer *dc)
+{
+	struct sample *sample;
+	int nr = packed_samples_nr(dc->packed_samples);
+
+	if (!dc->packed_samples)
+		return;
+	/* If the allocation fails, the samples are lost, as in alloc_samples() */
+	sample = malloc(nr * sizeof(struct sample));
+	if (sample)
+		unpack_samples(dc->packed_samples, sample);
+	else
+		nr = 0;
+	free_packed_samples(dc->packed_samples);
+	dc->packed_samples = NULL;
+	dc->sample = sample;
+	dc->samples = dc->alloc_samples = nr;
+}
+
+/*
+ * Compress the samples of a dive computer, for dives that are not looked at.
+ * Code that accesses dc->sample directly must call expand_dc_samples() first.
+ * Code that only reads the samples can use get_dc_samples(), which leaves
+ * the samples compressed. The functions that add samples expand them.
+ * Must not be called while the samples are accessed by other threads.
+ * Since many readers of dc->sample don't expand the samples yet, this is
+ * only used by the tests.
+ */
+void compress_dc_samples(struct divecomputer *dc)
+{
+	if (dc->packed_samples || !dc->samples)
+		return;
+	dc->packed_samples = pack_samples(dc->sample, dc->samples);
+	if (!dc->packed_samples)
+		return;
+	if (dc->arena) {
+		/* Leave the samples to the arena */
+		dc->sample = NULL;
+		unshare_dc_arena(dc);
+	}
+	free(dc->sample);
+	dc->sample = NULL;
+	dc->alloc_samples = 0;
+}
+
+/* Decompress the samples of a dive computer. Since this doesn't change the
+ * samples, it can be called on const dive computers and from different threads. */
+void expand_dc_samples(const struct divecomputer *dc)
+{
+	lock_dive_samples();
+	unpack_dc_samples((struct divecomputer *)dc);
+	unlock_dive_samples();
+}
+
+/* Access the samples without decompressing them permanently. If the samples are
+ * compressed, they are unpacked into a new array. Give them back with put_dc_samples().
+ * Takes the lock, since another thread might expand the samples concurrently. */
+const struct sample *get_dc_samples(const struct divecomputer *dc)
+{
+	struct sample *sample;
+
+	lock_dive_samples();
+	if (!dc->packed_samples) {
+		sample = dc->sample;
+	} else {
+		sample = malloc(dc->samples * sizeof(struct sample));
+		if (sample)
+			unpack_samples(dc->packed_samples, sample);
+	}
+	unlock_dive_samples();
+	return sample;
+}
+
+void put_dc_samples(const struct divecomputer *dc, const struct sample *samples)
+{
+	if (samples != dc->sample)
+		free((struct sample *)samples);
+}
+
 /* make room for num samples; if not enough space is available, the sample
  * array is reallocated and the existing samples are copied. */
 void alloc_samples(struct divecomputer *dc, int num)
 {
+	unpack_dc_samples(dc);
 	if (num > dc->alloc_samples) {
-		dc->alloc_samples = (num * 3) / 2 + 10;
-		dc->sample = realloc(dc->sample, dc->alloc_samples * sizeof(struct sample));
+		int alloc = (num * 3) / 2 + 10;
+		if (arena_sealed(dc->arena))
+			unshare_dc_arena(dc);
+		if (dc->arena)
+			dc->sample = arena_realloc(dc->arena, dc->sample, dc->alloc_samples * sizeof(struct sample),
+						   alloc * sizeof(struct sample));
+		else
+			dc->sample = realloc(dc->sample, alloc * sizeof(struct sample));
+		dc->alloc_samples = alloc;
 		if (!dc->sample)
 			dc->samples = dc->alloc_samples = 0;
 	}
@@ -257,7 +420,13 @@ void alloc_samples(struct divecomputer *dc, int num)
 void free_samples(struct divecomputer *dc)
 {
 	if (dc) {
+		if (dc->arena) {
+			dc->sample = NULL;
+			unshare_dc_arena(dc);
+		}
 		free(dc->sample);
+		free_packed_samples(dc->packed_samples);
+		dc->packed_samples = NULL;
 		dc->sample = 0;
 		dc->samples = 0;
 		dc->alloc_samples = 0;
@@ -411,12 +580,16 @@ void copy_samples(const struct divecomputer *s, struct divecomputer *d)
 	// if its a valid pointer, so don't expect malloc() to return NULL for
 	// zero-sized malloc, do it ourselves.
 	d->sample = NULL;
+	d->packed_samples = NULL;
 
 	if(!nr)
 		return;
 
+	// Copies are made for editing, therefore unpack compressed samples
 	d->sample = malloc(nr * sizeof(struct sample));
-	if (d->sample)
+	if (d->sample && s->packed_samples)
+		unpack_samples(s->packed_samples, d->sample);
+	else if (d->sample)
 		memcpy(d->sample, s->sample, nr * sizeof(struct sample));
 }
 
@@ -431,6 +604,7 @@ void add_event_to_dc(struct divecomputer *dc, struct event *ev)
 		p = &(*p)->next;
 	ev->next = *p;
 	*p = ev;
+	invalidate_event_index(dc);
 }
 
 struct event *add_event(struct divecomputer *dc, unsigned int time, int type, int flags, int value, const char *name)
@@ -454,6 +628,7 @@ void swap_event(struct divecomputer *dc, struct event *from, struct event *to)
 			to->next = from->next;
 			*ep = to;
 			from->next = NULL; // For good measure.
+			invalidate_event_index(dc);
 			break;
 		}
 	}
@@ -466,6 +641,7 @@ void remove_event_from_dc(struct divecomputer *dc, struct event *event)
 		if (*ep == event) {
 			*ep = event->next;
 			event->next = NULL; // For good measure.
+			invalidate_event_index(dc);
 			break;
 		}
 	}
@@ -475,11 +651,22 @@ void add_extra_data(struct divecomputer *dc, const char *key, const char *value)
 {
 	struct extra_data **ed = &dc->extra_data;
 
+	if (arena_sealed(dc->arena))
+		unshare_dc_arena(dc);
 	while (*ed)
 		ed = &(*ed)->next;
+	if (dc->arena) {
+		*ed = arena_alloc(dc->arena, sizeof(struct extra_data));
+		if (*ed) {
+			(*ed)->key = intern_string(key);
+			(*ed)->value = arena_strdup(dc->arena, value);
+			(*ed)->next = NULL;
+		}
+		return;
+	}
 	*ed = malloc(sizeof(struct extra_data));
 	if (*ed) {
-		(*ed)->key = strdup(key);
+		(*ed)->key = intern_string(key);
 		(*ed)->value = strdup(value);
 		(*ed)->next = NULL;
 	}
@@ -501,7 +688,7 @@ int match_one_dc(const struct divecomputer *a, const struct divecomputer *b)
 	/* Not same model? Don't know if matching.. */
 	if (!a->model || !b->model)
 		return 0;
-	if (strcasecmp(a->model, b->model))
+	if (a->model != b->model && strcasecmp(a->model, b->model))
 		return 0;
 
 	/* Different device ID's? Don't know */
@@ -519,19 +706,17 @@ int match_one_dc(const struct divecomputer *a, const struct divecomputer *b)
 	return a->diveid == b->diveid && a->when == b->when ? 1 : -1;
 }
 
-static void free_extra_data(struct extra_data *ed)
-{
-	free((void *)ed->key);
-	free((void *)ed->value);
-}
-
 void free_dc_contents(struct divecomputer *dc)
 {
-	free(dc->sample);
-	free((void *)dc->model);
-	free((void *)dc->serial);
-	free((void *)dc->fw_version);
+	free_packed_samples(dc->packed_samples);
 	free_events(dc->events);
+	free_event_index(dc->event_index);
+	if (dc->arena) {
+		/* The samples and the extra data are freed with the arena */
+		arena_unref(dc->arena);
+		return;
+	}
+	free(dc->sample);
 	STRUCTURED_LIST_FREE(struct extra_data, dc->extra_data, free_extra_data);
 }
 
@@ -9,7 +9,10 @@
 extern "C" {
 #endif
 
+struct arena;
+struct event_index;
 struct extra_data;
+struct packed_samples;
 struct sample;
 
 /* Is this header the correct place? */
@@ -41,8 +44,11 @@ struct divecomputer {
 	uint32_t deviceid, diveid;
 	int samples, alloc_samples;
 	struct sample *sample;
+	struct packed_samples *packed_samples;	// if set, the samples are compressed and sample is NULL
 	struct event *events;
+	struct event_index *event_index;	// built on demand, see eventindex.h
 	struct extra_data *extra_data;
+	struct arena *arena;			// if set, owns the samples and the extra data, see arena.h
 	struct divecomputer *next;
 };
 
@@ -50,10 +56,16 @@ extern void fake_dc(struct divecomputer *dc);
 extern void free_dc(struct divecomputer *dc);
 extern void free_dc_contents(struct divecomputer *dc);
 extern enum divemode_t get_current_divemode(const struct divecomputer *dc, int time, const struct event **evp, enum divemode_t *divemode);
+extern enum divemode_t get_divemode_at_time(const struct divecomputer *dc, int time);
 extern int get_depth_at_time(const struct divecomputer *dc, unsigned int time);
 extern void free_dive_dcs(struct divecomputer *dc);
 extern void alloc_samples(struct divecomputer *dc, int num);
 extern void free_samples(struct divecomputer *dc);
+extern void set_dc_arena(struct divecomputer *dc, struct arena *arena);
+extern void compress_dc_samples(struct divecomputer *dc); // for testing, see comment in divecomputer.c
+extern void expand_dc_samples(const struct divecomputer *dc);
+extern const struct sample *get_dc_samples(const struct divecomputer *dc);
+extern void put_dc_samples(const struct divecomputer *dc, const struct sample *samples);
 extern struct sample *prepare_sample(struct divecomputer *dc);
 extern void finish_sample(struct divecomputer *dc);
 extern struct sample *add_sample(const struct sample *sample, int time, struct divecomputer *dc);
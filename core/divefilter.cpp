@@ -51,6 +51,29 @@ bool FilterData::validFilter() const
 	return fullText.doit() || !constraints.empty();
 }
 
+// Returns true if the dives shown by this filter are a subset of the dives shown by old.
+// In that case, only the shown dives have to be reevaluated when switching to this filter.
+bool FilterData::narrows(const FilterData &old) const
+{
+	if (old.fullText.doit() &&
+	    (fulltextStringMode != old.fulltextStringMode || !fullText.narrows(old.fullText, fulltextStringMode)))
+		return false;
+	return filter_constraints_narrow(constraints, old.constraints);
+}
+
+bool DiveFilter::fieldRelevant(const DiveField &field) const
+{
+	if (diveSiteMode())
+		return field.divesite;
+	if (field.invalid)
+		return true;
+	if (filterData.fullText.doit() &&
+	    (field.notes || field.divemaster || field.buddy || field.suit || field.tags || field.divesite))
+		return true;
+	return std::any_of(filterData.constraints.begin(), filterData.constraints.end(),
+			   [&field](const filter_constraint &c) { return filter_constraint_depends_on(c.type, field); });
+}
+
 ShownChange DiveFilter::update(const QVector<dive *> &dives) const
 {
 	dive *old_current = current_dive;
@@ -58,17 +81,25 @@ ShownChange DiveFilter::update(const QVector<dive *> &dives) const
 	ShownChange res;
 	bool doDS = diveSiteMode();
 	bool doFullText = filterData.fullText.doit();
+	CompiledFilterConstraints constraints(filterData.constraints);
 	for (dive *d: dives) {
 		// There are three modes: divesite, fulltext, normal
 		bool newStatus = doDS        ? dive_sites.contains(d->dive_site) :
-				 doFullText  ? fulltext_dive_matches(d, filterData.fullText, filterData.fulltextStringMode) && showDive(d) :
-					       showDive(d);
+				 doFullText  ? fulltext_dive_matches(d, filterData.fullText, filterData.fulltextStringMode) && showDive(d, constraints) :
+					       showDive(d, constraints);
 		updateDiveStatus(d, newStatus, res);
 	}
 	res.currentChanged = old_current != current_dive;
 	return res;
 }
 
+ShownChange DiveFilter::update(const QVector<dive *> &dives, const DiveField &field) const
+{
+	if (!fieldRelevant(field))
+		return { {}, {}, false };
+	return update(dives);
+}
+
 void DiveFilter::reset()
 {
 	int i;
@@ -86,6 +117,10 @@ ShownChange DiveFilter::updateAll() const
 	ShownChange res;
 	int i;
 	dive *d;
+	// If the filter was only narrowed, hidden dives stay hidden.
+	bool onlyShown = narrowed;
+	narrowed = false;
+	filterChanged = false;
 	// There are three modes: divesite, fulltext, normal
 	if (diveSiteMode()) {
 		for_each_dive(i, d) {
@@ -94,13 +129,19 @@ ShownChange DiveFilter::updateAll() const
 		}
 	} else if (filterData.fullText.doit()) {
 		FullTextResult ft = fulltext_find_dives(filterData.fullText, filterData.fulltextStringMode);
+		CompiledFilterConstraints constraints(filterData.constraints);
 		for_each_dive(i, d) {
-			bool newStatus = ft.dive_matches(d) && showDive(d);
+			if (onlyShown && d->hidden_by_filter)
+				continue;
+			bool newStatus = ft.dive_matches(d) && showDive(d, constraints);
 			updateDiveStatus(d, newStatus, res);
 		}
 	} else {
+		CompiledFilterConstraints constraints(filterData.constraints);
 		for_each_dive(i, d) {
-			bool newStatus = showDive(d);
+			if (onlyShown && d->hidden_by_filter)
+				continue;
+			bool newStatus = showDive(d, constraints);
 			updateDiveStatus(d, newStatus, res);
 		}
 	}
@@ -116,6 +157,8 @@ DiveFilter *DiveFilter::instance()
 
 DiveFilter::DiveFilter() :
 	shown_dives(0),
+	narrowed(false),
+	filterChanged(false),
 	diveSiteRefCount(0)
 {
 }
@@ -126,7 +169,7 @@ void DiveFilter::diveRemoved(const dive *d) const
 		--shown_dives;
 }
 
-bool DiveFilter::showDive(const struct dive *d) const
+bool DiveFilter::showDive(const struct dive *d, const CompiledFilterConstraints &constraints) const
 {
 	if (d->invalid && !prefs.display_invalid_dives)
 		return false;
@@ -134,8 +177,7 @@ bool DiveFilter::showDive(const struct dive *d) const
 	if (!filterData.validFilter())
 		return true;
 
-	return std::all_of(filterData.constraints.begin(), filterData.constraints.end(),
-			   [d] (const filter_constraint &c) { return filter_constraint_match_dive(c, d); });
+	return constraints.match_dive(d);
 }
 
 #if !defined(SUBSURFACE_MOBILE) && !defined(SUBSURFACE_DOWNLOADER)
@@ -208,6 +250,10 @@ int DiveFilter::shownDives() const
 
 void DiveFilter::setFilter(const FilterData &data)
 {
+	// The status of the dives was calculated with the filter before the last change.
+	// Thus, if the filter is changed repeatedly in between, it must be narrowed every time.
+	narrowed = !diveSiteMode() && data.narrows(filterData) && (narrowed || !filterChanged);
+	filterChanged = true;
 	filterData = data;
 	emit diveListNotifier.filterReset();
 }
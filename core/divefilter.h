@@ -12,6 +12,7 @@
 struct dive;
 struct dive_trip;
 struct dive_site;
+struct DiveField;
 
 // Structure describing changes of shown status upon applying the filter
 struct ShownChange {
@@ -32,6 +33,7 @@ struct FilterData {
 	StringFilterMode fulltextStringMode = StringFilterMode::STARTSWITH;
 	std::vector<filter_constraint> constraints;
 	bool validFilter() const;
+	bool narrows(const FilterData &old) const; // true if this filter shows a subset of the dives shown by old
 	bool operator==(const FilterData &) const;
 };
 
@@ -52,17 +54,21 @@ public:
 #endif
 	void setFilter(const FilterData &data);
 	ShownChange update(const QVector<dive *> &dives) const; // Update filter status of given dives and return dives whose status changed
+	ShownChange update(const QVector<dive *> &dives, const DiveField &field) const; // Same, but only if the filter depends on the changed fields
 	ShownChange updateAll() const; // Update filter status of all dives and return dives whose status changed
 	void diveRemoved(const dive *dive) const; // Dive was removed; update count accordingly
 private:
 	DiveFilter();
-	bool showDive(const struct dive *d) const; // Should that dive be shown?
+	bool showDive(const struct dive *d, const CompiledFilterConstraints &constraints) const; // Should that dive be shown?
+	bool fieldRelevant(const DiveField &field) const; // Can a change of these fields change the filter status of a dive?
 	bool setFilterStatus(struct dive *d, bool shown) const;
 	void updateDiveStatus(dive *d, bool newStatus, ShownChange &change) const;
 
 	QVector<dive_site *> dive_sites;
 	FilterData filterData;
 	mutable int shown_dives;
+	mutable bool narrowed; // The filter was narrowed since the last updateAll(): only reevaluate shown dives
+	mutable bool filterChanged; // The filter was changed since the last updateAll()
 
 	// We use ref-counting for the dive site mode. The reason is that when switching
 	// between two tabs that both need dive site mode, the following course of
@@ -10,6 +10,7 @@
 #include "event.h"
 #include "filterpreset.h"
 #include "fulltext.h"
+#include "idindex.h"
 #include "interpolate.h"
 #include "planner.h"
 #include "qthelper.h"
@@ -375,6 +376,7 @@ static int calculate_sac(const struct dive *dive)
 static void add_dive_to_deco(struct deco_state *ds, struct dive *dive)
 {
 	struct divecomputer *dc = &dive->dc;
+	const struct sample *samples;
 	struct gasmix gasmix = gasmix_air;
 	int i;
 	const struct event *ev = NULL, *evd = NULL;
@@ -383,9 +385,13 @@ static void add_dive_to_deco(struct deco_state *ds, struct dive *dive)
 	if (!dc)
 		return;
 
+	/* Called from worker threads, therefore don't expand compressed samples */
+	samples = get_dc_samples(dc);
+	if (!samples)
+		return;
 	for (i = 1; i < dc->samples; i++) {
-		struct sample *psample = dc->sample + i - 1;
-		struct sample *sample = dc->sample + i;
+		const struct sample *psample = samples + i - 1;
+		const struct sample *sample = samples + i;
 		int t0 = psample->time.seconds;
 		int t1 = sample->time.seconds;
 		int j;
@@ -397,35 +403,122 @@ static void add_dive_to_deco(struct deco_state *ds, struct dive *dive)
 				get_current_divemode(&dive->dc, j, &evd, &current_divemode), dive->sac);
 		}
 	}
+	put_dc_samples(dc, samples);
 }
 
 int get_divenr(const struct dive *dive)
 {
-	int i;
 	const struct dive *d;
 	// tempting as it may be, don't die when called with dive=NULL
-	if (dive)
-		for_each_dive(i, d) {
-			if (d->id == dive->id) // don't compare pointers, we could be passing in a copy of the dive
-				return i;
-		}
-	return -1;
+	if (!dive)
+		return -1;
+	// don't compare pointers, we could be passing in a copy of the dive
+	d = id_index_get(ID_INDEX_DIVE, dive->id);
+	return d ? get_idx_in_global_dive_table(d) : -1;
 }
 
 static struct gasmix air = { .o2.permille = O2_IN_AIR, .he.permille = 0 };
 
+/*
+ * Cached tissue state at the end of a dive (after surfacing), as computed
+ * by init_decompression() when walking a chain of repetitive dives.
+ *
+ * The state depends on all previous dives of the chain. Therefore, each
+ * entry records the stamp of the entry of the preceding dive (0 for the
+ * first dive of a chain). An entry is only used if the entries of all
+ * previous dives in the chain are valid and their stamps match. If a dive
+ * is edited, invalidate_dive_cache() frees its entry and a recalculation
+ * gives it a new stamp, which implicitly invalidates all following entries.
+ * Likewise, adding or removing a dive changes the predecessor of the
+ * following dive.
+ *
+ * Since the calculation depends on the deco settings, which are part of
+ * the deco state, these are compared as well. Moreover, the trip-restriction
+ * of the chain and the dive mode used for the surface intervals are recorded.
+ *
+ * Since init_decompression() may be called from different threads, the
+ * cache is protected by lock_deco_cache().
+ */
+struct deco_cache {
+	struct deco_state ds;
+	unsigned int stamp;
+	unsigned int prev_stamp;
+	const struct dive_trip *trip;
+	enum divemode_t divemode;
+	timestamp_t when;
+};
+
+static unsigned int deco_cache_stamp = 0;
+
+/* If the cached tissue state of the dive is valid, copy it to ds and return the stamp. Otherwise return 0. */
+static unsigned int get_cached_tissue_state(const struct dive *dive, struct deco_state *ds, unsigned int prev_stamp,
+					   const struct deco_config *config, const struct dive_trip *trip, enum divemode_t divemode)
+{
+	unsigned int stamp = 0;
+	const struct deco_cache *cache;
+
+	lock_deco_cache();
+	cache = dive->deco_cache;
+	if (cache &&
+	    cache->prev_stamp == prev_stamp &&
+	    same_deco_config(&cache->ds.config, config) &&
+	    cache->trip == trip &&
+	    cache->divemode == divemode &&
+	    cache->when == dive->when) {
+		*ds = cache->ds;
+		stamp = cache->stamp;
+	}
+	unlock_deco_cache();
+	return stamp;
+}
+
+/* Remember the tissue state at the end of a dive. Returns the stamp of the new entry. */
+static unsigned int cache_tissue_state(struct dive *dive, const struct deco_state *ds, unsigned int prev_stamp,
+				       const struct dive_trip *trip, enum divemode_t divemode)
+{
+	unsigned int stamp = 0;
+	struct deco_cache *cache;
+
+	lock_deco_cache();
+	cache = dive->deco_cache;
+	if (!cache) {
+		cache = malloc(sizeof(struct deco_cache));
+		dive->deco_cache = cache;
+	}
+	if (cache) {
+		cache->ds = *ds;
+		/* Skip 0, which signifies "beginning of chain" */
+		if (++deco_cache_stamp == 0)
+			++deco_cache_stamp;
+		cache->stamp = stamp = deco_cache_stamp;
+		cache->prev_stamp = prev_stamp;
+		cache->trip = trip;
+		cache->divemode = divemode;
+		cache->when = dive->when;
+	}
+	unlock_deco_cache();
+	return stamp;
+}
+
 /* take into account previous dives until there is a 48h gap between dives */
 /* return last surface time before this dive or dummy value of 48h */
 /* return negative surface time if dives are overlapping */
 /* The place you call this function is likely the place where you want
  * to create the deco_state */
-int init_decompression(struct deco_state *ds, const struct dive *dive)
+/* The tissue states at the end of the previous dives are cached, so that
+ * only those dives that changed have to be replayed, see struct deco_cache. */
+/* The deco model is initialized with the given settings. Note that config
+ * may point to the settings of ds. */
+int init_decompression(struct deco_state *ds, const struct dive *dive, const struct deco_config *config_in)
 {
 	int i, divenr = -1;
 	int surface_time = 48 * 60 * 60;
 	timestamp_t last_endtime = 0, last_starttime = 0;
 	bool deco_init = false;
 	double surface_pressure;
+	unsigned int prev_stamp = 0;
+	bool use_cache = true;
+	struct deco_config config = *config_in;
 
 	if (!dive)
 		return false;
@@ -514,13 +607,35 @@ int init_decompression(struct deco_state *ds, const struct dive *dive)
 		printf("Yes\n");
 #endif
 
+		/* As long as all previous dives had a valid cached tissue state, we
+		 * don't have to do any calculation. Only remember the last state. */
+		if (use_cache) {
+			unsigned int stamp = get_cached_tissue_state(pdive, ds, prev_stamp, &config, dive->divetrip, dive->dc.divemode);
+			if (stamp) {
+				if (deco_init) {
+					surface_time = pdive->when - last_endtime;
+					if (surface_time < 0)
+						return surface_time;
+				}
+				deco_init = true;
+				prev_stamp = stamp;
+				last_starttime = pdive->when;
+				last_endtime = dive_endtime(pdive);
+#if DECO_CALC_DEBUG & 2
+				printf("Using cached tissue state\n");
+#endif
+				continue;
+			}
+			use_cache = false;
+		}
+
 		surface_pressure = get_surface_pressure_in_mbar(pdive, true) / 1000.0;
 		/* Is it the first dive we add? */
 		if (!deco_init) {
 #if DECO_CALC_DEBUG & 2
 			printf("Init deco\n");
 #endif
-			clear_deco(ds, surface_pressure);
+			clear_deco(ds, surface_pressure, &config);
 			deco_init = true;
 #if DECO_CALC_DEBUG & 2
 			printf("Tissues after init:\n");
@@ -546,6 +661,7 @@ int init_decompression(struct deco_state *ds, const struct dive *dive)
 		last_starttime = pdive->when;
 		last_endtime = dive_endtime(pdive);
 		clear_vpmb_state(ds);
+		prev_stamp = cache_tissue_state(pdive, ds, prev_stamp, dive->divetrip, dive->dc.divemode);
 #if DECO_CALC_DEBUG & 2
 		printf("Tissues after added dive #%d:\n", pdive->number);
 		dump_tissues(ds);
@@ -558,7 +674,7 @@ int init_decompression(struct deco_state *ds, const struct dive *dive)
 #if DECO_CALC_DEBUG & 2
 		printf("Init deco\n");
 #endif
-		clear_deco(ds, surface_pressure);
+		clear_deco(ds, surface_pressure, &config);
 #if DECO_CALC_DEBUG & 2
 		printf("Tissues after no previous dive, surface time set to 48h:\n");
 		dump_tissues(ds);
@@ -638,7 +754,7 @@ static int comp_dc(const struct divecomputer *dc1, const struct divecomputer *dc
 			return -1;
 		if (!dc2)
 			return 1;
-		if ((cmp = safe_strcmp(dc1->model, dc2->model)) != 0)
+		if (dc1->model != dc2->model && (cmp = safe_strcmp(dc1->model, dc2->model)) != 0)
 			return cmp;
 		dc1 = dc1->next;
 		dc2 = dc2->next;
@@ -694,15 +810,51 @@ int comp_dives(const struct dive *a, const struct dive *b)
 }
 
 /* Dive table functions */
+/* Keep the id index of the global dive table up to date */
+static void dive_table_added(struct dive_table *table, struct dive *d)
+{
+	if (table == &dive_table)
+		id_index_add(ID_INDEX_DIVE, d->id, d);
+}
+
+static void dive_table_removed(struct dive_table *table, struct dive *d)
+{
+	if (table == &dive_table)
+		id_index_remove(ID_INDEX_DIVE, d->id, d);
+}
+
 static MAKE_GROW_TABLE(dive_table, struct dive *, dives)
 MAKE_GET_INSERTION_INDEX(dive_table, struct dive *, dives, dive_less_than)
-MAKE_ADD_TO(dive_table, struct dive *, dives)
-static MAKE_REMOVE_FROM(dive_table, dives)
+MAKE_ADD_TO_HOOKED(dive_table, struct dive *, dives, dive_table_added)
+MAKE_ADD_MANY_HOOKED(dive_table, struct dive *, dives, dive_less_than, dive_table_added)
+static MAKE_REMOVE_FROM_HOOKED(dive_table, dives, dive_table_removed)
+MAKE_REMOVE_MANY_HOOKED(dive_table, struct dive *, dives, dive_table_removed)
 static MAKE_GET_IDX(dive_table, struct dive *, dives)
 MAKE_SORT(dive_table, struct dive *, dives, comp_dives)
 MAKE_REMOVE(dive_table, struct dive *, dive)
-MAKE_CLEAR_TABLE(dive_table, dives, dive)
-MAKE_MOVE_TABLE(dive_table, dives)
+MAKE_CLEAR_TABLE_HOOKED(dive_table, dives, dive, dive_table_removed)
+MAKE_MOVE_TABLE_HOOKED(dive_table, dives, dive_table_added, dive_table_removed)
+
+/* The global dive table is kept sorted, therefore look for the dive
+ * by bisection first. Fall back to a linear search if the table
+ * is not sorted (e.g. while loading). */
+int get_idx_in_global_dive_table(const struct dive *d)
+{
+	int lo = 0, hi = dive_table.nr - 1;
+	while (lo <= hi) {
+		int mid = lo + (hi - lo) / 2;
+		int cmp = comp_dives(dive_table.dives[mid], d);
+		if (cmp < 0)
+			lo = mid + 1;
+		else if (cmp > 0)
+			hi = mid - 1;
+		else if (dive_table.dives[mid] == d)
+			return mid;
+		else
+			break;
+	}
+	return get_idx_in_dive_table(&dive_table, d);
+}
 
 void insert_dive(struct dive_table *table, struct dive *d)
 {
@@ -742,8 +894,9 @@ static void autogroup_dives(struct dive_table *table, struct trip_table *trip_ta
  * It simply shrinks the table and frees the trip */
 void delete_dive_from_table(struct dive_table *table, int idx)
 {
-	free_dive(table->dives[idx]);
+	struct dive *d = table->dives[idx];
 	remove_from_dive_table(table, idx);
+	free_dive(d);
 }
 
 struct dive *get_dive_from_table(int nr, const struct dive_table *dt)
@@ -842,10 +995,10 @@ static void merge_imported_dives(struct dive_table *table)
 		unregister_dive_from_trip(prev);
 		unregister_dive_from_trip(dive);
 
-		/* Overwrite the first of the two dives and remove the second */
-		free_dive(prev);
-		table->dives[i - 1] = merged;
+		/* Replace the first of the two dives and remove the second */
 		delete_dive_from_table(table, i);
+		delete_dive_from_table(table, i - 1);
+		add_to_dive_table(table, i - 1, merged);
 
 		/* Redo the new 'i'th dive */
 		i--;
@@ -973,7 +1126,7 @@ void add_imported_dives(struct dive_table *import_table, struct trip_table *impo
 			struct dive_site_table *import_sites_table, struct device_table *import_device_table,
 			int flags)
 {
-	int i, idx;
+	int i;
 	struct dive_table dives_to_add = empty_dive_table;
 	struct dive_table dives_to_remove = empty_dive_table;
 	struct trip_table trips_to_add = empty_trip_table;
@@ -997,16 +1150,22 @@ void add_imported_dives(struct dive_table *import_table, struct trip_table *impo
 		add_dive_to_dive_site(d, site);
 	}
 
-	/* Remove old dives */
+	/* Remove old dives. Compact the dive table in a single pass. */
 	for (i = 0; i < dives_to_remove.nr; i++) {
-		idx = get_divenr(dives_to_remove.dives[i]);
-		delete_single_dive(idx);
+		struct dive *d = dives_to_remove.dives[i];
+		if (d->selected)
+			deselect_dive(d);
+		remove_dive_from_trip(d, &trip_table);
+		unregister_dive_from_dive_site(d);
 	}
+	remove_many_from_dive_table(&dive_table, dives_to_remove.dives, dives_to_remove.nr);
+	for (i = 0; i < dives_to_remove.nr; i++)
+		free_dive(dives_to_remove.dives[i]);
 	dives_to_remove.nr = 0;
 
-	/* Add new dives */
-	for (i = 0; i < dives_to_add.nr; i++)
-		insert_dive(&dive_table, dives_to_add.dives[i]);
+	/* Add new dives. The trips were assigned above, so sort again. */
+	sort_dive_table(&dives_to_add);
+	add_many_to_dive_table(&dive_table, dives_to_add.dives, dives_to_add.nr);
 	dives_to_add.nr = 0;
 
 	/* Add new trips */
@@ -1356,11 +1515,11 @@ void clear_dive_file_data()
 	fulltext_unregister_all();
 	clear_selection();
 
+	/* Delete from the end, so that the tables don't have to be moved down */
 	while (dive_table.nr)
-		delete_single_dive(0);
+		delete_single_dive(dive_table.nr - 1);
 	current_dive = NULL;
-	while (dive_site_table.nr)
-		delete_dive_site(get_dive_site(0, &dive_site_table), &dive_site_table);
+	clear_dive_site_table(&dive_site_table);
 	if (trip_table.nr != 0) {
 		fprintf(stderr, "Warning: trip table not empty in clear_dive_file_data()!\n");
 		trip_table.nr = 0;
@@ -1380,6 +1539,53 @@ void clear_dive_file_data()
 	emit_reset_signal();
 }
 
+/*
+ * Replace the dive data by a newer commit of the git repository it was
+ * loaded from, for example after syncing with the cloud. In contrast to
+ * clear_dive_file_data() followed by git_load_dives(), the dives that
+ * didn't change are kept including their fulltext cache and only the
+ * changed dives are parsed. As after git_load_dives(), the caller has
+ * to call process_loaded_dives().
+ */
+int reload_git_dive_file_data(struct git_repository *repo, const char *branch, struct filter_preset_table *filter_presets)
+{
+	struct dive_table old_dives = empty_dive_table;
+	struct trip_table old_trips = empty_trip_table;
+	struct dive_site_table old_sites = empty_dive_site_table;
+	int ret;
+
+	clear_selection();
+	move_dive_table(&dive_table, &old_dives);
+	move_dive_site_table(&dive_site_table, &old_sites);
+	move_trip_table(&trip_table, &old_trips);
+
+	clear_dive(&displayed_dive);
+	clear_device_table(&device_table);
+	clear_events();
+	clear_filter_presets();
+	reset_min_datafile_version();
+	clear_git_id();
+
+	/* The models must let go of the old dives, trips and dive sites before they are freed */
+	emit_reset_signal();
+
+	ret = git_reload_dives(repo, branch, &dive_table, &trip_table, &dive_site_table, &device_table,
+			       filter_presets, &old_dives);
+
+	/* The trips and dive sites of the reused dives have been replaced */
+	clear_dive_table(&old_dives);
+	free(old_dives.dives);
+	clear_trip_table(&old_trips);
+	free(old_trips.trips);
+	clear_dive_site_table(&old_sites);
+	free(old_sites.dive_sites);
+
+	/* Drop the cylinder types that are only used by the replaced dives */
+	reset_tank_info_table(&tank_info_table);
+
+	return ret;
+}
+
 bool dive_less_than(const struct dive *a, const struct dive *b)
 {
 	return comp_dives(a, b) < 0;
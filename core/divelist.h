@@ -13,6 +13,9 @@ struct trip_table;
 struct dive_site_table;
 struct device_table;
 struct deco_state;
+struct deco_config;
+struct git_repository;
+struct filter_preset_table;
 
 struct dive_table {
 	int nr, allocated;
@@ -26,7 +29,7 @@ extern struct dive_table dive_table;
 
 extern void sort_dive_table(struct dive_table *table);
 extern void update_cylinder_related_info(struct dive *);
-extern int init_decompression(struct deco_state *ds, const struct dive *dive);
+extern int init_decompression(struct deco_state *ds, const struct dive *dive, const struct deco_config *config);
 
 /* divelist core logic functions */
 extern void process_loaded_dives();
@@ -48,9 +51,12 @@ extern char *get_dive_gas_string(const struct dive *dive);
 
 extern int dive_table_get_insertion_index(struct dive_table *table, struct dive *dive);
 extern void add_to_dive_table(struct dive_table *table, int idx, struct dive *dive);
+extern void add_many_to_dive_table(struct dive_table *table, struct dive **dives, int nr); // dives must be sorted
+extern void remove_many_from_dive_table(struct dive_table *table, struct dive **dives, int nr);
 extern void insert_dive(struct dive_table *table, struct dive *d);
 extern void get_dive_gas(const struct dive *dive, int *o2_p, int *he_p, int *o2low_p);
 extern int get_divenr(const struct dive *dive);
+extern int get_idx_in_global_dive_table(const struct dive *dive);
 extern int remove_dive(const struct dive *dive, struct dive_table *table);
 extern int get_dive_nr_at_idx(int idx);
 extern void set_dive_nr_for_current_dive();
@@ -65,6 +71,7 @@ void reset_min_datafile_version();
 void report_datafile_version(int version);
 int get_dive_id_closest_to(timestamp_t when);
 void clear_dive_file_data();
+int reload_git_dive_file_data(struct git_repository *repo, const char *branch, struct filter_preset_table *filter_presets);
 void clear_dive_table(struct dive_table *table);
 void move_dive_table(struct dive_table *src, struct dive_table *dst);
 struct dive *unregister_dive(int idx);
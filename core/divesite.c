@@ -4,6 +4,9 @@
 #include "dive.h"
 #include "subsurface-string.h"
 #include "divelist.h"
+#include "fulltext.h"
+#include "divesiteindex.h"
+#include "idindex.h"
 #include "membuffer.h"
 #include "table.h"
 #include "sha1.h"
@@ -30,6 +33,8 @@ struct dive_site *get_dive_site_by_uuid(uint32_t uuid, struct dive_site_table *d
 {
 	int i;
 	struct dive_site *ds;
+	if (ds_table == &dive_site_table)
+		return id_index_get(ID_INDEX_DIVE_SITE, uuid);
 	for_each_dive_site (i, ds, ds_table)
 		if (ds->uuid == uuid)
 			return get_dive_site(i, ds_table);
@@ -53,6 +58,8 @@ struct dive_site *get_dive_site_by_gps(const location_t *loc, struct dive_site_t
 {
 	int i;
 	struct dive_site *ds;
+	if (ds_table == &dive_site_table && has_location(loc))
+		return dive_site_index_get_by_gps(loc, NULL);
 	for_each_dive_site (i, ds, ds_table) {
 		if (same_location(loc, &ds->location))
 			return ds;
@@ -67,6 +74,8 @@ struct dive_site *get_dive_site_by_gps_and_name(char *name, const location_t *lo
 {
 	int i;
 	struct dive_site *ds;
+	if (ds_table == &dive_site_table && has_location(loc))
+		return dive_site_index_get_by_gps(loc, name ? name : "");
 	for_each_dive_site (i, ds, ds_table) {
 		if (same_location(loc, &ds->location) && same_string(ds->name, name))
 			return ds;
@@ -98,6 +107,8 @@ struct dive_site *get_dive_site_by_gps_proximity(const location_t *loc, int dist
 	int i;
 	struct dive_site *ds, *res = NULL;
 	unsigned int cur_distance, min_distance = distance;
+	if (ds_table == &dive_site_table)
+		return distance > 0 ? dive_site_index_get_by_gps_proximity(loc, distance) : NULL;
 	for_each_dive_site (i, ds, ds_table) {
 		if (dive_site_has_gps_location(ds) &&
 		    (cur_distance = get_distance(&ds->location, loc)) < min_distance) {
@@ -108,6 +119,13 @@ struct dive_site *get_dive_site_by_gps_proximity(const location_t *loc, int dist
 	return res;
 }
 
+/* Change the location of a dive site, keeping the spatial index up to date */
+void set_dive_site_location(struct dive_site *ds, const location_t *loc)
+{
+	ds->location = *loc;
+	dive_site_index_update(ds);
+}
+
 int register_dive_site(struct dive_site *ds)
 {
 	return add_dive_site_to_table(ds, &dive_site_table);
@@ -123,15 +141,32 @@ static int site_less_than(const struct dive_site *a, const struct dive_site *b)
 	return compare_sites(a, b) < 0;
 }
 
+/* Keep the id and spatial indexes of the global dive site table up to date */
+static void dive_site_table_added(struct dive_site_table *table, struct dive_site *ds)
+{
+	if (table == &dive_site_table) {
+		id_index_add(ID_INDEX_DIVE_SITE, ds->uuid, ds);
+		dive_site_index_add(ds);
+	}
+}
+
+static void dive_site_table_removed(struct dive_site_table *table, struct dive_site *ds)
+{
+	if (table == &dive_site_table) {
+		id_index_remove(ID_INDEX_DIVE_SITE, ds->uuid, ds);
+		dive_site_index_remove(ds);
+	}
+}
+
 static MAKE_GROW_TABLE(dive_site_table, struct dive_site *, dive_sites)
 static MAKE_GET_INSERTION_INDEX(dive_site_table, struct dive_site *, dive_sites, site_less_than)
-static MAKE_ADD_TO(dive_site_table, struct dive_site *, dive_sites)
-static MAKE_REMOVE_FROM(dive_site_table, dive_sites)
+static MAKE_ADD_TO_HOOKED(dive_site_table, struct dive_site *, dive_sites, dive_site_table_added)
+static MAKE_REMOVE_FROM_HOOKED(dive_site_table, dive_sites, dive_site_table_removed)
 static MAKE_GET_IDX(dive_site_table, struct dive_site *, dive_sites)
 MAKE_SORT(dive_site_table, struct dive_site *, dive_sites, compare_sites)
 static MAKE_REMOVE(dive_site_table, struct dive_site *, dive_site)
-MAKE_CLEAR_TABLE(dive_site_table, dive_sites, dive_site)
-MAKE_MOVE_TABLE(dive_site_table, dive_sites)
+MAKE_CLEAR_TABLE_HOOKED(dive_site_table, dive_sites, dive_site, dive_site_table_removed)
+MAKE_MOVE_TABLE_HOOKED(dive_site_table, dive_sites, dive_site_table_added, dive_site_table_removed)
 
 int add_dive_site_to_table(struct dive_site *ds, struct dive_site_table *ds_table)
 {
@@ -221,6 +256,7 @@ bool is_dive_site_selected(struct dive_site *ds)
 void free_dive_site(struct dive_site *ds)
 {
 	if (ds) {
+		fulltext_unregister_site(ds);
 		free(ds->name);
 		free(ds->notes);
 		free(ds->description);
@@ -275,7 +311,7 @@ void copy_dive_site(struct dive_site *orig, struct dive_site *copy)
 	free(copy->notes);
 	free(copy->description);
 
-	copy->location = orig->location;
+	set_dive_site_location(copy, &orig->location);
 	copy->name = copy_string(orig->name);
 	copy->notes = copy_string(orig->notes);
 	copy->description = copy_string(orig->description);
@@ -327,7 +363,7 @@ struct dive_site *get_same_dive_site(const struct dive_site *site)
 
 void merge_dive_site(struct dive_site *a, struct dive_site *b)
 {
-	if (!has_location(&a->location)) a->location = b->location;
+	if (!has_location(&a->location)) set_dive_site_location(a, &b->location);
 	merge_string(&a->name, &b->name);
 	merge_string(&a->notes, &b->notes);
 	merge_string(&a->description, &b->description);
@@ -336,6 +372,8 @@ void merge_dive_site(struct dive_site *a, struct dive_site *b)
 		a->taxonomy = b->taxonomy;
 		memset(&b->taxonomy, 0, sizeof(b->taxonomy));
 	}
+	if (a->full_text)
+		fulltext_register_site(a); // Update the fulltext cache
 }
 
 struct dive_site *find_or_create_dive_site_with_name(const char *name, struct dive_site_table *ds_table)
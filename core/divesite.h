@@ -24,6 +24,7 @@ struct dive_site
 	char *description;
 	char *notes;
 	struct taxonomy_data taxonomy;
+	struct full_text_cache *full_text; /* word cache for full text search */
 };
 
 typedef struct dive_site_table {
@@ -54,6 +55,7 @@ struct dive_site *alloc_or_get_dive_site(uint32_t uuid, struct dive_site_table *
 struct dive_site *alloc_dive_site();
 struct dive_site *alloc_dive_site_with_name(const char *name);
 struct dive_site *alloc_dive_site_with_gps(const char *name, const location_t *loc);
+void set_dive_site_location(struct dive_site *ds, const location_t *loc);
 int nr_of_dives_at_dive_site(struct dive_site *ds);
 bool is_dive_site_selected(struct dive_site *ds);
 void free_dive_site(struct dive_site *ds);
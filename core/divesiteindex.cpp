@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include "divesiteindex.h"
+#include "divesite.h"
+#include "subsurface-string.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+static const int cell_size = 10000; // in micro-degrees, i.e. 0.01 degrees
+static const int lat_cells = 180 * 1000000 / cell_size + 1; // +1: 90 degrees north gets its own cell
+static const int lon_cells = 360 * 1000000 / cell_size;
+static const uint64_t no_cell = UINT64_MAX; // for sites without location
+
+// The earth radius of get_distance()
+static const double earth_radius = 6371000.0;
+
+static int64_t floor_div(int64_t a, int64_t b)
+{
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static int lat_cell(int64_t udeg)
+{
+	return (int)std::clamp<int64_t>(floor_div(udeg + 90000000, cell_size), 0, lat_cells - 1);
+}
+
+// Longitudes wrap around, so that coordinates beyond 180 degrees end up in the right cell.
+static int lon_cell(int64_t udeg)
+{
+	int64_t cell = floor_div(udeg + 180000000, cell_size) % lon_cells;
+	return (int)(cell < 0 ? cell + lon_cells : cell);
+}
+
+static uint64_t cell_key(int lat, int lon)
+{
+	return ((uint64_t)lat << 32) | (uint64_t)lon;
+}
+
+static uint64_t cell_key(const location_t &loc)
+{
+	return has_location(&loc) ? cell_key(lat_cell(loc.lat.udeg), lon_cell(loc.lon.udeg)) : no_cell;
+}
+
+static std::unordered_map<uint64_t, std::vector<dive_site *>> cells;
+static std::unordered_map<const dive_site *, uint64_t> site_cells;
+
+static void add_to_cell(uint64_t key, dive_site *ds)
+{
+	if (key != no_cell)
+		cells[key].push_back(ds);
+}
+
+static void remove_from_cell(uint64_t key, dive_site *ds)
+{
+	auto it = cells.find(key);
+	if (it == cells.end())
+		return;
+	std::vector<dive_site *> &sites = it->second;
+	sites.erase(std::remove(sites.begin(), sites.end(), ds), sites.end());
+	if (sites.empty())
+		cells.erase(it);
+}
+
+extern "C" void dive_site_index_add(struct dive_site *ds)
+{
+	uint64_t key = cell_key(ds->location);
+	if (!site_cells.emplace(ds, key).second)
+		return;
+	add_to_cell(key, ds);
+}
+
+extern "C" void dive_site_index_remove(struct dive_site *ds)
+{
+	auto it = site_cells.find(ds);
+	if (it == site_cells.end())
+		return;
+	remove_from_cell(it->second, ds);
+	site_cells.erase(it);
+}
+
+extern "C" void dive_site_index_update(struct dive_site *ds)
+{
+	auto it = site_cells.find(ds);
+	if (it == site_cells.end())
+		return;
+	uint64_t key = cell_key(ds->location);
+	if (key == it->second)
+		return;
+	remove_from_cell(it->second, ds);
+	add_to_cell(key, ds);
+	it->second = key;
+}
+
+extern "C" bool dive_site_index_contains(const struct dive_site *ds)
+{
+	return site_cells.count(ds) > 0;
+}
+
+// Of two sites, return the one that comes first in the dive site table.
+static dive_site *first_in_table(dive_site *ds1, dive_site *ds2)
+{
+	if (!ds1)
+		return ds2;
+	return get_divesite_idx(ds2, &dive_site_table) < get_divesite_idx(ds1, &dive_site_table) ? ds2 : ds1;
+}
+
+extern "C" struct dive_site *dive_site_index_get_by_gps(const location_t *loc, const char *name)
+{
+	auto it = cells.find(cell_key(*loc));
+	if (it == cells.end())
+		return nullptr;
+	dive_site *res = nullptr;
+	for (dive_site *ds: it->second) {
+		if (same_location(loc, &ds->location) && (!name || same_string(ds->name, name)))
+			res = first_in_table(res, ds);
+	}
+	return res;
+}
+
+// Call a function on the sites of all cells in the given ranges. The longitude range wraps
+// around. If the ranges cover more cells than are in use, visit all cells in use instead.
+template <typename F>
+static void for_each_site_in_cells(int lat_from, int lat_to, int lon_from, int nr_lon, F f)
+{
+	if ((int64_t)(lat_to - lat_from + 1) * nr_lon > (int64_t)cells.size()) {
+		for (auto &[key, sites]: cells) {
+			for (dive_site *ds: sites)
+				f(ds);
+		}
+		return;
+	}
+	for (int lat = lat_from; lat <= lat_to; ++lat) {
+		for (int i = 0; i < nr_lon; ++i) {
+			auto it = cells.find(cell_key(lat, (lon_from + i) % lon_cells));
+			if (it == cells.end())
+				continue;
+			for (dive_site *ds: it->second)
+				f(ds);
+		}
+	}
+}
+
+extern "C" struct dive_site *dive_site_index_get_by_gps_proximity(const location_t *loc, unsigned int distance)
+{
+	if (cells.empty() || distance == 0)
+		return nullptr;
+
+	// The bounding box of all points within the given great-circle distance.
+	// Add a meter to account for the rounding in get_distance().
+	double angle = (distance + 1.0) / earth_radius;
+	double lat = udeg_to_radians(loc->lat.udeg);
+	int64_t dlat_udeg = (int64_t)ceil(angle * 180.0 / M_PI * 1000000.0);
+	int lat_from = lat_cell(loc->lat.udeg - dlat_udeg);
+	int lat_to = lat_cell(loc->lat.udeg + dlat_udeg);
+	int lon_from = 0, nr_lon = lon_cells;
+	if (lat_from > 0 && lat_to < lat_cells - 1 && sin(angle) < cos(lat)) {
+		// No pole within the distance: the longitude range is limited.
+		double dlon = asin(sin(angle) / cos(lat));
+		int64_t dlon_udeg = (int64_t)ceil(dlon * 180.0 / M_PI * 1000000.0);
+		int64_t from = floor_div(loc->lon.udeg - dlon_udeg + 180000000, cell_size);
+		int64_t to = floor_div(loc->lon.udeg + dlon_udeg + 180000000, cell_size);
+		if (to - from + 1 < lon_cells) {
+			lon_from = lon_cell(loc->lon.udeg - dlon_udeg);
+			nr_lon = (int)(to - from + 1);
+		}
+	}
+
+	dive_site *res = nullptr;
+	unsigned int min_distance = distance;
+	for_each_site_in_cells(lat_from, lat_to, lon_from, nr_lon, [&](dive_site *ds) {
+		unsigned int cur_distance = get_distance(&ds->location, loc);
+		if (cur_distance < min_distance) {
+			min_distance = cur_distance;
+			res = ds;
+		} else if (res && cur_distance == min_distance) {
+			res = first_in_table(res, ds);
+		}
+	});
+	return res;
+}
+
+std::vector<dive_site *> dive_site_index_get_in_box(const location_t &sw, const location_t &ne)
+{
+	std::vector<dive_site *> res;
+	if (cells.empty() || sw.lat.udeg > ne.lat.udeg)
+		return res;
+	bool wraps = sw.lon.udeg > ne.lon.udeg;
+	int64_t from = floor_div(sw.lon.udeg + 180000000, cell_size);
+	int64_t to = floor_div(ne.lon.udeg + 180000000, cell_size) + (wraps ? lon_cells : 0);
+	int nr_lon = (int)std::min<int64_t>(to - from + 1, lon_cells);
+	for_each_site_in_cells(lat_cell(sw.lat.udeg), lat_cell(ne.lat.udeg), lon_cell(sw.lon.udeg), nr_lon, [&](dive_site *ds) {
+		const location_t &loc = ds->location;
+		bool in_lon = wraps ? loc.lon.udeg >= sw.lon.udeg || loc.lon.udeg <= ne.lon.udeg
+				    : loc.lon.udeg >= sw.lon.udeg && loc.lon.udeg <= ne.lon.udeg;
+		if (in_lon && loc.lat.udeg >= sw.lat.udeg && loc.lat.udeg <= ne.lat.udeg)
+			res.push_back(ds);
+	});
+	return res;
+}
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-2.0
+
+// A spatial index of the dive sites in the global dive site table.
+// Sites with a location are sorted into a grid of cells of 0.01 degrees,
+// so that proximity searches only have to look at the cells around the
+// searched location instead of every site.
+//
+// The index is kept up to date by the dive site table functions. Code that
+// changes the location of a dive site has to use set_dive_site_location().
+
+#ifndef DIVESITEINDEX_H
+#define DIVESITEINDEX_H
+
+#include "units.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct dive_site;
+
+void dive_site_index_add(struct dive_site *ds);
+void dive_site_index_remove(struct dive_site *ds);
+void dive_site_index_update(struct dive_site *ds); // Call after the location of the dive site changed
+bool dive_site_index_contains(const struct dive_site *ds);
+
+// Returns the candidate with the lowest index in the dive site table among the indexed
+// sites with exactly the given location (and name if not NULL). NULL if there is none.
+struct dive_site *dive_site_index_get_by_gps(const location_t *loc, const char *name);
+// Returns the closest indexed site strictly less than distance meters away.
+// Sites at the same distance are ordered by their index in the dive site table.
+struct dive_site *dive_site_index_get_by_gps_proximity(const location_t *loc, unsigned int distance);
+
+#ifdef __cplusplus
+}
+
+#include <vector>
+
+// The indexed sites in the box between the south-western and north-eastern corners, bounds included.
+// If sw is east of ne, the box extends over the antimeridian. The order of the sites is unspecified.
+std::vector<dive_site *> dive_site_index_get_in_box(const location_t &sw, const location_t &ne);
+
+#endif
+
+#endif
@@ -17,6 +17,7 @@
 #include "display.h"
 #include "divelist.h"
 #include "pref.h"
+#include "stringpool.h"
 #include "subsurface-string.h"
 #include "table.h"
 
@@ -30,9 +31,9 @@ void free_weightsystem(weightsystem_t ws)
 	ws.description = NULL;
 }
 
+/* The description is an interned string, see stringpool.h */
 void free_cylinder(cylinder_t c)
 {
-	free((void *)c.type.description);
 	c.type.description = NULL;
 }
 
@@ -143,6 +144,23 @@ void add_weightsystem_description(const weightsystem_t *weightsystem)
 	}
 }
 
+/* Remove the tank infos that were added after the first nr ones */
+void truncate_tank_info_table(struct tank_info_table *table, int nr)
+{
+	while (table->nr > nr)
+		free_tank_info(table->infos[--table->nr]);
+}
+
+/* Reset the weight system infos to a copy taken earlier, freeing the names added since */
+void restore_ws_info(const struct ws_info_t saved[MAX_WS_INFO])
+{
+	for (int i = 0; i < MAX_WS_INFO; i++) {
+		if (!saved[i].name && ws_info[i].name)
+			free((void *)ws_info[i].name);
+		ws_info[i] = saved[i];
+	}
+}
+
 weightsystem_t clone_weightsystem(weightsystem_t ws)
 {
 	weightsystem_t res = { ws.weight, copy_string(ws.description), ws.auto_filled };
@@ -166,7 +184,7 @@ void add_cloned_weightsystem_at(struct weightsystem_table *t, weightsystem_t ws)
 cylinder_t clone_cylinder(cylinder_t cyl)
 {
 	cylinder_t res = cyl;
-	res.type.description = copy_string(res.type.description);
+	res.type.description = intern_string(res.type.description);
 	return res;
 }
 
@@ -367,7 +385,7 @@ static void copy_cylinder_type(const cylinder_t *s, cylinder_t *d)
 {
 	free_cylinder(*d);
 	d->type = s->type;
-	d->type.description = s->type.description ? strdup(s->type.description) : NULL;
+	d->type.description = intern_string(s->type.description);
 	d->gasmix = s->gasmix;
 	d->depth = s->depth;
 	d->cylinder_use = s->cylinder_use;
@@ -391,7 +409,7 @@ void copy_cylinder_types(const struct dive *s, struct dive *d)
 cylinder_t *add_empty_cylinder(struct cylinder_table *t)
 {
 	cylinder_t cyl = empty_cylinder;
-	cyl.type.description = strdup("");
+	cyl.type.description = intern_string("");
 	add_cylinder(t, t->nr, cyl);
 	return &t->cylinders[t->nr - 1];
 }
@@ -438,7 +456,7 @@ void fill_default_cylinder(const struct dive *dive, cylinder_t *cyl)
 	for (int i = 0; i < tank_info_table.nr; ++i) {
 		struct tank_info *ti = &tank_info_table.infos[i];
 		if (strcmp(ti->name, cyl_name) == 0) {
-			cyl->type.description = strdup(ti->name);
+			cyl->type.description = intern_string(ti->name);
 			if (ti->ml) {
 				cyl->type.size.mliter = ti->ml;
 				cyl->type.workingpressure.mbar = ti->bar * 1000;
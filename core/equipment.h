@@ -124,12 +124,14 @@ extern void reset_tank_info_table(struct tank_info_table *table);
 extern void clear_tank_info_table(struct tank_info_table *table);
 extern void add_tank_info_metric(struct tank_info_table *table, const char *name, int ml, int bar);
 extern void add_tank_info_imperial(struct tank_info_table *table, const char *name, int cuft, int psi);
+extern void truncate_tank_info_table(struct tank_info_table *table, int nr);
 
 struct ws_info_t {
 	const char *name;
 	int grams;
 };
 extern struct ws_info_t ws_info[MAX_WS_INFO];
+extern void restore_ws_info(const struct ws_info_t saved[MAX_WS_INFO]);
 
 #ifdef __cplusplus
 }
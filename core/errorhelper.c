@@ -12,11 +12,18 @@
 int verbose;
 
 static void (*error_cb)(char *) = NULL;
+static __thread struct membuffer *collected_errors = NULL;
 
 int report_error(const char *fmt, ...)
 {
 	struct membuffer buf = { 0 };
 
+	if (collected_errors) {
+		VA_BUF(collected_errors, fmt);
+		put_bytes(collected_errors, "\n", 1);
+		return -1;
+	}
+
 	/* if there is no error callback registered, don't produce errors */
 	if (!error_cb)
 		return -1;
@@ -31,3 +38,8 @@ void set_error_cb(void(*cb)(char *))
 {
 	error_cb = cb;
 }
+
+void collect_errors(struct membuffer *b)
+{
+	collected_errors = b;
+}
@@ -12,6 +12,11 @@ extern int verbose;
 extern int report_error(const char *fmt, ...);
 extern void set_error_cb(void(*cb)(char *));	// Callback takes ownership of passed string
 
+// Append the errors of the calling thread to a buffer, one per line, instead of
+// passing them to the callback. For worker threads. Pass NULL to stop collecting.
+struct membuffer;
+extern void collect_errors(struct membuffer *b);
+
 #ifdef __cplusplus
 }
 #endif
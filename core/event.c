@@ -107,9 +107,16 @@ static int evn_allocated = 0;
 
 void clear_events(void)
 {
-	for (int i = 0; i < evn_used; i++)
+	clear_events_from(0);
+}
+
+/* forget the event names that were remembered after the first nr ones */
+void clear_events_from(int nr)
+{
+	for (int i = nr; i < evn_used; i++)
 		free(ev_namelist[i].ev_name);
-	evn_used = 0;
+	if (nr < evn_used)
+		evn_used = nr;
 }
 
 void remember_event(const char *eventname)
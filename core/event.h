@@ -57,6 +57,7 @@ extern struct event *clone_event_rename(const struct event *ev, const char *name
 extern bool same_event(const struct event *a, const struct event *b);
 extern void remember_event(const char *eventname);
 extern void clear_events(void);
+extern void clear_events_from(int nr);
 
 /* Since C doesn't have parameter-based overloading, two versions of get_next_event. */
 extern const struct event *get_next_event(const struct event *event, const char *name);
@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "eventindex.h"
+#include "divecomputer.h"
+#include "event.h"
+#include "qthelper.h"
+#include "stringpool.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+/*
+ * The event names, indexed by their id. The names are interned strings (see
+ * stringpool.h), so they are compared by pointer. There are only a few dozen
+ * different event names, so a linear search is good enough. Names are never
+ * removed, so that the ids stay valid. The table and the building of the indexes
+ * of the dive computers are protected by lock_event_index(), because profiles
+ * may be calculated from different threads. Lookups of an existing index don't
+ * take the lock, see get_event_index().
+ */
+static const char *const builtin_event_names[] = { "gaschange", "modechange", "SP change" };
+static const char **event_names = NULL;
+static int nr_event_names = 0, alloc_event_names = 0;
+
+struct event_type_index {
+	int id;
+	int nr;
+	bool sorted;		/* false if the events are not ordered by time */
+	int *times;
+	const struct event **events;
+};
+
+struct event_index {
+	const struct event *head;	/* dc->events when the index was built */
+	int nr_events;
+	int nr_types;
+	struct event_type_index *types; /* sorted by id */
+	int *times;			/* storage for the times and events of all types */
+	const struct event **events;
+};
+
+/* The name must be interned */
+static void add_event_name(const char *name)
+{
+	if (nr_event_names == alloc_event_names) {
+		alloc_event_names = alloc_event_names ? alloc_event_names * 2 : 32;
+		event_names = realloc(event_names, alloc_event_names * sizeof(const char *));
+		if (!event_names)
+			exit(1);
+	}
+	event_names[nr_event_names++] = name;
+}
+
+/* The lock must be held */
+static int intern_event_name(const char *name)
+{
+	int i;
+
+	if (!nr_event_names) {
+		for (i = 0; i < (int)(sizeof(builtin_event_names) / sizeof(builtin_event_names[0])); i++)
+			add_event_name(intern_string(builtin_event_names[i]));
+	}
+	name = intern_string(name);
+	for (i = 0; i < nr_event_names; i++) {
+		if (event_names[i] == name)
+			return i;
+	}
+	add_event_name(name);
+	return nr_event_names - 1;
+}
+
+int get_event_name_id(const char *name)
+{
+	int id;
+
+	if (!name || !*name)
+		return -1;
+	lock_event_index();
+	id = intern_event_name(name);
+	unlock_event_index();
+	return id;
+}
+
+void free_event_index(struct event_index *index)
+{
+	if (!index)
+		return;
+	free(index->types);
+	free(index->times);
+	free(index->events);
+	free(index);
+}
+
+void invalidate_event_index(struct divecomputer *dc)
+{
+	struct event_index *index;
+
+	lock_event_index();
+	index = dc->event_index;
+	__atomic_store_n(&dc->event_index, NULL, __ATOMIC_RELEASE);
+	free_event_index(index);
+	unlock_event_index();
+}
+
+/* The lock must be held */
+static struct event_index *build_event_index(const struct divecomputer *dc)
+{
+	struct event_index *index;
+	const struct event *ev;
+	int *ids, *type_of_id, i, pos, offset;
+
+	index = calloc(1, sizeof(*index));
+	if (!index)
+		exit(1);
+	index->head = dc->events;
+	for (ev = dc->events; ev; ev = ev->next)
+		index->nr_events++;
+	if (!index->nr_events)
+		return index;
+
+	ids = malloc(index->nr_events * sizeof(int));
+	index->times = malloc(index->nr_events * sizeof(int));
+	index->events = malloc(index->nr_events * sizeof(const struct event *));
+	if (!ids || !index->times || !index->events)
+		exit(1);
+	for (i = 0, ev = dc->events; ev; ev = ev->next, i++)
+		ids[i] = intern_event_name(ev->name);
+
+	/* Count the events of each name, then distribute the events on the types */
+	type_of_id = calloc(nr_event_names, sizeof(int));
+	if (!type_of_id)
+		exit(1);
+	for (i = 0; i < index->nr_events; i++) {
+		if (type_of_id[ids[i]]++ == 0)
+			index->nr_types++;
+	}
+	index->types = calloc(index->nr_types, sizeof(struct event_type_index));
+	if (!index->types)
+		exit(1);
+	for (i = 0, pos = 0, offset = 0; i < nr_event_names; i++) {
+		struct event_type_index *type;
+		int nr = type_of_id[i];
+
+		if (!nr)
+			continue;
+		type = &index->types[pos];
+		type->id = i;
+		type->sorted = true;
+		type->times = index->times + offset;
+		type->events = index->events + offset;
+		offset += nr;
+		type_of_id[i] = pos++;
+	}
+	for (i = 0, ev = dc->events; ev; ev = ev->next, i++) {
+		struct event_type_index *type = &index->types[type_of_id[ids[i]]];
+
+		if (type->nr > 0 && type->times[type->nr - 1] > (int)ev->time.seconds)
+			type->sorted = false;
+		type->times[type->nr] = ev->time.seconds;
+		type->events[type->nr] = ev;
+		type->nr++;
+	}
+	free(type_of_id);
+	free(ids);
+	return index;
+}
+
+/*
+ * The index is a cache, therefore it is built for const dive computers as well.
+ * Once built, the index is only read. Therefore, the lock is only taken when
+ * there is no valid index (double-checked locking). The pointer is published
+ * with release semantics, so that a thread that sees the pointer also sees the
+ * content of the index. The compiler builtins are used, because the core is C99.
+ */
+static const struct event_index *get_event_index(const struct divecomputer *dc)
+{
+	struct divecomputer *mutable_dc = (struct divecomputer *)dc;
+	struct event_index *index;
+
+	index = __atomic_load_n(&mutable_dc->event_index, __ATOMIC_ACQUIRE);
+	if (index && index->head == dc->events)
+		return index;
+
+	lock_event_index();
+	index = mutable_dc->event_index;
+	/* Catch code that replaced the start of the list without invalidating the index */
+	if (index && index->head != dc->events) {
+		__atomic_store_n(&mutable_dc->event_index, NULL, __ATOMIC_RELEASE);
+		free_event_index(index);
+		index = NULL;
+	}
+	if (!index) {
+		index = build_event_index(dc);
+		__atomic_store_n(&mutable_dc->event_index, index, __ATOMIC_RELEASE);
+	}
+	unlock_event_index();
+	return index;
+}
+
+static const struct event_type_index *get_event_type_index(const struct divecomputer *dc, int id)
+{
+	const struct event_index *index;
+	int i;
+
+	if (!dc || id < 0)
+		return NULL;
+	index = get_event_index(dc);
+	for (i = 0; i < index->nr_types; i++) {
+		if (index->types[i].id == id)
+			return &index->types[i];
+		if (index->types[i].id > id)
+			break;
+	}
+	return NULL;
+}
+
+int count_dc_events(const struct divecomputer *dc)
+{
+	return dc ? get_event_index(dc)->nr_events : 0;
+}
+
+const struct event *const *get_dc_events_by_id(const struct divecomputer *dc, int id, int *nr)
+{
+	const struct event_type_index *type = get_event_type_index(dc, id);
+
+	*nr = type ? type->nr : 0;
+	return type ? type->events : NULL;
+}
+
+const struct event *get_first_dc_event(const struct divecomputer *dc, int id)
+{
+	const struct event_type_index *type = get_event_type_index(dc, id);
+
+	return type ? type->events[0] : NULL;
+}
+
+const struct event *get_last_dc_event_at(const struct divecomputer *dc, int id, int time)
+{
+	const struct event_type_index *type = get_event_type_index(dc, id);
+	int lo = 0, hi;
+
+	if (!type)
+		return NULL;
+	if (type->sorted) {
+		hi = type->nr;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (type->times[mid] <= time)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+	} else {
+		/* Do what a walk of the list does: stop at the first later event */
+		while (lo < type->nr && type->times[lo] <= time)
+			lo++;
+	}
+	return lo > 0 ? type->events[lo - 1] : NULL;
+}
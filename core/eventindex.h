@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-2.0
+
+// An index of the events of a dive computer. The event names are interned into
+// small integer ids and for each id the events are kept in an array sorted by
+// time. Thus, questions such as "which gas is breathed at time t" are answered
+// by a binary search instead of comparing the name of every event in the list.
+//
+// The index is built on first use. It is dropped by the functions that change the
+// event list of a dive computer (add_event_to_dc(), remove_event_from_dc(), ...).
+// Code that modifies dc->events directly has to call invalidate_event_index().
+// The returned events are valid until the event list is changed.
+
+#ifndef EVENTINDEX_H
+#define EVENTINDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct divecomputer;
+struct event;
+struct event_index;
+
+// The ids of the event names that the core looks for. Other names get
+// their ids on first use.
+enum event_name_id {
+	EVENT_ID_GASCHANGE,	// "gaschange"
+	EVENT_ID_MODECHANGE,	// "modechange"
+	EVENT_ID_SP_CHANGE,	// "SP change"
+};
+
+extern int get_event_name_id(const char *name); // -1 if name is NULL or empty
+extern void invalidate_event_index(struct divecomputer *dc);
+extern void free_event_index(struct event_index *index);
+
+extern int count_dc_events(const struct divecomputer *dc);
+// The events with the given name id in the order of the event list. Sets nr to the number of events.
+extern const struct event *const *get_dc_events_by_id(const struct divecomputer *dc, int id, int *nr);
+extern const struct event *get_first_dc_event(const struct divecomputer *dc, int id);
+// The last event with the given name id at or before the given time. NULL if there is none.
+extern const struct event *get_last_dc_event_at(const struct divecomputer *dc, int id, int time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
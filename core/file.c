@@ -6,6 +6,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
 #include "gettext.h"
 #include <zip.h>
 #include <time.h>
@@ -38,6 +42,7 @@ int readfile(const char *filename, struct memblock *mem)
 
 	mem->buffer = NULL;
 	mem->size = 0;
+	mem->mapped = 0;
 
 	fd = subsurface_open(filename, O_RDONLY | O_BINARY, 0);
 	if (fd < 0)
@@ -75,6 +80,65 @@ out:
 	return ret;
 }
 
+/*
+ * Like readfile(), but map the file into memory instead of copying it.
+ * The mapping is private and writable, so that parsers may modify the
+ * buffer in place without touching the file. As with readfile(), the
+ * buffer is zero-terminated: the remainder of the last page of a
+ * mapping is filled with zeroes. Therefore, files whose size is a
+ * multiple of the page size are read the old way. The same goes for
+ * platforms without mmap() and for any failure to map the file.
+ *
+ * The buffer must be released with free_memblock() and must not be
+ * realloc()ed.
+ */
+int readfile_mapped(const char *filename, struct memblock *mem)
+{
+#ifndef WIN32
+	int fd;
+	struct stat st;
+	long pagesize;
+	void *map;
+
+	mem->buffer = NULL;
+	mem->size = 0;
+	mem->mapped = 0;
+
+	fd = subsurface_open(filename, O_RDONLY | O_BINARY, 0);
+	if (fd < 0)
+		return fd;
+	pagesize = sysconf(_SC_PAGESIZE);
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || !st.st_size ||
+	    pagesize <= 0 || st.st_size % pagesize == 0 || st.st_size > INT_MAX) {
+		close(fd);
+		return readfile(filename, mem);
+	}
+	map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return readfile(filename, mem);
+	mem->buffer = map;
+	mem->size = st.st_size;
+	mem->mapped = st.st_size;
+	return (int)st.st_size;
+#else
+	return readfile(filename, mem);
+#endif
+}
+
+void free_memblock(struct memblock *mem)
+{
+#ifndef WIN32
+	if (mem->mapped)
+		munmap(mem->buffer, mem->mapped);
+	else
+#endif
+		free(mem->buffer);
+	mem->buffer = NULL;
+	mem->size = 0;
+	mem->mapped = 0;
+}
+
 
 static void zip_read(struct zip_file *file, const char *filename, struct dive_table *table, struct trip_table *trips,
 		     struct dive_site_table *sites, struct device_table *devices, struct filter_preset_table *filter_presets)
@@ -327,7 +391,7 @@ int parse_file(const char *filename, struct dive_table *table, struct trip_table
 	if (git)
 		return git_load_dives(git, branch, table, trips, sites, devices, filter_presets);
 
-	if ((ret = readfile(filename, &mem)) < 0) {
+	if ((ret = readfile_mapped(filename, &mem)) < 0) {
 		/* we don't want to display an error if this was the default file  */
 		if (same_string(filename, prefs.default_filename))
 			return 0;
@@ -340,7 +404,7 @@ int parse_file(const char *filename, struct dive_table *table, struct trip_table
 	fmt = strrchr(filename, '.');
 	if (fmt && (!strcasecmp(fmt + 1, "DB") || !strcasecmp(fmt + 1, "BAK") || !strcasecmp(fmt + 1, "SQL"))) {
 		if (!try_to_open_db(filename, &mem, table, trips, sites, devices)) {
-			free(mem.buffer);
+			free_memblock(&mem);
 			return 0;
 		}
 	}
@@ -348,7 +412,7 @@ int parse_file(const char *filename, struct dive_table *table, struct trip_table
 	/* Divesoft Freedom */
 	if (fmt && (!strcasecmp(fmt + 1, "DLF"))) {
 		ret = parse_dlf_buffer(mem.buffer, mem.size, table, trips, sites, devices);
-		free(mem.buffer);
+		free_memblock(&mem);
 		return ret;
 	}
 
@@ -359,26 +423,26 @@ int parse_file(const char *filename, struct dive_table *table, struct trip_table
 		char *wl_name = memcpy(calloc(t - filename + 1, 1), filename, t - filename);
 		wl_name = realloc(wl_name, strlen(wl_name) + 5);
 		wl_name = strcat(wl_name, ".add");
-		if((ret = readfile(wl_name, &wl_mem)) < 0) {
+		if((ret = readfile_mapped(wl_name, &wl_mem)) < 0) {
 			fprintf(stderr, "No file %s found. No WLog extensions.\n", wl_name);
 			ret = datatrak_import(&mem, NULL, table, trips, sites, devices);
 		} else {
 			ret = datatrak_import(&mem, &wl_mem, table, trips, sites, devices);
-			free(wl_mem.buffer);
+			free_memblock(&wl_mem);
 		}
-		free(mem.buffer);
+		free_memblock(&mem);
 		free(wl_name);
 		return ret;
 	}
 
 	/* OSTCtools */
 	if (fmt && (!strcasecmp(fmt + 1, "DIVE"))) {
-		free(mem.buffer);
+		free_memblock(&mem);
 		ostctools_import(filename, table, trips, sites);
 		return 0;
 	}
 
 	ret = parse_file_buffer(filename, &mem, table, trips, sites, devices, filter_presets);
-	free(mem.buffer);
+	free_memblock(&mem);
 	return ret;
 }
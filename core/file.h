@@ -10,6 +10,7 @@
 struct memblock {
 	void *buffer;
 	size_t size;
+	size_t mapped;	/* length of the mapping if the buffer was mmap()ed, 0 if it was malloc()ed */
 };
 
 struct trip_table;
@@ -28,6 +29,8 @@ extern int datatrak_import(struct memblock *mem, struct memblock *wl_mem, struct
 extern void ostctools_import(const char *file, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites);
 
 extern int readfile(const char *filename, struct memblock *mem);
+extern int readfile_mapped(const char *filename, struct memblock *mem);
+extern void free_memblock(struct memblock *mem);
 extern int parse_file(const char *filename, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites,
 		      struct device_table *devices, struct filter_preset_table *filter_presets);
 extern int try_to_open_zip(const char *filename, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites,
@@ -35,6 +38,7 @@ extern int try_to_open_zip(const char *filename, struct dive_table *table, struc
 
 // Platform specific functions
 extern int subsurface_rename(const char *path, const char *newpath);
+extern int subsurface_remove(const char *path);
 extern int subsurface_dir_rename(const char *path, const char *newpath);
 extern int subsurface_open(const char *path, int oflags, mode_t mode);
 extern FILE *subsurface_fopen(const char *path, const char *mode);
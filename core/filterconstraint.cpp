@@ -8,6 +8,7 @@
 #include "tag.h"
 #include "trip.h"
 #include "string-format.h"
+#include "subsurface-qt/divelistnotifier.h"
 #include "subsurface-string.h"
 #include "subsurface-time.h"
 #include <QDateTime>
@@ -831,17 +832,21 @@ static bool listContainsSuperstring(const QStringList &list, const QString &s, S
 			   { return strchk(s2, s); } );
 }
 
-// Check whether any of the items of the first list is in the second list as a super string.
-// The mode is controlled by the second argument
-static bool check(const filter_constraint &c, const QStringList &list)
+static StrCheck get_strchk(enum filter_constraint_string_mode mode)
 {
-	StrCheck strchk =
-		c.string_mode == FILTER_CONSTRAINT_SUBSTRING ?
+	return	mode == FILTER_CONSTRAINT_SUBSTRING ?
 			[](const QString &s1, const QString &s2) { return s1.contains(s2, Qt::CaseInsensitive); } :
-		c.string_mode == FILTER_CONSTRAINT_STARTS_WITH ?
+		mode == FILTER_CONSTRAINT_STARTS_WITH ?
 			[](const QString &s1, const QString &s2) { return s1.startsWith(s2, Qt::CaseInsensitive); } :
 		/* FILTER_CONSTRAINT_EXACT */
 			[](const QString &s1, const QString &s2) { return s1.compare(s2, Qt::CaseInsensitive) == 0; };
+}
+
+// Check whether any of the items of the first list is in the second list as a super string.
+// The mode is controlled by the second argument
+static bool check(const filter_constraint &c, const QStringList &list)
+{
+	StrCheck strchk = get_strchk(c.string_mode);
 	return std::any_of(c.data.string_list->begin(), c.data.string_list->end(),
 			   [&list, strchk](const QString &item)
 			   { return listContainsSuperstring(list, item, strchk); }) != c.negate;
@@ -1136,3 +1141,281 @@ bool filter_constraint_match_dive(const filter_constraint &c, const struct dive
 	}
 	return false;
 }
+
+// Returns true if range [from2, to2] in the given mode is contained in range [from1, to1].
+template <typename T>
+static bool range_contained(enum filter_constraint_range_mode mode, T from1, T to1, T from2, T to2)
+{
+	switch (mode) {
+	case FILTER_CONSTRAINT_EQUAL:
+		return from1 == from2;
+	case FILTER_CONSTRAINT_LESS:
+		return to2 <= to1;
+	case FILTER_CONSTRAINT_GREATER:
+		return from2 >= from1;
+	case FILTER_CONSTRAINT_RANGE:
+		return from2 >= from1 && to2 <= to1;
+	}
+	return false;
+}
+
+bool filter_constraint_narrows(const filter_constraint &c, const filter_constraint &old)
+{
+	if (c == old)
+		return true;
+	if (c.type != old.type || c.negate != old.negate)
+		return false;
+
+	// For negated constraints, the dives outside of the range match. Thus,
+	// the constraint narrows if the new range contains the old range.
+	const filter_constraint &inner = c.negate ? old : c;
+	const filter_constraint &outer = c.negate ? c : old;
+	if (filter_constraint_is_multiple_choice(c.type))
+		return (inner.data.multiple_choice & ~outer.data.multiple_choice) == 0;
+	if (c.range_mode != old.range_mode || !filter_constraint_has_range_mode(c.type))
+		return false;
+	switch (c.type) {
+	case FILTER_CONSTRAINT_DATE:
+		// Days are monotonic in the timestamp, so comparing timestamps is fine.
+		return range_contained(c.range_mode, outer.data.timestamp_range.from, outer.data.timestamp_range.to,
+				       inner.data.timestamp_range.from, inner.data.timestamp_range.to);
+	case FILTER_CONSTRAINT_DATE_TIME:
+		// In EQUAL mode, the timestamp is tested against the whole dive. Only allow identical constraints.
+		return c.range_mode != FILTER_CONSTRAINT_EQUAL &&
+		       range_contained(c.range_mode, outer.data.timestamp_range.from, outer.data.timestamp_range.to,
+				       inner.data.timestamp_range.from, inner.data.timestamp_range.to);
+	case FILTER_CONSTRAINT_TIME_OF_DAY:
+		// Time-of-day ranges are cyclic, see check_time_of_day_range(). Only allow identical constraints.
+		return false;
+	default:
+		return range_contained(c.range_mode, outer.data.numerical_range.from, outer.data.numerical_range.to,
+				       inner.data.numerical_range.from, inner.data.numerical_range.to);
+	}
+}
+
+bool filter_constraints_narrow(const std::vector<filter_constraint> &constraints, const std::vector<filter_constraint> &old)
+{
+	if (constraints.size() < old.size())
+		return false;
+	for (size_t i = 0; i < old.size(); ++i) {
+		if (!filter_constraint_narrows(constraints[i], old[i]))
+			return false;
+	}
+	return true;
+}
+
+// Returns true if a change of the given fields can change whether a dive
+// matches a constraint of the given type. Constraints on data that is not
+// described by DiveField (cylinders, weights, dive computers) are always
+// reevaluated.
+bool filter_constraint_depends_on(enum filter_constraint_type type, const DiveField &field)
+{
+	switch (type) {
+	case FILTER_CONSTRAINT_DATE:
+	case FILTER_CONSTRAINT_DATE_TIME:
+	case FILTER_CONSTRAINT_TIME_OF_DAY:
+	case FILTER_CONSTRAINT_YEAR:
+	case FILTER_CONSTRAINT_DAY_OF_WEEK:
+		return field.datetime || field.duration;
+	case FILTER_CONSTRAINT_RATING:
+		return field.rating;
+	case FILTER_CONSTRAINT_WAVESIZE:
+		return field.wavesize;
+	case FILTER_CONSTRAINT_CURRENT:
+		return field.current;
+	case FILTER_CONSTRAINT_VISIBILITY:
+		return field.visibility;
+	case FILTER_CONSTRAINT_SURGE:
+		return field.surge;
+	case FILTER_CONSTRAINT_CHILL:
+		return field.chill;
+	case FILTER_CONSTRAINT_DEPTH:
+		return field.depth;
+	case FILTER_CONSTRAINT_DURATION:
+		return field.duration;
+	case FILTER_CONSTRAINT_WATER_TEMP:
+		return field.water_temp;
+	case FILTER_CONSTRAINT_AIR_TEMP:
+		return field.air_temp;
+	case FILTER_CONSTRAINT_WATER_DENSITY:
+		return field.salinity;
+	case FILTER_CONSTRAINT_DIVE_MODE:
+		return field.mode;
+	case FILTER_CONSTRAINT_TAGS:
+		// The dive mode is matched like a tag.
+		return field.tags || field.mode;
+	case FILTER_CONSTRAINT_PEOPLE:
+		return field.buddy || field.divemaster;
+	case FILTER_CONSTRAINT_LOCATION:
+		return field.divesite;
+	case FILTER_CONSTRAINT_SUIT:
+		return field.suit;
+	case FILTER_CONSTRAINT_NOTES:
+		return field.notes;
+	default:
+		return true;
+	}
+}
+
+// Compiled constraints
+
+struct CompiledFilterConstraints::Constraint {
+	filter_constraint c;
+	bool (*match)(const Constraint &c, const struct dive *d);
+	int cost;				// constraints are checked in order of increasing cost
+	int64_t from, to;			// inclusive bounds of range constraints
+	std::vector<const divetag *> tags;	// matching tags of tag constraints, sorted
+	std::vector<const divetag *> global_tags; // all tags of the global tag list, sorted
+	bool divemodes[NUM_DIVEMODE];		// matching dive modes of tag constraints
+	Constraint(const filter_constraint &c);
+	bool in_range(int64_t v) const;
+	bool matches_string(const QString &s) const;
+	bool matches_tag(const divetag *tag) const;
+};
+
+bool CompiledFilterConstraints::Constraint::in_range(int64_t v) const
+{
+	return (v >= from && v <= to) != c.negate;
+}
+
+bool CompiledFilterConstraints::Constraint::matches_string(const QString &s) const
+{
+	StrCheck strchk = get_strchk(c.string_mode);
+	return std::any_of(c.data.string_list->begin(), c.data.string_list->end(),
+			   [&s, strchk](const QString &item) { return strchk(s, item); });
+}
+
+bool CompiledFilterConstraints::Constraint::matches_tag(const divetag *tag) const
+{
+	if (std::binary_search(tags.begin(), tags.end(), tag))
+		return true;
+	// Copied dives may own divetags that are not in the global tag list (see taglist_copy()).
+	// Match these by name.
+	return !std::binary_search(global_tags.begin(), global_tags.end(), tag) &&
+	       matches_string(QString(tag->name).trimmed());
+}
+
+// Convert the range mode into inclusive bounds
+static void get_bounds(enum filter_constraint_range_mode mode, int64_t from_in, int64_t to_in, int64_t &from, int64_t &to)
+{
+	from = mode == FILTER_CONSTRAINT_LESS ? INT64_MIN : from_in;
+	to = mode == FILTER_CONSTRAINT_EQUAL ? from_in :
+	     mode == FILTER_CONSTRAINT_GREATER ? INT64_MAX : to_in;
+}
+
+using Constraint = CompiledFilterConstraints::Constraint;
+
+CompiledFilterConstraints::Constraint::Constraint(const filter_constraint &cIn) : c(cIn),
+	match([](const Constraint &c, const struct dive *d) { return filter_constraint_match_dive(c.c, d); }),
+	cost(1), from(0), to(0), divemodes { }
+{
+	if (is_numerical_constraint(c.type))
+		get_bounds(c.range_mode, c.data.numerical_range.from, c.data.numerical_range.to, from, to);
+
+	switch (c.type) {
+	case FILTER_CONSTRAINT_DATE:
+		get_bounds(c.range_mode, days_since_epoch(c.data.timestamp_range.from),
+			   days_since_epoch(c.data.timestamp_range.to), from, to);
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(days_since_epoch(d->when)); };
+		break;
+	case FILTER_CONSTRAINT_YEAR:
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(utc_year(d->when)); };
+		break;
+	case FILTER_CONSTRAINT_RATING:
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(d->rating); };
+		break;
+	case FILTER_CONSTRAINT_WAVESIZE:
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(d->wavesize); };
+		break;
+	case FILTER_CONSTRAINT_CURRENT:
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(d->current); };
+		break;
+	case FILTER_CONSTRAINT_VISIBILITY:
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(d->visibility); };
+		break;
+	case FILTER_CONSTRAINT_SURGE:
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(d->surge); };
+		break;
+	case FILTER_CONSTRAINT_CHILL:
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(d->chill); };
+		break;
+	case FILTER_CONSTRAINT_DEPTH:
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(d->maxdepth.mm); };
+		break;
+	case FILTER_CONSTRAINT_DURATION:
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(d->duration.seconds); };
+		break;
+	case FILTER_CONSTRAINT_WEIGHT:
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(total_weight(d)); };
+		cost = 2;
+		break;
+	case FILTER_CONSTRAINT_WATER_TEMP:
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(d->watertemp.mkelvin); };
+		break;
+	case FILTER_CONSTRAINT_AIR_TEMP:
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(d->airtemp.mkelvin); };
+		break;
+	case FILTER_CONSTRAINT_WATER_DENSITY:
+		match = [](const Constraint &c, const struct dive *d) { return c.in_range(d->user_salinity ? d->user_salinity : d->salinity); };
+		break;
+	case FILTER_CONSTRAINT_SAC:
+		match = [](const Constraint &c, const struct dive *d) { return d->sac ? c.in_range(d->sac) : c.c.negate; };
+		break;
+	case FILTER_CONSTRAINT_CYLINDER_SIZE:
+		match = [](const Constraint &c, const struct dive *d) {
+			return std::any_of(d->cylinders.cylinders, d->cylinders.cylinders + d->cylinders.nr,
+					   [&c](const cylinder_t &cyl) { return cyl.type.size.mliter && c.in_range(cyl.type.size.mliter); });
+		};
+		cost = 2;
+		break;
+	case FILTER_CONSTRAINT_TAGS: {
+		// Tags are stored only once in the global tag list. Thus, we can
+		// match the strings against all tags and dive modes up front.
+		for (const tag_entry *entry = g_tag_list; entry; entry = entry->next) {
+			global_tags.push_back(entry->tag);
+			if (matches_string(QString(entry->tag->name).trimmed()))
+				tags.push_back(entry->tag);
+		}
+		std::sort(tags.begin(), tags.end());
+		std::sort(global_tags.begin(), global_tags.end());
+		for (int i = 0; i < NUM_DIVEMODE; ++i)
+			divemodes[i] = matches_string(gettextFromC::tr(divemode_text_ui[i]).trimmed());
+		match = [](const Constraint &c, const struct dive *d) {
+			bool res = d->dc.divemode < NUM_DIVEMODE && c.divemodes[d->dc.divemode];
+			for (const tag_entry *tag = d->tag_list; tag && !res; tag = tag->next)
+				res = c.matches_tag(tag->tag);
+			return res != c.c.negate;
+		};
+		cost = 2;
+		break;
+	}
+	default:
+		// Strings and everything that is not a plain range are checked as before
+		if (filter_constraint_is_string(c.type))
+			cost = 3;
+		break;
+	}
+}
+
+CompiledFilterConstraints::CompiledFilterConstraints(const std::vector<filter_constraint> &constraintsIn)
+{
+	constraints.reserve(constraintsIn.size());
+	for (const filter_constraint &c: constraintsIn) {
+		// Empty string constraints match every dive
+		if (filter_constraint_is_string(c.type) && c.data.string_list->isEmpty())
+			continue;
+		constraints.emplace_back(c);
+	}
+	std::stable_sort(constraints.begin(), constraints.end(),
+			 [](const Constraint &c1, const Constraint &c2) { return c1.cost < c2.cost; });
+}
+
+CompiledFilterConstraints::~CompiledFilterConstraints()
+{
+}
+
+bool CompiledFilterConstraints::match_dive(const struct dive *d) const
+{
+	return std::all_of(constraints.begin(), constraints.end(),
+			   [d] (const Constraint &c) { return c.match(c, d); });
+}
@@ -7,9 +7,13 @@
 #include "units.h"
 
 struct dive;
+#ifdef __cplusplus
+struct DiveField;
+#endif
 
 #ifdef __cplusplus
 #include <QStringList>
+#include <vector>
 extern "C" {
 #else
 typedef void QStringList;
@@ -152,6 +156,22 @@ void filter_constraint_set_timestamp_from(filter_constraint &c, timestamp_t from
 void filter_constraint_set_timestamp_to(filter_constraint &c, timestamp_t to); // convert according to current units (metric or imperial)
 void filter_constraint_set_multiple_choice(filter_constraint &c, uint64_t);
 bool filter_constraint_match_dive(const filter_constraint &c, const struct dive *d);
+bool filter_constraint_narrows(const filter_constraint &c, const filter_constraint &old); // true if every dive matching c also matches old
+bool filter_constraints_narrow(const std::vector<filter_constraint> &constraints, const std::vector<filter_constraint> &old); // same for all constraints of a list
+bool filter_constraint_depends_on(enum filter_constraint_type type, const DiveField &field); // true if a change of field can change whether a dive matches
+
+// A list of constraints prepared for matching many dives: range modes are turned
+// into bounds, the checks are ordered by cost and tag constraints are matched against
+// the global tag list once. Since tags may be added, compile anew for every filter run.
+class CompiledFilterConstraints {
+public:
+	CompiledFilterConstraints(const std::vector<filter_constraint> &constraints);
+	~CompiledFilterConstraints();
+	bool match_dive(const struct dive *d) const; // true if all constraints match
+	struct Constraint;
+private:
+	std::vector<Constraint> constraints;
+};
 #endif
 
 #endif
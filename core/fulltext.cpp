@@ -7,26 +7,52 @@
 #include "trip.h"
 #include "qthelper.h"
 #include <QLocale>
+#include <QSet>
+#include <QtConcurrent>
+#include <algorithm>
+#include <iterator>
 #include <map>
 
-// This class caches each dives words, so that we can unregister a dive from the full text search
+// This class caches the words of each dive, dive site and trip, so that
+// we can unregister them from the full text search
 struct full_text_cache {
 	std::vector<QString> words;
 };
 
+// The dives, dive sites and trips that contain a word. The words of dive sites
+// and trips are stored only once and joined to their dives when searching.
+struct WordEntry {
+	std::vector<dive *> dives;
+	std::vector<dive_site *> sites;
+	std::vector<dive_trip *> trips;
+	bool empty() const;
+};
+
 // The FullText-search class
 class FullText {
-	std::map<QString, std::vector<dive *>> words; // Dives that belong to each word
+	using WordMap = std::map<QString, WordEntry>;
+	WordMap words; // Dives, sites and trips that belong to each word
+	std::map<QString, std::vector<const WordMap::value_type *>> trigrams; // Words that contain each trigram
 public:
-	void populate(); // Rebuild from current dive_table
+	void populate(); // Rebuild from current dive_table, dive_site_table and trip_table
 	void registerDive(struct dive *d); // Note: can be called repeatedly
 	void unregisterDive(struct dive *d); // Note: can be called repeatedly
-	void unregisterAll(); // Unregister all dives in the dive table
+	void registerSite(struct dive_site *ds); // Note: can be called repeatedly
+	void unregisterSite(struct dive_site *ds); // Note: can be called repeatedly
+	void registerTrip(struct dive_trip *trip); // Note: can be called repeatedly
+	void unregisterTrip(struct dive_trip *trip); // Note: can be called repeatedly
+	void unregisterAll(); // Unregister all dives, dive sites and trips in the global tables
 	FullTextResult find(const FullTextQuery &q, StringFilterMode mode) const; // Find dives matchin all words.
 private:
-	void registerWords(struct dive *d, const std::vector<QString> &w);
-	void unregisterWords(struct dive *d, const std::vector<QString> &w);
-	std::vector<dive *> findDives(const QString &s, StringFilterMode mode) const; // Find dives matching a given word.
+	template <typename T>
+	void registerItem(T *item, std::vector<T *> WordEntry::*list, std::vector<QString> w);
+	template <typename T>
+	void unregisterItem(T *item, std::vector<T *> WordEntry::*list);
+	template <typename T>
+	void registerWords(T *item, std::vector<T *> WordEntry::*list, const std::vector<QString> &w);
+	template <typename T>
+	void unregisterWords(T *item, std::vector<T *> WordEntry::*list, const std::vector<QString> &w);
+	std::vector<dive *> findDives(const QString &s, StringFilterMode mode) const; // Find dives matching a given word. Sorted by address.
 };
 
 // This class doesn't depend on any other objects, we might just initialize it at startup.
@@ -46,6 +72,26 @@ void fulltext_unregister(struct dive *d)
 	self.unregisterDive(d);
 }
 
+void fulltext_register_site(struct dive_site *ds)
+{
+	self.registerSite(ds);
+}
+
+void fulltext_unregister_site(struct dive_site *ds)
+{
+	self.unregisterSite(ds);
+}
+
+void fulltext_register_trip(struct dive_trip *trip)
+{
+	self.registerTrip(trip);
+}
+
+void fulltext_unregister_trip(struct dive_trip *trip)
+{
+	self.unregisterTrip(trip);
+}
+
 void fulltext_unregister_all()
 {
 	self.unregisterAll();
@@ -75,9 +121,14 @@ bool fulltext_dive_matches(const struct dive *d, const FullTextQuery &q, StringF
 		mode == StringFilterMode::EXACT ? [](const QString &s1, const QString &s2) { return s1 == s2; } :
 		mode == StringFilterMode::STARTSWITH ? [](const QString &s1, const QString &s2) { return s1.startsWith(s2); } :
 		/* mode == StringFilterMode::SUBSTRING ? */ [](const QString &s1, const QString &s2) { return s1.contains(s2); };
-	const std::vector<QString> &words = d->full_text->words;
+	auto cacheMatches = [matchFunc](const full_text_cache *cache, const QString &search) {
+		return cache && std::any_of(cache->words.begin(), cache->words.end(),
+					    [&search,matchFunc](const QString &w) { return matchFunc(w, search); });
+	};
 	for (const QString &search: q.words) {
-		if (std::any_of(words.begin(), words.end(), [&search,matchFunc](const QString &w) { return matchFunc(w, search); }))
+		if (cacheMatches(d->full_text, search) ||
+		    (d->dive_site && cacheMatches(d->dive_site->full_text, search)) ||
+		    (d->divetrip && cacheMatches(d->divetrip->full_text, search)))
 			return true;
 	}
 	return false;
@@ -86,11 +137,11 @@ bool fulltext_dive_matches(const struct dive *d, const FullTextQuery &q, StringF
 // Class implementation
 
 // Take a text and tokenize it into words. Normalize the words to upper case
-// and add to a given list, if not already in list.
+// and add to a given list, if not already in the set of seen words.
 // We might think about limiting the lower size of words we store.
 // Note: we convert to QString before tokenization because we rely in
 // Qt's isPunct() function.
-static void tokenize(QString s, std::vector<QString> &res)
+static void tokenize(QString s, std::vector<QString> &res, QSet<QString> &seen)
 {
 	if (s.isEmpty())
 		return;
@@ -110,7 +161,9 @@ static void tokenize(QString s, std::vector<QString> &res)
 		QString word = loc.toUpper(s.mid(pos, end - pos)); // Sad: Locale::toUpper can't use QStringRef - we have to copy the substring!
 		pos = end;
 
-		if (find(res.begin(), res.end(), word) == res.end())
+		int oldSize = seen.size();
+		seen.insert(word);
+		if (seen.size() != oldSize)
 			res.push_back(word);
 	}
 }
@@ -119,27 +172,51 @@ static void tokenize(QString s, std::vector<QString> &res)
 static std::vector<QString> getWords(const dive *d)
 {
 	std::vector<QString> res;
-	tokenize(QString(d->notes), res);
-	tokenize(QString(d->divemaster), res);
-	tokenize(QString(d->buddy), res);
-	tokenize(QString(d->suit), res);
+	QSet<QString> seen;
+	tokenize(QString(d->notes), res, seen);
+	tokenize(QString(d->divemaster), res, seen);
+	tokenize(QString(d->buddy), res, seen);
+	tokenize(QString(d->suit), res, seen);
 	for (const tag_entry *tag = d->tag_list; tag; tag = tag->next)
-		tokenize(QString(tag->tag->name), res);
+		tokenize(QString(tag->tag->name), res, seen);
 	for (int i = 0; i < d->cylinders.nr; ++i) {
 		const cylinder_t &cyl = *get_cylinder(d, i);
-		tokenize(QString(cyl.type.description), res);
+		tokenize(QString(cyl.type.description), res, seen);
 	}
 	for (int i = 0; i < d->weightsystems.nr; ++i) {
 		const weightsystem_t &ws = d->weightsystems.weightsystems[i];
-		tokenize(QString(ws.description), res);
+		tokenize(QString(ws.description), res, seen);
+	}
+	// The names of dive sites and trips are indexed separately.
+	return res;
+}
+
+static std::vector<QString> getWords(const dive_site *ds)
+{
+	std::vector<QString> res;
+	QSet<QString> seen;
+	tokenize(ds->name, res, seen);
+	return res;
+}
+
+static std::vector<QString> getWords(const dive_trip *trip)
+{
+	std::vector<QString> res;
+	QSet<QString> seen;
+	tokenize(trip->location, res, seen);
+	return res;
+}
+
+// Get the distinct trigrams (substrings of length three) of a word.
+// Substring searches use these to find candidate words.
+static std::vector<QString> getTrigrams(const QString &word)
+{
+	std::vector<QString> res;
+	for (int i = 0; i + 3 <= word.size(); ++i) {
+		QString trigram = word.mid(i, 3);
+		if (std::find(res.begin(), res.end(), trigram) == res.end())
+			res.push_back(trigram);
 	}
-	// TODO: We should tokenize all dive-sites and trips first and then
-	// take the tokens from a cache.
-	if (d->dive_site)
-		tokenize(d->dive_site->name, res);
-	// TODO: We should index trips separately!
-	if (d->divetrip)
-		tokenize(d->divetrip->location, res);
 	return res;
 }
 
@@ -150,54 +227,137 @@ void FullText::populate()
 	uiNotification(QObject::tr("start processing"));
 	int i;
 	dive *d;
-	for_each_dive(i, d)
-		registerDive(d);
+	dive_site *ds;
+	// Dive sites, trips and dives that kept their cache over a reload are already registered
+	for_each_dive_site(i, ds, &dive_site_table) {
+		if (!ds->full_text)
+			registerSite(ds);
+	}
+	for (i = 0; i < trip_table.nr; ++i) {
+		if (!trip_table.trips[i]->full_text)
+			registerTrip(trip_table.trips[i]);
+	}
+
+	// Tokenizing is the expensive part. Do it in parallel, storing
+	// the words in the caches of the dives, then add them to the index
+	// in one pass.
+	std::vector<dive *> todo;
+	for_each_dive(i, d) {
+		if (!d->full_text)
+			todo.push_back(d);
+	}
+	QtConcurrent::blockingMap(todo, [](dive *d) { d->full_text = new full_text_cache { getWords(d) }; });
+	for (dive *d: todo)
+		registerWords(d, &WordEntry::dives, d->full_text->words);
 	uiNotification(QObject::tr("%1 dives processed").arg(dive_table.nr));
 }
 
 void FullText::registerDive(struct dive *d)
 {
-	if (d->full_text) {
-		unregisterWords(d, d->full_text->words);
-	} else {
-		d->full_text = new full_text_cache;
-	}
-	d->full_text->words = getWords(d);
-	registerWords(d, d->full_text->words);
+	registerItem(d, &WordEntry::dives, getWords(d));
+	// Dive sites and trips that are not in the global tables yet (e.g. newly
+	// created by an edit) are registered when the first dive refers to them.
+	if (d->dive_site && !d->dive_site->full_text)
+		registerSite(d->dive_site);
+	if (d->divetrip && !d->divetrip->full_text)
+		registerTrip(d->divetrip);
 }
 
 void FullText::unregisterDive(struct dive *d)
 {
-	if (!d->full_text)
-		return;
-	unregisterWords(d, d->full_text->words);
-	delete d->full_text;
-	d->full_text = nullptr;
+	unregisterItem(d, &WordEntry::dives);
+}
+
+void FullText::registerSite(struct dive_site *ds)
+{
+	registerItem(ds, &WordEntry::sites, getWords(ds));
+}
+
+void FullText::unregisterSite(struct dive_site *ds)
+{
+	unregisterItem(ds, &WordEntry::sites);
+}
+
+void FullText::registerTrip(struct dive_trip *trip)
+{
+	registerItem(trip, &WordEntry::trips, getWords(trip));
+}
+
+void FullText::unregisterTrip(struct dive_trip *trip)
+{
+	unregisterItem(trip, &WordEntry::trips);
 }
 
 void FullText::unregisterAll()
 {
 	int i;
 	dive *d;
+	dive_site *ds;
 	for_each_dive(i, d) {
 		delete d->full_text;
 		d->full_text = nullptr;
 	}
+	for_each_dive_site(i, ds, &dive_site_table) {
+		delete ds->full_text;
+		ds->full_text = nullptr;
+	}
+	for (i = 0; i < trip_table.nr; ++i) {
+		delete trip_table.trips[i]->full_text;
+		trip_table.trips[i]->full_text = nullptr;
+	}
 	words.clear();
+	trigrams.clear();
+}
+
+bool WordEntry::empty() const
+{
+	return dives.empty() && sites.empty() && trips.empty();
+}
+
+// Register a dive, dive site or trip with the given words.
+template <typename T>
+void FullText::registerItem(T *item, std::vector<T *> WordEntry::*list, std::vector<QString> w)
+{
+	if (item->full_text) {
+		unregisterWords(item, list, item->full_text->words);
+	} else {
+		item->full_text = new full_text_cache;
+	}
+	item->full_text->words = std::move(w);
+	registerWords(item, list, item->full_text->words);
+}
+
+template <typename T>
+void FullText::unregisterItem(T *item, std::vector<T *> WordEntry::*list)
+{
+	if (!item->full_text)
+		return;
+	unregisterWords(item, list, item->full_text->words);
+	delete item->full_text;
+	item->full_text = nullptr;
 }
 
-// Register words of a dive.
-void FullText::registerWords(struct dive *d, const std::vector<QString> &w)
+// Register words of a dive, dive site or trip.
+template <typename T>
+void FullText::registerWords(T *item, std::vector<T *> WordEntry::*list, const std::vector<QString> &w)
 {
 	for (const QString &word: w) {
-		std::vector<dive *> &entry = words[word];
-		if (std::find(entry.begin(), entry.end(), d) == entry.end())
-			entry.push_back(d);
+		auto it = words.find(word);
+		if (it == words.end()) {
+			// New word: add it to the trigram index. Pointers to map entries are stable.
+			it = words.emplace(word, WordEntry()).first;
+			for (const QString &trigram: getTrigrams(word))
+				trigrams[trigram].push_back(&*it);
+		}
+		// The words of an item are unique and registerItem() unregisters
+		// the old words first. Thus, the item can't be in the list yet.
+		(it->second.*list).push_back(item);
 	}
 }
 
-// Unregister words of a dive.
-void FullText::unregisterWords(struct dive *d, const std::vector<QString> &w)
+// Unregister words of a dive, dive site or trip.
+template <typename T>
+void FullText::unregisterWords(T *item, std::vector<T *> WordEntry::*list, const std::vector<QString> &w)
 {
 	for (const QString &word: w) {
 		auto it = words.find(word);
@@ -205,24 +365,56 @@ void FullText::unregisterWords(struct dive *d, const std::vector<QString> &w)
 			qWarning("FullText::unregisterWords: didn't find word '%s' in index!?", qPrintable(word));
 			continue;
 		}
-		std::vector<dive *> &entry = it->second;
-		entry.erase(std::remove(entry.begin(), entry.end(), d));
-		if (entry.empty())
+		std::vector<T *> &entry = it->second.*list;
+		entry.erase(std::remove(entry.begin(), entry.end(), item), entry.end());
+		if (it->second.empty()) {
+			for (const QString &trigram: getTrigrams(word)) {
+				auto it2 = trigrams.find(trigram);
+				if (it2 == trigrams.end())
+					continue;
+				std::vector<const WordMap::value_type *> &trigramWords = it2->second;
+				trigramWords.erase(std::remove(trigramWords.begin(), trigramWords.end(), &*it), trigramWords.end());
+				if (trigramWords.empty())
+					trigrams.erase(it2);
+			}
 			words.erase(it);
+		}
 	}
 }
 
-// Add dives from second array to first, if not yet there
-void combineDives(std::vector<dive *> &to, const std::vector<dive *> &from)
+// Add the dives containing a word, either directly or via their dive site or trip.
+// Dive sites remember the dives that were removed from them for undo, therefore
+// check that the dive still belongs to them. Unregistered dives are not found.
+static void addDives(std::vector<dive *> &res, const WordEntry &entry)
 {
-	for (dive *d: from) {
-		if (std::find(to.begin(), to.end(), d) == to.end())
-			to.push_back(d);
+	res.insert(res.end(), entry.dives.begin(), entry.dives.end());
+	for (dive_site *ds: entry.sites) {
+		for (int i = 0; i < ds->dives.nr; ++i) {
+			dive *d = ds->dives.dives[i];
+			if (d->dive_site == ds && d->full_text)
+				res.push_back(d);
+		}
 	}
+	for (dive_trip *trip: entry.trips) {
+		for (int i = 0; i < trip->dives.nr; ++i) {
+			dive *d = trip->dives.dives[i];
+			if (d->divetrip == trip && d->full_text)
+				res.push_back(d);
+		}
+	}
+}
+
+// Sort dives by address and remove duplicates, so that results can be
+// intersected and searched quickly.
+static void sortDives(std::vector<dive *> &dives)
+{
+	std::sort(dives.begin(), dives.end());
+	dives.erase(std::unique(dives.begin(), dives.end()), dives.end());
 }
 
 std::vector<dive *> FullText::findDives(const QString &s, StringFilterMode mode) const
 {
+	std::vector<dive *> res;
 	switch (mode) {
 	case StringFilterMode::EXACT:
 	default: {
@@ -230,33 +422,45 @@ std::vector<dive *> FullText::findDives(const QString &s, StringFilterMode mode)
 		auto it = words.find(s);
 		if (it == words.end())
 			return {};
-		return it->second;
+		addDives(res, it->second);
+		break;
 	}
 	case StringFilterMode::STARTSWITH: {
 		// Find all words that start with a substring. We use the fact
 		// that these words must form a contiguous block, since the words are
 		// ordered lexicographically.
-		auto it = words.lower_bound(s);
-		if (it == words.end() || !it->first.startsWith(s))
-			return {};
-		std::vector<dive *> res = it->second;
-		++it;
-		while (it != words.end() && it->first.startsWith(s)) {
-			combineDives(res, it->second);
-			++it;
-		}
-		return res;
+		for (auto it = words.lower_bound(s); it != words.end() && it->first.startsWith(s); ++it)
+			addDives(res, it->second);
+		break;
 	}
 	case StringFilterMode::SUBSTRING: {
-		// Find all words that contain a substring. Here, we have to check all words!
-		std::vector<dive *> res;
-		for (auto it = words.begin(); it != words.end(); ++it) {
-			if (it->first.contains(s))
-				combineDives(res, it->second);
+		if (s.size() < 3) {
+			// Too short for the trigram index. Here, we have to check all words!
+			for (auto it = words.begin(); it != words.end(); ++it) {
+				if (it->first.contains(s))
+					addDives(res, it->second);
+			}
+			break;
+		}
+		// Every word containing the substring contains all of its trigrams.
+		// Take the words of the rarest trigram and check them.
+		const std::vector<const WordMap::value_type *> *candidates = nullptr;
+		for (const QString &trigram: getTrigrams(s)) {
+			auto it = trigrams.find(trigram);
+			if (it == trigrams.end())
+				return {};
+			if (!candidates || it->second.size() < candidates->size())
+				candidates = &it->second;
 		}
-		return res;
+		for (const WordMap::value_type *entry: *candidates) {
+			if (entry->first.contains(s))
+				addDives(res, entry->second);
+		}
+		break;
 	}
 	}
+	sortDives(res);
+	return res;
 }
 
 FullTextResult FullText::find(const FullTextQuery &q, StringFilterMode mode) const
@@ -265,11 +469,12 @@ FullTextResult FullText::find(const FullTextQuery &q, StringFilterMode mode) con
 		return FullTextResult();
 
 	std::vector<dive *> res = findDives(q.words[0], mode);
-	for (size_t i = 1; i < q.words.size(); ++i) {
+	for (size_t i = 1; i < q.words.size() && !res.empty(); ++i) {
 		std::vector<dive *> res2 = findDives(q.words[i], mode);
 		// Remove dives from res that are not in res2
-		res.erase(std::remove_if(res.begin(), res.end(),
-				[&res2] (dive *d) { return std::find(res2.begin(), res2.end(), d) == res2.end(); }), res.end());
+		std::vector<dive *> both;
+		std::set_intersection(res.begin(), res.end(), res2.begin(), res2.end(), std::back_inserter(both));
+		res = std::move(both);
 	}
 
 	return { res };
@@ -279,7 +484,8 @@ FullTextQuery &FullTextQuery::operator=(const QString &s)
 {
 	originalQuery = s;
 	words.clear();
-	tokenize(s, words);
+	QSet<QString> seen;
+	tokenize(s, words, seen);
 	return *this;
 }
 
@@ -288,7 +494,24 @@ bool FullTextQuery::doit() const
 	return !words.empty();
 }
 
+// A fulltext search returns the dives that match all words.
+bool FullTextQuery::narrows(const FullTextQuery &old, StringFilterMode mode) const
+{
+	if (words.size() < old.words.size())
+		return false;
+	for (size_t i = 0; i < old.words.size(); ++i) {
+		const QString &word = words[i];
+		const QString &oldWord = old.words[i];
+		bool narrower = mode == StringFilterMode::SUBSTRING ? word.contains(oldWord) :
+				mode == StringFilterMode::STARTSWITH ? word.startsWith(oldWord) :
+								       word == oldWord;
+		if (!narrower)
+			return false;
+	}
+	return true;
+}
+
 bool FullTextResult::dive_matches(const struct dive *d) const
 {
-	return std::find(dives.begin(), dives.end(), d) != dives.end();
+	return std::binary_search(dives.begin(), dives.end(), d);
 }
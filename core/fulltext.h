@@ -8,7 +8,8 @@
 //
 // To make this accessible from C, this does manual memory management:
 // Every dive is associated with a cache of words. Thus, when deleting
-// a dive, a function freeing that data has to be called.
+// a dive, a function freeing that data has to be called. The same goes
+// for dive sites and trips, whose names are indexed separately.
 
 #ifndef FULLTEXT_H
 #define FULLTEXT_H
@@ -21,10 +22,16 @@ extern "C" {
 
 struct full_text_cache;
 struct dive;
+struct dive_site;
+struct dive_trip;
 void fulltext_register(struct dive *d); // Note: can be called repeatedly
 void fulltext_unregister(struct dive *d); // Note: can be called repeatedly
-void fulltext_unregister_all(); // Unregisters all dives in the dive table
-void fulltext_populate(); // Registers all dives in the dive table
+void fulltext_register_site(struct dive_site *ds); // Note: can be called repeatedly
+void fulltext_unregister_site(struct dive_site *ds); // Note: can be called repeatedly
+void fulltext_register_trip(struct dive_trip *trip); // Note: can be called repeatedly
+void fulltext_unregister_trip(struct dive_trip *trip); // Note: can be called repeatedly
+void fulltext_unregister_all(); // Unregisters all dives, dive sites and trips in the global tables
+void fulltext_populate(); // Registers all dives, dive sites and trips in the global tables
 
 #ifdef __cplusplus
 }
@@ -48,11 +55,12 @@ struct FullTextQuery {
 	QString originalQuery; // Remember original query, which will be written to the log
 	FullTextQuery &operator=(const QString &); // Initialize by assigning a user-provided search string
 	bool doit() const; // true if we should to a fulltext search
+	bool narrows(const FullTextQuery &old, StringFilterMode mode) const; // true if every dive matching this query also matches old
 };
 
 // Describes the result of a fulltext search
 struct FullTextResult {
-	std::vector<dive *> dives;
+	std::vector<dive *> dives; // Sorted by address
 	bool dive_matches(const struct dive *d) const;
 };
 
@@ -28,10 +28,14 @@ extern int git_save_dives(struct git_repository *, const char *, const char *rem
 extern int git_load_dives(struct git_repository *repo, const char *branch, struct dive_table *table, struct trip_table *trips,
 			  struct dive_site_table *sites, struct device_table *devices,
 			  struct filter_preset_table *filter_presets);
+extern int git_reload_dives(struct git_repository *repo, const char *branch, struct dive_table *table, struct trip_table *trips,
+			    struct dive_site_table *sites, struct device_table *devices,
+			    struct filter_preset_table *filter_presets, struct dive_table *old_dives);
 extern const char *get_sha(git_repository *repo, const char *branch);
 extern int do_git_save(git_repository *repo, const char *branch, const char *remote, bool select_only, bool create_empty);
 extern const char *saved_git_id;
 extern bool git_local_only;
+extern bool git_load_sequential; // parse the dives on the calling thread, for testing
 extern bool git_remote_sync_successful;
 extern void clear_git_id(void);
 extern void set_git_id(const struct git_oid *);
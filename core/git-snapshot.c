@@ -0,0 +1,884 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Binary snapshot of the dive data loaded from a git commit.
+ *
+ * The format is a simple stream of native-endian integers and
+ * length-prefixed strings. It is only ever read by the same
+ * build that wrote it, on the same machine, so no attempt is
+ * made at portability: the header contains a format version, the
+ * size of struct sample, which is stored as a raw array, the data
+ * format version and the version of the build. The latter catches
+ * changes of the parser and of the fixups done when loading.
+ * Any mismatch makes the loader reject and remove the snapshot.
+ */
+#include "ssrf.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "git-snapshot.h"
+#include "git-access.h"
+#include "dive.h"
+#include "divelist.h"
+#include "divesite.h"
+#include "event.h"
+#include "extradata.h"
+#include "file.h"
+#include "membuffer.h"
+#include "qthelper.h"
+#include "sample.h"
+#include "stringpool.h"
+#include "subsurface-string.h"
+#include "tag.h"
+#include "trip.h"
+#include "version.h"
+
+#define SNAPSHOT_MAGIC "SSRFSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_SHA_LEN 40
+
+/*
+ * The snapshot is derived data, so it is not stored in the repository, but
+ * in the directory of the local caches. The repository itself may be such a
+ * cache, therefore the snapshot goes next to it, not into it.
+ */
+char *get_git_snapshot_filename(const char *repo_path, const char *branch)
+{
+	char *localdir = get_local_dir(repo_path, branch);
+	char *res = format_string("%s.snapshot", localdir);
+	free(localdir);
+	return res;
+}
+
+static void put_int32(struct membuffer *b, int32_t v)
+{
+	put_bytes(b, (const char *)&v, sizeof(v));
+}
+
+static void put_int64(struct membuffer *b, int64_t v)
+{
+	put_bytes(b, (const char *)&v, sizeof(v));
+}
+
+/* Strings are stored as length + 1, so that NULL can be distinguished from "". */
+static void put_text(struct membuffer *b, const char *s)
+{
+	int len = s ? strlen(s) : -1;
+	put_int32(b, len + 1);
+	if (len > 0)
+		put_bytes(b, s, len);
+}
+
+static void put_position(struct membuffer *b, const location_t *loc)
+{
+	put_int32(b, loc->lat.udeg);
+	put_int32(b, loc->lon.udeg);
+}
+
+static void write_site(struct membuffer *b, const struct dive_site *ds)
+{
+	put_int32(b, ds->uuid);
+	put_text(b, ds->name);
+	put_position(b, &ds->location);
+	put_text(b, ds->description);
+	put_text(b, ds->notes);
+	put_int32(b, ds->taxonomy.nr);
+	for (int i = 0; i < ds->taxonomy.nr; i++) {
+		put_int32(b, ds->taxonomy.category[i].category);
+		put_text(b, ds->taxonomy.category[i].value);
+		put_int32(b, ds->taxonomy.category[i].origin);
+	}
+}
+
+static void write_trip(struct membuffer *b, const struct dive_trip *trip)
+{
+	put_text(b, trip->location);
+	put_text(b, trip->notes);
+	put_int32(b, trip->autogen);
+}
+
+static void write_cylinder(struct membuffer *b, const cylinder_t *cyl)
+{
+	put_int32(b, cyl->type.size.mliter);
+	put_int32(b, cyl->type.workingpressure.mbar);
+	put_text(b, cyl->type.description);
+	put_int32(b, cyl->gasmix.o2.permille);
+	put_int32(b, cyl->gasmix.he.permille);
+	put_int32(b, cyl->start.mbar);
+	put_int32(b, cyl->end.mbar);
+	put_int32(b, cyl->sample_start.mbar);
+	put_int32(b, cyl->sample_end.mbar);
+	put_int32(b, cyl->depth.mm);
+	put_int32(b, cyl->manually_added);
+	put_int32(b, cyl->gas_used.mliter);
+	put_int32(b, cyl->deco_gas_used.mliter);
+	put_int32(b, cyl->cylinder_use);
+	put_int32(b, cyl->bestmix_o2);
+	put_int32(b, cyl->bestmix_he);
+}
+
+static void write_event(struct membuffer *b, const struct event *ev)
+{
+	put_int32(b, ev->time.seconds);
+	put_int32(b, ev->type);
+	put_int32(b, ev->flags);
+	put_int32(b, ev->value);
+	/* This also covers the divemode, which shares the memory with the gas index */
+	put_int32(b, ev->gas.index);
+	put_int32(b, ev->gas.mix.o2.permille);
+	put_int32(b, ev->gas.mix.he.permille);
+	put_int32(b, ev->deleted);
+	put_text(b, ev->name);
+}
+
+static void write_dc(struct membuffer *b, const struct divecomputer *dc)
+{
+	const struct event *ev;
+	const struct extra_data *ed;
+	int nr;
+
+	put_int64(b, dc->when);
+	put_int32(b, dc->duration.seconds);
+	put_int32(b, dc->surfacetime.seconds);
+	put_int32(b, dc->last_manual_time.seconds);
+	put_int32(b, dc->maxdepth.mm);
+	put_int32(b, dc->meandepth.mm);
+	put_int32(b, dc->airtemp.mkelvin);
+	put_int32(b, dc->watertemp.mkelvin);
+	put_int32(b, dc->surface_pressure.mbar);
+	put_int32(b, dc->divemode);
+	put_int32(b, dc->no_o2sensors);
+	put_int32(b, dc->salinity);
+	put_text(b, dc->model);
+	put_text(b, dc->serial);
+	put_text(b, dc->fw_version);
+	put_int32(b, dc->deviceid);
+	put_int32(b, dc->diveid);
+
+	put_int32(b, dc->samples);
+	if (dc->samples) {
+		const struct sample *samples = get_dc_samples(dc);
+		put_bytes(b, (const char *)samples, dc->samples * sizeof(struct sample));
+		put_dc_samples(dc, samples);
+	}
+
+	for (nr = 0, ev = dc->events; ev; ev = ev->next)
+		nr++;
+	put_int32(b, nr);
+	for (ev = dc->events; ev; ev = ev->next)
+		write_event(b, ev);
+
+	for (nr = 0, ed = dc->extra_data; ed; ed = ed->next)
+		nr++;
+	put_int32(b, nr);
+	for (ed = dc->extra_data; ed; ed = ed->next) {
+		put_text(b, ed->key);
+		put_text(b, ed->value);
+	}
+}
+
+/*
+ * The dives refer to their trip and dive site by index. To avoid a scan
+ * of the tables for every dive, the indexes are looked up in an array
+ * of the trips or dive sites sorted by address.
+ */
+struct pointer_index {
+	const void *p;
+	int idx;
+};
+
+static int comp_pointer_index(const void *_a, const void *_b)
+{
+	uintptr_t a = (uintptr_t)((const struct pointer_index *)_a)->p;
+	uintptr_t b = (uintptr_t)((const struct pointer_index *)_b)->p;
+	return a < b ? -1 : a > b;
+}
+
+static struct pointer_index *make_pointer_index(void *const *items, int nr)
+{
+	struct pointer_index *index = malloc((nr ? nr : 1) * sizeof(*index));
+	if (!index)
+		exit(1);
+	for (int i = 0; i < nr; i++) {
+		index[i].p = items[i];
+		index[i].idx = i;
+	}
+	qsort(index, nr, sizeof(*index), comp_pointer_index);
+	return index;
+}
+
+static int get_pointer_idx(const struct pointer_index *index, int nr, const void *p)
+{
+	struct pointer_index key = { p, -1 };
+	const struct pointer_index *entry;
+
+	if (!p)
+		return -1;
+	entry = bsearch(&key, index, nr, sizeof(*index), comp_pointer_index);
+	return entry ? entry->idx : -1;
+}
+
+static void write_dive(struct membuffer *b, const struct dive *dive,
+		       const struct pointer_index *trip_index, int nr_trips,
+		       const struct pointer_index *site_index, int nr_sites)
+{
+	const struct tag_entry *tag;
+	const struct divecomputer *dc;
+	int i, nr;
+
+	put_int32(b, get_pointer_idx(trip_index, nr_trips, dive->divetrip));
+	put_int32(b, get_pointer_idx(site_index, nr_sites, dive->dive_site));
+	put_int64(b, dive->when);
+	put_text(b, dive->notes);
+	put_text(b, dive->divemaster);
+	put_text(b, dive->buddy);
+	put_text(b, dive->suit);
+	put_int32(b, dive->number);
+	put_int32(b, dive->rating);
+	put_int32(b, dive->wavesize);
+	put_int32(b, dive->current);
+	put_int32(b, dive->visibility);
+	put_int32(b, dive->surge);
+	put_int32(b, dive->chill);
+	put_int32(b, dive->sac);
+	put_int32(b, dive->otu);
+	put_int32(b, dive->cns);
+	put_int32(b, dive->maxcns);
+	put_int32(b, dive->mintemp.mkelvin);
+	put_int32(b, dive->maxtemp.mkelvin);
+	put_int32(b, dive->watertemp.mkelvin);
+	put_int32(b, dive->airtemp.mkelvin);
+	put_int32(b, dive->maxdepth.mm);
+	put_int32(b, dive->meandepth.mm);
+	put_int32(b, dive->surface_pressure.mbar);
+	put_int32(b, dive->duration.seconds);
+	put_int32(b, dive->salinity);
+	put_int32(b, dive->user_salinity);
+	put_bytes(b, (const char *)dive->git_id, sizeof(dive->git_id));
+	put_int32(b, dive->notrip);
+	put_int32(b, dive->invalid);
+
+	for (nr = 0, tag = dive->tag_list; tag; tag = tag->next)
+		nr++;
+	put_int32(b, nr);
+	/* Store the untranslated name, as that is what taglist_add_tag() expects */
+	for (tag = dive->tag_list; tag; tag = tag->next)
+		put_text(b, tag->tag->source ? tag->tag->source : tag->tag->name);
+
+	put_int32(b, dive->cylinders.nr);
+	for (i = 0; i < dive->cylinders.nr; i++)
+		write_cylinder(b, &dive->cylinders.cylinders[i]);
+
+	put_int32(b, dive->weightsystems.nr);
+	for (i = 0; i < dive->weightsystems.nr; i++) {
+		const weightsystem_t *ws = &dive->weightsystems.weightsystems[i];
+		put_int32(b, ws->weight.grams);
+		put_text(b, ws->description);
+		put_int32(b, ws->auto_filled);
+	}
+
+	put_int32(b, dive->pictures.nr);
+	for (i = 0; i < dive->pictures.nr; i++) {
+		const struct picture *pic = &dive->pictures.pictures[i];
+		put_text(b, pic->filename);
+		put_int32(b, pic->offset.seconds);
+		put_position(b, &pic->location);
+	}
+
+	nr = number_of_computers(dive);
+	put_int32(b, nr);
+	for_each_dc (dive, dc)
+		write_dc(b, dc);
+}
+
+/* The cache directory doesn't exist if cloud storage was never used */
+static void make_parent_directory(const char *filename)
+{
+	const char *slash = strrchr(filename, '/');
+	char *dir;
+
+	if (!slash)
+		return;
+	dir = strndup(filename, slash - filename);
+	if (!dir)
+		exit(1);
+	subsurface_mkdir(dir);
+	free(dir);
+}
+
+int save_git_snapshot(const char *filename, const char *sha, const struct git_snapshot_text *texts, int nr_texts,
+		      const struct dive_table *table, const struct trip_table *trips, const struct dive_site_table *sites)
+{
+	struct membuffer b = { 0 };
+	struct pointer_index *trip_index, *site_index;
+	char *tmpname;
+	FILE *f;
+	int i, ret = 0;
+
+	if (strlen(sha) != SNAPSHOT_SHA_LEN)
+		return -1;
+
+	put_bytes(&b, SNAPSHOT_MAGIC, strlen(SNAPSHOT_MAGIC));
+	put_int32(&b, SNAPSHOT_VERSION);
+	put_int32(&b, sizeof(struct sample));
+	put_int32(&b, DATAFORMAT_VERSION);
+	put_text(&b, subsurface_canonical_version());
+	put_bytes(&b, sha, SNAPSHOT_SHA_LEN);
+
+	put_int32(&b, sites->nr);
+	for (i = 0; i < sites->nr; i++)
+		write_site(&b, sites->dive_sites[i]);
+
+	put_int32(&b, trips->nr);
+	for (i = 0; i < trips->nr; i++)
+		write_trip(&b, trips->trips[i]);
+
+	trip_index = make_pointer_index((void *const *)trips->trips, trips->nr);
+	site_index = make_pointer_index((void *const *)sites->dive_sites, sites->nr);
+	put_int32(&b, table->nr);
+	for (i = 0; i < table->nr; i++)
+		write_dive(&b, table->dives[i], trip_index, trips->nr, site_index, sites->nr);
+	free(trip_index);
+	free(site_index);
+
+	put_int32(&b, nr_texts);
+	for (i = 0; i < nr_texts; i++) {
+		put_int32(&b, texts[i].kind);
+		put_int32(&b, texts[i].len);
+		put_bytes(&b, texts[i].text, texts[i].len);
+	}
+
+	/* Write to a temporary file first, so that we never leave a truncated snapshot behind */
+	make_parent_directory(filename);
+	tmpname = format_string("%s.tmp", filename);
+	f = subsurface_fopen(tmpname, "wb");
+	if (f) {
+		flush_buffer(&b, f);
+		if (ferror(f))
+			ret = -1;
+		if (fclose(f))
+			ret = -1;
+		if (!ret)
+			ret = subsurface_rename(tmpname, filename);
+	} else {
+		ret = -1;
+	}
+	free(tmpname);
+	free_buffer(&b);
+	return ret;
+}
+
+/*
+ * All reads are bounds-checked. After the first failed read, the
+ * reader is in an error state and returns zeroes only, so that
+ * the callers only have to check for errors at the end of a record.
+ *
+ * Global data (tags, event names, cylinder and weight descriptions)
+ * is only registered once the whole snapshot was read successfully,
+ * see register_global_data(). Until then, the tags are collected in
+ * the reader.
+ */
+struct snapshot_tag {
+	struct dive *dive;
+	char *name;
+};
+
+struct snapshot_reader {
+	const char *p, *end;
+	bool error;
+	int nr_tags, alloc_tags;
+	struct snapshot_tag *tags;
+};
+
+static const char *get_bytes(struct snapshot_reader *r, size_t len)
+{
+	const char *res = r->p;
+	if (r->error || (size_t)(r->end - r->p) < len) {
+		r->error = true;
+		return NULL;
+	}
+	r->p += len;
+	return res;
+}
+
+static int32_t get_int32(struct snapshot_reader *r)
+{
+	int32_t v = 0;
+	const char *p = get_bytes(r, sizeof(v));
+	if (p)
+		memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static int64_t get_int64(struct snapshot_reader *r)
+{
+	int64_t v = 0;
+	const char *p = get_bytes(r, sizeof(v));
+	if (p)
+		memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/* Returns an array count and checks it for plausibility: each entry takes at least one byte */
+static int get_count(struct snapshot_reader *r)
+{
+	int32_t nr = get_int32(r);
+	if (nr < 0 || nr > r->end - r->p) {
+		r->error = true;
+		return 0;
+	}
+	return nr;
+}
+
+static char *get_text(struct snapshot_reader *r)
+{
+	int32_t len = get_int32(r);
+	const char *p;
+	char *res;
+
+	if (len <= 0) {
+		if (len < 0)
+			r->error = true;
+		return NULL;
+	}
+	p = get_bytes(r, len - 1);
+	if (!p)
+		return NULL;
+	res = malloc(len);
+	if (!res)
+		exit(1);
+	memcpy(res, p, len - 1);
+	res[len - 1] = 0;
+	return res;
+}
+
+/* Like get_text(), but the result is an interned string */
+static const char *get_interned_text(struct snapshot_reader *r)
+{
+	int32_t len = get_int32(r);
+	const char *p;
+
+	if (len <= 0) {
+		if (len < 0)
+			r->error = true;
+		return NULL;
+	}
+	p = get_bytes(r, len - 1);
+	return p ? intern_string_len(p, len - 1) : NULL;
+}
+
+static void get_position(struct snapshot_reader *r, location_t *loc)
+{
+	loc->lat.udeg = get_int32(r);
+	loc->lon.udeg = get_int32(r);
+}
+
+static void read_site(struct snapshot_reader *r, struct dive_site_table *sites)
+{
+	struct dive_site *ds = alloc_dive_site();
+	int nr;
+
+	ds->uuid = get_int32(r);
+	ds->name = get_text(r);
+	get_position(r, &ds->location);
+	ds->description = get_text(r);
+	ds->notes = get_text(r);
+	nr = get_count(r);
+	if (nr) {
+		ds->taxonomy.category = calloc(nr, sizeof(struct taxonomy));
+		if (!ds->taxonomy.category)
+			exit(1);
+		ds->taxonomy.nr = nr;
+	}
+	for (int i = 0; i < nr; i++) {
+		ds->taxonomy.category[i].category = get_int32(r);
+		ds->taxonomy.category[i].value = get_text(r);
+		ds->taxonomy.category[i].origin = get_int32(r);
+	}
+	/* A zero uuid would be replaced by a new one, so the dive references wouldn't match */
+	if (!ds->uuid)
+		r->error = true;
+	add_dive_site_to_table(ds, sites);
+}
+
+static dive_trip_t *read_trip(struct snapshot_reader *r)
+{
+	dive_trip_t *trip = alloc_trip();
+
+	trip->location = get_text(r);
+	trip->notes = get_text(r);
+	trip->autogen = get_int32(r);
+	return trip;
+}
+
+static void read_cylinder(struct snapshot_reader *r, struct dive *dive)
+{
+	cylinder_t cyl = empty_cylinder;
+
+	cyl.type.size.mliter = get_int32(r);
+	cyl.type.workingpressure.mbar = get_int32(r);
+	cyl.type.description = get_interned_text(r);
+	cyl.gasmix.o2.permille = get_int32(r);
+	cyl.gasmix.he.permille = get_int32(r);
+	cyl.start.mbar = get_int32(r);
+	cyl.end.mbar = get_int32(r);
+	cyl.sample_start.mbar = get_int32(r);
+	cyl.sample_end.mbar = get_int32(r);
+	cyl.depth.mm = get_int32(r);
+	cyl.manually_added = get_int32(r);
+	cyl.gas_used.mliter = get_int32(r);
+	cyl.deco_gas_used.mliter = get_int32(r);
+	cyl.cylinder_use = get_int32(r);
+	cyl.bestmix_o2 = get_int32(r);
+	cyl.bestmix_he = get_int32(r);
+	add_cylinder(&dive->cylinders, dive->cylinders.nr, cyl);
+}
+
+static struct event *read_event(struct snapshot_reader *r)
+{
+	struct event *ev;
+	int time = get_int32(r);
+	int type = get_int32(r);
+	int flags = get_int32(r);
+	int value = get_int32(r);
+	int index = get_int32(r);
+	int o2 = get_int32(r);
+	int he = get_int32(r);
+	bool deleted = get_int32(r);
+	char *name = get_text(r);
+
+	ev = create_event(time, type, flags, value, name ? name : "");
+	free(name);
+	if (!ev)
+		return NULL;
+	ev->gas.index = index;
+	ev->gas.mix.o2.permille = o2;
+	ev->gas.mix.he.permille = he;
+	ev->deleted = deleted;
+	return ev;
+}
+
+static void read_dc(struct snapshot_reader *r, struct divecomputer *dc)
+{
+	struct event **evp = &dc->events;
+	const char *samples;
+	int nr;
+
+	dc->when = get_int64(r);
+	dc->duration.seconds = get_int32(r);
+	dc->surfacetime.seconds = get_int32(r);
+	dc->last_manual_time.seconds = get_int32(r);
+	dc->maxdepth.mm = get_int32(r);
+	dc->meandepth.mm = get_int32(r);
+	dc->airtemp.mkelvin = get_int32(r);
+	dc->watertemp.mkelvin = get_int32(r);
+	dc->surface_pressure.mbar = get_int32(r);
+	dc->divemode = get_int32(r);
+	dc->no_o2sensors = get_int32(r);
+	dc->salinity = get_int32(r);
+	dc->model = get_interned_text(r);
+	dc->serial = get_interned_text(r);
+	dc->fw_version = get_interned_text(r);
+	dc->deviceid = get_int32(r);
+	dc->diveid = get_int32(r);
+
+	nr = get_count(r);
+	samples = get_bytes(r, nr * sizeof(struct sample));
+	if (samples && nr) {
+		alloc_samples(dc, nr);
+		memcpy(dc->sample, samples, nr * sizeof(struct sample));
+		dc->samples = nr;
+	}
+
+	/* The events were saved in order - simply append them */
+	nr = get_count(r);
+	for (int i = 0; i < nr && !r->error; i++) {
+		struct event *ev = read_event(r);
+		if (!ev)
+			continue;
+		*evp = ev;
+		evp = &ev->next;
+	}
+
+	nr = get_count(r);
+	for (int i = 0; i < nr && !r->error; i++) {
+		char *key = get_text(r);
+		char *value = get_text(r);
+		if (key && value)
+			add_extra_data(dc, key, value);
+		free(key);
+		free(value);
+	}
+}
+
+static void add_snapshot_tag(struct snapshot_reader *r, struct dive *dive, char *name)
+{
+	struct snapshot_tag *tag;
+
+	if (r->nr_tags >= r->alloc_tags) {
+		r->alloc_tags = (r->alloc_tags + 16) * 3 / 2;
+		r->tags = realloc(r->tags, r->alloc_tags * sizeof(*r->tags));
+		if (!r->tags)
+			exit(1);
+	}
+	tag = &r->tags[r->nr_tags++];
+	tag->dive = dive;
+	tag->name = name;
+}
+
+static void free_snapshot_tags(struct snapshot_reader *r)
+{
+	for (int i = 0; i < r->nr_tags; i++)
+		free(r->tags[i].name);
+	free(r->tags);
+}
+
+/* Register the global data of the dives, as parsing them would */
+static void register_global_data(const struct snapshot_reader *r, const struct dive_table *table)
+{
+	for (int i = 0; i < r->nr_tags; i++)
+		taglist_add_tag(&r->tags[i].dive->tag_list, r->tags[i].name);
+	for (int i = 0; i < table->nr; i++) {
+		struct dive *dive = table->dives[i];
+		struct divecomputer *dc;
+		for (int j = 0; j < dive->cylinders.nr; j++)
+			add_cylinder_description(&dive->cylinders.cylinders[j].type);
+		for (int j = 0; j < dive->weightsystems.nr; j++)
+			add_weightsystem_description(&dive->weightsystems.weightsystems[j]);
+		for_each_dc (dive, dc) {
+			for (struct event *ev = dc->events; ev; ev = ev->next)
+				remember_event(ev->name);
+		}
+	}
+}
+
+static struct dive *read_dive(struct snapshot_reader *r, dive_trip_t **trips, int nr_trips, struct dive_site_table *sites)
+{
+	struct dive *dive = alloc_dive();
+	struct divecomputer *dc;
+	int trip_idx, site_idx;
+	const char *git_id;
+	int nr;
+
+	trip_idx = get_int32(r);
+	site_idx = get_int32(r);
+	dive->when = get_int64(r);
+	dive->notes = get_text(r);
+	dive->divemaster = get_text(r);
+	dive->buddy = get_text(r);
+	dive->suit = get_text(r);
+	dive->number = get_int32(r);
+	dive->rating = get_int32(r);
+	dive->wavesize = get_int32(r);
+	dive->current = get_int32(r);
+	dive->visibility = get_int32(r);
+	dive->surge = get_int32(r);
+	dive->chill = get_int32(r);
+	dive->sac = get_int32(r);
+	dive->otu = get_int32(r);
+	dive->cns = get_int32(r);
+	dive->maxcns = get_int32(r);
+	dive->mintemp.mkelvin = get_int32(r);
+	dive->maxtemp.mkelvin = get_int32(r);
+	dive->watertemp.mkelvin = get_int32(r);
+	dive->airtemp.mkelvin = get_int32(r);
+	dive->maxdepth.mm = get_int32(r);
+	dive->meandepth.mm = get_int32(r);
+	dive->surface_pressure.mbar = get_int32(r);
+	dive->duration.seconds = get_int32(r);
+	dive->salinity = get_int32(r);
+	dive->user_salinity = get_int32(r);
+	git_id = get_bytes(r, sizeof(dive->git_id));
+	if (git_id)
+		memcpy(dive->git_id, git_id, sizeof(dive->git_id));
+	dive->notrip = get_int32(r);
+	dive->invalid = get_int32(r);
+
+	nr = get_count(r);
+	for (int i = 0; i < nr && !r->error; i++) {
+		char *tag = get_text(r);
+		if (tag)
+			add_snapshot_tag(r, dive, tag);
+	}
+
+	nr = get_count(r);
+	for (int i = 0; i < nr && !r->error; i++)
+		read_cylinder(r, dive);
+
+	nr = get_count(r);
+	for (int i = 0; i < nr && !r->error; i++) {
+		weightsystem_t ws = empty_weightsystem;
+		ws.weight.grams = get_int32(r);
+		ws.description = get_text(r);
+		ws.auto_filled = get_int32(r);
+		add_to_weightsystem_table(&dive->weightsystems, dive->weightsystems.nr, ws);
+	}
+
+	nr = get_count(r);
+	for (int i = 0; i < nr && !r->error; i++) {
+		struct picture pic = empty_picture;
+		pic.filename = get_text(r);
+		pic.offset.seconds = get_int32(r);
+		get_position(r, &pic.location);
+		add_picture(&dive->pictures, pic);
+	}
+
+	/* The first dive computer is embedded in the dive */
+	nr = get_count(r);
+	dc = &dive->dc;
+	for (int i = 0; i < nr && !r->error; i++) {
+		if (i > 0) {
+			dc->next = calloc(1, sizeof(struct divecomputer));
+			if (!dc->next)
+				exit(1);
+			dc = dc->next;
+		}
+		read_dc(r, dc);
+	}
+
+	if (trip_idx >= nr_trips || site_idx >= sites->nr)
+		r->error = true;
+	if (!r->error && trip_idx >= 0)
+		add_dive_to_trip(dive, trips[trip_idx]);
+	if (!r->error && site_idx >= 0)
+		add_dive_to_dive_site(dive, sites->dive_sites[site_idx]);
+	return dive;
+}
+
+enum snapshot_header {
+	SNAPSHOT_HEADER_OK,
+	SNAPSHOT_HEADER_OTHER_COMMIT,
+	SNAPSHOT_HEADER_STALE,		/* written by a different build or corrupt */
+};
+
+static enum snapshot_header check_header(struct snapshot_reader *r, const char *sha)
+{
+	const char *magic = get_bytes(r, strlen(SNAPSHOT_MAGIC));
+	const char *version = subsurface_canonical_version();
+	const char *file_version, *file_sha;
+
+	if (!magic || memcmp(magic, SNAPSHOT_MAGIC, strlen(SNAPSHOT_MAGIC)))
+		return SNAPSHOT_HEADER_STALE;
+	if (get_int32(r) != SNAPSHOT_VERSION)
+		return SNAPSHOT_HEADER_STALE;
+	if (get_int32(r) != sizeof(struct sample))
+		return SNAPSHOT_HEADER_STALE;
+	if (get_int32(r) != DATAFORMAT_VERSION)
+		return SNAPSHOT_HEADER_STALE;
+	/* See put_text(): the length includes the terminator, which isn't stored */
+	if (get_int32(r) != (int32_t)strlen(version) + 1)
+		return SNAPSHOT_HEADER_STALE;
+	file_version = get_bytes(r, strlen(version));
+	if (!file_version || memcmp(file_version, version, strlen(version)))
+		return SNAPSHOT_HEADER_STALE;
+	file_sha = get_bytes(r, SNAPSHOT_SHA_LEN);
+	if (!file_sha)
+		return SNAPSHOT_HEADER_STALE;
+	return strlen(sha) == SNAPSHOT_SHA_LEN && !memcmp(file_sha, sha, SNAPSHOT_SHA_LEN) ?
+		SNAPSHOT_HEADER_OK : SNAPSHOT_HEADER_OTHER_COMMIT;
+}
+
+bool git_snapshot_matches(const char *filename, const char *sha)
+{
+	/* Room for the header with a generous version string */
+	char header[sizeof(SNAPSHOT_MAGIC) - 1 + 4 * sizeof(int32_t) + 256 + SNAPSHOT_SHA_LEN];
+	struct snapshot_reader r = { 0 };
+	FILE *f = subsurface_fopen(filename, "rb");
+	enum snapshot_header res;
+	size_t len;
+
+	if (!f)
+		return false;
+	len = fread(header, 1, sizeof(header), f);
+	fclose(f);
+	r.p = header;
+	r.end = header + len;
+	res = check_header(&r, sha);
+	/* A snapshot of a different build will never be used, so remove it */
+	if (res == SNAPSHOT_HEADER_STALE)
+		subsurface_remove(filename);
+	return res == SNAPSHOT_HEADER_OK;
+}
+
+int load_git_snapshot(const char *filename, const char *sha,
+		      void (*text_cb)(const struct git_snapshot_text *text, void *data), void *data,
+		      struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites)
+{
+	struct memblock mem;
+	struct snapshot_reader r;
+	enum snapshot_header res;
+	dive_trip_t **new_trips = NULL;
+	struct git_snapshot_text *texts = NULL;
+	int i, nr, nr_trips = 0, nr_texts;
+
+	if (readfile_mapped(filename, &mem) <= 0)
+		return -1;
+	memset(&r, 0, sizeof(r));
+	r.p = mem.buffer;
+	r.end = r.p + mem.size;
+
+	res = check_header(&r, sha);
+	if (res != SNAPSHOT_HEADER_OK) {
+		/* Remove it only after unmapping it, see git_snapshot_matches() */
+		free_memblock(&mem);
+		if (res == SNAPSHOT_HEADER_STALE)
+			subsurface_remove(filename);
+		return -1;
+	}
+
+	nr = get_count(&r);
+	for (i = 0; i < nr && !r.error; i++)
+		read_site(&r, sites);
+
+	/* The trips are added to the table only once they contain their dives,
+	 * because they are sorted by the date of their first dive. */
+	nr_trips = get_count(&r);
+	if (nr_trips) {
+		new_trips = calloc(nr_trips, sizeof(*new_trips));
+		if (!new_trips)
+			exit(1);
+	}
+	for (i = 0; i < nr_trips && !r.error; i++)
+		new_trips[i] = read_trip(&r);
+
+	nr = get_count(&r);
+	for (i = 0; i < nr && !r.error; i++)
+		add_to_dive_table(table, table->nr, read_dive(&r, new_trips, nr_trips, sites));
+
+	for (i = 0; i < nr_trips; i++) {
+		if (new_trips[i])
+			insert_trip(new_trips[i], trips);
+	}
+	free(new_trips);
+
+	/* The texts are only passed on if the snapshot is valid,
+	 * so that the caller doesn't have to undo their effects. */
+	nr_texts = get_count(&r);
+	if (nr_texts) {
+		texts = calloc(nr_texts, sizeof(*texts));
+		if (!texts)
+			exit(1);
+	}
+	for (i = 0; i < nr_texts && !r.error; i++) {
+		texts[i].kind = get_int32(&r);
+		texts[i].len = get_count(&r);
+		texts[i].text = get_bytes(&r, texts[i].len);
+	}
+
+	if (r.p != r.end)
+		r.error = true;
+
+	if (r.error) {
+		clear_dive_table(table);
+		clear_trip_table(trips);
+		clear_dive_site_table(sites);
+	} else {
+		register_global_data(&r, table);
+		for (i = 0; i < nr_texts; i++)
+			text_cb(&texts[i], data);
+	}
+	free_snapshot_tags(&r);
+	free(texts);
+	free_memblock(&mem);
+	return r.error ? -1 : 0;
+}
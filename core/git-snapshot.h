@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef GIT_SNAPSHOT_H
+#define GIT_SNAPSHOT_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct dive_table;
+struct trip_table;
+struct dive_site_table;
+
+/*
+ * A binary snapshot of the dives, trips and dive sites loaded from a
+ * git commit. It is used to skip the parsing of the git blobs if the
+ * commit didn't change since the last load.
+ *
+ * Settings and filter presets are small and have side effects (preferences,
+ * devices). Therefore they are stored as the raw text of their blobs, which
+ * the loader passes back to the caller to be parsed.
+ */
+struct git_snapshot_text {
+	int kind;		/* opaque to the snapshot code */
+	unsigned int len;
+	const char *text;
+};
+
+/* The snapshot is stored next to the local cache of the repository, see get_local_dir() */
+extern char *get_git_snapshot_filename(const char *repo_path, const char *branch);
+extern bool git_snapshot_matches(const char *filename, const char *sha);
+extern int save_git_snapshot(const char *filename, const char *sha, const struct git_snapshot_text *texts, int nr_texts,
+			     const struct dive_table *table, const struct trip_table *trips, const struct dive_site_table *sites);
+/* Returns 0 on success. On failure, the tables are left empty and text_cb is not called. */
+extern int load_git_snapshot(const char *filename, const char *sha,
+			     void (*text_cb)(const struct git_snapshot_text *text, void *data), void *data,
+			     struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include "idindex.h"
+#include <unordered_map>
+
+static std::unordered_map<uint32_t, void *> indexes[ID_INDEX_NR];
+
+extern "C" void id_index_add(enum id_index_type type, uint32_t id, void *item)
+{
+	indexes[type][id] = item;
+}
+
+extern "C" void id_index_remove(enum id_index_type type, uint32_t id, const void *item)
+{
+	auto it = indexes[type].find(id);
+	if (it != indexes[type].end() && it->second == item)
+		indexes[type].erase(it);
+}
+
+extern "C" void *id_index_get(enum id_index_type type, uint32_t id)
+{
+	auto it = indexes[type].find(id);
+	return it != indexes[type].end() ? it->second : nullptr;
+}
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-2.0
+
+// Hash indexes of the dives, trips and dive sites in the global tables by
+// their unique id. The tables keep them up to date via the hooks of the
+// table macros (see table.h), therefore the lookups are O(1) instead of a
+// scan of the whole table.
+//
+// Only the lookups are safe to be called concurrently.
+
+#ifndef IDINDEX_H
+#define IDINDEX_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum id_index_type {
+	ID_INDEX_DIVE,
+	ID_INDEX_TRIP,
+	ID_INDEX_DIVE_SITE,
+	ID_INDEX_NR
+};
+
+void id_index_add(enum id_index_type type, uint32_t id, void *item);
+void id_index_remove(enum id_index_type type, uint32_t id, const void *item); // Note: does nothing if the id is mapped to a different item
+void *id_index_get(enum id_index_type type, uint32_t id); // NULL if there is no such item
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -153,7 +153,8 @@ Thumbnailer::Thumbnail Thumbnailer::getHashedImage(const QString &filename, bool
 	return thumbnail;
 }
 
-Thumbnailer::Thumbnailer() : failImage(renderSVGIcon(":filter-close", maxThumbnailSize(), false)), // TODO: Don't misuse filter close icon
+Thumbnailer::Thumbnailer() : store(thumbnailDir()),
+			     failImage(renderSVGIcon(":filter-close", maxThumbnailSize(), false)), // TODO: Don't misuse filter close icon
 			     dummyImage(renderSVGIcon(":camera-icon", maxThumbnailSize(), false)),
 			     videoImage(renderSVGIcon(":video-icon", maxThumbnailSize(), false)),
 			     videoOverlayImage(renderSVGIconWidth(":video-overlay", maxThumbnailSize())),
@@ -226,34 +227,62 @@ Thumbnailer::Thumbnail Thumbnailer::getVideoThumbnailFromStream(QDataStream &str
 	return { res, MEDIATYPE_VIDEO, { (int32_t)duration } };
 }
 
+// Older versions wrote one thumbnail file per picture. Move such a thumbnail
+// into the thumbnail store, keeping the time it was written.
+ThumbnailStore::Entry Thumbnailer::importOldThumbnail(const QString &picture_filename)
+{
+	QString filename = thumbnailFileName(picture_filename);
+	QFile file(filename);
+	if (filename.isEmpty() || !file.open(QIODevice::ReadOnly))
+		return { QByteArray(), 0 };
+	QDateTime thumbnailTime = QFileInfo(file).lastModified();
+	ThumbnailStore::Entry entry { file.readAll(), thumbnailTime.isValid() ? thumbnailTime.toMSecsSinceEpoch() : 0 };
+	file.close();
+	if (!entry.data.isEmpty()) {
+		store.put(picture_filename, entry.data, entry.mtime);
+		file.remove();
+	}
+	return entry;
+}
+
+void Thumbnailer::storeThumbnail(const QString &picture_filename, const QByteArray &data)
+{
+	if (!picture_filename.isEmpty())
+		store.put(picture_filename, data, QDateTime::currentMSecsSinceEpoch());
+}
+
 // Fetch a thumbnail from cache.
 // If Thumbnail::QImage is null, the thumbnail is scheduled for recreation.
 Thumbnailer::Thumbnail Thumbnailer::getThumbnailFromCache(const QString &picture_filename)
 {
-	QString filename = thumbnailFileName(picture_filename);
-	if (filename.isEmpty())
+	if (picture_filename.isEmpty())
+		return { QImage(), MEDIATYPE_UNKNOWN, zero_duration };
+	ThumbnailStore::Entry entry = store.get(picture_filename);
+	if (entry.data.isEmpty())
+		entry = importOldThumbnail(picture_filename);
+	return getThumbnailFromCache(picture_filename, entry);
+}
+
+Thumbnailer::Thumbnail Thumbnailer::getThumbnailFromCache(const QString &picture_filename, const ThumbnailStore::Entry &entry)
+{
+	if (entry.data.isEmpty())
 		return { QImage(), MEDIATYPE_UNKNOWN, zero_duration };
-	QFile file(filename);
 
 	if (prefs.auto_recalculate_thumbnails) {
 		// Check if thumbnails is older than the (local) image file
 		QString filenameLocal = localFilePath(qPrintable(picture_filename));
 		QFileInfo pictureInfo(filenameLocal);
-		QFileInfo thumbnailInfo(file);
-		if (pictureInfo.exists() && thumbnailInfo.exists()) {
+		if (pictureInfo.exists()) {
 			QDateTime pictureTime = pictureInfo.lastModified();
-			QDateTime thumbnailTime = thumbnailInfo.lastModified();
-			if (pictureTime.isValid() && thumbnailTime.isValid() && thumbnailTime < pictureTime) {
-				// Both files exist, have valid timestamps and thumbnail was calculated before picture.
+			if (pictureTime.isValid() && entry.mtime < pictureTime.toMSecsSinceEpoch()) {
+				// Thumbnail was calculated before picture.
 				// Return an empty thumbnail to signal recalculation of the thumbnail
 				return { QImage(), MEDIATYPE_UNKNOWN, zero_duration };
 			}
 		}
 	}
 
-	if (!file.open(QIODevice::ReadOnly))
-		return { QImage(), MEDIATYPE_UNKNOWN, zero_duration };
-	QDataStream stream(&file);
+	QDataStream stream(entry.data);
 
 	// Each thumbnail file is composed of a media-type and an image file.
 	quint32 type;
@@ -278,26 +307,23 @@ Thumbnailer::Thumbnail Thumbnailer::addVideoThumbnailToCache(const QString &pict
 	//	for each picture:
 	//		uint32	offset in msec from begining of video
 	//		QImage	frame
-	QString filename = thumbnailFileName(picture_filename);
-	QSaveFile file(filename);
-	if (file.open(QIODevice::WriteOnly)) {
-		QDataStream stream(&file);
-
-		stream << (quint32)MEDIATYPE_VIDEO;
-		stream << (quint32)duration.seconds;
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
 
-		if (image.isNull()) {
-			// No image provided
-			stream << (quint32)0;
-		} else {
-			// Currently, we support at most one image
-			stream << (quint32)1;
-			stream << (quint32)position.seconds;
-			stream << image;
-		}
+	stream << (quint32)MEDIATYPE_VIDEO;
+	stream << (quint32)duration.seconds;
 
-		file.commit();
+	if (image.isNull()) {
+		// No image provided
+		stream << (quint32)0;
+	} else {
+		// Currently, we support at most one image
+		stream << (quint32)1;
+		stream << (quint32)position.seconds;
+		stream << image;
 	}
+
+	storeThumbnail(picture_filename, data);
 	return { videoImage, MEDIATYPE_VIDEO, duration };
 }
 
@@ -320,26 +346,21 @@ Thumbnailer::Thumbnail Thumbnailer::addPictureThumbnailToCache(const QString &pi
 	// The format of a picture-thumbnail is very simple:
 	// 	uint32	MEDIATYPE_PICTURE
 	// 	QImage	thumbnail
-	QString filename = thumbnailFileName(picture_filename);
-	QSaveFile file(filename);
-	if (file.open(QIODevice::WriteOnly)) {
-		QDataStream stream(&file);
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
 
-		stream << (quint32)MEDIATYPE_PICTURE;
-		stream << thumbnail;
-		file.commit();
-	}
+	stream << (quint32)MEDIATYPE_PICTURE;
+	stream << thumbnail;
+	storeThumbnail(picture_filename, data);
 	return { thumbnail, MEDIATYPE_PICTURE, zero_duration };
 }
 
 Thumbnailer::Thumbnail Thumbnailer::addUnknownThumbnailToCache(const QString &picture_filename)
 {
-	QString filename = thumbnailFileName(picture_filename);
-	QSaveFile file(filename);
-	if (file.open(QIODevice::WriteOnly)) {
-		QDataStream stream(&file);
-		stream << (quint32)MEDIATYPE_UNKNOWN;
-	}
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
+	stream << (quint32)MEDIATYPE_UNKNOWN;
+	storeThumbnail(picture_filename, data);
 	return { unknownImage, MEDIATYPE_UNKNOWN, zero_duration };
 }
 
@@ -398,8 +419,12 @@ void Thumbnailer::recalculate(QString filename)
 
 void Thumbnailer::processItem(QString filename, bool tryDownload)
 {
-	Thumbnail thumbnail = getThumbnailFromCache(filename);
+	processItem(filename, tryDownload, getThumbnailFromCache(filename));
+}
 
+// Process an item with the thumbnail that was read from the cache
+void Thumbnailer::processItem(const QString &filename, bool tryDownload, Thumbnail thumbnail)
+{
 	if (thumbnail.img.isNull()) {
 		thumbnail = getHashedImage(filename, tryDownload);
 		if (thumbnail.type == MEDIATYPE_STILL_LOADING)
@@ -418,6 +443,40 @@ void Thumbnailer::processItem(QString filename, bool tryDownload)
 	workingOn.remove(filename);
 }
 
+// Process multiple items. The cached thumbnails are fetched from the thumbnail
+// store in one go. Items that are not in the cache are handed to jobs of their
+// own, so that the pictures are loaded and scaled in parallel. Items that were
+// removed from the work queue in the meantime (see clearWorkQueue()) are skipped.
+void Thumbnailer::processItems(const QVector<QString> &filenames)
+{
+	QVector<ThumbnailStore::Entry> entries = store.getMany(filenames);
+	for (int i = 0; i < filenames.size(); ++i) {
+		const QString &filename = filenames[i];
+		{
+			QMutexLocker l(&lock);
+			if (!workingOn.contains(filename))
+				continue;
+		}
+		Thumbnail thumbnail = getThumbnailFromCache(filename, entries[i]);
+		if (!thumbnail.img.isNull()) {
+			processItem(filename, true, thumbnail);
+			continue;
+		}
+
+		QMutexLocker l(&lock);
+		if (!workingOn.contains(filename))
+			continue;
+		if (entries[i].data.isEmpty()) {
+			// Not in the store - this may still be an old thumbnail file
+			workingOn[filename] = QtConcurrent::run(&pool, [this, filename]() { processItem(filename, true); });
+		} else {
+			// Outdated thumbnail
+			workingOn[filename] = QtConcurrent::run(&pool, [this, filename, thumbnail]()
+								{ processItem(filename, true, thumbnail); });
+		}
+	}
+}
+
 void Thumbnailer::imageDownloaded(QString filename)
 {
 	// Image was downloaded -> try thumbnailing again.
@@ -459,6 +518,24 @@ QImage Thumbnailer::fetchThumbnail(const QString &filename, bool synchronous)
 	return dummyImage;
 }
 
+QImage Thumbnailer::fetchThumbnails(const QVector<QString> &filenames)
+{
+	QMutexLocker l(&lock);
+
+	// Only fetch the thumbnails that we are not currently fetching.
+	QVector<QString> todo;
+	for (const QString &filename: filenames) {
+		if (!workingOn.contains(filename))
+			todo.push_back(filename);
+	}
+	if (!todo.isEmpty()) {
+		QFuture<void> future = QtConcurrent::run(&pool, [this, todo]() { processItems(todo); });
+		for (const QString &filename: todo)
+			workingOn.insert(filename, future);
+	}
+	return dummyImage;
+}
+
 void Thumbnailer::calculateThumbnails(const QVector<QString> &filenames)
 {
 	QMutexLocker l(&lock);
@@ -3,6 +3,7 @@
 #define IMAGEDOWNLOADER_H
 
 #include "metadata.h"
+#include "thumbnailstore.h"
 #include <QImage>
 #include <QFuture>
 #include <QNetworkReply>
@@ -39,6 +40,11 @@ public:
 	// images are not supported.
 	QImage fetchThumbnail(const QString &filename, bool synchronous);
 
+	// Schedule the thumbnails of multiple pictures, e.g. of a whole dive or trip,
+	// for fetching. The cached thumbnails are read in one go. Returns a placeholder
+	// thumbnail, the actual thumbnails will be sent via signals later.
+	QImage fetchThumbnails(const QVector<QString> &filenames);
+
 	// Schedule multiple thumbnails for forced recalculation
 	void calculateThumbnails(const QVector<QString> &filenames);
 
@@ -70,7 +76,12 @@ private:
 	Thumbnail addUnknownThumbnailToCache(const QString &picture_filename);
 	void recalculate(QString filename);
 	void processItem(QString filename, bool tryDownload);
+	void processItem(const QString &filename, bool tryDownload, Thumbnail thumbnail);
+	void processItems(const QVector<QString> &filenames);
+	void storeThumbnail(const QString &picture_filename, const QByteArray &data);
+	ThumbnailStore::Entry importOldThumbnail(const QString &picture_filename);
 	Thumbnail getThumbnailFromCache(const QString &picture_filename);
+	Thumbnail getThumbnailFromCache(const QString &picture_filename, const ThumbnailStore::Entry &entry);
 	Thumbnail getPictureThumbnailFromStream(QDataStream &stream);
 	Thumbnail getVideoThumbnailFromStream(QDataStream &stream, const QString &filename);
 	Thumbnail fetchImage(const QString &filename, const QString &originalFilename, bool tryDownload);
@@ -79,6 +90,7 @@ private:
 
 	mutable QMutex lock;
 	QThreadPool pool;
+	ThumbnailStore store;
 	QImage failImage;		// Shown when image-fetching fails
 	QImage dummyImage;		// Shown before thumbnail is fetched
 	QImage videoImage;		// Place holder for videos
@@ -10,6 +10,7 @@
 #include "gas.h"
 #include "parse.h"
 #include "sample.h"
+#include "stringpool.h"
 #include "subsurface-string.h"
 #include "divelist.h"
 #include "device.h"
@@ -154,7 +155,7 @@ static int cobalt_dive(void *param, int columns, char **data, char **column)
 
 	if (data[9]) {
 		state->cur_dive->dc.deviceid = atoi(data[9]);
-		state->cur_dive->dc.model = strdup("Cobalt import");
+		state->cur_dive->dc.model = intern_string("Cobalt import");
 	}
 
 	snprintf(get_buffer, sizeof(get_buffer) - 1, get_cylinder_template, state->cur_dive->number);
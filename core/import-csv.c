@@ -11,6 +11,7 @@
 #include "file.h"
 #include "parse.h"
 #include "sample.h"
+#include "stringpool.h"
 #include "divelist.h"
 #include "gettext.h"
 #include "import-csv.h"
@@ -543,7 +544,7 @@ int parse_txt_file(const char *filename, const char *csv, struct dive_table *tab
 
 		dive = alloc_dive();
 		dive->when = utc_mktime(&cur_tm);;
-		dive->dc.model = strdup("Poseidon MkVI Discovery");
+		dive->dc.model = intern_string("Poseidon MkVI Discovery");
 		value = parse_mkvi_value(memtxt.buffer, "Rig Serial number");
 		dive->dc.deviceid = atoi(value);
 		free(value);
@@ -553,7 +554,7 @@ int parse_txt_file(const char *filename, const char *csv, struct dive_table *tab
 		cyl.cylinder_use = OXYGEN;
 		cyl.type.size.mliter = 3000;
 		cyl.type.workingpressure.mbar = 200000;
-		cyl.type.description = "3l Mk6";
+		cyl.type.description = intern_string("3l Mk6");
 		cyl.gasmix.o2.permille = 1000;
 		cyl.manually_added = true;
 		cyl.bestmix_o2 = 0;
@@ -563,7 +564,7 @@ int parse_txt_file(const char *filename, const char *csv, struct dive_table *tab
 		cyl.cylinder_use = DILUENT;
 		cyl.type.size.mliter = 3000;
 		cyl.type.workingpressure.mbar = 200000;
-		cyl.type.description = "3l Mk6";
+		cyl.type.description = intern_string("3l Mk6");
 		value = parse_mkvi_value(memtxt.buffer, "Helium percentage");
 		he = atoi(value);
 		free(value);
@@ -8,6 +8,7 @@
 #include "dive.h"
 #include "divesite.h"
 #include "sample.h"
+#include "stringpool.h"
 #include "subsurface-string.h"
 #include "parse.h"
 #include "divelist.h"
@@ -335,7 +336,7 @@ static int divinglog_dive(void *param, int columns, char **data, char **column)
 	dc_settings_start(state);
 
 	if (data[12]) {
-		state->cur_dive->dc.model = strdup(data[12]);
+		state->cur_dive->dc.model = intern_string(data[12]);
 	} else {
 		state->cur_settings.dc.model = strdup("Divinglog import");
 	}
@@ -372,9 +373,9 @@ static int divinglog_dive(void *param, int columns, char **data, char **column)
 	settings_end(state);
 
 	if (data[12]) {
-		state->cur_dive->dc.model = strdup(data[12]);
+		state->cur_dive->dc.model = intern_string(data[12]);
 	} else {
-		state->cur_dive->dc.model = strdup("Divinglog import");
+		state->cur_dive->dc.model = intern_string("Divinglog import");
 	}
 
 	snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template, diveid);
@@ -8,6 +8,7 @@
 #include "ssrf.h"
 #include "dive.h"
 #include "sample.h"
+#include "stringpool.h"
 #include "subsurface-string.h"
 #include "parse.h"
 #include "divelist.h"
@@ -203,9 +204,9 @@ static int seac_dive(void *param, int columns, char **data, char **column)
 	settings_start(state);
 	dc_settings_start(state);
 
-	utf8_string(data[1], &state->cur_dive->dc.serial);
-	utf8_string(data[12], &state->cur_dive->dc.fw_version);
-	state->cur_dive->dc.model = strdup("Seac Action");
+	interned_string(data[1], &state->cur_dive->dc.serial);
+	interned_string(data[12], &state->cur_dive->dc.fw_version);
+	state->cur_dive->dc.model = intern_string("Seac Action");
 	// TODO: Calculate device hash from string
 	state->cur_dive->dc.deviceid = 0xffffffff;
 	add_extra_data(&state->cur_dive->dc, "GF-Lo", (const char*)sqlite3_column_text(sqlstmt, 9));
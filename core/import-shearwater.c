@@ -7,6 +7,7 @@
 #include "ssrf.h"
 #include "dive.h"
 #include "sample.h"
+#include "stringpool.h"
 #include "subsurface-string.h"
 #include "parse.h"
 #include "divelist.h"
@@ -297,13 +298,13 @@ static int shearwater_dive(void *param, int columns, char **data, char **column)
 	if (data[10]) {
 		switch (atoi(data[10])) {
 		case 2:
-			state->cur_dive->dc.model = strdup("Shearwater Petrel/Perdix");
+			state->cur_dive->dc.model = intern_string("Shearwater Petrel/Perdix");
 			break;
 		case 4:
-			state->cur_dive->dc.model = strdup("Shearwater Predator");
+			state->cur_dive->dc.model = intern_string("Shearwater Predator");
 			break;
 		default:
-			state->cur_dive->dc.model = strdup("Shearwater import");
+			state->cur_dive->dc.model = intern_string("Shearwater import");
 			break;
 		}
 	}
@@ -430,13 +431,13 @@ static int shearwater_cloud_dive(void *param, int columns, char **data, char **c
 	if (data[10]) {
 		switch (atoi(data[10])) {
 		case 2:
-			state->cur_dive->dc.model = strdup("Shearwater Petrel/Perdix");
+			state->cur_dive->dc.model = intern_string("Shearwater Petrel/Perdix");
 			break;
 		case 4:
-			state->cur_dive->dc.model = strdup("Shearwater Predator");
+			state->cur_dive->dc.model = intern_string("Shearwater Predator");
 			break;
 		default:
-			state->cur_dive->dc.model = strdup("Shearwater import");
+			state->cur_dive->dc.model = intern_string("Shearwater import");
 			break;
 		}
 	}
@@ -430,7 +430,7 @@ static int dm5_dive(void *param, int columns, char **data, char **column)
 		state->cur_dive->dc.deviceid = atoi(data[4]);
 	}
 	if (data[5])
-		utf8_string(data[5], &state->cur_dive->dc.model);
+		interned_string(data[5], &state->cur_dive->dc.model);
 
 	snprintf(get_events, sizeof(get_events) - 1, get_cylinders_template, state->cur_dive->number);
 	retval = sqlite3_exec(handle, get_events, &dm5_cylinders, state, NULL);
@@ -77,6 +77,11 @@ int subsurface_rename(const char *path, const char *newpath)
 	return rename(path, newpath);
 }
 
+int subsurface_remove(const char *path)
+{
+	return remove(path);
+}
+
 int subsurface_open(const char *path, int oflags, mode_t mode)
 {
 	return open(path, oflags, mode);
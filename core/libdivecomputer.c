@@ -22,6 +22,7 @@
 #include "errorhelper.h"
 #include "event.h"
 #include "sha1.h"
+#include "stringpool.h"
 #include "subsurface-time.h"
 #include "timer.h"
 
@@ -194,7 +195,7 @@ static int parse_gasmixes(device_data_t *devdata, struct dive *dive, dc_parser_t
 							snprintf(name_buffer, sizeof(name_buffer), "%d cuft", rounded_size);
 							break;
 						}
-						cyl.type.description = copy_string(name_buffer);
+						cyl.type.description = intern_string(name_buffer);
 						cyl.type.size.mliter = lrint(cuft_to_l(rounded_size) * 1000 /
 											mbar_to_atm(cyl.type.workingpressure.mbar));
 					}
@@ -230,7 +231,7 @@ static int parse_gasmixes(device_data_t *devdata, struct dive *dive, dc_parser_t
 		}
 		/* whatever happens, make sure there is a name for the cylinder */
 		if (empty_string(cyl.type.description))
-			cyl.type.description = strdup(translate("gettextFromC", "unknown"));
+			cyl.type.description = intern_string(translate("gettextFromC", "unknown"));
 
 		add_cylinder(&dive->cylinders, dive->cylinders.nr, cyl);
 	}
@@ -464,7 +465,7 @@ static int might_be_same_dc(struct divecomputer *a, struct divecomputer *b)
 {
 	if (!a->model || !b->model)
 		return 1;
-	if (strcasecmp(a->model, b->model))
+	if (a->model != b->model && strcasecmp(a->model, b->model))
 		return 0;
 	if (!a->deviceid || !b->deviceid)
 		return 1;
@@ -566,7 +567,7 @@ static void set_dc_serial(struct divecomputer *dc, const char *serial, const dev
 {
 	const struct device *device;
 
-	dc->serial = strdup(serial);
+	dc->serial = intern_string(serial);
 	if ((device = get_device_for_dc(&device_table, dc)) != NULL)	// prefer already known ID over downloaded ID.
 		dc->deviceid = device_get_id(device);
 
@@ -591,7 +592,7 @@ static void parse_string_field(device_data_t *devdata, struct dive *dive, dc_fie
 		return;
 	}
 	if (!strcmp(str->desc, "FW Version")) {
-		dive->dc.fw_version = strdup(str->value);
+		dive->dc.fw_version = intern_string(str->value);
 		return;
 	}
 	/* GPS data? */
@@ -797,7 +798,7 @@ static int dive_cb(const unsigned char *data, unsigned int size,
 	dive = alloc_dive();
 
 	// Fill in basic fields
-	dive->dc.model = strdup(devdata->model);
+	dive->dc.model = intern_string(devdata->model);
 	dive->dc.diveid = calculate_diveid(fingerprint, fsize);
 
 	/* Should we add it to the cached fingerprint file? */
@@ -6,6 +6,7 @@
 #include "dive.h"
 #include "file.h"
 #include "sample.h"
+#include "stringpool.h"
 #include "strndup.h"
 
 // Convert bytes into an INT
@@ -159,17 +160,17 @@ static void parse_dives(int log_version, const unsigned char *buf, unsigned int
 		model = *(buf + ptr);
 		switch (model) {
 		case 0:
-			dc->model = strdup("Xen");
+			dc->model = intern_string("Xen");
 			break;
 		case 1:
 		case 2:
-			dc->model = strdup("Xeo");
+			dc->model = intern_string("Xeo");
 			break;
 		case 4:
-			dc->model = strdup("Lynx");
+			dc->model = intern_string("Lynx");
 			break;
 		default:
-			dc->model = strdup("Liquivision");
+			dc->model = intern_string("Liquivision");
 			break;
 		}
 		ptr++;
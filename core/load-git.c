@@ -14,22 +14,86 @@
 
 #include "gettext.h"
 
+#include "arena.h"
 #include "dive.h"
 #include "divesite.h"
 #include "event.h"
 #include "errorhelper.h"
 #include "sample.h"
+#include "stringpool.h"
 #include "subsurface-string.h"
 #include "trip.h"
 #include "device.h"
 #include "membuffer.h"
 #include "git-access.h"
+#include "git-snapshot.h"
 #include "picture.h"
 #include "qthelper.h"
 #include "tag.h"
 #include "subsurface-time.h"
 
 const char *saved_git_id = NULL;
+bool git_load_sequential = false;
+
+struct git_parser_state;
+typedef void (line_fn_t)(char *, struct membuffer *, struct git_parser_state *);
+
+/*
+ * Loading happens in three phases:
+ *
+ *  1) The tree is walked and everything but the dive and divecomputer
+ *     files is parsed. For each dive, the contents of these blobs are
+ *     collected in a 'git_dive_job'. The repository is only accessed in
+ *     this phase, since libgit2 objects must not be used from different
+ *     threads concurrently.
+ *  2) The dive jobs are parsed in parallel. Lines that modify global
+ *     data (dive sites, tags) are not executed but recorded. Errors
+ *     are collected in the job, since the error callback may be GUI code.
+ *  3) The recorded lines are replayed, the errors are reported and the
+ *     dives and trips are added to the tables in the order of the tree
+ *     walk. Thus, the result is the same as if everything was parsed
+ *     sequentially.
+ *
+ * If git_load_sequential is set, phase 2 is skipped and the dives are
+ * parsed in phase 3 on the calling thread. This is used to test that
+ * both give the same result.
+ */
+struct git_dive_file {
+	char *content;
+	unsigned int size;
+	bool is_dc;
+	char *suffix;
+};
+
+struct git_deferred_line {
+	line_fn_t *fn;
+	char *line;
+	struct membuffer str;
+};
+
+struct git_dive_job {
+	struct dive *dive;
+	bool reused;		/* taken over from a previous load, nothing to parse */
+	int nr_files, alloc_files;
+	struct git_dive_file *files;
+	int nr_deferred, alloc_deferred;
+	struct git_deferred_line *deferred;
+	struct membuffer errors;	/* reported in phase 3, one per line */
+};
+
+/* A dive of a previous load that may be reused, see reuse_dive() */
+struct git_reusable_dive {
+	unsigned char git_id[20];
+	timestamp_t when;
+	struct dive *dive;
+	bool reused;
+};
+
+/* A dive or a trip that is added to the tables in phase 3 */
+struct git_load_step {
+	struct git_dive_job *job;
+	dive_trip_t *trip;
+};
 
 struct git_parser_state {
 	git_repository *repo;
@@ -52,6 +116,15 @@ struct git_parser_state {
 	struct device_table *devices;
 	struct filter_preset_table *filter_presets;
 	int o2pressure_sensor;
+	struct git_dive_job *active_job;
+	bool defer_shared;	/* set when parsing in a worker thread */
+	struct arena *arena;	/* samples and extra data of the dive parsed in a worker thread */
+	int nr_steps, alloc_steps;
+	struct git_load_step *steps;
+	int nr_snapshot_texts, alloc_snapshot_texts;
+	struct git_snapshot_text *snapshot_texts;
+	int nr_reusable;
+	struct git_reusable_dive *reusable;	/* sorted by git_id and time */
 };
 
 struct keyword_action {
@@ -168,12 +241,41 @@ static int get_index(const char *line)
 static int get_hex(const char *line)
 { return strtoul(line, NULL, 16); }
 
+/*
+ * When parsing in a worker thread, lines that access data shared
+ * between dives are recorded and replayed later in the main thread.
+ * Returns true if the line was recorded.
+ */
+static bool defer_line(line_fn_t *fn, char *line, struct membuffer *str, struct git_parser_state *state)
+{
+	struct git_dive_job *job = state->active_job;
+	struct git_deferred_line *deferred;
+
+	if (!state->defer_shared)
+		return false;
+	if (job->nr_deferred >= job->alloc_deferred) {
+		job->alloc_deferred = (job->alloc_deferred + 4) * 3 / 2;
+		job->deferred = realloc(job->deferred, job->alloc_deferred * sizeof(*job->deferred));
+		if (!job->deferred)
+			exit(1);
+	}
+	deferred = &job->deferred[job->nr_deferred++];
+	deferred->fn = fn;
+	deferred->line = strdup(line);
+	memset(&deferred->str, 0, sizeof(deferred->str));
+	if (str->len)
+		put_bytes(&deferred->str, str->buffer, str->len);
+	return true;
+}
+
 static void parse_dive_gps(char *line, struct membuffer *str, struct git_parser_state *state)
 {
-	UNUSED(str);
 	location_t location;
-	struct dive_site *ds = get_dive_site_for_dive(state->active_dive);
+	struct dive_site *ds;
 
+	if (defer_line(parse_dive_gps, line, str, state))
+		return;
+	ds = get_dive_site_for_dive(state->active_dive);
 	parse_location(line, &location);
 	if (!ds) {
 		ds = get_dive_site_by_gps(&location, state->sites);
@@ -187,16 +289,20 @@ static void parse_dive_gps(char *line, struct membuffer *str, struct git_parser_
 			ds->notes = add_to_string(ds->notes, translate("gettextFromC", "multiple GPS locations for this dive site; also %s\n"), coords);
 			free(coords);
 		}
-		ds->location = location;
+		set_dive_site_location(ds, &location);
 	}
 
 }
 
 static void parse_dive_location(char *line, struct membuffer *str, struct git_parser_state *state)
 {
-	UNUSED(line);
-	char *name = detach_cstring(str);
-	struct dive_site *ds = get_dive_site_for_dive(state->active_dive);
+	char *name;
+	struct dive_site *ds;
+
+	if (defer_line(parse_dive_location, line, str, state))
+		return;
+	name = detach_cstring(str);
+	ds = get_dive_site_for_dive(state->active_dive);
 	if (!ds) {
 		ds = get_dive_site_by_name(name, &dive_site_table);
 		if (!ds)
@@ -228,7 +334,11 @@ static void parse_dive_notes(char *line, struct membuffer *str, struct git_parse
 { UNUSED(line); state->active_dive->notes = detach_cstring(str); }
 
 static void parse_dive_divesiteid(char *line, struct membuffer *str, struct git_parser_state *state)
-{ UNUSED(str); add_dive_to_dive_site(state->active_dive, get_dive_site_by_uuid(get_hex(line), &dive_site_table)); }
+{
+	if (defer_line(parse_dive_divesiteid, line, str, state))
+		return;
+	add_dive_to_dive_site(state->active_dive, get_dive_site_by_uuid(get_hex(line), &dive_site_table));
+}
 
 /*
  * We can have multiple tags in the membuffer. They are separated by
@@ -236,12 +346,13 @@ static void parse_dive_divesiteid(char *line, struct membuffer *str, struct git_
  */
 static void parse_dive_tags(char *line, struct membuffer *str, struct git_parser_state *state)
 {
-	UNUSED(line);
 	const char *tag;
 	int len = str->len;
 
 	if (!len)
 		return;
+	if (defer_line(parse_dive_tags, line, str, state))
+		return;
 
 	/* Make sure there is a NUL at the end too */
 	tag = mb_cstring(str);
@@ -402,7 +513,8 @@ static void parse_cylinder_keyvalue(void *_cylinder, const char *key, const char
 		return;
 	}
 	if (!strcmp(key, "description")) {
-		cylinder->type.description = value;
+		cylinder->type.description = intern_string(value);
+		free((void *)value);
 		return;
 	}
 	if (!strcmp(key, "o2")) {
@@ -741,7 +853,7 @@ static void parse_dc_meandepth(char *line, struct membuffer *str, struct git_par
 { UNUSED(str); state->active_dc->meandepth = get_depth(line); }
 
 static void parse_dc_model(char *line, struct membuffer *str, struct git_parser_state *state)
-{ UNUSED(line); state->active_dc->model = detach_cstring(str); }
+{ UNUSED(line); state->active_dc->model = intern_string(mb_cstring(str)); }
 
 static void parse_dc_numberofoxygensensors(char *line, struct membuffer *str, struct git_parser_state *state)
 { UNUSED(str); state->active_dc->no_o2sensors = get_index(line); }
@@ -860,7 +972,11 @@ static void parse_dc_event(char *line, struct membuffer *str, struct git_parser_
 	if (p.has_divemode && strcmp(p.name, "modechange"))
 		p.name = "modechange";
 
-	ev = add_event(state->active_dc, p.ev.time.seconds, p.ev.type, p.ev.flags, p.ev.value, p.name);
+	/* Don't use add_event(), since that remembers the event name in a global
+	 * list. This is done when merging the dive, see remember_event_names(). */
+	ev = create_event(p.ev.time.seconds, p.ev.type, p.ev.flags, p.ev.value, p.name);
+	if (ev)
+		add_event_to_dc(state->active_dc, ev);
 
 	/*
 	 * Older logs might mark the dive to be CCR by having an "SP change" event at time 0:00.
@@ -1296,7 +1412,6 @@ static const char *parse_one_string(const char *buf, const char *end, struct mem
 	return p;
 }
 
-typedef void (line_fn_t)(char *, struct membuffer *, struct git_parser_state *);
 #define MAXLINE 500
 static unsigned parse_one_line(const char *buf, unsigned size, line_fn_t *fn, struct git_parser_state *state, struct membuffer *b)
 {
@@ -1326,10 +1441,8 @@ static unsigned parse_one_line(const char *buf, unsigned size, line_fn_t *fn, st
  * strings, but the callback function can "steal" it by
  * saving its value and just clear the original.
  */
-static void for_each_line(git_blob *blob, line_fn_t *fn, struct git_parser_state *state)
+static void for_each_line_buf(const char *content, unsigned int size, line_fn_t *fn, struct git_parser_state *state)
 {
-	const char *content = git_blob_rawcontent(blob);
-	unsigned int size = git_blob_rawsize(blob);
 	struct membuffer str = { 0 };
 
 	while (size) {
@@ -1343,32 +1456,96 @@ static void for_each_line(git_blob *blob, line_fn_t *fn, struct git_parser_state
 	free_buffer(&str);
 }
 
+static void for_each_line(git_blob *blob, line_fn_t *fn, struct git_parser_state *state)
+{
+	for_each_line_buf(git_blob_rawcontent(blob), git_blob_rawsize(blob), fn, state);
+}
+
+/* Settings and filter presets are stored verbatim in the snapshot, see git-snapshot.h */
+enum snapshot_text_kind {
+	SNAPSHOT_SETTINGS,
+	SNAPSHOT_FILTER_PRESET
+};
+
+static void add_snapshot_text(struct git_parser_state *state, enum snapshot_text_kind kind, git_blob *blob)
+{
+	struct git_snapshot_text *text;
+	unsigned int len = git_blob_rawsize(blob);
+	char *copy;
+
+	if (state->nr_snapshot_texts >= state->alloc_snapshot_texts) {
+		state->alloc_snapshot_texts = (state->alloc_snapshot_texts + 4) * 3 / 2;
+		state->snapshot_texts = realloc(state->snapshot_texts, state->alloc_snapshot_texts * sizeof(*state->snapshot_texts));
+		if (!state->snapshot_texts)
+			exit(1);
+	}
+	copy = malloc(len + 1);
+	if (!copy)
+		exit(1);
+	memcpy(copy, git_blob_rawcontent(blob), len);
+	text = &state->snapshot_texts[state->nr_snapshot_texts++];
+	text->kind = kind;
+	text->len = len;
+	text->text = copy;
+}
+
+static void free_snapshot_texts(struct git_parser_state *state)
+{
+	for (int i = 0; i < state->nr_snapshot_texts; i++)
+		free((void *)state->snapshot_texts[i].text);
+	free(state->snapshot_texts);
+	state->snapshot_texts = NULL;
+	state->nr_snapshot_texts = state->alloc_snapshot_texts = 0;
+}
+
 #define GIT_WALK_OK   0
 #define GIT_WALK_SKIP 1
 
+static void add_load_step(struct git_parser_state *state, struct git_dive_job *job, dive_trip_t *trip)
+{
+	struct git_load_step *step;
+
+	if (state->nr_steps >= state->alloc_steps) {
+		state->alloc_steps = (state->alloc_steps + 16) * 3 / 2;
+		state->steps = realloc(state->steps, state->alloc_steps * sizeof(*state->steps));
+		if (!state->steps)
+			exit(1);
+	}
+	step = &state->steps[state->nr_steps++];
+	step->job = job;
+	step->trip = trip;
+}
+
+/* The trip is added to the trip table in phase 3, see merge_load_steps() */
 static void finish_active_trip(struct git_parser_state *state)
 {
 	dive_trip_t *trip = state->active_trip;
 
 	if (trip) {
 		state->active_trip = NULL;
-		insert_trip(trip, state->trips);
+		add_load_step(state, NULL, trip);
 	}
 }
 
+/* The dive is parsed in phase 2 and added to the dive table in phase 3 */
 static void finish_active_dive(struct git_parser_state *state)
 {
-	struct dive *dive = state->active_dive;
+	struct git_dive_job *job = state->active_job;
 
-	if (dive) {
+	if (job) {
 		state->active_dive = NULL;
-		record_dive_to_table(dive, state->table);
+		state->active_job = NULL;
+		add_load_step(state, job, NULL);
 	}
 }
 
 static void create_new_dive(timestamp_t when, struct git_parser_state *state)
 {
 	state->active_dive = alloc_dive();
+	state->active_job = calloc(1, sizeof(struct git_dive_job));
+	if (!state->active_job)
+		exit(1);
+	state->active_job->dive = state->active_dive;
 
 	/* We'll fill in more data from the dive file */
 	state->active_dive->when = when;
@@ -1377,6 +1554,102 @@ static void create_new_dive(timestamp_t when, struct git_parser_state *state)
 		add_dive_to_trip(state->active_dive, state->active_trip);
 }
 
+static int comp_reusable_dive(const void *_a, const void *_b)
+{
+	const struct git_reusable_dive *a = _a, *b = _b;
+	int res = memcmp(a->git_id, b->git_id, sizeof(a->git_id));
+	if (res)
+		return res;
+	return a->when < b->when ? -1 : a->when > b->when;
+}
+
+static void init_reusable_dives(struct git_parser_state *state, const struct dive_table *old_dives)
+{
+	state->nr_reusable = 0;
+	if (!old_dives->nr)
+		return;
+	state->reusable = malloc(old_dives->nr * sizeof(*state->reusable));
+	if (!state->reusable)
+		exit(1);
+	for (int i = 0; i < old_dives->nr; i++) {
+		struct dive *dive = old_dives->dives[i];
+		struct git_reusable_dive *entry;
+		/* The git id is reset when a dive is modified */
+		if (!dive_cache_is_valid(dive))
+			continue;
+		entry = &state->reusable[state->nr_reusable++];
+		memcpy(entry->git_id, dive->git_id, sizeof(entry->git_id));
+		entry->when = dive->when;
+		entry->dive = dive;
+		entry->reused = false;
+	}
+	qsort(state->reusable, state->nr_reusable, sizeof(*state->reusable), comp_reusable_dive);
+}
+
+/* Leave only the dives that were not reused in the table */
+static void remove_reused_dives(struct git_parser_state *state, struct dive_table *old_dives)
+{
+	int i, nr = 0;
+
+	for (i = 0; i < old_dives->nr; i++) {
+		if (!dive_cache_is_valid(old_dives->dives[i]))
+			old_dives->dives[nr++] = old_dives->dives[i];
+	}
+	for (i = 0; i < state->nr_reusable; i++) {
+		if (!state->reusable[i].reused)
+			old_dives->dives[nr++] = state->reusable[i].dive;
+	}
+	old_dives->nr = nr;
+	free(state->reusable);
+	state->reusable = NULL;
+	state->nr_reusable = 0;
+}
+
+/*
+ * When reloading, a dive whose directory didn't change is taken over
+ * from the previous load instead of being parsed again. Since the time
+ * of the dive is encoded in the directory name, it has to be compared
+ * separately. The dive keeps its fulltext cache and filter state, which
+ * may depend on the trip location and the name of the dive site. Thus,
+ * only dives whose trip and dive site didn't change their names are
+ * reused. The dive sites are parsed before the dives, because their
+ * directory comes first in the tree.
+ */
+static bool reuse_dive(timestamp_t when, const git_oid *id, struct git_parser_state *state)
+{
+	struct git_reusable_dive key, *entry;
+	struct dive *dive;
+
+	if (!state->nr_reusable)
+		return false;
+	memcpy(key.git_id, id->id, sizeof(key.git_id));
+	key.when = when;
+	entry = bsearch(&key, state->reusable, state->nr_reusable, sizeof(*state->reusable), comp_reusable_dive);
+	if (!entry || entry->reused)
+		return false;
+	dive = entry->dive;
+	if (!same_string(dive->divetrip ? dive->divetrip->location : NULL,
+			 state->active_trip ? state->active_trip->location : NULL))
+		return false;
+	if (dive->dive_site) {
+		struct dive_site *ds = get_dive_site_by_uuid(dive->dive_site->uuid, state->sites);
+		if (!ds || !same_string(ds->name, dive->dive_site->name))
+			return false;
+	}
+
+	entry->reused = true;
+	dive->divetrip = NULL;
+	state->active_dive = dive;
+	state->active_job = calloc(1, sizeof(struct git_dive_job));
+	if (!state->active_job)
+		exit(1);
+	state->active_job->dive = dive;
+	state->active_job->reused = true;
+	if (state->active_trip)
+		add_dive_to_trip(dive, state->active_trip);
+	return true;
+}
+
 static bool validate_date(int yyyy, int mm, int dd)
 {
 	return yyyy > 1930 && yyyy < 3000 &&
@@ -1493,6 +1766,8 @@ static int dive_directory(const char *root, const git_tree_entry *entry, const c
 	tm.tm_mday = dd;
 
 	finish_active_dive(state);
+	if (reuse_dive(utc_mktime(&tm), git_tree_entry_id(entry), state))
+		return GIT_WALK_SKIP;
 	create_new_dive(utc_mktime(&tm), state);
 	memcpy(state->active_dive->git_id, git_tree_entry_id(entry)->id, 20);
 	return GIT_WALK_OK;
@@ -1604,9 +1879,8 @@ static int walk_tree_directory(const char *root, const git_tree_entry *entry, st
 	return dive_trip_directory(root, name, state);
 }
 
-static git_blob *git_tree_entry_blob(git_repository *repo, const git_tree_entry *entry)
+static git_blob *git_id_blob(git_repository *repo, const git_oid *id)
 {
-	const git_oid *id = git_tree_entry_id(entry);
 	git_blob *blob;
 
 	if (git_blob_lookup(&blob, repo, id))
@@ -1614,6 +1888,11 @@ static git_blob *git_tree_entry_blob(git_repository *repo, const git_tree_entry
 	return blob;
 }
 
+static git_blob *git_tree_entry_blob(git_repository *repo, const git_tree_entry *entry)
+{
+	return git_id_blob(repo, git_tree_entry_id(entry));
+}
+
 static struct divecomputer *create_new_dc(struct dive *dive)
 {
 	struct divecomputer *dc = &dive->dc;
@@ -1637,21 +1916,14 @@ static struct divecomputer *create_new_dc(struct dive *dive)
  * We should *really* try to delay the dive computer data parsing
  * until necessary, in order to reduce load-time. The parsing is
  * cheap, but the loading of the git blob into memory can be pretty
- * costly.
+ * costly. At least, the parsing is done in parallel, see parse_dive_job().
  */
-static int parse_divecomputer_entry(struct git_parser_state *state, const git_tree_entry *entry, const char *suffix)
+static void parse_divecomputer_entry(struct git_parser_state *state, const struct git_dive_file *file)
 {
-	UNUSED(suffix);
-	git_blob *blob = git_tree_entry_blob(state->repo, entry);
-
-	if (!blob)
-		return report_error("Unable to read divecomputer file");
-
 	state->active_dc = create_new_dc(state->active_dive);
-	for_each_line(blob, divecomputer_parser, state);
-	git_blob_free(blob);
+	set_dc_arena(state->active_dc, state->arena);
+	for_each_line_buf(file->content, file->size, divecomputer_parser, state);
 	state->active_dc = NULL;
-	return 0;
 }
 
 /*
@@ -1660,18 +1932,45 @@ static int parse_divecomputer_entry(struct git_parser_state *state, const git_tr
  * pictures too. So if any of the dive computers change, the dive cache
  * has to be invalidated too.
  */
-static int parse_dive_entry(struct git_parser_state *state, const git_tree_entry *entry, const char *suffix)
+static void parse_dive_entry(struct git_parser_state *state, const struct git_dive_file *file)
 {
 	struct dive *dive = state->active_dive;
-	git_blob *blob = git_tree_entry_blob(state->repo, entry);
-	if (!blob)
-		return report_error("Unable to read dive file");
-	if (*suffix)
-		dive->number = atoi(suffix + 1);
+	if (*file->suffix)
+		dive->number = atoi(file->suffix + 1);
 	clear_weightsystem_table(&state->active_dive->weightsystems);
 	state->o2pressure_sensor = 1;
-	for_each_line(blob, dive_parser, state);
+	for_each_line_buf(file->content, file->size, dive_parser, state);
+}
+
+/* In phase 1, only read the dive and divecomputer files of a dive */
+static int queue_dive_file(struct git_parser_state *state, const git_tree_entry *entry, const char *suffix, bool is_dc)
+{
+	struct git_dive_job *job = state->active_job;
+	struct git_dive_file *file;
+	git_blob *blob = git_tree_entry_blob(state->repo, entry);
+	unsigned int size;
+	char *content;
+
+	if (!blob)
+		return report_error(is_dc ? "Unable to read divecomputer file" : "Unable to read dive file");
+	size = git_blob_rawsize(blob);
+	content = malloc(size ? size : 1);
+	if (!content)
+		exit(1);
+	memcpy(content, git_blob_rawcontent(blob), size);
 	git_blob_free(blob);
+
+	if (job->nr_files >= job->alloc_files) {
+		job->alloc_files = (job->alloc_files + 2) * 3 / 2;
+		job->files = realloc(job->files, job->alloc_files * sizeof(*job->files));
+		if (!job->files)
+			exit(1);
+	}
+	file = &job->files[job->nr_files++];
+	file->content = content;
+	file->size = size;
+	file->is_dc = is_dc;
+	file->suffix = strdup(suffix);
 	return 0;
 }
 
@@ -1705,6 +2004,7 @@ static int parse_settings_entry(struct git_parser_state *state, const git_tree_e
 	git_blob *blob = git_tree_entry_blob(state->repo, entry);
 	if (!blob)
 		return report_error("Unable to read settings file");
+	add_snapshot_text(state, SNAPSHOT_SETTINGS, blob);
 	for_each_line(blob, settings_parser, state);
 	git_blob_free(blob);
 	return 0;
@@ -1745,21 +2045,25 @@ static int parse_picture_entry(struct git_parser_state *state, const git_tree_en
 	return 0;
 }
 
-static int parse_filter_preset(struct git_parser_state *state, const git_tree_entry *entry)
+static void parse_filter_preset_buf(struct git_parser_state *state, const char *content, unsigned int size)
 {
-	git_blob *blob = git_tree_entry_blob(state->repo, entry);
-	if (!blob)
-		return report_error("Unable to read filter preset file");
-
 	state->active_filter = alloc_filter_preset();
-	for_each_line(blob, filter_preset_parser, state);
-
-	git_blob_free(blob);
+	for_each_line_buf(content, size, filter_preset_parser, state);
 
 	add_filter_preset_to_table(state->active_filter, state->filter_presets);
 	free_filter_preset(state->active_filter);
 	state->active_filter = NULL;
+}
 
+static int parse_filter_preset(struct git_parser_state *state, const git_tree_entry *entry)
+{
+	git_blob *blob = git_tree_entry_blob(state->repo, entry);
+	if (!blob)
+		return report_error("Unable to read filter preset file");
+
+	add_snapshot_text(state, SNAPSHOT_FILTER_PRESET, blob);
+	parse_filter_preset_buf(state, git_blob_rawcontent(blob), git_blob_rawsize(blob));
+	git_blob_free(blob);
 	return 0;
 }
 
@@ -1777,9 +2081,9 @@ static int walk_tree_file(const char *root, const git_tree_entry *entry, struct
 		break;
 	case 'D':
 		if (dive && !strncmp(name, "Divecomputer", 12))
-			return parse_divecomputer_entry(state, entry, name + 12);
+			return queue_dive_file(state, entry, name + 12, true);
 		if (dive && !strncmp(name, "Dive", 4))
-			return parse_dive_entry(state, entry, name + 4);
+			return queue_dive_file(state, entry, name + 4, false);
 		break;
 	case 'P':
 		if (!strncmp(name, "Preset-", 7))
@@ -1813,9 +2117,171 @@ static int walk_tree_cb(const char *root, const git_tree_entry *entry, void *pay
 	return GIT_WALK_OK;
 }
 
+static void parse_dive_files(struct git_parser_state *state, struct git_dive_job *job)
+{
+	state->active_dive = job->dive;
+	state->active_job = job;
+	state->arena = arena_new();
+	for (int i = 0; i < job->nr_files; i++) {
+		struct git_dive_file *file = &job->files[i];
+		if (file->is_dc)
+			parse_divecomputer_entry(state, file);
+		else
+			parse_dive_entry(state, file);
+	}
+	arena_seal(state->arena);
+	arena_unref(state->arena);
+	state->arena = NULL;
+	state->active_job = NULL;
+	state->active_dive = NULL;
+}
+
+/*
+ * Phase 2: parse the dive and divecomputer files of a dive. This is
+ * called from worker threads and therefore uses its own parser state.
+ */
+static void parse_dive_job(void *data, int idx)
+{
+	const struct git_parser_state *main_state = data;
+	struct git_dive_job *job = main_state->steps[idx].job;
+	struct git_parser_state state = { 0 };
+
+	if (!job || job->reused)
+		return;
+	state.sites = main_state->sites;
+	state.devices = main_state->devices;
+	state.defer_shared = true;
+	collect_errors(&job->errors);
+	parse_dive_files(&state, job);
+	collect_errors(NULL);
+}
+
+/* Report the errors collected by parse_dive_job() on the calling thread */
+static void report_job_errors(struct git_dive_job *job)
+{
+	const char *line;
+
+	if (!job->errors.len)
+		return;
+	line = mb_cstring(&job->errors);
+	while (*line) {
+		const char *end = strchr(line, '\n');
+		report_error("%.*s", (int)(end - line), line);
+		line = end + 1;
+	}
+}
+
+static void remember_event_names(const struct dive *dive)
+{
+	const struct divecomputer *dc;
+	const struct event *ev;
+
+	for_each_dc (dive, dc) {
+		for (ev = dc->events; ev; ev = ev->next)
+			remember_event(ev->name);
+	}
+}
+
+static void free_dive_job(struct git_dive_job *job)
+{
+	for (int i = 0; i < job->nr_files; i++) {
+		free(job->files[i].content);
+		free(job->files[i].suffix);
+	}
+	free(job->files);
+	free(job->deferred);
+	free_buffer(&job->errors);
+	free(job);
+}
+
+/* Phase 3: finish the dives and add them and the trips to the tables. */
+static void merge_load_steps(struct git_parser_state *state)
+{
+	for (int i = 0; i < state->nr_steps; i++) {
+		struct git_load_step *step = &state->steps[i];
+		struct git_dive_job *job = step->job;
+
+		if (step->trip) {
+			insert_trip(step->trip, state->trips);
+			continue;
+		}
+		if (job->reused) {
+			/* Move the dive over to the newly loaded dive site */
+			struct dive_site *ds = job->dive->dive_site;
+			job->dive->dive_site = NULL;
+			if (ds && (ds = get_dive_site_by_uuid(ds->uuid, state->sites)) != NULL)
+				add_dive_to_dive_site(job->dive, ds);
+			/* The event names were cleared before reloading */
+			remember_event_names(job->dive);
+			record_dive_to_table(job->dive, state->table);
+			free_dive_job(job);
+			continue;
+		}
+		if (git_load_sequential) {
+			parse_dive_files(state, job);
+		} else {
+			report_job_errors(job);
+			state->active_dive = job->dive;
+			for (int j = 0; j < job->nr_deferred; j++) {
+				struct git_deferred_line *deferred = &job->deferred[j];
+				deferred->fn(deferred->line, &deferred->str, state);
+				free(deferred->line);
+				free_buffer(&deferred->str);
+			}
+			state->active_dive = NULL;
+		}
+		remember_event_names(job->dive);
+		record_dive_to_table(job->dive, state->table);
+		free_dive_job(job);
+	}
+	free(state->steps);
+	state->steps = NULL;
+	state->nr_steps = state->alloc_steps = 0;
+}
+
+/*
+ * Phase 1 failed: free the queued dives and trips. The reused dives
+ * are returned to the dives of the previous load.
+ */
+static void free_load_steps(struct git_parser_state *state)
+{
+	for (int i = 0; i < state->nr_steps; i++) {
+		struct git_load_step *step = &state->steps[i];
+		struct git_dive_job *job = step->job;
+
+		if (step->trip) {
+			free_trip(step->trip);
+			continue;
+		}
+		if (job->reused) {
+			job->dive->divetrip = NULL;
+			for (int j = 0; j < state->nr_reusable; j++) {
+				if (state->reusable[j].dive == job->dive)
+					state->reusable[j].reused = false;
+			}
+		} else {
+			free_dive(job->dive);
+		}
+		free_dive_job(job);
+	}
+	free(state->steps);
+	state->steps = NULL;
+	state->nr_steps = state->alloc_steps = 0;
+}
+
 static int load_dives_from_tree(git_repository *repo, git_tree *tree, struct git_parser_state *state)
 {
-	git_tree_walk(tree, GIT_TREEWALK_PRE, walk_tree_cb, state);
+	int ret = git_tree_walk(tree, GIT_TREEWALK_PRE, walk_tree_cb, state);
+
+	finish_active_dive(state);
+	finish_active_trip(state);
+	if (ret < 0) {
+		free_load_steps(state);
+		return report_error("Could not read the dives of the repository");
+	}
+	if (!git_load_sequential)
+		run_in_parallel(state->nr_steps, parse_dive_job, state);
+	merge_load_steps(state);
 	return 0;
 }
 
@@ -1845,23 +2311,83 @@ static int find_commit(git_repository *repo, const char *branch, git_commit **co
 	return 0;
 }
 
+static void replay_snapshot_text(const struct git_snapshot_text *text, void *data)
+{
+	struct git_parser_state *state = data;
+
+	switch (text->kind) {
+	case SNAPSHOT_SETTINGS:
+		for_each_line_buf(text->text, text->len, settings_parser, state);
+		break;
+	case SNAPSHOT_FILTER_PRESET:
+		parse_filter_preset_buf(state, text->text, text->len);
+		break;
+	}
+}
+
+/*
+ * The snapshot is only used when loading into empty tables and not when
+ * testing the sequential parser. Moreover, some
+ * of the parsing functions access the global dive site and device tables
+ * directly, so the result only depends on the repository if these are
+ * the target tables.
+ */
+static bool can_use_snapshot(const struct git_parser_state *state)
+{
+	return !git_load_sequential && state->table->nr == 0 && state->trips->nr == 0 &&
+	       state->sites == &dive_site_table && state->sites->nr == 0 &&
+	       state->devices == &device_table && nr_devices(state->devices) == 0;
+}
+
 static int do_git_load(git_repository *repo, const char *branch, struct git_parser_state *state)
 {
 	int ret;
 	git_commit *commit;
 	git_tree *tree;
+	char sha[GIT_OID_HEXSZ + 1];
+	char *snapshot = NULL;
+	bool snapshot_current = false;
 
 	ret = find_commit(repo, branch, &commit);
 	if (ret)
 		return ret;
-	if (git_commit_tree(&tree, commit))
+
+	/*
+	 * If the commit didn't change since the last load, use the snapshot.
+	 * When reusing dives of a previous load, parsing the changed dives
+	 * is cheaper than recreating all dives from the snapshot.
+	 */
+	git_oid_tostr(sha, sizeof(sha), git_commit_id(commit));
+	if (can_use_snapshot(state))
+		snapshot = get_git_snapshot_filename(git_repository_path(repo), branch);
+	if (snapshot && !state->nr_reusable) {
+		if (!load_git_snapshot(snapshot, sha, replay_snapshot_text, state, state->table, state->trips, state->sites)) {
+			set_git_id(git_commit_id(commit));
+			git_storage_update_progress(translate("gettextFromC", "Successfully opened dive data"));
+			free(snapshot);
+			return 0;
+		}
+	} else if (snapshot) {
+		/* Don't rewrite the snapshot if only the dives changed by the user are reloaded */
+		snapshot_current = git_snapshot_matches(snapshot, sha);
+	}
+
+	if (git_commit_tree(&tree, commit)) {
+		free(snapshot);
 		return report_error("Could not look up tree of commit in branch '%s'", branch);
+	}
 	git_storage_update_progress(translate("gettextFromC", "Load dives from local cache"));
 	ret = load_dives_from_tree(repo, tree, state);
 	if (!ret) {
 		set_git_id(git_commit_id(commit));
+		/* This replaces an outdated or corrupt snapshot */
+		if (snapshot && !snapshot_current)
+			save_git_snapshot(snapshot, sha, state->snapshot_texts, state->nr_snapshot_texts,
+					  state->table, state->trips, state->sites);
 		git_storage_update_progress(translate("gettextFromC", "Successfully opened dive data"));
 	}
+	free_snapshot_texts(state);
+	free(snapshot);
 	git_object_free((git_object *)tree);
 
 	return ret;
@@ -1902,7 +2428,38 @@ int git_load_dives(struct git_repository *repo, const char *branch, struct dive_
 	ret = do_git_load(repo, branch, &state);
 	git_repository_free(repo);
 	free((void *)branch);
-	finish_active_dive(&state);
-	finish_active_trip(&state);
+	return ret;
+}
+
+/*
+ * Like git_load_dives(), but dives of old_dives whose directory in the
+ * repository didn't change are moved to the new table instead of being
+ * parsed again. They keep their fulltext cache and filter state.
+ * Their trips and dive sites are replaced by the newly loaded ones,
+ * therefore the trips and dive sites of the old dives must not be in
+ * the target tables.
+ *
+ * On return, old_dives contains the dives that were not reused.
+ */
+int git_reload_dives(struct git_repository *repo, const char *branch, struct dive_table *table, struct trip_table *trips,
+		     struct dive_site_table *sites, struct device_table *devices, struct filter_preset_table *filter_presets,
+		     struct dive_table *old_dives)
+{
+	int ret;
+	struct git_parser_state state = { 0 };
+	state.repo = repo;
+	state.table = table;
+	state.trips = trips;
+	state.sites = sites;
+	state.devices = devices;
+	state.filter_presets = filter_presets;
+
+	if (repo == dummy_git_repository)
+		return report_error("Unable to open git repository at '%s'", branch);
+	init_reusable_dives(&state, old_dives);
+	ret = do_git_load(repo, branch, &state);
+	remove_reused_dives(&state, old_dives);
+	git_repository_free(repo);
+	free((void *)branch);
 	return ret;
 }
@@ -12,6 +12,7 @@
 #include "extradata.h"
 #include "file.h"
 #include "libdivecomputer.h"
+#include "stringpool.h"
 
 /*
  * Fills a device_data_t structure with known dc data and a descriptor.
@@ -157,7 +158,7 @@ void ostctools_import(const char *file, struct dive_table *divetable, struct tri
 	}
 	tmp = calloc(strlen(devdata->vendor) + strlen(devdata->model) + 28, 1);
 	sprintf(tmp, "%s %s (Imported from OSTCTools)", devdata->vendor, devdata->model);
-	ostcdive->dc.model = copy_string(tmp);
+	ostcdive->dc.model = intern_string(tmp);
 	free(tmp);
 
 	// Parse the dive data
@@ -170,7 +171,7 @@ void ostctools_import(const char *file, struct dive_table *divetable, struct tri
 	// it from the list and add again.
 	tmp = calloc(12, 1);
 	sprintf(tmp, "%d", serial);
-	ostcdive->dc.serial = copy_string(tmp);
+	ostcdive->dc.serial = intern_string(tmp);
 	free(tmp);
 
 	if (ostcdive->dc.extra_data) {
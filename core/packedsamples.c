@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "packedsamples.h"
+#include "sample.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if MAX_SENSORS != 2
+#error "The pressure and sensor columns must be adapted to MAX_SENSORS"
+#endif
+
+enum column_type {
+	COLUMN_INT32,
+	COLUMN_UINT32,
+	COLUMN_INT16,
+	COLUMN_UINT16,
+	COLUMN_UINT8,
+	COLUMN_BOOL
+};
+
+struct column {
+	size_t offset;
+	enum column_type type;
+};
+
+#define COLUMN(field, type) { offsetof(struct sample, field), type }
+
+/* Every field of struct sample. Time and depth come first, since they are accessed most. */
+static const struct column columns[] = {
+	COLUMN(time.seconds, COLUMN_INT32),
+	COLUMN(depth.mm, COLUMN_INT32),
+	COLUMN(stoptime.seconds, COLUMN_INT32),
+	COLUMN(ndl.seconds, COLUMN_INT32),
+	COLUMN(tts.seconds, COLUMN_INT32),
+	COLUMN(rbt.seconds, COLUMN_INT32),
+	COLUMN(stopdepth.mm, COLUMN_INT32),
+	COLUMN(temperature.mkelvin, COLUMN_UINT32),
+	COLUMN(pressure[0].mbar, COLUMN_INT32),
+	COLUMN(pressure[1].mbar, COLUMN_INT32),
+	COLUMN(setpoint.mbar, COLUMN_UINT16),
+	COLUMN(o2sensor[0].mbar, COLUMN_UINT16),
+	COLUMN(o2sensor[1].mbar, COLUMN_UINT16),
+	COLUMN(o2sensor[2].mbar, COLUMN_UINT16),
+	COLUMN(bearing.degrees, COLUMN_INT16),
+	COLUMN(sensor[0], COLUMN_UINT8),
+	COLUMN(sensor[1], COLUMN_UINT8),
+	COLUMN(cns, COLUMN_UINT16),
+	COLUMN(heartbeat, COLUMN_UINT8),
+	COLUMN(sac.mliter, COLUMN_INT32),
+	COLUMN(in_deco, COLUMN_BOOL),
+	COLUMN(manually_entered, COLUMN_BOOL),
+};
+
+#define NR_COLUMNS (int)(sizeof(columns) / sizeof(columns[0]))
+
+/*
+ * The data consists of one block per column, in the order of the
+ * columns array. If the bit of the column in "varying" is set, the block
+ * contains the difference of each sample to the previous sample (the first
+ * sample to zero), otherwise it contains the value of all samples. All
+ * numbers are zig-zag encoded variable length integers.
+ */
+struct packed_samples {
+	int nr;
+	uint32_t varying;
+	size_t size;
+	unsigned char data[];
+};
+
+static int64_t get_column(const struct sample *s, const struct column *c)
+{
+	const char *p = (const char *)s + c->offset;
+
+	switch (c->type) {
+	case COLUMN_INT32: { int32_t v; memcpy(&v, p, sizeof(v)); return v; }
+	case COLUMN_UINT32: { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+	case COLUMN_INT16: { int16_t v; memcpy(&v, p, sizeof(v)); return v; }
+	case COLUMN_UINT16: { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+	case COLUMN_UINT8: { uint8_t v; memcpy(&v, p, sizeof(v)); return v; }
+	case COLUMN_BOOL: { bool v; memcpy(&v, p, sizeof(v)); return v; }
+	}
+	return 0;
+}
+
+static void set_column(struct sample *s, const struct column *c, int64_t value)
+{
+	char *p = (char *)s + c->offset;
+
+	switch (c->type) {
+	case COLUMN_INT32: { int32_t v = (int32_t)value; memcpy(p, &v, sizeof(v)); break; }
+	case COLUMN_UINT32: { uint32_t v = (uint32_t)value; memcpy(p, &v, sizeof(v)); break; }
+	case COLUMN_INT16: { int16_t v = (int16_t)value; memcpy(p, &v, sizeof(v)); break; }
+	case COLUMN_UINT16: { uint16_t v = (uint16_t)value; memcpy(p, &v, sizeof(v)); break; }
+	case COLUMN_UINT8: { uint8_t v = (uint8_t)value; memcpy(p, &v, sizeof(v)); break; }
+	case COLUMN_BOOL: { bool v = value != 0; memcpy(p, &v, sizeof(v)); break; }
+	}
+}
+
+/* Map small negative and positive numbers to small unsigned numbers: 0, -1, 1, -2, 2, ... */
+static uint64_t zigzag(int64_t v)
+{
+	return v < 0 ? ((uint64_t)(-(v + 1)) << 1) | 1 : (uint64_t)v << 1;
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+	return v & 1 ? -(int64_t)(v >> 1) - 1 : (int64_t)(v >> 1);
+}
+
+/* Write a number with 7 bits per byte. If p is NULL, only count the bytes. */
+static size_t put_varint(unsigned char *p, int64_t value)
+{
+	uint64_t v = zigzag(value);
+	size_t n = 0;
+
+	while (v >= 0x80) {
+		if (p)
+			p[n] = (v & 0x7f) | 0x80;
+		v >>= 7;
+		n++;
+	}
+	if (p)
+		p[n] = (unsigned char)v;
+	return n + 1;
+}
+
+static int64_t get_varint(const unsigned char **p)
+{
+	uint64_t v = 0;
+	int shift = 0;
+	unsigned char c;
+
+	do {
+		c = *(*p)++;
+		v |= (uint64_t)(c & 0x7f) << shift;
+		shift += 7;
+	} while (c & 0x80);
+	return unzigzag(v);
+}
+
+/* Encode the samples into data and return the number of bytes. If data is NULL, only count the bytes. */
+static size_t encode_samples(const struct sample *samples, int nr, uint32_t varying, unsigned char *data)
+{
+	size_t size = 0;
+
+	for (int col = 0; col < NR_COLUMNS; col++) {
+		const struct column *c = &columns[col];
+
+		if (varying & (1u << col)) {
+			int64_t prev = 0;
+			for (int i = 0; i < nr; i++) {
+				int64_t v = get_column(samples + i, c);
+				size += put_varint(data ? data + size : NULL, v - prev);
+				prev = v;
+			}
+		} else {
+			size += put_varint(data ? data + size : NULL, get_column(samples, c));
+		}
+	}
+	return size;
+}
+
+struct packed_samples *pack_samples(const struct sample *samples, int nr)
+{
+	struct packed_samples *packed;
+	uint32_t varying = 0;
+	size_t size;
+
+	if (nr <= 0)
+		return NULL;
+
+	for (int col = 0; col < NR_COLUMNS; col++) {
+		int64_t first = get_column(samples, &columns[col]);
+		for (int i = 1; i < nr; i++) {
+			if (get_column(samples + i, &columns[col]) != first) {
+				varying |= 1u << col;
+				break;
+			}
+		}
+	}
+
+	size = encode_samples(samples, nr, varying, NULL);
+	packed = malloc(sizeof(*packed) + size);
+	if (!packed)
+		return NULL;
+	packed->nr = nr;
+	packed->varying = varying;
+	packed->size = size;
+	encode_samples(samples, nr, varying, packed->data);
+	return packed;
+}
+
+/* Unpack into an array with room for packed_samples_nr() samples */
+void unpack_samples(const struct packed_samples *packed, struct sample *samples)
+{
+	const unsigned char *p = packed->data;
+	int nr = packed->nr;
+
+	memset(samples, 0, nr * sizeof(struct sample));
+	for (int col = 0; col < NR_COLUMNS; col++) {
+		const struct column *c = &columns[col];
+
+		if (packed->varying & (1u << col)) {
+			int64_t v = 0;
+			for (int i = 0; i < nr; i++) {
+				v += get_varint(&p);
+				set_column(samples + i, c, v);
+			}
+		} else {
+			int64_t v = get_varint(&p);
+			for (int i = 0; i < nr; i++)
+				set_column(samples + i, c, v);
+		}
+	}
+}
+
+void free_packed_samples(struct packed_samples *packed)
+{
+	free(packed);
+}
+
+int packed_samples_nr(const struct packed_samples *packed)
+{
+	return packed ? packed->nr : 0;
+}
+
+size_t packed_samples_size(const struct packed_samples *packed)
+{
+	return packed ? sizeof(*packed) + packed->size : 0;
+}
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: GPL-2.0
+
+// A compact, columnar representation of the samples of a dive computer.
+// Each field of struct sample is stored as a column. Columns that have
+// the same value in all samples (typically the rebreather, deco and
+// heartbeat fields of open-circuit dives) are stored as that single
+// value. The other columns, which always include time and depth, are
+// stored as differences to the previous sample, encoded as variable
+// length integers. The encoding is lossless.
+//
+// Packed samples are meant for dives that are not being looked at. They
+// are unpacked into a normal sample array for access, see
+// expand_dc_samples() and get_dc_samples() in divecomputer.h.
+
+#ifndef PACKEDSAMPLES_H
+#define PACKEDSAMPLES_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct sample;
+struct packed_samples;
+
+extern struct packed_samples *pack_samples(const struct sample *samples, int nr);
+extern void unpack_samples(const struct packed_samples *packed, struct sample *samples);
+extern void free_packed_samples(struct packed_samples *packed);
+extern int packed_samples_nr(const struct packed_samples *packed);
+extern size_t packed_samples_size(const struct packed_samples *packed); // Allocated bytes
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -16,6 +16,7 @@
 #include <libxml/parser.h>
 #include <libxml/parserInternals.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 #include <libxslt/transform.h>
 #include <libdivecomputer/parser.h>
 
@@ -23,7 +24,9 @@
 
 #include "dive.h"
 #include "divesite.h"
+#include "equipment.h"
 #include "errorhelper.h"
+#include "event.h"
 #include "subsurface-string.h"
 #include "parse.h"
 #include "subsurface-time.h"
@@ -33,12 +36,15 @@
 #include "picture.h"
 #include "qthelper.h"
 #include "sample.h"
+#include "stringpool.h"
 #include "tag.h"
 #include "xmlparams.h"
 
 int last_xml_version = -1;
+bool xml_tree_parser = false;
 
 static xmlDoc *test_xslt_transforms(xmlDoc *doc, const struct xml_params *params);
+static bool has_xslt_transform(const char *root_name);
 
 const struct units SI_units = SI_UNITS;
 const struct units IMPERIAL_units = IMPERIAL_UNITS;
@@ -828,7 +834,7 @@ static void try_to_fill_dc(struct divecomputer *dc, const char *name, char *buf,
 		return;
 	if (MATCH_STATE("time", divetime, &dc->when))
 		return;
-	if (MATCH("model", utf8_string, &dc->model))
+	if (MATCH("model", interned_string, &dc->model))
 		return;
 	if (MATCH("deviceid", hex_value, &deviceid)) {
 		set_dc_deviceid(dc, deviceid, &device_table); // prefer already known serial/firmware over those from the loaded log
@@ -847,96 +853,132 @@ static void try_to_fill_dc(struct divecomputer *dc, const char *name, char *buf,
 	nonmatch("divecomputer", name, buf);
 }
 
+/*
+ * The fields of a sample. Since there are many samples, these are not
+ * matched by a chain of MATCH() calls, but by a table, so that the streaming
+ * parser can look up the handler of an attribute once and then dispatch
+ * directly (see stream_sample_match()). As with MATCH(), the first pattern
+ * that matches wins.
+ */
+typedef void (*sample_fn_t)(char *buf, struct sample *sample, struct parser_state *state);
+
+#define SAMPLE_FN(name, fn, field) \
+	static void name(char *buf, struct sample *sample, struct parser_state *state) { fn(buf, &sample->field); }
+#define SAMPLE_FN_STATE(name, fn, field) \
+	static void name(char *buf, struct sample *sample, struct parser_state *state) { fn(buf, &sample->field, state); }
+#define SAMPLE_FN_PRESSURE(name, idx)									\
+	static void name(char *buf, struct sample *sample, struct parser_state *state)			\
+	{												\
+		pressure_t p;										\
+		pressure(buf, &p, state);								\
+		add_sample_pressure(sample, idx, p.mbar);						\
+	}
+
+SAMPLE_FN_STATE(sample_pressure, pressure, pressure[0])
+SAMPLE_FN_STATE(sample_o2pressure, pressure, pressure[1])
+/* Christ, this is ugly */
+SAMPLE_FN_PRESSURE(sample_pressure0, 0)
+SAMPLE_FN_PRESSURE(sample_pressure1, 1)
+SAMPLE_FN_PRESSURE(sample_pressure2, 2)
+SAMPLE_FN_PRESSURE(sample_pressure3, 3)
+SAMPLE_FN_PRESSURE(sample_pressure4, 4)
+SAMPLE_FN_STATE(sample_cylinderindex, get_cylinderindex, sensor[0])
+SAMPLE_FN(sample_sensor, get_sensor, sensor[0])
+SAMPLE_FN_STATE(sample_depth, depth, depth)
+SAMPLE_FN_STATE(sample_temperature, temperature, temperature)
+SAMPLE_FN(sample_time, sampletime, time)
+SAMPLE_FN(sample_ndl, sampletime, ndl)
+SAMPLE_FN(sample_tts, sampletime, tts)
+SAMPLE_FN(sample_stoptime, sampletime, stoptime)
+SAMPLE_FN_STATE(sample_stopdepth, depth, stopdepth)
+SAMPLE_FN(sample_cns, get_uint16, cns)
+SAMPLE_FN(sample_rbt, sampletime, rbt)
+SAMPLE_FN(sample_sensor1, double_to_o2pressure, o2sensor[0]) // CCR O2 sensor data
+SAMPLE_FN(sample_sensor2, double_to_o2pressure, o2sensor[1])
+SAMPLE_FN(sample_sensor3, double_to_o2pressure, o2sensor[2]) // up to 3 CCR sensors
+SAMPLE_FN(sample_setpoint, double_to_o2pressure, setpoint)
+SAMPLE_FN(sample_heartbeat, get_uint8, heartbeat)
+SAMPLE_FN(sample_bearing, get_bearing, bearing)
+
+static void sample_in_deco(char *buf, struct sample *sample, struct parser_state *state)
+{
+	int in_deco;
+	get_index(buf, &in_deco);
+	sample->in_deco = (in_deco == 1);
+}
+
+static void sample_ppo2(char *buf, struct sample *sample, struct parser_state *state)
+{
+	double_to_o2pressure(buf, &sample->o2sensor[state->next_o2_sensor]);
+	state->next_o2_sensor++;
+}
+
+static void sample_deco(char *buf, struct sample *sample, struct parser_state *state)
+{
+	parse_libdc_deco(buf, sample);
+}
+
+static const struct sample_match {
+	const char *pattern;
+	sample_fn_t fn;
+} sample_matches[] = {
+	{ "pressure.sample", sample_pressure },
+	{ "cylpress.sample", sample_pressure },
+	{ "pdiluent.sample", sample_pressure },
+	{ "o2pressure.sample", sample_o2pressure },
+	{ "pressure0.sample", sample_pressure0 },
+	{ "pressure1.sample", sample_pressure1 },
+	{ "pressure2.sample", sample_pressure2 },
+	{ "pressure3.sample", sample_pressure3 },
+	{ "pressure4.sample", sample_pressure4 },
+	{ "cylinderindex.sample", sample_cylinderindex },
+	{ "sensor.sample", sample_sensor },
+	{ "depth.sample", sample_depth },
+	{ "temp.sample", sample_temperature },
+	{ "temperature.sample", sample_temperature },
+	{ "sampletime.sample", sample_time },
+	{ "time.sample", sample_time },
+	{ "ndl.sample", sample_ndl },
+	{ "tts.sample", sample_tts },
+	{ "in_deco.sample", sample_in_deco },
+	{ "stoptime.sample", sample_stoptime },
+	{ "stopdepth.sample", sample_stopdepth },
+	{ "cns.sample", sample_cns },
+	{ "rbt.sample", sample_rbt },
+	{ "sensor1.sample", sample_sensor1 },
+	{ "sensor2.sample", sample_sensor2 },
+	{ "sensor3.sample", sample_sensor3 },
+	{ "po2.sample", sample_setpoint },
+	{ "heartbeat", sample_heartbeat },
+	{ "bearing", sample_bearing },
+	{ "setpoint.sample", sample_setpoint },
+	{ "ppo2.sample", sample_ppo2 },
+	{ "deco.sample", sample_deco },
+	{ "time.deco", sample_stoptime },
+	{ "depth.deco", sample_stopdepth },
+};
+
+/* The index of the first entry of sample_matches that matches name or -1 */
+static int find_sample_match(const char *name)
+{
+	for (size_t i = 0; i < sizeof(sample_matches) / sizeof(sample_matches[0]); i++) {
+		if (match_name(sample_matches[i].pattern, name))
+			return (int)i;
+	}
+	return -1;
+}
+
 /* We're in samples - try to convert the random xml value to something useful */
 static void try_to_fill_sample(struct sample *sample, const char *name, char *buf, struct parser_state *state)
 {
-	int in_deco;
-	pressure_t p;
+	int idx;
 
 	start_match("sample", name, buf);
-	if (MATCH_STATE("pressure.sample", pressure, &sample->pressure[0]))
-		return;
-	if (MATCH_STATE("cylpress.sample", pressure, &sample->pressure[0]))
-		return;
-	if (MATCH_STATE("pdiluent.sample", pressure, &sample->pressure[0]))
-		return;
-	if (MATCH_STATE("o2pressure.sample", pressure, &sample->pressure[1]))
-		return;
-	/* Christ, this is ugly */
-	if (MATCH_STATE("pressure0.sample", pressure, &p)) {
-		add_sample_pressure(sample, 0, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure1.sample", pressure, &p)) {
-		add_sample_pressure(sample, 1, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure2.sample", pressure, &p)) {
-		add_sample_pressure(sample, 2, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure3.sample", pressure, &p)) {
-		add_sample_pressure(sample, 3, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure4.sample", pressure, &p)) {
-		add_sample_pressure(sample, 4, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("cylinderindex.sample", get_cylinderindex, &sample->sensor[0]))
-		return;
-	if (MATCH("sensor.sample", get_sensor, &sample->sensor[0]))
-		return;
-	if (MATCH_STATE("depth.sample", depth, &sample->depth))
-		return;
-	if (MATCH_STATE("temp.sample", temperature, &sample->temperature))
-		return;
-	if (MATCH_STATE("temperature.sample", temperature, &sample->temperature))
-		return;
-	if (MATCH("sampletime.sample", sampletime, &sample->time))
-		return;
-	if (MATCH("time.sample", sampletime, &sample->time))
-		return;
-	if (MATCH("ndl.sample", sampletime, &sample->ndl))
-		return;
-	if (MATCH("tts.sample", sampletime, &sample->tts))
-		return;
-	if (MATCH("in_deco.sample", get_index, &in_deco)) {
-		sample->in_deco = (in_deco == 1);
-		return;
-	}
-	if (MATCH("stoptime.sample", sampletime, &sample->stoptime))
-		return;
-	if (MATCH_STATE("stopdepth.sample", depth, &sample->stopdepth))
-		return;
-	if (MATCH("cns.sample", get_uint16, &sample->cns))
-		return;
-	if (MATCH("rbt.sample", sampletime, &sample->rbt))
-		return;
-	if (MATCH("sensor1.sample", double_to_o2pressure, &sample->o2sensor[0])) // CCR O2 sensor data
-		return;
-	if (MATCH("sensor2.sample", double_to_o2pressure, &sample->o2sensor[1]))
-		return;
-	if (MATCH("sensor3.sample", double_to_o2pressure, &sample->o2sensor[2])) // up to 3 CCR sensors
-		return;
-	if (MATCH("po2.sample", double_to_o2pressure, &sample->setpoint))
-		return;
-	if (MATCH("heartbeat", get_uint8, &sample->heartbeat))
-		return;
-	if (MATCH("bearing", get_bearing, &sample->bearing))
-		return;
-	if (MATCH("setpoint.sample", double_to_o2pressure, &sample->setpoint))
-		return;
-	if (MATCH("ppo2.sample", double_to_o2pressure, &sample->o2sensor[state->next_o2_sensor])) {
-		state->next_o2_sensor++;
+	idx = find_sample_match(name);
+	if (idx >= 0) {
+		sample_matches[idx].fn(buf, sample, state);
 		return;
 	}
-	if (MATCH("deco.sample", parse_libdc_deco, sample))
-		return;
-	if (MATCH("time.deco", sampletime, &sample->stoptime))
-		return;
-	if (MATCH_STATE("depth.deco", depth, &sample->stopdepth))
-		return;
 
 	switch (state->import_source) {
 	case DIVINGLOG:
@@ -983,9 +1025,8 @@ static int divinglog_dive_match(struct dive *dive, const char *name, char *buf,
 {
 	/* For cylinder related fields, we might have to create a cylinder first. */
 	cylinder_t cyl = empty_cylinder;
-	if (MATCH("tanktype", utf8_string, &cyl.type.description)) {
+	if (MATCH("tanktype", interned_string, &cyl.type.description)) {
 		cylinder_t *cyl0 = get_or_create_cylinder(dive, 0);
-		free((void *)cyl0->type.description);
 		cyl0->type.description = cyl.type.description;
 		return 1;
 	}
@@ -1145,7 +1186,8 @@ static void gps_lat(char *buffer, struct dive *dive, struct parser_state *state)
 	} else {
 		if (ds->location.lat.udeg && ds->location.lat.udeg != location.lat.udeg)
 			fprintf(stderr, "Oops, changing the latitude of existing dive site id %8x name %s; not good\n", ds->uuid, ds->name ?: "(unknown)");
-		ds->location.lat = location.lat;
+		location.lon = ds->location.lon;
+		set_dive_site_location(ds, &location);
 	}
 }
 
@@ -1161,7 +1203,8 @@ static void gps_long(char *buffer, struct dive *dive, struct parser_state *state
 	} else {
 		if (ds->location.lon.udeg && ds->location.lon.udeg != location.lon.udeg)
 			fprintf(stderr, "Oops, changing the longitude of existing dive site id %8x name %s; not good\n", ds->uuid, ds->name ?: "(unknown)");
-		ds->location.lon = location.lon;
+		location.lat = ds->location.lat;
+		set_dive_site_location(ds, &location);
 	}
 }
 
@@ -1176,7 +1219,9 @@ void parse_location(const char *buffer, location_t *loc)
 
 static void gps_location(char *buffer, struct dive_site *ds)
 {
-	parse_location(buffer, &ds->location);
+	location_t location;
+	parse_location(buffer, &location);
+	set_dive_site_location(ds, &location);
 }
 
 static void gps_in_dive(char *buffer, struct dive *dive, struct parser_state *state)
@@ -1208,7 +1253,7 @@ static void gps_in_dive(char *buffer, struct dive *dive, struct parser_state *st
 			ds->notes = add_to_string(ds->notes, translate("gettextFromC", "multiple GPS locations for this dive site; also %s\n"), coords);
 			free(coords);
 		} else {
-			ds->location = location;
+			set_dive_site_location(ds, &location);
 		}
 	}
 }
@@ -1346,7 +1391,7 @@ static void try_to_fill_dive(struct dive *dive, const char *name, char *buf, str
 			return;
 		if (MATCH_STATE("workpressure.cylinder", pressure, &cyl->type.workingpressure))
 			return;
-		if (MATCH("description.cylinder", utf8_string, &cyl->type.description))
+		if (MATCH("description.cylinder", interned_string, &cyl->type.description))
 			return;
 		if (MATCH_STATE("start.cylinder", pressure, &cyl->start))
 			return;
@@ -1526,6 +1571,14 @@ static bool entry(const char *name, char *buf, struct parser_state *state)
 	return true;
 }
 
+/* Whether entry() passes text on to try_to_fill_sample() */
+static bool entry_is_sample(const struct parser_state *state)
+{
+	return !state->in_userid && !state->in_settings && !state->cur_dive_site &&
+	       !state->in_filter_constraint && !state->in_fulltext && !state->cur_filter &&
+	       state->cur_event.deleted && state->cur_sample;
+}
+
 static const char *nodename(xmlNode *node, char *buf, int len)
 {
 	int levels = 2;
@@ -1692,6 +1745,336 @@ static bool traverse(xmlNode *root, struct parser_state *state)
 	return ret;
 }
 
+/*
+ * Streaming parser for files that don't need an XSLT transformation, i.e.
+ * our own format. Instead of building the whole document tree and walking
+ * it with traverse(), the nodes are read one after the other with an
+ * xmlTextReader, which only keeps the nodes of the current element in
+ * memory. The nesting rules and entry() are called in the same order
+ * and with the same names as by traverse().
+ *
+ * Element names are interned in the dictionary of the reader, so that the
+ * nesting rules can be found by pointer comparisons instead of strcmp().
+ * Likewise, the attributes of samples, which make up most of a log, are
+ * looked up in sample_matches only once per attribute name.
+ */
+#define NR_NESTING_RULES (sizeof(nesting) / sizeof(nesting[0]))
+
+struct stream_element {
+	const struct nesting *rule;
+	const char *name;	/* interned */
+};
+
+#define MAX_SAMPLE_ATTRS 64
+
+struct stream_sample_attr {
+	const xmlChar *name;	/* interned */
+	int match;		/* index into sample_matches or -1 */
+};
+
+struct stream_parser {
+	xmlTextReaderPtr reader;
+	const xmlChar *rule_names[NR_NESTING_RULES];	/* interned */
+	const struct nesting *sample_rule;
+	int nr_sample_attrs;
+	struct stream_sample_attr sample_attrs[MAX_SAMPLE_ATTRS];
+	int depth, allocated;
+	struct stream_element *stack;
+	bool seen_root;
+};
+
+enum stream_result {
+	STREAM_OK,
+	STREAM_GAVE_UP,		/* entry() decided to give up parsing */
+	STREAM_NEEDS_TREE,	/* the document must be transformed */
+	STREAM_ERROR
+};
+
+/* Same as xmlIsBlankNode() for text nodes */
+static bool is_blank_text(const xmlChar *text)
+{
+	if (!text)
+		return true;
+	for (; *text; text++) {
+		if (!IS_BLANK_CH(*text))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Equivalent of nodename() for the node "first", whose parent is "second"
+ * (if any). "third" says whether "second" has a parent element itself.
+ */
+static const char *stream_nodename(const char *first, const char *second, bool third, char *buf, int len)
+{
+	const char *names[2] = { first, second };
+	char *p = buf;
+
+	/* Make sure it's always NUL-terminated */
+	p[--len] = 0;
+
+	for (int level = 0; ; level++) {
+		const char *name = names[level];
+		char c;
+		while ((c = *name++) != 0) {
+			/* Cheaper 'tolower()' for ASCII */
+			c = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+			*p++ = c;
+			if (!--len)
+				return buf;
+		}
+		*p = 0;
+		if (level == 0 ? !second : !third)
+			return buf;
+		*p++ = '.';
+		if (!--len)
+			return buf;
+		if (level == 1) {
+			*p = 0;
+			return buf;
+		}
+	}
+}
+
+/* Call entry() for text, whose name is built from "first" and the open elements */
+static bool stream_entry(struct stream_parser *sp, const char *first, int parent, char *text, struct parser_state *state)
+{
+	char buffer[MAXNAME];
+	const char *second = parent >= 0 ? sp->stack[parent].name : NULL;
+	const char *name = stream_nodename(first, second, parent >= 1, buffer, sizeof(buffer));
+
+	return entry(name, text, state);
+}
+
+/*
+ * The sample_matches entry for an attribute of a sample, or -1 if
+ * it has to go through entry().
+ */
+static int stream_sample_match(struct stream_parser *sp, const xmlChar *attr)
+{
+	char buffer[MAXNAME];
+	int match;
+
+	for (int i = 0; i < sp->nr_sample_attrs; i++) {
+		if (sp->sample_attrs[i].name == attr)
+			return sp->sample_attrs[i].match;
+	}
+	/* Whether "sample" has a parent doesn't change the result of match_name() */
+	match = find_sample_match(stream_nodename((const char *)attr, "sample", false, buffer, sizeof(buffer)));
+	if (sp->nr_sample_attrs < MAX_SAMPLE_ATTRS) {
+		sp->sample_attrs[sp->nr_sample_attrs].name = attr;
+		sp->sample_attrs[sp->nr_sample_attrs].match = match;
+		sp->nr_sample_attrs++;
+	}
+	return match;
+}
+
+static bool stream_element_end(struct stream_parser *sp, struct parser_state *state)
+{
+	const struct nesting *rule;
+
+	if (sp->depth <= 0)
+		return false;
+	rule = sp->stack[--sp->depth].rule;
+	if (rule->end)
+		rule->end(state);
+	return true;
+}
+
+static bool stream_element_start(struct stream_parser *sp, struct parser_state *state)
+{
+	xmlTextReaderPtr reader = sp->reader;
+	const xmlChar *name = xmlTextReaderConstString(reader, xmlTextReaderConstLocalName(reader));
+	struct stream_element *element;
+	size_t i;
+
+	if (sp->depth >= sp->allocated) {
+		sp->allocated = (sp->allocated + 8) * 3 / 2;
+		sp->stack = realloc(sp->stack, sp->allocated * sizeof(*sp->stack));
+		if (!sp->stack)
+			exit(1);
+	}
+	element = &sp->stack[sp->depth++];
+	element->name = (const char *)name;
+	for (i = 0; i < NR_NESTING_RULES - 1; i++) {
+		if (sp->rule_names[i] == name)
+			break;
+	}
+	element->rule = &nesting[i];
+
+	if (element->rule->start)
+		element->rule->start(state);
+
+	while (xmlTextReaderMoveToNextAttribute(reader) == 1) {
+		const xmlChar *attr;
+		char *value;
+		bool ret;
+
+		if (xmlTextReaderIsNamespaceDecl(reader))
+			continue;
+		if (is_blank_text(xmlTextReaderConstValue(reader)))
+			continue;
+		attr = xmlTextReaderConstString(reader, xmlTextReaderConstLocalName(reader));
+		value = (char *)xmlTextReaderValue(reader);
+		if (element->rule == sp->sample_rule && entry_is_sample(state)) {
+			int match = stream_sample_match(sp, attr);
+			if (match >= 0) {
+				sample_matches[match].fn(value, state->cur_sample, state);
+				xmlFree(value);
+				continue;
+			}
+		}
+		ret = stream_entry(sp, (const char *)attr, sp->depth - 1, value, state);
+		xmlFree(value);
+		if (!ret)
+			return false;
+	}
+	xmlTextReaderMoveToElement(reader);
+
+	/* Empty elements don't get an end node */
+	if (xmlTextReaderIsEmptyElement(reader))
+		stream_element_end(sp, state);
+	return true;
+}
+
+static bool stream_text(struct stream_parser *sp, const char *first, bool check_blank, int parent, struct parser_state *state)
+{
+	char *value;
+	bool ret;
+
+	if (check_blank && is_blank_text(xmlTextReaderConstValue(sp->reader)))
+		return true;
+	value = (char *)xmlTextReaderValue(sp->reader);
+	ret = stream_entry(sp, first, parent, value ? value : "", state);
+	xmlFree(value);
+	return ret;
+}
+
+/* Returns false if parsing should be stopped */
+static bool stream_node(struct stream_parser *sp, struct parser_state *state)
+{
+	int type = xmlTextReaderNodeType(sp->reader);
+	int top = sp->depth - 1;
+
+	/* Like traverse(), ignore everything outside of the root element */
+	if (sp->depth == 0) {
+		if (type != XML_READER_TYPE_ELEMENT || sp->seen_root)
+			return true;
+		sp->seen_root = true;
+		return stream_element_start(sp, state);
+	}
+
+	switch (type) {
+	case XML_READER_TYPE_ELEMENT:
+		return stream_element_start(sp, state);
+	case XML_READER_TYPE_END_ELEMENT:
+		return stream_element_end(sp, state);
+	case XML_READER_TYPE_TEXT:
+	case XML_READER_TYPE_CDATA:
+		/* nodename() names text by the enclosing element */
+		return stream_text(sp, sp->stack[top].name, true, top - 1, state);
+	case XML_READER_TYPE_COMMENT:
+		return stream_text(sp, "comment", false, top, state);
+	case XML_READER_TYPE_PROCESSING_INSTRUCTION:
+		return stream_text(sp, (const char *)xmlTextReaderConstLocalName(sp->reader), false, top, state);
+	default:
+		/* Whitespace is blank */
+		return true;
+	}
+}
+
+static enum stream_result stream_xml(const char *buffer, const char *url, struct parser_state *state)
+{
+	struct stream_parser sp = { 0 };
+	enum stream_result res = STREAM_OK;
+	int ret;
+
+	sp.reader = xmlReaderForMemory(buffer, strlen(buffer), url, NULL, 0);
+	if (!sp.reader)
+		return STREAM_ERROR;
+	for (size_t i = 0; i < NR_NESTING_RULES - 1; i++) {
+		sp.rule_names[i] = xmlTextReaderConstString(sp.reader, (const xmlChar *)nesting[i].name);
+		if (!strcmp(nesting[i].name, "sample"))
+			sp.sample_rule = &nesting[i];
+	}
+
+	while ((ret = xmlTextReaderRead(sp.reader)) == 1) {
+		if (!sp.seen_root && xmlTextReaderNodeType(sp.reader) == XML_READER_TYPE_ELEMENT &&
+		    has_xslt_transform((const char *)xmlTextReaderConstLocalName(sp.reader))) {
+			res = STREAM_NEEDS_TREE;
+			break;
+		}
+		if (!stream_node(&sp, state)) {
+			res = STREAM_GAVE_UP;
+			break;
+		}
+	}
+	if (res == STREAM_OK && (ret < 0 || !sp.seen_root))
+		res = STREAM_ERROR;
+
+	free(sp.stack);
+	xmlFreeTextReader(sp.reader);
+	return res;
+}
+
+/*
+ * The streaming parser is only used when loading into empty tables, so
+ * that a file that turns out to be broken can be thrown away.
+ */
+static bool can_stream_xml(const struct parser_state *state, const struct xml_params *params)
+{
+	return !params && !xml_tree_parser && state->target_table->nr == 0 && state->trips->nr == 0 &&
+	       state->sites->nr == 0 && nr_devices(state->devices) == 0;
+}
+
+/*
+ * The global data that is registered while parsing. If the streaming
+ * parser fails, it is reset so that the document tree is parsed from
+ * the same state.
+ */
+struct xml_globals {
+	int nr_event_names;
+	struct tag_entry *tags;
+	int nr_tank_infos;
+	struct ws_info_t ws_info[MAX_WS_INFO];
+	bool autogroup;
+	int xml_version;
+};
+
+static void save_xml_globals(struct xml_globals *globals)
+{
+	globals->nr_event_names = evn_used;
+	globals->tags = taglist_save_global();
+	globals->nr_tank_infos = tank_info_table.nr;
+	memcpy(globals->ws_info, ws_info, sizeof(ws_info));
+	globals->autogroup = autogroup;
+	globals->xml_version = last_xml_version;
+}
+
+static void free_xml_globals(struct xml_globals *globals)
+{
+	taglist_free(globals->tags);
+	globals->tags = NULL;
+}
+
+/* The dives referencing the tags must be freed before the globals are restored */
+static void clear_streamed_xml(struct parser_state *state, struct xml_globals *globals)
+{
+	clear_dive_table(state->target_table);
+	clear_trip_table(state->trips);
+	clear_dive_site_table(state->sites);
+	clear_device_table(state->devices);
+
+	clear_events_from(globals->nr_event_names);
+	taglist_restore_global(globals->tags);
+	globals->tags = NULL;
+	truncate_tank_info_table(&tank_info_table, globals->nr_tank_infos);
+	restore_ws_info(globals->ws_info);
+	autogroup = globals->autogroup;
+	last_xml_version = globals->xml_version;
+}
+
 /* Per-file reset */
 static void reset_all(struct parser_state *state)
 {
@@ -1748,6 +2131,41 @@ int parse_xml_buffer(const char *url, const char *buffer, int size,
 	state.sites = sites;
 	state.devices = devices;
 	state.filter_presets = filter_presets;
+
+	if (can_stream_xml(&state, params)) {
+		enum stream_result stream_res;
+		struct xml_globals globals;
+
+		/* Filter presets are added at the end, after the file was found to be good */
+		state.defer_filter_presets = true;
+		save_xml_globals(&globals);
+		reset_all(&state);
+		dive_start(&state);
+		stream_res = stream_xml(res, url, &state);
+		if (stream_res == STREAM_OK || stream_res == STREAM_GAVE_UP) {
+			dive_end(&state);
+			add_pending_filter_presets(&state);
+			free_parser_state(&state);
+			free_xml_globals(&globals);
+			if (res != buffer)
+				free((char *)res);
+			return stream_res == STREAM_OK ? 0 : -1;
+		}
+
+		/* Start over with the document tree, which also reports the error */
+		free_parser_state(&state);
+		if (stream_res == STREAM_ERROR)
+			clear_streamed_xml(&state, &globals);
+		else
+			free_xml_globals(&globals);
+		init_parser_state(&state);
+		state.target_table = table;
+		state.trips = trips;
+		state.sites = sites;
+		state.devices = devices;
+		state.filter_presets = filter_presets;
+	}
+
 	doc = xmlReadMemory(res, strlen(res), url, NULL, 0);
 	if (!doc)
 		doc = xmlReadMemory(res, strlen(res), url, "latin1", 0);
@@ -1823,10 +2241,10 @@ int parse_dlf_buffer(unsigned char *buffer, size_t size, struct dive_table *tabl
 	dive_start(&state);
 	divecomputer_start(&state);
 
-	state.cur_dc->model = strdup("DLF import");
+	state.cur_dc->model = intern_string("DLF import");
 	// (ptr[7] << 8) + ptr[6] Is "Serial"
 	snprintf(serial, sizeof(serial), "%d", (ptr[7] << 8) + ptr[6]);
-	state.cur_dc->serial = strdup(serial);
+	state.cur_dc->serial = intern_string(serial);
 	state.cur_dc->when = parse_dlf_timestamp(ptr + 8);
 	state.cur_dive->when = state.cur_dc->when;
 
@@ -2324,6 +2742,20 @@ static struct xslt_files {
 	  { NULL, }
   };
 
+/*
+ * Used to decide whether the streaming parser can be used. A file with
+ * a transformable root element might still be in our own format (see the
+ * "subsurface" test in test_xslt_transforms()), but these are rare.
+ */
+static bool has_xslt_transform(const char *root_name)
+{
+	for (struct xslt_files *info = xslt_files; info->root; info++) {
+		if (strcasecmp(root_name, info->root) == 0)
+			return true;
+	}
+	return false;
+}
+
 static xmlDoc *test_xslt_transforms(xmlDoc *doc, const struct xml_params *params)
 {
 	struct xslt_files *info = xslt_files;
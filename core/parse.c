@@ -8,10 +8,12 @@
 #include <libdivecomputer/parser.h>
 
 #include "parse.h"
+#include "arena.h"
 #include "dive.h"
 #include "divesite.h"
 #include "errorhelper.h"
 #include "sample.h"
+#include "stringpool.h"
 #include "subsurface-string.h"
 #include "picture.h"
 #include "trip.h"
@@ -26,6 +28,7 @@ void init_parser_state(struct parser_state *state)
 	state->metric = true;
 	state->cur_event.deleted = 1;
 	state->sample_rate = 0;
+	state->arena = arena_new();
 }
 
 void free_parser_state(struct parser_state *state)
@@ -34,6 +37,9 @@ void free_parser_state(struct parser_state *state)
 	free_trip(state->cur_trip);
 	free_dive_site(state->cur_dive_site);
 	free_filter_preset(state->cur_filter);
+	for (int i = 0; i < state->nr_pending_filters; i++)
+		free_filter_preset(state->pending_filters[i]);
+	free(state->pending_filters);
 	free((void *)state->cur_extra_data.key);
 	free((void *)state->cur_extra_data.value);
 	free((void *)state->cur_settings.dc.model);
@@ -48,6 +54,9 @@ void free_parser_state(struct parser_state *state)
 	free(state->filter_constraint_string_mode);
 	free(state->filter_constraint_range_mode);
 	free(state->filter_constraint);
+	/* The dives that were loaded keep the arena alive. Changes move their data out of it. */
+	arena_seal(state->arena);
+	arena_unref(state->arena);
 }
 
 /*
@@ -241,11 +250,32 @@ void filter_preset_start(struct parser_state *state)
 
 void filter_preset_end(struct parser_state *state)
 {
+	if (state->defer_filter_presets) {
+		state->pending_filters = realloc(state->pending_filters,
+						 (state->nr_pending_filters + 1) * sizeof(*state->pending_filters));
+		if (!state->pending_filters)
+			exit(1);
+		state->pending_filters[state->nr_pending_filters++] = state->cur_filter;
+		state->cur_filter = NULL;
+		return;
+	}
 	add_filter_preset_to_table(state->cur_filter, state->filter_presets);
 	free_filter_preset(state->cur_filter);
 	state->cur_filter = NULL;
 }
 
+/* Add the filter presets that were collected with defer_filter_presets set */
+void add_pending_filter_presets(struct parser_state *state)
+{
+	for (int i = 0; i < state->nr_pending_filters; i++) {
+		add_filter_preset_to_table(state->pending_filters[i], state->filter_presets);
+		free_filter_preset(state->pending_filters[i]);
+	}
+	free(state->pending_filters);
+	state->pending_filters = NULL;
+	state->nr_pending_filters = 0;
+}
+
 void fulltext_start(struct parser_state *state)
 {
 	if (!state->cur_filter)
@@ -296,6 +326,7 @@ void dive_start(struct parser_state *state)
 	if (state->cur_dive)
 		return;
 	state->cur_dive = alloc_dive();
+	set_dc_arena(&state->cur_dive->dc, state->arena);
 	reset_dc_info(&state->cur_dive->dc, state);
 	memset(&state->cur_tm, 0, sizeof(state->cur_tm));
 	state->o2pressure_sensor = 1;
@@ -427,6 +458,7 @@ void divecomputer_start(struct parser_state *state)
 	}
 
 	/* .. this is the one we'll use */
+	set_dc_arena(dc, state->arena);
 	state->cur_dc = dc;
 	reset_dc_info(dc, state);
 }
@@ -463,6 +495,16 @@ void utf8_string(char *buffer, void *_res)
 		*res = strdup(buffer);
 }
 
+/* Like utf8_string(), but the result is an interned string, see stringpool.h */
+void interned_string(char *buffer, void *_res)
+{
+	const char **res = _res;
+	int size;
+	size = trimspace(buffer);
+	if(size)
+		*res = intern_string(buffer);
+}
+
 void add_dive_site(char *ds_name, struct dive *dive, struct parser_state *state)
 {
 	char *buffer = ds_name;
@@ -493,9 +535,9 @@ void add_dive_site(char *ds_name, struct dive *dive, struct parser_state *state)
 					add_dive_to_dive_site(dive, newds);
 					if (has_location(&state->cur_location)) {
 						// we started this uuid with GPS data, so lets use those
-						newds->location = state->cur_location;
+						set_dive_site_location(newds, &state->cur_location);
 					} else {
-						newds->location = ds->location;
+						set_dive_site_location(newds, &ds->location);
 					}
 					newds->notes = add_to_string(newds->notes, translate("gettextFromC", "additional name for site: %s\n"), ds->name);
 				}
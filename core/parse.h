@@ -59,6 +59,9 @@ struct parser_state {
 	struct sample *cur_sample;		/* non-owning */
 	struct picture cur_picture;		/* owning */
 	struct filter_preset *cur_filter;	/* owning */
+	bool defer_filter_presets;		/* collect in pending_filters, see filter_preset_end() */
+	int nr_pending_filters;
+	struct filter_preset **pending_filters;	/* owning */
 	char *fulltext;				/* owning */
 	char *fulltext_string_mode;		/* owning */
 	char *filter_constraint_type;		/* owning */
@@ -85,6 +88,7 @@ struct parser_state {
 	struct device_table *devices;			/* non-owning */
 	struct filter_preset_table *filter_presets;	/* non-owning */
 
+	struct arena *arena;			/* owning: samples and extra data of the loaded dives */
 	sqlite3 *sql_handle;			/* for SQL based parsers */
 	event_allocation_t event_allocation;
 };
@@ -121,6 +125,7 @@ void dive_start(struct parser_state *state);
 void dive_end(struct parser_state *state);
 void filter_preset_start(struct parser_state *state);
 void filter_preset_end(struct parser_state *state);
+void add_pending_filter_presets(struct parser_state *state);
 void filter_constraint_start(struct parser_state *state);
 void filter_constraint_end(struct parser_state *state);
 void fulltext_start(struct parser_state *state);
@@ -141,10 +146,13 @@ void divecomputer_end(struct parser_state *state);
 void userid_start(struct parser_state *state);
 void userid_stop(struct parser_state *state);
 void utf8_string(char *buffer, void *_res);
+void interned_string(char *buffer, void *_res);
 
 void add_dive_site(char *ds_name, struct dive *dive, struct parser_state *state);
 int atoi_n(char *ptr, unsigned int len);
 
+extern bool xml_tree_parser; // parse our own files with the document tree instead of streaming, for testing
+
 void parse_xml_init(void);
 int parse_xml_buffer(const char *url, const char *buf, int size, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites,
 		     struct device_table *devices, struct filter_preset_table *filter_presets, const struct xml_params *params);
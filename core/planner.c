@@ -17,6 +17,7 @@
 #include "deco.h"
 #include "errorhelper.h"
 #include "event.h"
+#include "eventindex.h"
 #include "interpolate.h"
 #include "planner.h"
 #include "subsurface-time.h"
@@ -82,14 +83,8 @@ bool diveplan_empty(struct diveplan *diveplan)
 int get_cylinderid_at_time(struct dive *dive, struct divecomputer *dc, duration_t time)
 {
 	// we start with the first cylinder unless an event tells us otherwise
-	int cylinder_idx = 0;
-	struct event *event = dc->events;
-	while (event && event->time.seconds <= time.seconds) {
-		if (!strcmp(event->name, "gaschange"))
-			cylinder_idx = get_cylinder_index(dive, event);
-		event = event->next;
-	}
-	return cylinder_idx;
+	const struct event *event = get_last_dc_event_at(dc, EVENT_ID_GASCHANGE, time.seconds);
+	return event ? get_cylinder_index(dive, event) : 0;
 }
 
 int get_gasidx(struct dive *dive, struct gasmix mix)
@@ -125,7 +120,7 @@ static int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_s
 	if (*cached_datap) {
 		restore_deco_state(*cached_datap, ds, true);
 	} else {
-		surface_interval = init_decompression(ds, dive);
+		surface_interval = init_decompression(ds, dive, &ds->config);
 		cache_deco_state(ds, cached_datap);
 	}
 	dc = &dive->dc;
@@ -158,7 +153,7 @@ static int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_s
 		 * portion of the dive.
 		 * Remember the value for later.
 		 */
-		if ((decoMode() == VPMB) && (lastdepth.mm > sample->depth.mm)) {
+		if ((ds->config.deco_mode == VPMB) && (lastdepth.mm > sample->depth.mm)) {
 			pressure_t ceiling_pressure;
 			nuclear_regeneration(ds, t0.seconds);
 			vpmb_start_gradient(ds);
@@ -239,6 +234,7 @@ static void create_dive_from_plan(struct diveplan *diveplan, struct dive *dive,
 		dc->events = dc->events->next;
 		free(ev);
 	}
+	invalidate_event_index(dc);
 	dp = diveplan->dp;
 	/* Create first sample at time = 0, not based on dp because
 	 * there is no real dp for time = 0, set first cylinder to 0
@@ -534,7 +530,7 @@ static bool trial_ascent(struct deco_state *ds, int wait_time, int trial_depth,
 		add_segment(ds, depth_to_bar(trial_depth, dive),
 			    gasmix,
 			    wait_time, po2, divemode, prefs.decosac);
-	if (decoMode() == VPMB) {
+	if (ds->config.deco_mode == VPMB) {
 		double tolerance_limit = tissue_tolerance_calc(ds, dive, depth_to_bar(stoplevel, dive));
 		update_regression(ds, dive);
 		if (deco_allowed_depth(tolerance_limit, surface_pressure, dive, 1) > stoplevel) {
@@ -553,7 +549,7 @@ static bool trial_ascent(struct deco_state *ds, int wait_time, int trial_depth,
 			    gasmix,
 			    TIMESTEP, po2, divemode, prefs.decosac);
 		tolerance_limit = tissue_tolerance_calc(ds, dive, depth_to_bar(trial_depth, dive));
-		if (decoMode() == VPMB)
+		if (ds->config.deco_mode == VPMB)
 			update_regression(ds, dive);
 		if (deco_allowed_depth(tolerance_limit, surface_pressure, dive, 1) > trial_depth - deltad) {
 			/* We should have stopped */
@@ -634,7 +630,7 @@ static void average_max_depth(struct diveplan *dive, int *avg_depth, int *max_de
 		*avg_depth = *max_depth = 0;
 }
 
-bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, int timestep, struct decostop *decostoptable, struct deco_state **cached_datap, bool is_planner, bool show_disclaimer)
+bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, const struct deco_config *config, int timestep, struct decostop *decostoptable, struct deco_state **cached_datap, bool is_planner, bool show_disclaimer)
 {
 
 	int bottom_depth;
@@ -672,13 +668,14 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	bool o2breaking = false;
 	int decostopcounter = 0;
 	enum divemode_t divemode = dive->dc.divemode;
+	struct deco_config deco_config = *config;
 
-	set_gf(diveplan->gflow, diveplan->gfhigh);
-	set_vpmb_conservatism(diveplan->vpmb_conservatism);
+	set_deco_config_gf(&deco_config, diveplan->gflow, diveplan->gfhigh);
+	set_deco_config_vpmb_conservatism(&deco_config, diveplan->vpmb_conservatism);
 	if (!diveplan->surface_pressure)
 		diveplan->surface_pressure = SURFACE_PRESSURE;
 	dive->surface_pressure.mbar = diveplan->surface_pressure;
-	clear_deco(ds, dive->surface_pressure.mbar / 1000.0);
+	clear_deco(ds, dive->surface_pressure.mbar / 1000.0, &deco_config);
 	ds->max_bottom_ceiling_pressure.mbar = ds->first_ceiling_pressure.mbar = 0;
 	create_dive_from_plan(diveplan, dive, is_planner);
 
@@ -707,9 +704,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 
 	current_cylinder = get_cylinderid_at_time(dive, &dive->dc, sample->time);
 	// Find the divemode at the end of the dive
-	const struct event *ev = NULL;
-	divemode = UNDEF_COMP_TYPE;
-	divemode = get_current_divemode(&dive->dc, bottom_time, &ev, &divemode);
+	divemode = get_divemode_at_time(&dive->dc, bottom_time);
 	gas = get_cylinder(dive, current_cylinder)->gasmix;
 
 	po2 = sample->setpoint.mbar;
@@ -759,7 +754,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	diveplan->surface_interval = tissue_at_end(ds, dive, cached_datap);
 	nuclear_regeneration(ds, clock);
 	vpmb_start_gradient(ds);
-	if (decoMode() == RECREATIONAL) {
+	if (ds->config.deco_mode == RECREATIONAL) {
 		bool safety_stop = prefs.safetystop && max_depth >= 10000;
 		track_ascent_gas(depth, dive, current_cylinder, avg_depth, bottom_time, safety_stop, divemode);
 		// How long can we stay at the current depth and still directly ascent to the surface?
@@ -805,7 +800,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 		} while (depth > 0);
 		plan_add_segment(diveplan, clock - previous_point_time, 0, current_cylinder, po2, false, divemode);
 		create_dive_from_plan(diveplan, dive, is_planner);
-		add_plan_to_notes(diveplan, dive, show_disclaimer, error);
+		add_plan_to_notes(diveplan, dive, ds->config.deco_mode, show_disclaimer, error);
 		fixup_dc_duration(&dive->dc);
 
 		free(stoplevels);
@@ -847,7 +842,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	//CVA
 	do {
 		decostopcounter = 0;
-		is_final_plan = (decoMode() == BUEHLMANN) || (previous_deco_time - ds->deco_time < 10);  // CVA time converges
+		is_final_plan = (ds->config.deco_mode == BUEHLMANN) || (previous_deco_time - ds->deco_time < 10);  // CVA time converges
 		if (ds->deco_time != 10000000)
 			vpmb_next_gradient(ds, ds->deco_time, diveplan->surface_pressure / 1000.0);
 
@@ -1074,7 +1069,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	decostoptable[decostopcounter].depth = 0;
 
 	plan_add_segment(diveplan, clock - previous_point_time, 0, current_cylinder, po2, false, divemode);
-	if (decoMode() == VPMB) {
+	if (ds->config.deco_mode == VPMB) {
 		diveplan->eff_gfhigh = lrint(100.0 * regressionb(ds));
 		diveplan->eff_gflow = lrint(100.0 * (regressiona(ds) * first_stop_depth + regressionb(ds)));
 	}
@@ -1089,7 +1084,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 		plan_add_segment(diveplan, prefs.surface_segment, 0, current_cylinder, 0, false, OC);
 	}
 	create_dive_from_plan(diveplan, dive, is_planner);
-	add_plan_to_notes(diveplan, dive, show_disclaimer, error);
+	add_plan_to_notes(diveplan, dive, ds->config.deco_mode, show_disclaimer, error);
 	fixup_dc_duration(&dive->dc);
 
 	free(stoplevels);
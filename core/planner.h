@@ -7,6 +7,7 @@
 
 #include "units.h"
 #include "divemode.h"
+#include "pref.h"
 
 #define DECOTIMESTEP 60 /* seconds. Unit of deco stop times */
 
@@ -51,9 +52,9 @@ extern void set_display_transitions(bool display);
 extern int get_cylinderid_at_time(struct dive *dive, struct divecomputer *dc, duration_t time);
 extern int get_gasidx(struct dive *dive, struct gasmix mix);
 extern bool diveplan_empty(struct diveplan *diveplan);
-extern void add_plan_to_notes(struct diveplan *diveplan, struct dive *dive, bool show_disclaimer, int error);
+extern void add_plan_to_notes(struct diveplan *diveplan, struct dive *dive, enum deco_mode deco_mode, bool show_disclaimer, int error);
 extern const char *get_planner_disclaimer();
-extern char *get_planner_disclaimer_formatted();
+extern char *get_planner_disclaimer_formatted(enum deco_mode deco_mode);
 
 extern void free_dps(struct diveplan *diveplan);
 extern struct dive *planned_dive;
@@ -68,7 +69,7 @@ struct decostop {
 	int depth;
 	int time;
 };
-extern bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, int timestep, struct decostop *decostoptable, struct deco_state **cached_datap, bool is_planner, bool show_disclaimer);
+extern bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, const struct deco_config *config, int timestep, struct decostop *decostoptable, struct deco_state **cached_datap, bool is_planner, bool show_disclaimer);
 
 #ifdef __cplusplus
 }
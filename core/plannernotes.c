@@ -83,16 +83,16 @@ const char *get_planner_disclaimer()
 }
 
 /* Returns newly allocated buffer. Must be freed by caller */
-char *get_planner_disclaimer_formatted()
+char *get_planner_disclaimer_formatted(enum deco_mode deco_mode)
 {
 	struct membuffer buf = { 0 };
-	const char *deco = decoMode() == VPMB ? translate("gettextFromC", "VPM-B")
+	const char *deco = deco_mode == VPMB ? translate("gettextFromC", "VPM-B")
 					      : translate("gettextFromC", "BUHLMANN");
 	put_format(&buf, get_planner_disclaimer(), deco);
 	return detach_cstring(&buf);
 }
 
-void add_plan_to_notes(struct diveplan *diveplan, struct dive *dive, bool show_disclaimer, int error)
+void add_plan_to_notes(struct diveplan *diveplan, struct dive *dive, enum deco_mode deco_mode, bool show_disclaimer, int error)
 {
 	struct membuffer buf = { 0 };
 	struct membuffer icdbuf = { 0 };
@@ -127,7 +127,7 @@ void add_plan_to_notes(struct diveplan *diveplan, struct dive *dive, bool show_d
 	}
 
 	if (show_disclaimer) {
-		char *disclaimer = get_planner_disclaimer_formatted();
+		char *disclaimer = get_planner_disclaimer_formatted(deco_mode);
 		put_string(&buf, "<div><b>");
 		put_string(&buf, disclaimer);
 		put_string(&buf, "</b><br/>\n</div>\n");
@@ -162,7 +162,7 @@ void add_plan_to_notes(struct diveplan *diveplan, struct dive *dive, bool show_d
 	}
 	put_string(&buf, "<br/>\n");
 
-	if (prefs.display_variations && decoMode() != RECREATIONAL)
+	if (prefs.display_variations && deco_mode != RECREATIONAL)
 		put_format_loc(&buf, translate("gettextFromC", "Runtime: %dmin%s"),
 			diveplan_duration(diveplan), "VARIATIONS");
 	else
@@ -420,16 +420,16 @@ void add_plan_to_notes(struct diveplan *diveplan, struct dive *dive, bool show_d
 
 	/* Print the settings for the diveplan next. */
 	put_string(&buf, "<div>\n");
-	if (decoMode() == BUEHLMANN) {
+	if (deco_mode == BUEHLMANN) {
 		put_format_loc(&buf, translate("gettextFromC", "Deco model: Bühlmann ZHL-16C with GFLow = %d%% and GFHigh = %d%%"), diveplan->gflow, diveplan->gfhigh);
-	} else if (decoMode() == VPMB){
+	} else if (deco_mode == VPMB){
 		if (diveplan->vpmb_conservatism == 0)
 			put_string(&buf, translate("gettextFromC", "Deco model: VPM-B at nominal conservatism"));
 		else
 			put_format_loc(&buf, translate("gettextFromC", "Deco model: VPM-B at +%d conservatism"), diveplan->vpmb_conservatism);
 		if (diveplan->eff_gflow)
 			put_format_loc(&buf,  translate("gettextFromC", ", effective GF=%d/%d"), diveplan->eff_gflow, diveplan->eff_gfhigh);
-	} else if (decoMode() == RECREATIONAL){
+	} else if (deco_mode == RECREATIONAL){
 		put_format_loc(&buf, translate("gettextFromC", "Deco model: Recreational mode based on Bühlmann ZHL-16B with GFLow = %d%% and GFHigh = %d%%"),
 			     diveplan->gflow, diveplan->gfhigh);
 	}
@@ -496,7 +496,7 @@ void add_plan_to_notes(struct diveplan *diveplan, struct dive *dive, bool show_d
 			/* not for recreational mode and if no other warning was set before. */
 			else
 				if (lastbottomdp && gasidx == lastbottomdp->cylinderid
-					&& dive->dc.divemode == OC && decoMode() != RECREATIONAL) {
+					&& dive->dc.divemode == OC && deco_mode != RECREATIONAL) {
 					/* Calculate minimum gas volume. */
 					volume_t mingasv;
 					mingasv.mliter = lrint(prefs.sacfactor / 100.0 * prefs.problemsolvingtime * prefs.bottomsac
@@ -12,6 +12,7 @@
 #include "display.h"
 #include "divelist.h"
 #include "event.h"
+#include "eventindex.h"
 #include "interpolate.h"
 #include "sample.h"
 #include "subsurface-string.h"
@@ -308,17 +309,6 @@ const struct event *get_next_event(const struct event *event, const char *name)
 	return get_next_event_mutable((struct event *)event, name);
 }
 
-static int count_events(const struct divecomputer *dc)
-{
-	int result = 0;
-	struct event *ev = dc->events;
-	while (ev != NULL) {
-		result++;
-		ev = ev->next;
-	}
-	return result;
-}
-
 static int set_setpoint(struct plot_info *pi, int i, int setpoint, int end)
 {
 	while (i < pi->nr) {
@@ -334,19 +324,18 @@ static int set_setpoint(struct plot_info *pi, int i, int setpoint, int end)
 static void check_setpoint_events(const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi)
 {
 	UNUSED(dive);
-	int i = 0;
+	int i = 0, j, nr;
 	pressure_t setpoint;
 	setpoint.mbar = 0;
-	const struct event *ev = get_next_event(dc->events, "SP change");
+	const struct event *const *ev = get_dc_events_by_id(dc, EVENT_ID_SP_CHANGE, &nr);
 
-	if (!ev)
+	if (!nr)
 		return;
 
-	do {
-		i = set_setpoint(pi, i, setpoint.mbar, ev->time.seconds);
-		setpoint.mbar = ev->value;
-		ev = get_next_event(ev->next, "SP change");
-	} while (ev);
+	for (j = 0; j < nr; j++) {
+		i = set_setpoint(pi, i, setpoint.mbar, ev[j]->time.seconds);
+		setpoint.mbar = ev[j]->value;
+	}
 	set_setpoint(pi, i, setpoint.mbar, INT_MAX);
 }
 
@@ -468,8 +457,33 @@ void free_plot_info_data(struct plot_info *pi)
 {
 	free(pi->entry);
 	free(pi->pressures);
+	free(pi->tissues);
+	free(pi->gas_depths);
 	pi->entry = NULL;
 	pi->pressures = NULL;
+	pi->tissues = NULL;
+	pi->gas_depths = NULL;
+}
+
+static void *copy_plot_array(const void *src, size_t nr, size_t size)
+{
+	void *res;
+	if (!src || !nr)
+		return NULL;
+	res = malloc(nr * size);
+	memcpy(res, src, nr * size);
+	return res;
+}
+
+/* Make a deep copy of a plot info. The old data of dst is freed. */
+void copy_plot_info(struct plot_info *dst, const struct plot_info *src)
+{
+	free_plot_info_data(dst);
+	*dst = *src;
+	dst->entry = copy_plot_array(src->entry, src->nr, sizeof(struct plot_data));
+	dst->pressures = copy_plot_array(src->pressures, (size_t)src->nr * src->nr_cylinders, sizeof(struct plot_pressure_data));
+	dst->tissues = copy_plot_array(src->tissues, src->nr, sizeof(struct plot_tissue_data));
+	dst->gas_depths = copy_plot_array(src->gas_depths, src->nr, sizeof(struct plot_gas_depth_data));
 }
 
 static void populate_plot_entries(const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi)
@@ -490,11 +504,15 @@ static void populate_plot_entries(const struct dive *dive, const struct divecomp
 	 * that has time > maxtime (because there can be surface samples
 	 * past "maxtime" in the original sample data)
 	 */
-	nr = dc->samples + 6 + maxtime / 10 + count_events(dc);
+	nr = dc->samples + 6 + maxtime / 10 + count_dc_events(dc);
 	plot_data = calloc(nr, sizeof(struct plot_data));
 	pi->entry = plot_data;
 	pi->nr_cylinders = dive->cylinders.nr;
 	pi->pressures = calloc(nr * (size_t)pi->nr_cylinders, sizeof(struct plot_pressure_data));
+	if (pi->channels & PLOT_CHANNEL_TISSUES)
+		pi->tissues = calloc(nr, sizeof(struct plot_tissue_data));
+	if (pi->channels & PLOT_CHANNEL_GAS_DEPTHS)
+		pi->gas_depths = calloc(nr, sizeof(struct plot_gas_depth_data));
 	if (!plot_data)
 		return;
 	pi->nr = nr;
@@ -1004,9 +1022,8 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 		ds->first_ceiling_pressure = planner_ds->first_ceiling_pressure;
 	}
 	struct deco_state *cache_data_initial = NULL;
-	lock_planner();
 	/* For VPM-B outside the planner, cache the initial deco state for CVA iterations */
-	if (decoMode() == VPMB) {
+	if (ds->config.deco_mode == VPMB) {
 		cache_deco_state(ds, &cache_data_initial);
 	}
 	/* For VPM-B outside the planner, iterate until deco time converges (usually one or two iterations after the initial)
@@ -1014,7 +1031,7 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 
 	while ((abs(prev_deco_time - ds->deco_time) >= 30) && (count_iteration < 10)) {
 		int last_ndl_tts_calc_time = 0, first_ceiling = 0, current_ceiling, last_ceiling = 0, final_tts = 0 , time_clear_ceiling = 0;
-		if (decoMode() == VPMB)
+		if (ds->config.deco_mode == VPMB)
 			ds->first_ceiling_pressure.mbar = depth_to_mbar(first_ceiling, dive);
 		struct gasmix gasmix = gasmix_invalid;
 		const struct event *ev = NULL, *evd = NULL;
@@ -1049,7 +1066,7 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 				entry->ceiling = (entry - 1)->ceiling;
 			} else {
 				/* Keep updating the VPM-B gradients until the start of the ascent phase of the dive. */
-				if (decoMode() == VPMB && last_ceiling >= first_ceiling && first_iteration == true) {
+				if (ds->config.deco_mode == VPMB && last_ceiling >= first_ceiling && first_iteration == true) {
 					nuclear_regeneration(ds, t1);
 					vpmb_start_gradient(ds);
 					/* For CVA iterations, calculate next gradient */
@@ -1063,7 +1080,7 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 					current_ceiling = entry->ceiling;
 				last_ceiling = current_ceiling;
 				/* If using VPM-B, take first_ceiling_pressure as the deepest ceiling */
-				if (decoMode() == VPMB) {
+				if (ds->config.deco_mode == VPMB) {
 					if  (current_ceiling >= first_ceiling ||
 					     (time_deep_ceiling == t0 && entry->depth == (entry - 1)->depth)) {
 						time_deep_ceiling = t1;
@@ -1089,16 +1106,20 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 			}
 			entry->surface_gf = 0.0;
 			entry->current_gf = 0.0;
+			struct plot_tissue_data *tissues = pi->tissues ? pi->tissues + i : NULL;
 			for (j = 0; j < 16; j++) {
 				double m_value = ds->buehlmann_inertgas_a[j] + entry->ambpressure / ds->buehlmann_inertgas_b[j];
 				double surface_m_value = ds->buehlmann_inertgas_a[j] + surface_pressure / ds->buehlmann_inertgas_b[j];
-				entry->ceilings[j] = deco_allowed_depth(ds->tolerated_by_tissue[j], surface_pressure, dive, 1);
-				if (entry->ceilings[j] > max_ceiling)
-					max_ceiling = entry->ceilings[j];
+				int ceiling = deco_allowed_depth(ds->tolerated_by_tissue[j], surface_pressure, dive, 1);
+				if (ceiling > max_ceiling)
+					max_ceiling = ceiling;
 				double current_gf = (ds->tissue_inertgas_saturation[j] - entry->ambpressure) / (m_value - entry->ambpressure);
-				entry->percentages[j] = ds->tissue_inertgas_saturation[j] < entry->ambpressure ?
-					lrint(ds->tissue_inertgas_saturation[j] / entry->ambpressure * AMB_PERCENTAGE) :
-					lrint(AMB_PERCENTAGE + current_gf * (100.0 - AMB_PERCENTAGE));
+				if (tissues) {
+					tissues->ceilings[j] = ceiling;
+					tissues->percentages[j] = ds->tissue_inertgas_saturation[j] < entry->ambpressure ?
+						lrint(ds->tissue_inertgas_saturation[j] / entry->ambpressure * AMB_PERCENTAGE) :
+						lrint(AMB_PERCENTAGE + current_gf * (100.0 - AMB_PERCENTAGE));
+				}
 				if (current_gf > entry->current_gf)
 					entry->current_gf = current_gf;
 				double surface_gf = 100.0 * (ds->tissue_inertgas_saturation[j] - surface_pressure) / (surface_m_value - surface_pressure);
@@ -1124,8 +1145,8 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 			* We don't for print-mode because this info doesn't show up there
 			* If the ceiling hasn't cleared by the last data point, we need tts for VPM-B CVA calculation
 			* It is not necessary to do these calculation on the first VPMB iteration, except for the last data point */
-			if ((prefs.calcndltts && !print_mode && (decoMode() != VPMB || !planner_ds || !first_iteration)) ||
-			    (decoMode() == VPMB && !planner_ds && i == pi->nr - 1)) {
+			if ((prefs.calcndltts && !print_mode && (ds->config.deco_mode != VPMB || !planner_ds || !first_iteration)) ||
+			    (ds->config.deco_mode == VPMB && !planner_ds && i == pi->nr - 1)) {
 				/* only calculate ndl/tts on every 30 seconds */
 				if ((entry->sec - last_ndl_tts_calc_time) < 30 && i != pi->nr - 1) {
 					struct plot_data *prev_entry = (entry - 1);
@@ -1141,14 +1162,14 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 				struct deco_state *cache_data = NULL;
 				cache_deco_state(ds, &cache_data);
 				calculate_ndl_tts(ds, dive, entry, gasmix, surface_pressure, current_divemode);
-				if (decoMode() == VPMB && !planner_ds && i == pi->nr - 1)
+				if (ds->config.deco_mode == VPMB && !planner_ds && i == pi->nr - 1)
 					final_tts = entry->tts_calc;
 				/* Restore "real" deco state for next real time step */
-				restore_deco_state(cache_data, ds, decoMode() == VPMB);
+				restore_deco_state(cache_data, ds, ds->config.deco_mode == VPMB);
 				free(cache_data);
 			}
 		}
-		if (decoMode() == VPMB && !planner_ds) {
+		if (ds->config.deco_mode == VPMB && !planner_ds) {
 			int this_deco_time;
 			prev_deco_time = ds->deco_time;
 			// Do we need to update deco_time?
@@ -1179,7 +1200,6 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 #if DECO_CALC_DEBUG & 1
 	dump_tissues(ds);
 #endif
-	unlock_planner();
 }
 
 
@@ -1249,28 +1269,32 @@ static void calculate_gas_information_new(const struct dive *dive, const struct
 			entry->scr_OC_pO2.mbar = (int) depth_to_mbar(entry->depth, dive) * get_o2(gasmix2) / 1000;
 		}
 
+		entry->density = gas_density(gasmix, depth_to_mbar(entry->depth, dive));
+		if (!pi->gas_depths)
+			continue;
+
 		/* Calculate MOD, EAD, END and EADD based on partial pressures calculated before
 		 * so there is no difference in calculating between OC and CC
 		 * END takes O₂ + N₂ (air) into account ("Narcotic" for trimix dives)
 		 * EAD just uses N₂ ("Air" for nitrox dives) */
+		struct plot_gas_depth_data *gas_depths = pi->gas_depths + i;
 		pressure_t modpO2 = { .mbar = (int)(prefs.modpO2 * 1000) };
-		entry->mod = (double)gas_mod(gasmix, modpO2, dive, 1).mm;
-		entry->end = (entry->depth + 10000) * (1000 - fhe) / 1000.0 - 10000;
-		entry->ead = (entry->depth + 10000) * fn2 / (double)N2_IN_AIR - 10000;
-		entry->eadd = (entry->depth + 10000) *
+		gas_depths->mod = (double)gas_mod(gasmix, modpO2, dive, 1).mm;
+		gas_depths->end = (entry->depth + 10000) * (1000 - fhe) / 1000.0 - 10000;
+		gas_depths->ead = (entry->depth + 10000) * fn2 / (double)N2_IN_AIR - 10000;
+		gas_depths->eadd = (entry->depth + 10000) *
 				      (entry->pressures.o2 / amb_pressure * O2_DENSITY +
 				       entry->pressures.n2 / amb_pressure * N2_DENSITY +
 				       entry->pressures.he / amb_pressure * HE_DENSITY) /
 				      (O2_IN_AIR * O2_DENSITY + N2_IN_AIR * N2_DENSITY) * 1000 - 10000;
-		entry->density = gas_density(gasmix, depth_to_mbar(entry->depth, dive));
-		if (entry->mod < 0)
-			entry->mod = 0;
-		if (entry->ead < 0)
-			entry->ead = 0;
-		if (entry->end < 0)
-			entry->end = 0;
-		if (entry->eadd < 0)
-			entry->eadd = 0;
+		if (gas_depths->mod < 0)
+			gas_depths->mod = 0;
+		if (gas_depths->ead < 0)
+			gas_depths->ead = 0;
+		if (gas_depths->end < 0)
+			gas_depths->end = 0;
+		if (gas_depths->eadd < 0)
+			gas_depths->eadd = 0;
 	}
 }
 
@@ -1354,12 +1378,34 @@ void init_plot_info(struct plot_info *pi)
  * info must be initialized with init_plot_info().
  */
 void create_plot_info_new(const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, bool fast, const struct deco_state *planner_ds)
+{
+	struct deco_config deco_config;
+
+	/* A planned dive is shown with the settings of the planner */
+	if (planner_ds)
+		deco_config = planner_ds->config;
+	else
+		init_deco_config(&deco_config, in_planner());
+	expand_dive_samples(dive);
+	create_plot_info_config(dive, dc, pi, fast, planner_ds, &deco_config, PLOT_CHANNELS_ALL);
+}
+
+/* Same as create_plot_info_new(), but with explicit deco settings. Does not
+ * access the global application state and can therefore be used from worker
+ * threads, as long as the dive table is not modified concurrently.
+ * The samples of the dive must have been expanded, see expand_dive_samples().
+ * Only the optional channels given by the plot_channel flags are calculated. */
+void create_plot_info_config(const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, bool fast,
+			     const struct deco_state *planner_ds, const struct deco_config *deco_config, unsigned int channels)
 {
 	int o2, he, o2max;
 	struct deco_state plot_deco_state;
-	init_decompression(&plot_deco_state, dive);
+
+	init_decompression(&plot_deco_state, dive, deco_config);
 	free_plot_info_data(pi);
 	calculate_max_limits_new(dive, dc, pi, planner_ds != NULL);
+	pi->deco_mode = deco_config->deco_mode;
+	pi->channels = channels;
 	get_dive_gas(dive, &o2, &he, &o2max);
 	if (dc->divemode == FREEDIVE){
 		pi->dive_type = FREEDIVE;
@@ -1415,6 +1461,8 @@ static void plot_string(const struct dive *d, const struct plot_info *pi, int id
 	int decimals, cyl;
 	const char *unit;
 	const struct plot_data *entry = pi->entry + idx;
+	const struct plot_gas_depth_data *gas_depths = get_plot_gas_depths(pi, idx);
+	const struct plot_tissue_data *tissues = get_plot_tissues(pi, idx);
 
 	depthvalue = get_depth_units(entry->depth, NULL, &depth_unit);
 	put_format_loc(b, translate("gettextFromC", "@: %d:%02d\nD: %.1f%s\n"), FRACTION(entry->sec, 60), depthvalue, depth_unit);
@@ -1449,23 +1497,23 @@ static void plot_string(const struct dive *d, const struct plot_info *pi, int id
 		put_format_loc(b, translate("gettextFromC", "pN₂: %.2fbar\n"), entry->pressures.n2);
 	if (prefs.pp_graphs.phe && entry->pressures.he > 0)
 		put_format_loc(b, translate("gettextFromC", "pHe: %.2fbar\n"), entry->pressures.he);
-	if (prefs.mod && entry->mod > 0) {
-		mod = lrint(get_depth_units(lrint(entry->mod), NULL, &depth_unit));
+	if (prefs.mod && gas_depths && gas_depths->mod > 0) {
+		mod = lrint(get_depth_units(lrint(gas_depths->mod), NULL, &depth_unit));
 		put_format_loc(b, translate("gettextFromC", "MOD: %d%s\n"), mod, depth_unit);
 	}
-	eadd = lrint(get_depth_units(lrint(entry->eadd), NULL, &depth_unit));
+	eadd = gas_depths ? lrint(get_depth_units(lrint(gas_depths->eadd), NULL, &depth_unit)) : 0;
 
-	if (prefs.ead) {
+	if (prefs.ead && gas_depths) {
 		switch (pi->dive_type) {
 		case NITROX:
-			if (entry->ead > 0) {
-				ead = lrint(get_depth_units(lrint(entry->ead), NULL, &depth_unit));
+			if (gas_depths->ead > 0) {
+				ead = lrint(get_depth_units(lrint(gas_depths->ead), NULL, &depth_unit));
 				put_format_loc(b, translate("gettextFromC", "EAD: %d%s\nEADD: %d%s / %.1fg/ℓ\n"), ead, depth_unit, eadd, depth_unit, entry->density);
 				break;
 			}
 		case TRIMIX:
-			if (entry->end > 0) {
-				end = lrint(get_depth_units(lrint(entry->end), NULL, &depth_unit));
+			if (gas_depths->end > 0) {
+				end = lrint(get_depth_units(lrint(gas_depths->end), NULL, &depth_unit));
 				put_format_loc(b, translate("gettextFromC", "END: %d%s\nEADD: %d%s / %.1fg/ℓ\n"), end, depth_unit, eadd, depth_unit, entry->density);
 				break;
 			}
@@ -1537,11 +1585,11 @@ static void plot_string(const struct dive *d, const struct plot_info *pi, int id
 		if (entry->ceiling) {
 			depthvalue = get_depth_units(entry->ceiling, NULL, &depth_unit);
 			put_format_loc(b, translate("gettextFromC", "Calculated ceiling %.0f%s\n"), depthvalue, depth_unit);
-			if (prefs.calcalltissues) {
+			if (prefs.calcalltissues && tissues) {
 				int k;
 				for (k = 0; k < 16; k++) {
-					if (entry->ceilings[k]) {
-						depthvalue = get_depth_units(entry->ceilings[k], NULL, &depth_unit);
+					if (tissues->ceilings[k]) {
+						depthvalue = get_depth_units(tissues->ceilings[k], NULL, &depth_unit);
 						put_format_loc(b, translate("gettextFromC", "Tissue %.0fmin: %.1f%s\n"), buehlmann_N2_t_halflife[k], depthvalue, depth_unit);
 					}
 				}
@@ -25,6 +25,7 @@ enum plot_pressure {
 
 struct membuffer;
 struct deco_state;
+struct deco_config;
 struct divecomputer;
 struct plot_info;
 
@@ -35,15 +36,35 @@ struct plot_pressure_data {
 	int data[NUM_PLOT_PRESSURES];
 };
 
+/*
+ * Optional data of a plot. It is only calculated if requested by the
+ * caller, see create_plot_info_config(). It is stored in separate arrays
+ * (cf. plot_info.pressures), so that the entries of plots without these
+ * channels stay small.
+ */
+enum plot_channel {
+	PLOT_CHANNEL_TISSUES = 1 << 0,		/* per-compartment ceilings and tissue saturations */
+	PLOT_CHANNEL_GAS_DEPTHS = 1 << 1	/* MOD, EAD, END and EADD */
+};
+#define PLOT_CHANNELS_ALL (PLOT_CHANNEL_TISSUES | PLOT_CHANNEL_GAS_DEPTHS)
+
+struct plot_tissue_data {
+	int ceilings[16];
+	int percentages[16];
+};
+
+struct plot_gas_depth_data {
+	double mod, ead, end, eadd;
+};
+
 struct plot_data {
 	unsigned int in_deco : 1;
+	unsigned int in_deco_calc : 1;
 	int sec;
 	int temperature;
 	/* Depth info */
 	int depth;
 	int ceiling;
-	int ceilings[16];
-	int percentages[16];
 	int ndl;
 	int tts;
 	int rbt;
@@ -58,13 +79,11 @@ struct plot_data {
 	pressure_t o2sensor[3]; //for rebreathers with up to 3 PO2 sensors
 	pressure_t o2setpoint;
 	pressure_t scr_OC_pO2;
-	double mod, ead, end, eadd;
 	velocity_t velocity;
 	int speed;
 	// stats over 9 minute window:
 	int min, max;	// indices into pi->entry[]
 	/* values calculated by us */
-	unsigned int in_deco_calc : 1;
 	int ndl_calc;
 	int tts_calc;
 	int stoptime_calc;
@@ -84,8 +103,11 @@ extern void compare_samples(const struct dive *d, const struct plot_info *pi, in
 extern void init_plot_info(struct plot_info *pi);
 /* when planner_dc is non-null, this is called in planner mode. */
 extern void create_plot_info_new(const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, bool fast, const struct deco_state *planner_ds);
+extern void create_plot_info_config(const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, bool fast,
+				    const struct deco_state *planner_ds, const struct deco_config *config, unsigned int channels);
 extern int get_plot_details_new(const struct dive *d, const struct plot_info *pi, int time, struct membuffer *);
 extern void free_plot_info_data(struct plot_info *pi);
+extern void copy_plot_info(struct plot_info *dst, const struct plot_info *src);
 
 /*
  * When showing dive profiles, we scale things to the
@@ -128,6 +150,17 @@ static inline int get_plot_pressure(const struct plot_info *pi, int idx, int cyl
 	return res ? res : get_plot_interpolated_pressure(pi, idx, cylinder);
 }
 
+/* The optional channels return NULL if the channel was not calculated */
+static inline const struct plot_tissue_data *get_plot_tissues(const struct plot_info *pi, int idx)
+{
+	return pi->tissues ? &pi->tissues[idx] : NULL;
+}
+
+static inline const struct plot_gas_depth_data *get_plot_gas_depths(const struct plot_info *pi, int idx)
+{
+	return pi->gas_depths ? &pi->gas_depths[idx] : NULL;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "profilebatch.h"
+#include "dive.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <QFuture>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+ProfileBatch::ProfileBatch(std::vector<const dive *> divesIn) : dives(std::move(divesIn)),
+	canceled(false),
+	done(0)
+{
+	init_deco_config(&config, false);
+	// The profile code accesses the samples directly. Expand them here,
+	// so that the worker threads don't modify the dives.
+	for (const dive *d: dives)
+		expand_dive_samples(d);
+}
+
+void ProfileBatch::cancel()
+{
+	canceled = true;
+}
+
+bool ProfileBatch::isCanceled() const
+{
+	return canceled;
+}
+
+int ProfileBatch::progress() const
+{
+	return done;
+}
+
+int ProfileBatch::total() const
+{
+	return (int)dives.size();
+}
+
+void ProfileBatch::setProgressCallback(std::function<void(int, int)> callback)
+{
+	progressCallback = std::move(callback);
+}
+
+// Split the dives into chains of repetitive dives. Uses the same 48h criterion as
+// init_decompression(). Each chain is a list of indices into the dives vector,
+// sorted by time.
+std::vector<std::vector<int>> ProfileBatch::chains() const
+{
+	std::vector<int> order(dives.size());
+	for (size_t i = 0; i < dives.size(); ++i)
+		order[i] = (int)i;
+	std::sort(order.begin(), order.end(), [this](int i1, int i2)
+		  { return dives[i1]->when < dives[i2]->when; });
+
+	std::vector<std::vector<int>> res;
+	timestamp_t last_endtime = 0;
+	for (int idx: order) {
+		const dive *d = dives[idx];
+		if (res.empty() || last_endtime + 48 * 60 * 60 < d->when)
+			res.emplace_back();
+		res.back().push_back(idx);
+		last_endtime = std::max(last_endtime, dive_endtime(d));
+	}
+
+	// Start the longest chains first, so that we don't end up waiting for
+	// a single long chain at the end.
+	std::stable_sort(res.begin(), res.end(), [](const std::vector<int> &c1, const std::vector<int> &c2)
+			 { return c1.size() > c2.size(); });
+	return res;
+}
+
+static ProfileSummary summarize(const dive *d, const plot_info &pi)
+{
+	ProfileSummary res;
+	res.valid = true;
+	res.max_cns = d->maxcns;
+	for (int i = 0; i < pi.nr; ++i) {
+		const plot_data &entry = pi.entry[i];
+		res.max_ceiling = std::max(res.max_ceiling, entry.ceiling);
+		res.max_tts = std::max(res.max_tts, entry.tts_calc);
+		res.max_density = std::max(res.max_density, entry.density);
+		res.max_cns = std::max(res.max_cns, entry.cns);
+	}
+	if (pi.nr > 0)
+		res.surface_gf = pi.entry[pi.nr - 1].surface_gf;
+	return res;
+}
+
+void ProfileBatch::calculateChain(const std::vector<int> &chain, std::vector<ProfileSummary> &res)
+{
+	struct plot_info pi;
+	init_plot_info(&pi);
+	for (int idx: chain) {
+		if (canceled)
+			break;
+		const dive *d = dives[idx];
+		// The summary needs none of the optional channels
+		create_plot_info_config(d, &d->dc, &pi, true, nullptr, &config, 0);
+		res[idx] = summarize(d, pi);
+		int n = ++done;
+		if (progressCallback)
+			progressCallback(n, total());
+	}
+	free_plot_info_data(&pi);
+}
+
+std::vector<ProfileSummary> ProfileBatch::run(QThreadPool *pool)
+{
+	if (!pool)
+		pool = QThreadPool::globalInstance();
+
+	// Each chain writes to distinct entries of the result vector,
+	// therefore no locking is needed.
+	std::vector<ProfileSummary> res(dives.size());
+	std::vector<std::vector<int>> todo = chains();
+	std::vector<QFuture<void>> futures;
+	futures.reserve(todo.size());
+	for (const std::vector<int> &chain: todo)
+		futures.push_back(QtConcurrent::run(pool, [this, &chain, &res]() { calculateChain(chain, res); }));
+	for (QFuture<void> &future: futures)
+		future.waitForFinished();
+	return res;
+}
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0
+// Compute profile derived data (ceilings, TTS, etc.) for many dives in parallel.
+#ifndef PROFILE_BATCH_H
+#define PROFILE_BATCH_H
+
+#include "deco.h"
+#include <atomic>
+#include <functional>
+#include <vector>
+
+class QThreadPool;
+struct dive;
+
+// The interesting values of a plot_info, which itself is rather large.
+struct ProfileSummary {
+	bool valid = false;		// false if the computation was canceled
+	int max_ceiling = 0;		// in mm
+	int max_tts = 0;		// in seconds
+	double surface_gf = 0.0;	// GF when surfacing at the end of the dive, in %
+	double max_density = 0.0;	// in g/l
+	int max_cns = 0;		// in %
+};
+
+// Dives are split into chains of repetitive dives. The dives of a chain are
+// calculated in order on the same thread, so that each dive can use the cached
+// tissue state of the previous dive (see init_decompression()). Independent
+// chains are calculated concurrently.
+// The dive table must not be modified while the batch is running.
+class ProfileBatch {
+public:
+	// The deco settings are read from the preferences and the samples of
+	// the dives are expanded on construction, i.e. on the calling thread.
+	ProfileBatch(std::vector<const dive *> dives);
+	// Blocks until all dives are calculated or the batch is canceled.
+	// The results are in the order of the dives passed to the constructor.
+	std::vector<ProfileSummary> run(QThreadPool *pool = nullptr);
+	void cancel(); // May be called from any thread.
+	bool isCanceled() const;
+	int progress() const;
+	int total() const;
+	// Called from the worker threads after each dive.
+	void setProgressCallback(std::function<void(int done, int total)> callback);
+private:
+	std::vector<std::vector<int>> chains() const;
+	void calculateChain(const std::vector<int> &chain, std::vector<ProfileSummary> &res);
+	std::vector<const dive *> dives;
+	struct deco_config config;
+	std::function<void(int, int)> progressCallback;
+	std::atomic<bool> canceled;
+	std::atomic<int> done;
+};
+
+#endif
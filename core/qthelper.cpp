@@ -19,6 +19,7 @@
 #include "file.h"
 #include "picture.h"
 #include "selection.h"
+#include "stringpool.h"
 #include "tag.h"
 #include "trip.h"
 #include "imagedownloader.h"
@@ -41,6 +42,8 @@
 #include <QSvgRenderer>
 #include <cstdarg>
 #include <cstdint>
+#include <numeric>
+#include <vector>
 #ifdef Q_OS_UNIX
 #include <sys/utsname.h>
 #endif
@@ -1066,7 +1069,7 @@ static const QString hashfile_name()
 	return QString(system_default_directory()).append("/hashes");
 }
 
-static QString thumbnailDir()
+QString thumbnailDir()
 {
 	return QString(system_default_directory()) + "/thumbnails/";
 }
@@ -1679,11 +1682,93 @@ extern "C" void unlock_planner()
 	planLock.unlock();
 }
 
+// Protects the cached tissue states of init_decompression(), which may be
+// called from different threads.
+QMutex decoCacheLock;
+
+extern "C" void lock_deco_cache()
+{
+	decoCacheLock.lock();
+}
+
+extern "C" void unlock_deco_cache()
+{
+	decoCacheLock.unlock();
+}
+
+// Protects the event indexes of the dive computers, which are built
+// on demand from different threads.
+QMutex eventIndexLock;
+
+extern "C" void lock_event_index()
+{
+	eventIndexLock.lock();
+}
+
+extern "C" void unlock_event_index()
+{
+	eventIndexLock.unlock();
+}
+
+// Protects the decompression of the samples of dive computers, which
+// may be accessed from different threads.
+QMutex diveSamplesLock;
+
+extern "C" void lock_dive_samples()
+{
+	diveSamplesLock.lock();
+}
+
+extern "C" void unlock_dive_samples()
+{
+	diveSamplesLock.unlock();
+}
+
+// Protects the reference counts of the arenas, see arena.h.
+QMutex arenaLock;
+
+extern "C" void lock_arena()
+{
+	arenaLock.lock();
+}
+
+extern "C" void unlock_arena()
+{
+	arenaLock.unlock();
+}
+
+// Protects the table of interned strings, see stringpool.h.
+QMutex stringPoolLock;
+
+extern "C" void lock_string_pool()
+{
+	stringPoolLock.lock();
+}
+
+extern "C" void unlock_string_pool()
+{
+	stringPoolLock.unlock();
+}
+
+// Call fn(data, idx) for idx = 0..n-1 on the global thread pool and wait
+// until all calls are finished. The order of the calls is undefined.
+extern "C" void run_in_parallel(int n, void (*fn)(void *data, int idx), void *data)
+{
+	std::vector<int> indices(n);
+	std::iota(indices.begin(), indices.end(), 0);
+	QtConcurrent::blockingMap(indices, [fn, data](int idx) { fn(data, idx); });
+}
+
 char *copy_qstring(const QString &s)
 {
 	return strdup(qPrintable(s));
 }
 
+const char *intern_qstring(const QString &s)
+{
+	return intern_string(qPrintable(s));
+}
+
 // function to call to allow the UI to show updates for longer running activities
 void (*uiNotificationCallback)(QString msg) = nullptr;
 
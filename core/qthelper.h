@@ -32,6 +32,7 @@ QString get_taglist_string(struct tag_entry *tag_list);
 QStringList stringToList(const QString &s);
 void read_hashes();
 void write_hashes();
+QString thumbnailDir();
 QString thumbnailFileName(const QString &filename);
 void learnPictureFilename(const QString &originalName, const QString &localName);
 QString localFilePath(const QString &originalFilename);
@@ -45,6 +46,7 @@ QStringList mediaExtensionFilters();
 QStringList imageExtensionFilters();
 QStringList videoExtensionFilters();
 char *copy_qstring(const QString &);
+const char *intern_qstring(const QString &); // see stringpool.h
 QString get_depth_string(depth_t depth, bool showunit = false, bool showdecimal = true);
 QString get_depth_string(int mm, bool showunit = false, bool showdecimal = true);
 QString get_depth_unit(bool metric);
@@ -158,6 +160,17 @@ time_t get_dive_datetime_from_isostring(char *when);
 void print_qt_versions();
 void lock_planner();
 void unlock_planner();
+void lock_deco_cache();
+void unlock_deco_cache();
+void lock_event_index();
+void unlock_event_index();
+void lock_dive_samples();
+void unlock_dive_samples();
+void lock_arena();
+void unlock_arena();
+void lock_string_pool();
+void unlock_string_pool();
+void run_in_parallel(int n, void (*fn)(void *data, int idx), void *data);
 xsltStylesheetPtr get_stylesheet(const char *name);
 weight_t string_to_weight(const char *str);
 depth_t string_to_depth(const char *str);
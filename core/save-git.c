@@ -246,7 +246,7 @@ static void show_index(struct membuffer *b, int value, const char *pre, const ch
  *
  * For parsing, look at the units to figure out what the numbers are.
  */
-static void save_sample(struct membuffer *b, struct sample *sample, struct sample *old, int o2sensor)
+static void save_sample(struct membuffer *b, const struct sample *sample, struct sample *old, int o2sensor)
 {
 	int idx;
 
@@ -354,7 +354,7 @@ static void save_samples(struct membuffer *b, struct dive *dive, struct divecomp
 {
 	int nr;
 	int o2sensor;
-	struct sample *s;
+	const struct sample *s, *samples;
 	struct sample dummy = { .bearing.degrees = -1, .ndl.seconds = -1 };
 
 	/* Is this a CCR dive with the old-style "o2pressure" sensor? */
@@ -364,12 +364,13 @@ static void save_samples(struct membuffer *b, struct dive *dive, struct divecomp
 		dummy.sensor[1] = o2sensor;
 	}
 
-	s = dc->sample;
+	samples = s = get_dc_samples(dc);
 	nr = dc->samples;
 	while (--nr >= 0) {
 		save_sample(b, s, &dummy, o2sensor);
 		s++;
 	}
+	put_dc_samples(dc, samples);
 }
 
 static void save_one_event(struct membuffer *b, struct dive *dive, struct event *ev)
@@ -587,14 +588,31 @@ static void create_dive_name(struct dive *dive, struct membuffer *name, struct t
 /*
  * Write a membuffer to the git repo, and free it
  */
+static int create_blob(git_repository *repo, struct membuffer *b, git_oid *blob_id)
+{
+	int ret = git_blob_create_frombuffer(blob_id, repo, b->buffer, b->len);
+	free_buffer(b);
+	return ret;
+}
+
+static int blob_id_insert(struct dir *tree, git_oid *blob_id, const char *fmt, ...)
+{
+	int ret;
+	struct membuffer name = { 0 };
+
+	VA_BUF(&name, fmt);
+	ret = tree_insert(tree->files, mb_cstring(&name), 1, blob_id, GIT_FILEMODE_BLOB);
+	free_buffer(&name);
+	return ret;
+}
+
 static int blob_insert(git_repository *repo, struct dir *tree, struct membuffer *b, const char *fmt, ...)
 {
 	int ret;
 	git_oid blob_id;
 	struct membuffer name = { 0 };
 
-	ret = git_blob_create_frombuffer(&blob_id, repo, b->buffer, b->len);
-	free_buffer(b);
+	ret = create_blob(repo, b, &blob_id);
 	if (ret)
 		return ret;
 
@@ -604,27 +622,138 @@ static int blob_insert(git_repository *repo, struct dir *tree, struct membuffer
 	return ret;
 }
 
-static int save_one_divecomputer(git_repository *repo, struct dir *tree, struct dive *dive, struct divecomputer *dc, int idx)
-{
+/*
+ * Serializing the dives is the expensive part of saving. Therefore, this
+ * is done for all dives that have to be written in parallel. Since libgit2
+ * objects must not be used from several threads at once, the blobs are
+ * then written one by one on the calling thread, before the trees are
+ * assembled in order. The resulting objects are the same as when writing
+ * them dive by dive.
+ */
+struct saved_blob {
+	struct membuffer buf;	/* freed when the blob is written */
 	int ret;
-	struct membuffer buf = { 0 };
+	git_oid id;
+};
+
+struct dive_blobs {
+	bool needed;
+	struct saved_blob dive;
+	int nr_dcs;
+	struct saved_blob *dcs;
+	int nr_pictures;
+	struct saved_blob *pictures;
+};
+
+struct dive_blobs_job {
+	struct dive_blobs *blobs;	/* indexed like the dive table */
+};
+
+static void save_one_picture(struct membuffer *b, struct picture *pic)
+{
+	show_utf8(b, "filename ", pic->filename, "\n");
+	put_location(b, &pic->location, "gps ", "\n");
+}
+
+/* Called from worker threads: only serialize, don't access the repository */
+static void render_dive_blobs(void *data, int idx)
+{
+	struct dive_blobs_job *job = data;
+	struct dive_blobs *blobs = &job->blobs[idx];
+	struct dive *dive = get_dive(idx);
+	struct divecomputer *dc;
+	int i;
+
+	if (!blobs->needed)
+		return;
+
+	/* On failure, the error of the dive blob makes save_one_dive() fail */
+	blobs->dcs = calloc(number_of_computers(dive), sizeof(*blobs->dcs));
+	blobs->pictures = dive->pictures.nr ? calloc(dive->pictures.nr, sizeof(*blobs->pictures)) : NULL;
+	if (!blobs->dcs || (dive->pictures.nr && !blobs->pictures)) {
+		blobs->dive.ret = -1;
+		return;
+	}
+
+	create_dive_buffer(dive, &blobs->dive.buf);
+
+	blobs->nr_dcs = number_of_computers(dive);
+	for (dc = &dive->dc, i = 0; dc; dc = dc->next, i++)
+		save_dc(&blobs->dcs[i].buf, dive, dc);
+
+	blobs->nr_pictures = dive->pictures.nr;
+	for (i = 0; i < dive->pictures.nr; i++)
+		save_one_picture(&blobs->pictures[i].buf, &dive->pictures.pictures[i]);
+}
+
+static void write_blob(git_repository *repo, struct saved_blob *blob)
+{
+	blob->ret = create_blob(repo, &blob->buf, &blob->id);
+}
 
-	save_dc(&buf, dive, dc);
-	ret = blob_insert(repo, tree, &buf, "Divecomputer%c%03u", idx ? '-' : 0, idx);
+static void write_dive_blobs(git_repository *repo, struct dive_blobs *blobs)
+{
+	int i;
+
+	if (!blobs->needed || blobs->dive.ret)
+		return;
+	write_blob(repo, &blobs->dive);
+	for (i = 0; i < blobs->nr_dcs; i++)
+		write_blob(repo, &blobs->dcs[i]);
+	for (i = 0; i < blobs->nr_pictures; i++)
+		write_blob(repo, &blobs->pictures[i]);
+}
+
+static struct dive_blobs *create_all_dive_blobs(git_repository *repo, bool select_only, bool cached_ok)
+{
+	int i;
+	struct dive *dive;
+	struct dive_blobs_job job;
+
+	job.blobs = calloc(dive_table.nr, sizeof(*job.blobs));
+	if (!job.blobs)
+		return NULL;	/* an empty dive table, or out of memory */
+	for_each_dive(i, dive) {
+		if (select_only && !dive->selected)
+			continue;
+		job.blobs[i].needed = !cached_ok || !dive_cache_is_valid(dive);
+	}
+	run_in_parallel(dive_table.nr, render_dive_blobs, &job);
+	for (i = 0; i < dive_table.nr; i++)
+		write_dive_blobs(repo, &job.blobs[i]);
+	return job.blobs;
+}
+
+static void free_all_dive_blobs(struct dive_blobs *blobs, int nr)
+{
+	if (!blobs)
+		return;
+	for (int i = 0; i < nr; i++) {
+		free(blobs[i].dcs);
+		free(blobs[i].pictures);
+	}
+	free(blobs);
+}
+
+static int insert_one_divecomputer(struct dir *tree, struct saved_blob *blob, int idx)
+{
+	int ret = blob->ret;
+
+	if (!ret)
+		ret = blob_id_insert(tree, &blob->id, "Divecomputer%c%03u", idx ? '-' : 0, idx);
 	if (ret)
 		report_error("divecomputer tree insert failed");
 	return ret;
 }
 
-static int save_one_picture(git_repository *repo, struct dir *dir, struct picture *pic)
+static int insert_one_picture(struct dir *dir, struct picture *pic, struct saved_blob *blob)
 {
 	int offset = pic->offset.seconds;
-	struct membuffer buf = { 0 };
 	char sign = '+';
 	unsigned h;
 
-	show_utf8(&buf, "filename ", pic->filename, "\n");
-	put_location(&buf, &pic->location, "gps ", "\n");
+	if (blob->ret)
+		return blob->ret;
 
 	/* Picture loading will load even negative offsets.. */
 	if (offset < 0) {
@@ -635,27 +764,25 @@ static int save_one_picture(git_repository *repo, struct dir *dir, struct pictur
 	/* Use full hh:mm:ss format to make it all sort nicely */
 	h = offset / 3600;
 	offset -= h *3600;
-	return blob_insert(repo, dir, &buf, "%c%02u=%02u=%02u",
+	return blob_id_insert(dir, &blob->id, "%c%02u=%02u=%02u",
 		sign, h, FRACTION(offset, 60));
 }
 
-static int save_pictures(git_repository *repo, struct dir *dir, struct dive *dive)
+static int insert_pictures(git_repository *repo, struct dir *dir, struct dive *dive, struct dive_blobs *blobs)
 {
 	if (dive->pictures.nr > 0) {
 		dir = mktree(repo, dir, "Pictures");
-		FOR_EACH_PICTURE(dive) {
-			save_one_picture(repo, dir, picture);
-		}
+		for (int i = 0; i < dive->pictures.nr; i++)
+			insert_one_picture(dir, &dive->pictures.pictures[i], &blobs->pictures[i]);
 	}
 	return 0;
 }
 
-static int save_one_dive(git_repository *repo, struct dir *tree, struct dive *dive, struct tm *tm, bool cached_ok)
+static int save_one_dive(git_repository *repo, struct dir *tree, struct dive *dive, struct tm *tm, struct dive_blobs *blobs)
 {
-	struct divecomputer *dc;
-	struct membuffer buf = { 0 }, name = { 0 };
+	struct membuffer name = { 0 };
 	struct dir *subdir;
-	int ret, nr;
+	int ret, nr, i;
 
 	/* Create dive directory */
 	create_dive_name(dive, &name, tm);
@@ -664,7 +791,7 @@ static int save_one_dive(git_repository *repo, struct dir *tree, struct dive *di
 	 * If the dive git ID is valid, we just create the whole directory
 	 * with that ID
 	 */
-	if (cached_ok && dive_cache_is_valid(dive)) {
+	if (!blobs->needed) {
 		git_oid oid;
 		git_oid_fromraw(&oid, dive->git_id);
 		ret = tree_insert(tree->files, mb_cstring(&name), 1,
@@ -679,10 +806,11 @@ static int save_one_dive(git_repository *repo, struct dir *tree, struct dive *di
 	subdir->unique = 1;
 	free_buffer(&name);
 
-	create_dive_buffer(dive, &buf);
 	nr = dive->number;
-	ret = blob_insert(repo, subdir, &buf,
-		"Dive%c%d", nr ? '-' : 0, nr);
+	ret = blobs->dive.ret;
+	if (!ret)
+		ret = blob_id_insert(subdir, &blobs->dive.id,
+			"Dive%c%d", nr ? '-' : 0, nr);
 	if (ret)
 		return report_error("dive save-file tree insert failed");
 
@@ -691,15 +819,12 @@ static int save_one_dive(git_repository *repo, struct dir *tree, struct dive *di
 	 * computer, use index 0 for that (which disables the index
 	 * generation when naming it).
 	 */
-	dc = &dive->dc;
-	nr = dc->next ? 1 : 0;
-	do {
-		save_one_divecomputer(repo, subdir, dive, dc, nr++);
-		dc = dc->next;
-	} while (dc);
+	nr = blobs->nr_dcs > 1 ? 1 : 0;
+	for (i = 0; i < blobs->nr_dcs; i++)
+		insert_one_divecomputer(subdir, &blobs->dcs[i], nr++);
 
 	/* Save the picture data, if any */
-	save_pictures(repo, subdir, dive);
+	insert_pictures(repo, subdir, dive, blobs);
 	return 0;
 }
 
@@ -791,7 +916,7 @@ static void verify_shared_date(timestamp_t when, struct tm *tm)
 #define MIN_TIMESTAMP (0)
 #define MAX_TIMESTAMP (0x7fffffffffffffff)
 
-static int save_one_trip(git_repository *repo, struct dir *tree, dive_trip_t *trip, struct tm *tm, bool cached_ok)
+static int save_one_trip(git_repository *repo, struct dir *tree, dive_trip_t *trip, struct tm *tm, struct dive_blobs *blobs)
 {
 	int i;
 	struct dive *dive;
@@ -825,7 +950,7 @@ static int save_one_trip(git_repository *repo, struct dir *tree, dive_trip_t *tr
 	/* Save each dive in the directory */
 	for_each_dive(i, dive) {
 		if (dive->divetrip == trip)
-			save_one_dive(repo, subdir, dive, tm, cached_ok);
+			save_one_dive(repo, subdir, dive, tm, &blobs[i]);
 	}
 
 	return 0;
@@ -1010,6 +1135,7 @@ static int create_git_tree(git_repository *repo, struct dir *root, bool select_o
 	int i;
 	struct dive *dive;
 	dive_trip_t *trip;
+	struct dive_blobs *blobs;
 
 	git_storage_update_progress(translate("gettextFromC", "Start saving data"));
 	save_settings(repo, root);
@@ -1022,6 +1148,9 @@ static int create_git_tree(git_repository *repo, struct dir *root, bool select_o
 
 	/* save the dives */
 	git_storage_update_progress(translate("gettextFromC", "Start saving dives"));
+	blobs = create_all_dive_blobs(repo, select_only, cached_ok);
+	if (!blobs && dive_table.nr)
+		return report_error("Out of memory saving dives");
 	for_each_dive(i, dive) {
 		struct tm tm;
 		struct dir *tree;
@@ -1048,12 +1177,13 @@ static int create_git_tree(git_repository *repo, struct dir *root, bool select_o
 			trip->saved = 1;
 
 			/* Pass that new subdirectory in for save-trip */
-			save_one_trip(repo, tree, trip, &tm, cached_ok);
+			save_one_trip(repo, tree, trip, &tm, blobs);
 			continue;
 		}
 
-		save_one_dive(repo, tree, dive, &tm, cached_ok);
+		save_one_dive(repo, tree, dive, &tm, &blobs[i]);
 	}
+	free_all_dive_blobs(blobs, dive_table.nr);
 	git_storage_update_progress(translate("gettextFromC", "Done creating local cache"));
 	return 0;
 }
@@ -45,6 +45,8 @@ static void put_video_time(struct membuffer *b, int secs)
 static void put_pd(struct membuffer *b, const struct plot_info *pi, int idx)
 {
 	const struct plot_data *entry = pi->entry + idx;
+	const struct plot_tissue_data *tissues = get_plot_tissues(pi, idx);
+	const struct plot_gas_depth_data *gas_depths = get_plot_gas_depths(pi, idx);
 
 	put_int(b, entry->in_deco);
 	put_int(b,  entry->sec);
@@ -56,9 +58,9 @@ static void put_pd(struct membuffer *b, const struct plot_info *pi, int idx)
 	put_int(b, entry->depth);
 	put_int(b, entry->ceiling);
 	for (int i = 0; i < 16; i++)
-		put_int(b, entry->ceilings[i]);
+		put_int(b, tissues ? tissues->ceilings[i] : 0);
 	for (int i = 0; i < 16; i++)
-		put_int(b, entry->percentages[i]);
+		put_int(b, tissues ? tissues->percentages[i] : 0);
 	put_int(b, entry->ndl);
 	put_int(b, entry->tts);
 	put_int(b, entry->rbt);
@@ -77,10 +79,10 @@ static void put_pd(struct membuffer *b, const struct plot_info *pi, int idx)
 	put_int(b, entry->o2sensor[2].mbar);
 	put_int(b, entry->o2setpoint.mbar);
 	put_int(b, entry->scr_OC_pO2.mbar);
-	put_double(b, entry->mod);
-	put_double(b, entry->ead);
-	put_double(b, entry->end);
-	put_double(b, entry->eadd);
+	put_double(b, gas_depths ? gas_depths->mod : 0.0);
+	put_double(b, gas_depths ? gas_depths->ead : 0.0);
+	put_double(b, gas_depths ? gas_depths->end : 0.0);
+	put_double(b, gas_depths ? gas_depths->eadd : 0.0);
 	switch (entry->velocity) {
 	case STABLE:
 		put_csv_string(b, "STABLE");
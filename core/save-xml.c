@@ -237,7 +237,7 @@ static void show_index(struct membuffer *b, int value, const char *pre, const ch
 		show_integer(b, value, pre, post);
 }
 
-static void save_sample(struct membuffer *b, struct sample *sample, struct sample *old, int o2sensor)
+static void save_sample(struct membuffer *b, const struct sample *sample, struct sample *old, int o2sensor)
 {
 	int idx;
 
@@ -413,7 +413,7 @@ static void save_samples(struct membuffer *b, struct dive *dive, struct divecomp
 {
 	int nr;
 	int o2sensor;
-	struct sample *s;
+	const struct sample *s, *samples;
 	struct sample dummy = { .bearing.degrees = -1, .ndl.seconds = -1 };
 
 	/* Set up default pressure sensor indices */
@@ -423,12 +423,13 @@ static void save_samples(struct membuffer *b, struct dive *dive, struct divecomp
 		dummy.sensor[1] = o2sensor;
 	}
 
-	s = dc->sample;
+	samples = s = get_dc_samples(dc);
 	nr = dc->samples;
 	while (--nr >= 0) {
 		save_sample(b, s, &dummy, o2sensor);
 		s++;
 	}
+	put_dc_samples(dc, samples);
 }
 
 static void save_dc(struct membuffer *b, struct dive *dive, struct divecomputer *dc)
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "stringpool.h"
+#include "arena.h"
+#include "qthelper.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * An open addressing hash table of the interned strings. The strings
+ * themselves live in an arena that is never freed. The table is protected
+ * by lock_string_pool(), because the git loader parses dives in worker
+ * threads.
+ */
+struct pool_entry {
+	uint32_t hash;
+	const char *string;
+};
+
+static struct arena *pool_arena;
+static struct pool_entry *pool;
+static size_t pool_size, pool_nr;	/* pool_size is a power of two */
+
+/* FNV-1a */
+static uint32_t hash_string(const char *s, size_t len)
+{
+	uint32_t hash = 2166136261u;
+
+	while (len--) {
+		hash ^= (unsigned char)*s++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static struct pool_entry *find_entry(struct pool_entry *table, size_t size, uint32_t hash, const char *s, size_t len)
+{
+	size_t i = hash & (size - 1);
+
+	while (table[i].string) {
+		if (table[i].hash == hash && !strncmp(table[i].string, s, len) && table[i].string[len] == '\0')
+			break;
+		i = (i + 1) & (size - 1);
+	}
+	return &table[i];
+}
+
+/* Keep the table at most half full */
+static void grow_pool(void)
+{
+	size_t size = pool_size ? pool_size * 2 : 1024;
+	struct pool_entry *table = calloc(size, sizeof(struct pool_entry));
+
+	if (!table)
+		exit(1);
+	for (size_t i = 0; i < pool_size; i++) {
+		const struct pool_entry *entry = &pool[i];
+		if (entry->string)
+			*find_entry(table, size, entry->hash, entry->string, strlen(entry->string)) = *entry;
+	}
+	free(pool);
+	pool = table;
+	pool_size = size;
+}
+
+const char *intern_string_len(const char *s, size_t len)
+{
+	uint32_t hash;
+	struct pool_entry *entry;
+	const char *res;
+	char *string;
+
+	if (!s)
+		return NULL;
+	hash = hash_string(s, len);
+	lock_string_pool();
+	if (2 * (pool_nr + 1) > pool_size)
+		grow_pool();
+	entry = find_entry(pool, pool_size, hash, s, len);
+	if (!entry->string) {
+		if (!pool_arena)
+			pool_arena = arena_new();
+		string = arena_alloc(pool_arena, len + 1);
+		if (!string)
+			exit(1);
+		memcpy(string, s, len);
+		string[len] = '\0';
+		entry->hash = hash;
+		entry->string = string;
+		pool_nr++;
+	}
+	res = entry->string;
+	unlock_string_pool();
+	return res;
+}
+
+const char *intern_string(const char *s)
+{
+	return s ? intern_string_len(s, strlen(s)) : NULL;
+}
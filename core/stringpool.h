@@ -0,0 +1,30 @@
+// SPDX-License-Identifier: GPL-2.0
+
+// A global table of interned strings. There is only one copy of every
+// interned string and it is never freed. Thus, interned strings can be
+// shared without copying, and two interned strings are equal if and only
+// if they are the same pointer.
+//
+// The following strings are always interned and must not be freed:
+//	- the model, serial and fw_version of struct divecomputer
+//	- the description of cylinder_type_t
+//	- the key of struct extra_data
+// Code that sets them gets the string from intern_string().
+
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const char *intern_string(const char *s); // NULL for NULL
+extern const char *intern_string_len(const char *s, size_t len); // s doesn't have to be zero terminated
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
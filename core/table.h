@@ -5,6 +5,10 @@
 #ifndef CORE_TABLE_H
 #define CORE_TABLE_H
 
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
 #define MAKE_GROW_TABLE(table_type, item_type, array_name) \
 	item_type *grow_##table_type(struct table_type *table)				\
 	{										\
@@ -23,41 +27,117 @@
 	}
 
 /* get the index where we want to insert an object so that everything stays
- * ordered according to a comparison function() */
+ * ordered according to a comparison function(). The object is inserted after
+ * all objects that compare equal. */
 #define MAKE_GET_INSERTION_INDEX(table_type, item_type, array_name, fun)		\
 	int table_type##_get_insertion_index(struct table_type *table, item_type item)	\
 	{										\
-		/* we might want to use binary search here */				\
-		for (int i = 0; i < table->nr; i++) {					\
-			if (fun(item, table->array_name[i]))				\
-				return i;						\
+		int lo = 0, hi = table->nr;						\
+		while (lo < hi) {							\
+			int mid = lo + (hi - lo) / 2;					\
+			if (fun(item, table->array_name[mid]))				\
+				hi = mid;						\
+			else								\
+				lo = mid + 1;						\
 		}									\
-		return table->nr;							\
+		return lo;								\
 	}
 
+/* Tables whose items are indexed elsewhere use the _HOOKED variants of the
+ * macros below. These call added(table, item) when an item enters the table
+ * and removed(table, item) before an item leaves the table. */
+#define NO_TABLE_HOOK(table, item)
+
 /* add object at the given index to a table. */
-#define MAKE_ADD_TO(table_type, item_type, array_name)					\
-	void add_to_##table_type(struct table_type *table, int idx, item_type item)	\
-	{										\
-		int i;									\
-		grow_##table_type(table);						\
-		table->nr++;								\
-											\
-		for (i = idx; i < table->nr; i++) {					\
-			item_type tmp = table->array_name[i];				\
-			table->array_name[i] = item;					\
-			item = tmp;							\
-		}									\
+#define MAKE_ADD_TO_HOOKED(table_type, item_type, array_name, added)				\
+	void add_to_##table_type(struct table_type *table, int idx, item_type item)		\
+	{											\
+		grow_##table_type(table);							\
+		added(table, item);								\
+		memmove(&table->array_name[idx + 1], &table->array_name[idx],			\
+			(table->nr - idx) * sizeof(item_type));					\
+		table->array_name[idx] = item;							\
+		table->nr++;									\
+	}
+#define MAKE_ADD_TO(table_type, item_type, array_name) \
+	MAKE_ADD_TO_HOOKED(table_type, item_type, array_name, NO_TABLE_HOOK)
+
+/* add a number of objects, which are ordered according to a comparison function(),
+ * to an ordered table in a single pass. Equivalent to inserting the objects one by one
+ * at their insertion index. */
+#define MAKE_ADD_MANY_HOOKED(table_type, item_type, array_name, fun, added)			\
+	void add_many_to_##table_type(struct table_type *table, item_type *items, int nr)	\
+	{											\
+		int i = table->nr - 1, j = nr - 1, k = table->nr + nr - 1;			\
+		if (table->nr + nr > table->allocated) {					\
+			int allocated = (table->nr + nr + 32) * 3 / 2;				\
+			item_type *array = realloc(table->array_name, allocated * sizeof(item_type)); \
+			if (!array)								\
+				exit(1);							\
+			table->array_name = array;						\
+			table->allocated = allocated;						\
+		}										\
+		/* merge from the back, so that every object is moved only once */		\
+		while (j >= 0) {								\
+			if (i >= 0 && fun(items[j], table->array_name[i])) {			\
+				table->array_name[k--] = table->array_name[i--];		\
+			} else {								\
+				added(table, items[j]);						\
+				table->array_name[k--] = items[j--];				\
+			}									\
+		}										\
+		table->nr += nr;								\
 	}
+#define MAKE_ADD_MANY(table_type, item_type, array_name, fun) \
+	MAKE_ADD_MANY_HOOKED(table_type, item_type, array_name, fun, NO_TABLE_HOOK)
 
-#define MAKE_REMOVE_FROM(table_type, array_name)						\
+#define MAKE_REMOVE_FROM_HOOKED(table_type, array_name, removed)				\
 	void remove_from_##table_type(struct table_type *table, int idx)			\
 	{											\
-		int i;										\
-		for (i = idx; i < table->nr - 1; i++)						\
-			table->array_name[i] = table->array_name[i + 1];			\
+		removed(table, table->array_name[idx]);						\
+		memmove(&table->array_name[idx], &table->array_name[idx + 1],			\
+			(table->nr - idx - 1) * sizeof(table->array_name[0]));			\
 		memset(&table->array_name[--table->nr], 0, sizeof(table->array_name[0]));	\
 	}
+#define MAKE_REMOVE_FROM(table_type, array_name) \
+	MAKE_REMOVE_FROM_HOOKED(table_type, array_name, NO_TABLE_HOOK)
+
+/* remove a number of objects from a table of pointers in a single pass.
+ * Objects that are not in the table are ignored. Like MAKE_SORT, this
+ * defines a static helper function and thus can't be made static. */
+#define MAKE_REMOVE_MANY_HOOKED(table_type, item_type, array_name, removed)			\
+	static int comp_ptr_##table_type(const void *_a, const void *_b)			\
+	{											\
+		uintptr_t a = (uintptr_t)*(const item_type *)_a;				\
+		uintptr_t b = (uintptr_t)*(const item_type *)_b;				\
+		return a < b ? -1 : a > b ? 1 : 0;						\
+	}											\
+												\
+	void remove_many_from_##table_type(struct table_type *table, item_type *items, int nr)	\
+	{											\
+		int i, j = 0;									\
+		item_type *sorted;								\
+		if (nr <= 0)									\
+			return;									\
+		sorted = malloc(nr * sizeof(item_type));					\
+		if (!sorted)									\
+			exit(1);								\
+		memcpy(sorted, items, nr * sizeof(item_type));					\
+		qsort(sorted, nr, sizeof(item_type), comp_ptr_##table_type);			\
+		for (i = 0; i < table->nr; i++) {						\
+			item_type item = table->array_name[i];					\
+			if (bsearch(&item, sorted, nr, sizeof(item_type), comp_ptr_##table_type)) { \
+				removed(table, item);						\
+				continue;							\
+			}									\
+			table->array_name[j++] = item;						\
+		}										\
+		memset(&table->array_name[j], 0, (table->nr - j) * sizeof(item_type));	\
+		table->nr = j;									\
+		free(sorted);									\
+	}
+#define MAKE_REMOVE_MANY(table_type, item_type, array_name) \
+	MAKE_REMOVE_MANY_HOOKED(table_type, item_type, array_name, NO_TABLE_HOOK)
 
 #define MAKE_GET_IDX(table_type, item_type, array_name)						\
 	int get_idx_in_##table_type(const struct table_type *table, const item_type item)	\
@@ -91,23 +171,33 @@
 		return idx;							\
 	}
 
-#define MAKE_CLEAR_TABLE(table_type, array_name, item_name)			\
+#define MAKE_CLEAR_TABLE_HOOKED(table_type, array_name, item_name, removed)	\
 	void clear_##table_type(struct table_type *table)			\
 	{									\
-		for (int i = 0; i < table->nr; i++)				\
+		for (int i = 0; i < table->nr; i++) {				\
+			removed(table, table->array_name[i]);			\
 			free_##item_name(table->array_name[i]);			\
+		}								\
 		table->nr = 0;							\
 	}
+#define MAKE_CLEAR_TABLE(table_type, array_name, item_name) \
+	MAKE_CLEAR_TABLE_HOOKED(table_type, array_name, item_name, NO_TABLE_HOOK)
 
 /* Move data of one table to the other - source table is empty after call. */
-#define MAKE_MOVE_TABLE(table_type, array_name)					\
+#define MAKE_MOVE_TABLE_HOOKED(table_type, array_name, added, removed)		\
 	void move_##table_type(struct table_type *src, struct table_type *dst)	\
 	{									\
 		clear_##table_type(dst);					\
 		free(dst->array_name);						\
+		for (int i = 0; i < src->nr; i++) {				\
+			removed(src, src->array_name[i]);			\
+			added(dst, src->array_name[i]);				\
+		}								\
 		*dst = *src;							\
 		src->nr = src->allocated = 0;					\
 		src->array_name = NULL;						\
 	}
+#define MAKE_MOVE_TABLE(table_type, array_name) \
+	MAKE_MOVE_TABLE_HOOKED(table_type, array_name, NO_TABLE_HOOK, NO_TABLE_HOOK)
 
 #endif
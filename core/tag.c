@@ -182,6 +182,41 @@ void taglist_init_global()
 		taglist_add_tag(&g_tag_list, default_tags[i]);
 }
 
+struct tag_entry *taglist_save_global()
+{
+	struct tag_entry *res = NULL, **tail = &res;
+
+	for (struct tag_entry *entry = g_tag_list; entry; entry = entry->next) {
+		*tail = malloc(sizeof(struct tag_entry));
+		if (!*tail)
+			break;
+		(*tail)->tag = entry->tag;
+		tail = &(*tail)->next;
+	}
+	*tail = NULL;
+	return res;
+}
+
+/* Both lists are sorted and the saved list is a subset of the global list */
+void taglist_restore_global(struct tag_entry *saved)
+{
+	struct tag_entry **entry = &g_tag_list;
+	struct tag_entry *old = saved;
+
+	while (*entry) {
+		struct tag_entry *cur = *entry;
+		if (old && old->tag == cur->tag) {
+			old = old->next;
+			entry = &cur->next;
+			continue;
+		}
+		*entry = cur->next;
+		taglist_free_divetag(cur->tag);
+		free(cur);
+	}
+	taglist_free(saved);
+}
+
 bool taglist_contains(struct tag_entry *tag_list, const char *tag)
 {
 	while (tag_list) {
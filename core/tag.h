@@ -50,6 +50,14 @@ char *taglist_get_tagstring(struct tag_entry *tag_list);
 void taglist_cleanup(struct tag_entry **tag_list);
 
 void taglist_init_global();
+
+/*
+ * Remember the divetags of the global list, so that the ones that were
+ * added by a parse that is thrown away can be removed again. The divetags
+ * must not be referenced by any dive anymore when restoring the list.
+ */
+struct tag_entry *taglist_save_global();
+void taglist_restore_global(struct tag_entry *saved);
 void taglist_free(struct tag_entry *tag_list);
 struct tag_entry *taglist_copy(struct tag_entry *s);
 bool taglist_contains(struct tag_entry *tag_list, const char *tag);
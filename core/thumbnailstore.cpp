@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "thumbnailstore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QtEndian>
+
+// The format of the data file:
+//	char[8]	"SSRFTHM1"
+//	for each thumbnail:
+//		uint32	record magic
+//		char[20]	SHA1 of the picture filename
+//		int64	time the thumbnail was written in msec since the epoch
+//		uint32	size of the thumbnail data
+//		char[]	thumbnail data
+// All numbers are little endian.
+static const char dataMagic[8] = { 'S', 'S', 'R', 'F', 'T', 'H', 'M', '1' };
+static const quint32 recordMagic = 0x52485453; // "STHR"
+static const int keySize = 20;
+static const int recordHeaderSize = 4 + keySize + 8 + 4;
+static const quint32 indexVersion = 1;
+
+// Compact the data file when the garbage exceeds the live data and this size
+static const qint64 compactionThreshold = 4 * 1024 * 1024;
+
+static QByteArray hashFilename(const QString &filename)
+{
+	return QCryptographicHash::hash(filename.toUtf8(), QCryptographicHash::Sha1);
+}
+
+ThumbnailStore::ThumbnailStore(const QString &dir) : dataFile(dir + "thumbnails.dat"),
+	indexFilename(dir + "thumbnails.idx"),
+	map(nullptr),
+	mapSize(0),
+	garbage(0),
+	indexDirty(false)
+{
+	QMutexLocker l(&lock);
+	open();
+	l.unlock();
+	if (garbage > compactionThreshold && garbage > mapSize - garbage)
+		compact();
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+	QMutexLocker l(&lock);
+	if (indexDirty)
+		saveIndexLocked();
+	if (map)
+		dataFile.unmap(map);
+	dataFile.close();
+}
+
+// Open the data file and build the index. The lock must be held.
+void ThumbnailStore::open()
+{
+	index.clear();
+	garbage = 0;
+	indexDirty = false;
+	if (!dataFile.open(QIODevice::ReadWrite)) {
+		qWarning("Can't open thumbnail store %s", qPrintable(dataFile.fileName()));
+		return;
+	}
+
+	char magic[sizeof(dataMagic)];
+	if (dataFile.read(magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, dataMagic, sizeof(magic)) != 0) {
+		// New or unknown file: start from scratch
+		if (!dataFile.resize(0) || dataFile.write(dataMagic, sizeof(dataMagic)) != sizeof(dataMagic)) {
+			qWarning("Can't initialize thumbnail store %s", qPrintable(dataFile.fileName()));
+			dataFile.close();
+			return;
+		}
+		dataFile.flush();
+		indexDirty = true;
+	}
+
+	remap();
+	qint64 pos = loadIndex(mapSize);
+	if (pos < mapSize)
+		scan(pos);
+
+	qint64 live = sizeof(dataMagic);
+	for (const IndexEntry &entry: index)
+		live += recordHeaderSize + entry.size;
+	garbage = mapSize - live;
+}
+
+// Read the index file. Returns the size of the data file that is covered by the
+// index. If the index file is missing or broken, the index is cleared and the
+// position after the file header is returned.
+qint64 ThumbnailStore::loadIndex(qint64 dataSize)
+{
+	QFile file(indexFilename);
+	if (file.open(QIODevice::ReadOnly)) {
+		QDataStream stream(&file);
+		quint32 version, count;
+		quint64 covered;
+		stream >> version >> covered >> count;
+		if (stream.status() == QDataStream::Ok && version == indexVersion &&
+		    covered >= sizeof(dataMagic) && covered <= (quint64)dataSize) {
+			index.reserve(count);
+			quint32 i;
+			for (i = 0; i < count; ++i) {
+				QByteArray key;
+				IndexEntry entry;
+				stream >> key >> entry.offset >> entry.size >> entry.mtime;
+				if (stream.status() != QDataStream::Ok || key.size() != keySize ||
+				    entry.offset < sizeof(dataMagic) + recordHeaderSize || entry.offset + entry.size > covered)
+					break;
+				index.insert(key, entry);
+			}
+			if (i == count)
+				return (qint64)covered;
+		}
+		qWarning("Ignoring broken thumbnail index %s", qPrintable(indexFilename));
+	}
+	index.clear();
+	indexDirty = true;
+	return sizeof(dataMagic);
+}
+
+// Add the records starting at the given position to the index. An incomplete
+// or broken record at the end of the file (e.g. after a crash) is cut off.
+void ThumbnailStore::scan(qint64 pos)
+{
+	if (!map)
+		return;
+	while (pos + recordHeaderSize <= mapSize) {
+		const uchar *p = map + pos;
+		if (qFromLittleEndian<quint32>(p) != recordMagic)
+			break;
+		QByteArray key((const char *)p + 4, keySize);
+		qint64 mtime = qFromLittleEndian<qint64>(p + 4 + keySize);
+		quint32 size = qFromLittleEndian<quint32>(p + 4 + keySize + 8);
+		if (pos + recordHeaderSize + size > mapSize)
+			break;
+		index.insert(key, { (quint64)(pos + recordHeaderSize), size, mtime });
+		pos += recordHeaderSize + size;
+	}
+	if (pos < mapSize) {
+		qWarning("Truncating broken thumbnail store %s", qPrintable(dataFile.fileName()));
+		dataFile.unmap(map);
+		map = nullptr;
+		dataFile.resize(pos);
+		remap();
+	}
+	indexDirty = true;
+}
+
+// Map the whole data file into memory. Called when the data file has grown.
+void ThumbnailStore::remap()
+{
+	if (map)
+		dataFile.unmap(map);
+	mapSize = dataFile.size();
+	map = mapSize > 0 ? dataFile.map(0, mapSize) : nullptr;
+	if (!map)
+		mapSize = 0;
+}
+
+// Read a thumbnail. The lock must be held.
+ThumbnailStore::Entry ThumbnailStore::read(const IndexEntry &entry)
+{
+	if (entry.offset + entry.size > (quint64)mapSize)
+		remap();
+	if (!map || entry.offset + entry.size > (quint64)mapSize)
+		return { QByteArray(), 0 };
+	return { QByteArray((const char *)map + entry.offset, entry.size), entry.mtime };
+}
+
+ThumbnailStore::Entry ThumbnailStore::get(const QString &filename)
+{
+	QByteArray key = hashFilename(filename);
+	QMutexLocker l(&lock);
+	auto it = index.find(key);
+	return it != index.end() ? read(*it) : Entry { QByteArray(), 0 };
+}
+
+QVector<ThumbnailStore::Entry> ThumbnailStore::getMany(const QVector<QString> &filenames)
+{
+	QVector<QByteArray> keys;
+	keys.reserve(filenames.size());
+	for (const QString &filename: filenames)
+		keys.push_back(hashFilename(filename));
+
+	QVector<Entry> res(filenames.size(), Entry { QByteArray(), 0 });
+	QMutexLocker l(&lock);
+	std::vector<std::pair<IndexEntry, int>> found;
+	found.reserve(keys.size());
+	for (int i = 0; i < keys.size(); ++i) {
+		auto it = index.find(keys[i]);
+		if (it != index.end())
+			found.push_back({ *it, i });
+	}
+	std::sort(found.begin(), found.end(),
+		  [](const std::pair<IndexEntry, int> &e1, const std::pair<IndexEntry, int> &e2)
+		  { return e1.first.offset < e2.first.offset; });
+	for (const auto &[entry, idx]: found)
+		res[idx] = read(entry);
+	return res;
+}
+
+void ThumbnailStore::put(const QString &filename, const QByteArray &data, qint64 mtime)
+{
+	QByteArray key = hashFilename(filename);
+	uchar header[recordHeaderSize];
+	qToLittleEndian<quint32>(recordMagic, header);
+	memcpy(header + 4, key.constData(), keySize);
+	qToLittleEndian<qint64>(mtime, header + 4 + keySize);
+	qToLittleEndian<quint32>((quint32)data.size(), header + 4 + keySize + 8);
+
+	QMutexLocker l(&lock);
+	if (!dataFile.isOpen())
+		return;
+	qint64 pos = dataFile.size();
+	if (!dataFile.seek(pos) ||
+	    dataFile.write((const char *)header, recordHeaderSize) != recordHeaderSize ||
+	    dataFile.write(data) != data.size() ||
+	    !dataFile.flush()) {
+		// Don't leave a partial record behind
+		dataFile.resize(pos);
+		return;
+	}
+
+	auto it = index.find(key);
+	if (it != index.end())
+		garbage += recordHeaderSize + it->size;
+	index.insert(key, { (quint64)(pos + recordHeaderSize), (quint32)data.size(), mtime });
+	indexDirty = true;
+}
+
+// Write the live thumbnails into a new data file, keeping their order, and
+// replace the old data file. The index is rebuilt from the new data file.
+void ThumbnailStore::compact()
+{
+	QMutexLocker l(&lock);
+	if (!map)
+		return;
+
+	std::vector<IndexEntry> entries;
+	entries.reserve(index.size());
+	for (const IndexEntry &entry: index)
+		entries.push_back(entry);
+	std::sort(entries.begin(), entries.end(),
+		  [](const IndexEntry &e1, const IndexEntry &e2) { return e1.offset < e2.offset; });
+
+	QString filename = dataFile.fileName();
+	QFile out(filename + ".new");
+	if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return;
+	bool ok = out.write(dataMagic, sizeof(dataMagic)) == sizeof(dataMagic);
+	for (const IndexEntry &entry: entries) {
+		if (!ok)
+			break;
+		qint64 size = recordHeaderSize + entry.size;
+		ok = out.write((const char *)map + entry.offset - recordHeaderSize, size) == size;
+	}
+	out.close();
+	if (!ok) {
+		out.remove();
+		return;
+	}
+
+	// The old index doesn't describe the new data file. Remove it before replacing
+	// the data file, so that a crash can't leave us with a mismatched index.
+	dataFile.unmap(map);
+	map = nullptr;
+	dataFile.close();
+	QFile::remove(indexFilename);
+	if (!QFile::remove(filename) || !QFile::rename(out.fileName(), filename))
+		qWarning("Can't replace thumbnail store %s", qPrintable(filename));
+	open();
+	saveIndexLocked();
+}
+
+void ThumbnailStore::saveIndex()
+{
+	QMutexLocker l(&lock);
+	saveIndexLocked();
+}
+
+// The format of the index file (QDataStream):
+//	uint32	version
+//	uint64	size of the data file covered by the index
+//	uint32	number of entries
+//	for each entry:
+//		QByteArray	SHA1 of the picture filename
+//		uint64	offset of the thumbnail data
+//		uint32	size of the thumbnail data
+//		int64	time the thumbnail was written
+void ThumbnailStore::saveIndexLocked()
+{
+	if (!dataFile.isOpen())
+		return;
+	QSaveFile file(indexFilename);
+	if (!file.open(QIODevice::WriteOnly))
+		return;
+	QDataStream stream(&file);
+	stream << indexVersion << (quint64)dataFile.size() << (quint32)index.size();
+	for (auto it = index.begin(); it != index.end(); ++it)
+		stream << it.key() << it->offset << it->size << it->mtime;
+	if (file.commit())
+		indexDirty = false;
+}
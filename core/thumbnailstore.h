@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: GPL-2.0
+// A packed store of thumbnails. All thumbnails are appended to a single data
+// file, which is memory-mapped for reading. The thumbnails are identified by
+// the SHA1-hash of the picture filename. An index of the positions of the
+// thumbnails is kept in memory and saved to an index file. Should the index
+// file be outdated, e.g. after a crash, the records after the indexed part of
+// the data file are read back in.
+//
+// Replacing a thumbnail leaves the old record in the data file as garbage.
+// The garbage is removed by compaction, which rewrites the data file.
+#ifndef THUMBNAILSTORE_H
+#define THUMBNAILSTORE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+class ThumbnailStore {
+public:
+	struct Entry {
+		QByteArray data;	// Empty if there is no thumbnail for that picture
+		qint64 mtime;		// When the thumbnail was written, in msec since the epoch
+	};
+
+	ThumbnailStore(const QString &dir);
+	~ThumbnailStore();
+	Entry get(const QString &filename);
+	// Fetch the thumbnails of multiple pictures. The thumbnails are read in the order
+	// in which they are stored in the data file. The entries are returned in the
+	// order of the filenames.
+	QVector<Entry> getMany(const QVector<QString> &filenames);
+	void put(const QString &filename, const QByteArray &data, qint64 mtime);
+	void compact();		// Remove replaced thumbnails from the data file
+	void saveIndex();
+private:
+	struct IndexEntry {
+		quint64 offset;	// Position of the thumbnail data (not the record header) in the data file
+		quint32 size;
+		qint64 mtime;
+	};
+
+	void open();
+	qint64 loadIndex(qint64 dataSize);
+	void scan(qint64 pos);
+	void remap();
+	void saveIndexLocked();
+	Entry read(const IndexEntry &entry);
+
+	QMutex lock;
+	QFile dataFile;
+	QString indexFilename;
+	uchar *map;		// Memory-mapped data file
+	qint64 mapSize;
+	qint64 garbage;		// Number of bytes of replaced thumbnails in the data file
+	bool indexDirty;
+	QHash<QByteArray, IndexEntry> index;
+};
+
+#endif
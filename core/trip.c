@@ -2,6 +2,8 @@
 
 #include "trip.h"
 #include "dive.h"
+#include "fulltext.h"
+#include "idindex.h"
 #include "subsurface-time.h"
 #include "subsurface-string.h"
 #include "selection.h"
@@ -38,6 +40,7 @@ void dump_trip_list(void)
 void free_trip(dive_trip_t *trip)
 {
 	if (trip) {
+		fulltext_unregister_trip(trip);
 		free(trip->location);
 		free(trip->notes);
 		free(trip->dives.dives);
@@ -45,15 +48,29 @@ void free_trip(dive_trip_t *trip)
 	}
 }
 
+/* Keep the id index of the global trip table up to date */
+static void trip_table_added(struct trip_table *table, struct dive_trip *trip)
+{
+	if (table == &trip_table)
+		id_index_add(ID_INDEX_TRIP, trip->id, trip);
+}
+
+static void trip_table_removed(struct trip_table *table, struct dive_trip *trip)
+{
+	if (table == &trip_table)
+		id_index_remove(ID_INDEX_TRIP, trip->id, trip);
+}
+
 /* Trip table functions */
 static MAKE_GET_IDX(trip_table, struct dive_trip *, trips)
 static MAKE_GROW_TABLE(trip_table, struct dive_trip *, trips)
 static MAKE_GET_INSERTION_INDEX(trip_table, struct dive_trip *, trips, trip_less_than)
-static MAKE_ADD_TO(trip_table, struct dive_trip *, trips)
-static MAKE_REMOVE_FROM(trip_table, trips)
+static MAKE_ADD_TO_HOOKED(trip_table, struct dive_trip *, trips, trip_table_added)
+static MAKE_REMOVE_FROM_HOOKED(trip_table, trips, trip_table_removed)
 MAKE_SORT(trip_table, struct dive_trip *, trips, comp_trips)
 MAKE_REMOVE(trip_table, struct dive_trip *, trip)
-MAKE_CLEAR_TABLE(trip_table, trips, trip)
+MAKE_CLEAR_TABLE_HOOKED(trip_table, trips, trip, trip_table_removed)
+MAKE_MOVE_TABLE_HOOKED(trip_table, trips, trip_table_added, trip_table_removed)
 
 timestamp_t trip_date(const struct dive_trip *trip)
 {
@@ -203,11 +220,7 @@ dive_trip_t *get_trip_for_new_dive(struct dive *new_dive, bool *allocated)
 /* lookup of trip in main trip_table based on its id */
 dive_trip_t *get_trip_by_uniq_id(int tripId)
 {
-	for (int i = 0; i < trip_table.nr; i++) {
-		if (trip_table.trips[i]->id == tripId)
-			return trip_table.trips[i];
-	}
-	return NULL;
+	return id_index_get(ID_INDEX_TRIP, tripId);
 }
 
 /* Check if two trips overlap time-wise up to trip threshold. */
@@ -276,8 +289,11 @@ dive_trip_t *get_dives_to_autogroup(struct dive_table *table, int start, int *fr
 			if (dive->divetrip || dive->notrip ||
 			    dive->when >= lastdive->when + TRIP_THRESHOLD)
 				break;
-			if (get_dive_location(dive) && !trip->location)
+			if (get_dive_location(dive) && !trip->location) {
 				trip->location = copy_string(get_dive_location(dive));
+				if (trip->full_text)
+					fulltext_register_trip(trip); // Update the fulltext cache
+			}
 			lastdive = dive;
 		}
 		return trip;
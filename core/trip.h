@@ -18,6 +18,7 @@ typedef struct dive_trip
 	bool saved;
 	bool autogen;
 	bool selected;
+	struct full_text_cache *full_text; /* word cache for full text search */
 } dive_trip_t;
 
 typedef struct trip_table {
@@ -58,6 +59,7 @@ extern bool trip_is_single_day(const struct dive_trip *trip);
 extern int trip_shown_dives(const struct dive_trip *trip);
 
 void clear_trip_table(struct trip_table *table);
+void move_trip_table(struct trip_table *src, struct trip_table *dst);
 
 #ifdef DEBUG_TRIP
 extern void dump_trip_list(void);
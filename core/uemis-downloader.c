@@ -29,6 +29,7 @@
 #include "errorhelper.h"
 #include "file.h"
 #include "tag.h"
+#include "stringpool.h"
 #include "subsurface-time.h"
 #include "core/subsurface-string.h"
 
@@ -203,7 +204,7 @@ static void uemis_get_weight(char *buffer, weightsystem_t *weight, int diveid)
 static struct dive *uemis_start_dive(uint32_t deviceid)
 {
 	struct dive *dive = alloc_dive();
-	dive->dc.model = strdup("Uemis Zurich");
+	dive->dc.model = intern_string("Uemis Zurich");
 	dive->dc.deviceid = deviceid;
 	return dive;
 }
@@ -15,6 +15,7 @@
 #include "uemis.h"
 #include "divesite.h"
 #include "sample.h"
+#include "stringpool.h"
 #include <libdivecomputer/parser.h>
 #include <libdivecomputer/version.h>
 
@@ -175,7 +176,8 @@ void uemis_set_divelocation(int divespot, char *text, double longitude, double l
 			struct dive_site *ds = hp->dive_site;
 			if (ds) {
 				ds->name = strdup(text);
-				ds->location = create_location(latitude, longitude);
+				location_t loc = create_location(latitude, longitude);
+				set_dive_site_location(ds, &loc);
 			}
 		}
 		hp = hp->next;
@@ -309,7 +311,7 @@ void uemis_parse_divelog_binary(char *base64, void *datap)
 		dive->dc.salinity = FRESHWATER_SALINITY; /* grams per 10l fresh water */
 
 	/* this will allow us to find the last dive read so far from this computer */
-	dc->model = strdup("Uemis Zurich");
+	dc->model = intern_string("Uemis Zurich");
 	dc->deviceid = *(uint32_t *)(data + 9);
 	dc->diveid = *(uint16_t *)(data + 7);
 	/* remember the weight units used in this dive - we may need this later when
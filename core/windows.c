@@ -263,6 +263,20 @@ int subsurface_rename(const char *path, const char *newpath)
 	return ret;
 }
 
+int subsurface_remove(const char *path)
+{
+	int ret = -1;
+	if (!path)
+		return ret;
+
+	wchar_t *wpath = utf8_to_utf16(path);
+
+	if (wpath)
+		ret = _wremove(wpath);
+	free((void *)wpath);
+	return ret;
+}
+
 // if the QDir based rename fails, we try this one
 int subsurface_dir_rename(const char *path, const char *newpath)
 {
@@ -588,7 +588,7 @@ void PlannerWidgets::replanDive()
 void PlannerWidgets::printDecoPlan()
 {
 #ifndef NO_PRINTING
-	char *disclaimer = get_planner_disclaimer_formatted();
+	char *disclaimer = get_planner_disclaimer_formatted(DivePlannerPointsModel::instance()->final_deco_state.config.deco_mode);
 	// Prepend a logo and a disclaimer to the plan.
 	// Save the old plan so that it can be restored at the end of the function.
 	QString origPlan = plannerDetails.divePlanOutput()->toHtml();
@@ -26,6 +26,7 @@
 #include "core/import-csv.h"
 #include "core/planner.h"
 #include "core/qthelper.h"
+#include "core/stringpool.h"
 #include "core/subsurface-string.h"
 #include "core/trip.h"
 #include "core/version.h"
@@ -782,7 +783,7 @@ void MainWindow::on_actionAddDive_triggered()
 	d.dc.duration.seconds = 40 * 60;
 	d.dc.maxdepth.mm = M_OR_FT(15, 45);
 	d.dc.meandepth.mm = M_OR_FT(13, 39); // this creates a resonable looking safety stop
-	d.dc.model = strdup("manually added dive"); // don't translate! this is stored in the XML file
+	d.dc.model = intern_string("manually added dive"); // don't translate! this is stored in the XML file
 	fake_dc(&d.dc);
 	fixup_dive(&d);
 
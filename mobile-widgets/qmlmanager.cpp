@@ -31,6 +31,7 @@
 #include "core/divefilter.h"
 #include "core/filterconstraint.h"
 #include "core/qthelper.h"
+#include "core/stringpool.h"
 #include "core/qt-gui.h"
 #include "core/git-access.h"
 #include "core/cloudstorage.h"
@@ -738,14 +739,21 @@ void QMLManager::loadDivesWithValidCredentials()
 	} else {
 		appendTextToLog("Cloud sync brought newer data, reloading the dive list");
 		setDiveListProcessing(true);
-		// if we aren't switching from no-cloud mode, let's clear the dive data
-		if (!noCloudToCloud) {
+		// if we aren't switching from no-cloud mode, the dives that didn't
+		// change in the repository are kept and the others are reloaded
+		bool reload = !noCloudToCloud && git != dummy_git_repository;
+		if (reload) {
+			appendTextToLog("Reload changed dives of in memory dive data");
+		} else if (!noCloudToCloud) {
 			appendTextToLog("Clear out in memory dive data");
 			clear_dive_file_data();
 		} else {
 			appendTextToLog("Switching from no cloud mode; keep in memory dive data");
 		}
-		if (git != dummy_git_repository) {
+		if (reload) {
+			appendTextToLog(QString("have repository and branch %1").arg(branch));
+			error = reload_git_dive_file_data(git, branch, &filter_preset_table);
+		} else if (git != dummy_git_repository) {
 			appendTextToLog(QString("have repository and branch %1").arg(branch));
 			error = git_load_dives(git, branch, &dive_table, &trip_table, &dive_site_table, &device_table, &filter_preset_table);
 		} else {
@@ -1209,7 +1217,7 @@ void QMLManager::commitChanges(QString diveId, QString number, QString date, QSt
 					break;
 				}
 			}
-			get_or_create_cylinder(d, j)->type.description = copy_qstring(usedCylinder[k]);
+			get_or_create_cylinder(d, j)->type.description = intern_qstring(usedCylinder[k]);
 			get_cylinder(d, j)->type.size.mliter = size;
 			get_cylinder(d, j)->type.workingpressure.mbar = wp;
 			k++;
@@ -1622,7 +1630,7 @@ int QMLManager::addDive()
 	d.dc.duration.seconds = 40 * 60;
 	d.dc.maxdepth.mm = M_OR_FT(15, 45);
 	d.dc.meandepth.mm = M_OR_FT(13, 39); // this creates a resonable looking safety stop
-	d.dc.model = strdup("manually added dive"); // don't translate! this is stored in the XML file
+	d.dc.model = intern_string("manually added dive"); // don't translate! this is stored in the XML file
 	fake_dc(&d.dc);
 	fixup_dive(&d);
 
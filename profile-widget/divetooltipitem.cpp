@@ -254,13 +254,15 @@ void ToolTipItem::refresh(const dive *d, const QPointF &pos)
 
 		const struct plot_data *entry = &pInfo.entry[idx];
 		painter.setPen(QColor(0, 0, 0, 255));
-		if (decoMode() == BUEHLMANN)
+		if (pInfo.deco_mode == BUEHLMANN)
 			painter.drawLine(0, lrint(60 - entry->gfline / 2), 16, lrint(60 - entry->gfline / 2));
 		painter.drawLine(0, lrint(60 - AMB_PERCENTAGE * (entry->pressures.n2 + entry->pressures.he) / entry->ambpressure / 2),
 				16, lrint(60 - AMB_PERCENTAGE * (entry->pressures.n2 + entry->pressures.he) / entry->ambpressure /2));
 		painter.setPen(QColor(0, 0, 0, 127));
-		for (int i=0; i<16; i++) {
-			painter.drawLine(i, 60, i, 60 - entry->percentages[i] / 2);
+		if (const struct plot_tissue_data *tissues = get_plot_tissues(&pInfo, idx)) {
+			for (int i=0; i<16; i++) {
+				painter.drawLine(i, 60, i, 60 - tissues->percentages[i] / 2);
+			}
 		}
 		entryToolTip.second->setText(QString::fromUtf8(mb.buffer, mb.len));
 	}
@@ -543,7 +543,10 @@ void ProfileWidget2::plotDive(const struct dive *d, bool force, bool doClearPict
 		// this copies the dive and makes copies of all the relevant additional data
 		copy_dive(d, &displayed_dive);
 
-		if (decoMode() == VPMB)
+		// the same settings as used by create_plot_info_new() below
+		struct deco_config config;
+		init_deco_config(&config, in_planner());
+		if (config.deco_mode == VPMB)
 			decoModelParameters->setText(QString("VPM-B +%1").arg(prefs.vpmb_conservatism));
 		else
 			decoModelParameters->setText(QString("GF %1/%2").arg(prefs.gflow).arg(prefs.gfhigh));
@@ -556,7 +559,7 @@ void ProfileWidget2::plotDive(const struct dive *d, bool force, bool doClearPict
 			plannerModel->deleteTemporaryPlan();
 			return;
 		}
-		if (decoMode() == VPMB)
+		if (plannerModel->final_deco_state.config.deco_mode == VPMB)
 			decoModelParameters->setText(QString("VPM-B +%1").arg(diveplan.vpmb_conservatism));
 		else
 			decoModelParameters->setText(QString("GF %1/%2").arg(diveplan.gflow).arg(diveplan.gfhigh));
@@ -1413,10 +1416,7 @@ void ProfileWidget2::contextMenuEvent(QContextMenuEvent *event)
 	m.addAction(tr("Add setpoint change"), [this, seconds]() { ProfileWidget2::addSetpointChange(seconds); });
 	m.addAction(tr("Add bookmark"), [this, seconds]() { addBookmark(seconds); });
 	m.addAction(tr("Split dive into two"), [this, seconds]() { splitDive(seconds); });
-	const struct event *ev = NULL;
-	enum divemode_t divemode = UNDEF_COMP_TYPE;
-
-	get_current_divemode(current_dc, seconds, &ev, &divemode);
+	enum divemode_t divemode = get_divemode_at_time(current_dc, seconds);
 	QMenu *changeMode = m.addMenu(tr("Change divemode"));
 	if (divemode != OC)
 		changeMode->addAction(gettextFromC::tr(divemode_text_ui[OC]),
@@ -319,8 +319,7 @@ bool CylindersModel::setData(const QModelIndex &index, const QVariant &value, in
 		case TYPE: {
 			QString type = value.toString();
 			if (!same_string(qPrintable(type), tempCyl.type.description)) {
-				free((void *)tempCyl.type.description);
-				tempCyl.type.description = strdup(qPrintable(type));
+				tempCyl.type.description = intern_qstring(type);
 				dataChanged(index, index);
 			}
 			return true;
@@ -76,8 +76,13 @@ void DivePictureModel::updateZoom()
 void DivePictureModel::updateThumbnails()
 {
 	updateZoom();
+	QVector<QString> filenames;
+	filenames.reserve(pictures.size());
+	for (const PictureEntry &entry: pictures)
+		filenames.push_back(QString::fromStdString(entry.filename));
+	QImage placeholder = Thumbnailer::instance()->fetchThumbnails(filenames);
 	for (PictureEntry &entry: pictures)
-		entry.image = Thumbnailer::instance()->fetchThumbnail(QString::fromStdString(entry.filename), false);
+		entry.image = placeholder;
 }
 
 void DivePictureModel::updateDivePictures()
@@ -8,6 +8,7 @@
 #include "core/device.h"
 #include "core/qthelper.h"
 #include "core/sample.h"
+#include "core/stringpool.h"
 #include "core/settings/qPrefDivePlanner.h"
 #include "core/settings/qPrefUnit.h"
 #if !defined(SUBSURFACE_TESTING)
@@ -51,7 +52,7 @@ void DivePlannerPointsModel::createSimpleDive()
 	clear_dive(&displayed_dive);
 	displayed_dive.id = dive_getUniqID();
 	displayed_dive.when = QDateTime::currentMSecsSinceEpoch() / 1000L + gettimezoneoffset() + 3600;
-	displayed_dive.dc.model = strdup("planned dive"); // don't translate! this is stored in the XML file
+	displayed_dive.dc.model = intern_string("planned dive"); // don't translate! this is stored in the XML file
 
 	clear();
 	setupCylinders();
@@ -195,7 +196,7 @@ void DivePlannerPointsModel::setupCylinders()
 	} else {
 		cylinder_t cyl = empty_cylinder;
 		// roughly an AL80
-		cyl.type.description = copy_qstring(tr("unknown"));
+		cyl.type.description = intern_qstring(tr("unknown"));
 		cyl.type.size.mliter = 11100;
 		cyl.type.workingpressure.mbar = 207000;
 		add_cylinder(&displayed_dive.cylinders, 0, cyl);
@@ -236,11 +237,10 @@ void DivePlannerPointsModel::addCylinder_clicked()
 void DivePlannerPointsModel::setPlanMode(Mode m)
 {
 	mode = m;
-	// the planner may reset our GF settings that are used to show deco
-	// reset them to what's in the preferences
-	if (m != PLAN) {
-		set_gf(prefs.gflow, prefs.gfhigh);
-		set_vpmb_conservatism(prefs.vpmb_conservatism);
+	// until a plan was calculated, show the planned dive with the settings of the preferences
+	if (m == PLAN) {
+		memset(&final_deco_state, 0, sizeof(final_deco_state));
+		init_deco_config(&final_deco_state.config, true);
 	}
 }
 
@@ -1003,8 +1003,11 @@ void DivePlannerPointsModel::createTemporaryPlan()
 		struct deco_state plan_deco_state;
 		struct diveplan *plan_copy;
 
+		struct deco_config config;
+
+		init_deco_config(&config, in_planner());
 		memset(&plan_deco_state, 0, sizeof(struct deco_state));
-		plan(&plan_deco_state, &diveplan, &displayed_dive, DECOTIMESTEP, stoptable, &cache, isPlanner(), false);
+		plan(&plan_deco_state, &diveplan, &displayed_dive, &config, DECOTIMESTEP, stoptable, &cache, isPlanner(), false);
 		plan_copy = (struct diveplan *)malloc(sizeof(struct diveplan));
 		lock_planner();
 		cloneDiveplan(&diveplan, plan_copy);
@@ -1117,8 +1120,11 @@ void DivePlannerPointsModel::computeVariations(struct diveplan *original_plan, c
 	struct diveplan plan_copy;
 	struct divedatapoint *last_segment;
 	struct deco_state ds = *previous_ds;
+	// This may run in a worker thread. Therefore, don't access the preferences
+	// but take the settings of the deco model from the original plan.
+	struct deco_config config = previous_ds->config;
 
-	if (isPlanner() && prefs.display_variations && decoMode() != RECREATIONAL) {
+	if (isPlanner() && prefs.display_variations && ds.config.deco_mode != RECREATIONAL) {
 		int my_instance = ++instanceCounter;
 		cache_deco_state(&ds, &save);
 
@@ -1140,7 +1146,7 @@ void DivePlannerPointsModel::computeVariations(struct diveplan *original_plan, c
 			goto finish;
 		if (my_instance != instanceCounter)
 			goto finish;
-		plan(&ds, &plan_copy, dive, 1, original, &cache, true, false);
+		plan(&ds, &plan_copy, dive, &config, 1, original, &cache, true, false);
 		free_dps(&plan_copy);
 		restore_deco_state(save, &ds, false);
 
@@ -1149,7 +1155,7 @@ void DivePlannerPointsModel::computeVariations(struct diveplan *original_plan, c
 		last_segment->next->depth.mm += delta_depth.mm;
 		if (my_instance != instanceCounter)
 			goto finish;
-		plan(&ds, &plan_copy, dive, 1, deeper, &cache, true, false);
+		plan(&ds, &plan_copy, dive, &config, 1, deeper, &cache, true, false);
 		free_dps(&plan_copy);
 		restore_deco_state(save, &ds, false);
 
@@ -1158,7 +1164,7 @@ void DivePlannerPointsModel::computeVariations(struct diveplan *original_plan, c
 		last_segment->next->depth.mm -= delta_depth.mm;
 		if (my_instance != instanceCounter)
 			goto finish;
-		plan(&ds, &plan_copy, dive, 1, shallower, &cache, true, false);
+		plan(&ds, &plan_copy, dive, &config, 1, shallower, &cache, true, false);
 		free_dps(&plan_copy);
 		restore_deco_state(save, &ds, false);
 
@@ -1166,7 +1172,7 @@ void DivePlannerPointsModel::computeVariations(struct diveplan *original_plan, c
 		last_segment->next->time += delta_time.seconds;
 		if (my_instance != instanceCounter)
 			goto finish;
-		plan(&ds, &plan_copy, dive, 1, longer, &cache, true, false);
+		plan(&ds, &plan_copy, dive, &config, 1, longer, &cache, true, false);
 		free_dps(&plan_copy);
 		restore_deco_state(save, &ds, false);
 
@@ -1174,7 +1180,7 @@ void DivePlannerPointsModel::computeVariations(struct diveplan *original_plan, c
 		last_segment->next->time -= delta_time.seconds;
 		if (my_instance != instanceCounter)
 			goto finish;
-		plan(&ds, &plan_copy, dive, 1, shorter, &cache, true, false);
+		plan(&ds, &plan_copy, dive, &config, 1, shorter, &cache, true, false);
 		free_dps(&plan_copy);
 		restore_deco_state(save, &ds, false);
 
@@ -1217,7 +1223,9 @@ void DivePlannerPointsModel::createPlan(bool replanCopy)
 
 	//TODO: C-based function here?
 	struct decostop stoptable[60];
-	plan(&ds_after_previous_dives, &diveplan, &displayed_dive, DECOTIMESTEP, stoptable, &cache, isPlanner(), true);
+	struct deco_config config;
+	init_deco_config(&config, in_planner());
+	plan(&ds_after_previous_dives, &diveplan, &displayed_dive, &config, DECOTIMESTEP, stoptable, &cache, isPlanner(), true);
 	struct diveplan *plan_copy;
 	plan_copy = (struct diveplan *)malloc(sizeof(struct diveplan));
 	lock_planner();
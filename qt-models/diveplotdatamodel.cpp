@@ -28,7 +28,7 @@ QVariant DivePlotDataModel::data(const QModelIndex &index, int role) const
 	if ((!index.isValid()) || (index.row() >= pInfo.nr) || pInfo.entry == 0)
 		return QVariant();
 
-	plot_data item = pInfo.entry[index.row()];
+	const plot_data &item = pInfo.entry[index.row()];
 	if (role == Qt::DisplayRole) {
 		switch (index.column()) {
 		case DEPTH:
@@ -78,12 +78,13 @@ QVariant DivePlotDataModel::data(const QModelIndex &index, int role) const
 		}
 	}
 
+	const plot_tissue_data *tissues = get_plot_tissues(&pInfo, index.row());
 	if (role == Qt::DisplayRole && index.column() >= TISSUE_1 && index.column() <= TISSUE_16) {
-		return item.ceilings[index.column() - TISSUE_1];
+		return tissues ? tissues->ceilings[index.column() - TISSUE_1] : 0;
 	}
 
 	if (role == Qt::DisplayRole && index.column() >= PERCENTAGE_1 && index.column() <= PERCENTAGE_16) {
-		return item.percentages[index.column() - PERCENTAGE_1];
+		return tissues ? tissues->percentages[index.column() - PERCENTAGE_1] : 0;
 	}
 
 	if (role == Qt::BackgroundRole) {
@@ -171,10 +172,7 @@ void DivePlotDataModel::clear()
 	if (rowCount() != 0) {
 		beginRemoveRows(QModelIndex(), 0, rowCount() - 1);
 		pInfo.nr = 0;
-		free(pInfo.entry);
-		free(pInfo.pressures);
-		pInfo.entry = nullptr;
-		pInfo.pressures = nullptr;
+		free_plot_info_data(&pInfo);
 		dcNr = -1;
 		endRemoveRows();
 	}
@@ -184,13 +182,7 @@ void DivePlotDataModel::setDive(const plot_info &info)
 {
 	beginResetModel();
 	dcNr = dc_number;
-	free(pInfo.entry);
-	free(pInfo.pressures);
-	pInfo = info;
-	pInfo.entry = (plot_data *)malloc(sizeof(plot_data) * pInfo.nr);
-	memcpy(pInfo.entry, info.entry, sizeof(plot_data) * pInfo.nr);
-	pInfo.pressures = (plot_pressure_data *)malloc(sizeof(plot_pressure_data) * pInfo.nr_cylinders * pInfo.nr);
-	memcpy(pInfo.pressures, info.pressures, sizeof(plot_pressure_data) * pInfo.nr_cylinders * pInfo.nr);
+	copy_plot_info(&pInfo, &info);
 	endResetModel();
 }
 
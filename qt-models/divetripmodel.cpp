@@ -505,11 +505,12 @@ Qt::ItemFlags DiveTripModelBase::flags(const QModelIndex &index) const
 }
 
 // Update visibility status of dive and return dives whose visibility changed.
+// Only does something if the filter depends on the changed fields.
 // Attention: the changed dives are removed from the original vector!
-static ShownChange updateShown(QVector<dive *> &dives)
+static ShownChange updateShown(QVector<dive *> &dives, DiveField field)
 {
 	DiveFilter *filter = DiveFilter::instance();
-	ShownChange res = filter->update(dives);
+	ShownChange res = filter->update(dives, field);
 	if (!res.newShown.empty() || !res.newHidden.empty())
 		emit diveListNotifier.numShownChanged();
 	for (dive *d: res.newHidden)
@@ -1232,24 +1233,25 @@ void DiveTripModelTree::diveSiteChanged(dive_site *ds, int field)
 {
 	if (!isInterestingDiveSiteField(field))
 		return;
-	divesChanged(getDivesForSite(ds));
+	divesChanged(getDivesForSite(ds), DiveField::DIVESITE);
 }
 
-void DiveTripModelTree::divesChanged(const QVector<dive *> &dives)
+void DiveTripModelTree::divesChanged(const QVector<dive *> &dives, DiveField field)
 {
-	processByTrip(dives, [this] (dive_trip *trip, const QVector<dive *> &divesInTrip)
-		      { divesChangedTrip(trip, divesInTrip); });
+	processByTrip(dives, [this, field] (dive_trip *trip, const QVector<dive *> &divesInTrip)
+		      { divesChangedTrip(trip, divesInTrip, field); });
 }
 
 void DiveTripModelTree::diveChanged(dive *d)
 {
-	divesChanged(QVector<dive *> { d });
+	// Cylinders and pictures are not described by DiveField.
+	divesChanged(QVector<dive *> { d }, DiveField::NONE);
 }
 
-void DiveTripModelTree::divesChangedTrip(dive_trip *trip, const QVector<dive *> &divesIn)
+void DiveTripModelTree::divesChangedTrip(dive_trip *trip, const QVector<dive *> &divesIn, DiveField field)
 {
 	QVector<dive *> dives = divesIn;
-	ShownChange shownChange = updateShown(dives);
+	ShownChange shownChange = updateShown(dives, field);
 	divesShown(trip, shownChange.newShown);
 	divesHidden(trip, shownChange.newHidden);
 
@@ -1594,15 +1596,15 @@ void DiveTripModelList::diveSiteChanged(dive_site *ds, int field)
 {
 	if (!isInterestingDiveSiteField(field))
 		return;
-	divesChanged(getDivesForSite(ds));
+	divesChanged(getDivesForSite(ds), DiveField::DIVESITE);
 }
 
-void DiveTripModelList::divesChanged(const QVector<dive *> &divesIn)
+void DiveTripModelList::divesChanged(const QVector<dive *> &divesIn, DiveField field)
 {
 	QVector<dive *> dives = divesIn;
 	std::sort(dives.begin(), dives.end(), dive_less_than);
 
-	ShownChange shownChange = updateShown(dives);
+	ShownChange shownChange = updateShown(dives, field);
 	removeDives(shownChange.newHidden);
 	addDives(shownChange.newShown);
 
@@ -1626,7 +1628,8 @@ void DiveTripModelList::divesChanged(const QVector<dive *> &divesIn)
 
 void DiveTripModelList::diveChanged(dive *d)
 {
-	divesChanged(QVector<dive *> { d });
+	// Cylinders and pictures are not described by DiveField.
+	divesChanged(QVector<dive *> { d }, DiveField::NONE);
 }
 
 void DiveTripModelList::divesTimeChanged(timestamp_t delta, const QVector<dive *> &divesIn)
@@ -110,7 +110,7 @@ public slots:
 	void divesDeleted(dive_trip *trip, bool deleteTrip, const QVector<dive *> &dives);
 	void divesMovedBetweenTrips(dive_trip *from, dive_trip *to, bool deleteFrom, bool createTo, const QVector<dive *> &dives);
 	void diveSiteChanged(dive_site *ds, int field);
-	void divesChanged(const QVector<dive *> &dives);
+	void divesChanged(const QVector<dive *> &dives, DiveField field);
 	void diveChanged(dive *d);
 	void divesTimeChanged(timestamp_t delta, const QVector<dive *> &dives);
 	void divesSelected(const QVector<dive *> &dives);
@@ -130,7 +130,7 @@ private:
 	bool lessThan(const QModelIndex &i1, const QModelIndex &i2) const override;
 	void divesSelectedTrip(dive_trip *trip, const QVector<dive *> &dives, QVector<QModelIndex> &);
 	dive *diveOrNull(const QModelIndex &index) const override;
-	void divesChangedTrip(dive_trip *trip, const QVector<dive *> &dives);
+	void divesChangedTrip(dive_trip *trip, const QVector<dive *> &dives, DiveField field);
 	void divesShown(dive_trip *trip, const QVector<dive *> &dives);
 	void divesHidden(dive_trip *trip, const QVector<dive *> &dives);
 	void divesTimeChangedTrip(dive_trip *trip, timestamp_t delta, const QVector<dive *> &dives);
@@ -186,7 +186,7 @@ public slots:
 	void divesAdded(dive_trip *trip, bool addTrip, const QVector<dive *> &dives);
 	void divesDeleted(dive_trip *trip, bool deleteTrip, const QVector<dive *> &dives);
 	void diveSiteChanged(dive_site *ds, int field);
-	void divesChanged(const QVector<dive *> &dives);
+	void divesChanged(const QVector<dive *> &dives, DiveField field);
 	void diveChanged(dive *d);
 	void divesTimeChanged(timestamp_t delta, const QVector<dive *> &dives);
 	// Does nothing in list view.
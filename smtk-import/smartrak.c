@@ -36,6 +36,7 @@
 #include "core/membuffer.h"
 #include "core/tag.h"
 #include "core/device.h"
+#include "core/stringpool.h"
 
 /* SmartTrak version, constant for every single file */
 int smtk_version;
@@ -430,7 +431,7 @@ static void smtk_build_tank_info(MdbHandle *mdb, cylinder_t *tank, char *idx)
 
 	for (i = 1; i <= atoi(idx); i++)
 		mdb_fetch_row(table);
-	tank->type.description = copy_string(bound_values[1]);
+	tank->type.description = intern_string(bound_values[1]);
 	tank->type.size.mliter = lrint(strtod(bound_values[2], NULL) * 1000);
 	tank->type.workingpressure.mbar = lrint(strtod(bound_values[4], NULL) * 1000);
 
@@ -1013,7 +1014,7 @@ void smartrak_import(const char *file, struct dive_table *divetable)
 		}
 		rc = prepare_data(dc_model, copy_string(col[coln(DCNUMBER)]->bind_ptr), dc_fam, devdata);
 		smtkdive->dc.deviceid = devdata->deviceid;
-		smtkdive->dc.model = copy_string(devdata->model);
+		smtkdive->dc.model = intern_string(devdata->model);
 		if (rc == DC_STATUS_SUCCESS && *bound_lens[coln(PROFILE)]) {
 			prf_buffer = mdb_ole_read_full(mdb, col[coln(PROFILE)], &prf_length);
 			if (prf_length > 0) {
@@ -2,6 +2,7 @@
 #include "statsvariables.h"
 #include "statstranslations.h"
 #include "core/dive.h"
+#include "core/divelist.h"
 #include "core/divemode.h"
 #include "core/divesite.h"
 #include "core/gas.h"
@@ -10,8 +11,10 @@
 #include "core/string-format.h"
 #include "core/tag.h"
 #include "core/subsurface-time.h"
+#include "core/subsurface-qt/divelistnotifier.h"
 #include <cmath>
 #include <limits>
+#include <unordered_map>
 #include <QLocale>
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
@@ -223,10 +226,132 @@ QString StatsBinner::unitSymbol() const
 	return QString();
 }
 
+// The cached values of a variable. Additionally, the dives of the dive table are kept
+// sorted by value, so that the sorted values of large sets of dives can be extracted
+// without sorting.
+struct StatsVariable::ValueCache {
+	struct Entry {
+		double v;
+		int rank; // Index in the sorted vector, -1 if not sorted in
+	};
+	struct units valueUnits; // The units the values were calculated in
+	std::unordered_map<const dive *, Entry> entries;
+	std::vector<StatsValue> sorted; // Dives of the dive table with a valid value
+	bool sortedValid = false;
+
+	Entry &get(const StatsVariable &var, const dive *d);
+	void sort(const StatsVariable &var);
+};
+
+StatsVariable::ValueCache::Entry &StatsVariable::ValueCache::get(const StatsVariable &var, const dive *d)
+{
+	auto it = entries.find(d);
+	if (it == entries.end())
+		it = entries.insert({ d, { var.toFloat(d), -1 } }).first;
+	return it->second;
+}
+
+void StatsVariable::ValueCache::sort(const StatsVariable &var)
+{
+	for (auto &[d, entry]: entries)
+		entry.rank = -1;
+	sorted.clear();
+	int i;
+	dive *d;
+	for_each_dive (i, d) {
+		double v = get(var, d).v;
+		if (!is_invalid_value(v))
+			sorted.push_back({ v, d });
+	}
+	std::stable_sort(sorted.begin(), sorted.end(),
+			 [](const StatsValue &v1, const StatsValue &v2)
+			 { return v1.v < v2.v; });
+	for (size_t j = 0; j < sorted.size(); ++j)
+		entries[sorted[j].d].rank = (int)j;
+	sortedValid = true;
+}
+
+static bool same_units(const struct units &u1, const struct units &u2)
+{
+	return u1.length == u2.length && u1.volume == u2.volume && u1.pressure == u2.pressure &&
+	       u1.temperature == u2.temperature && u1.weight == u2.weight;
+}
+
+// Drop the cached values of dives when they are changed. Any change of a dive
+// invalidates the values of all variables of that dive. Signals are delivered in
+// the order of connection, therefore this has to be connected before any handler
+// that might replot the statistics.
+void StatsVariable::connectCacheSignals()
+{
+	static bool connected = false;
+	if (connected)
+		return;
+	connected = true;
+
+	auto invalidate = [](const QVector<dive *> &dives) {
+		for (const dive *d: dives)
+			StatsVariable::invalidateCache(d);
+	};
+	QObject::connect(&diveListNotifier, &DiveListNotifier::dataReset, &StatsVariable::clearCache);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesImported, &StatsVariable::clearCache);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesAdded,
+			 [invalidate](dive_trip *, bool, const QVector<dive *> &dives) { invalidate(dives); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesDeleted,
+			 [invalidate](dive_trip *, bool, const QVector<dive *> &dives) { invalidate(dives); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesChanged,
+			 [invalidate](const QVector<dive *> &dives, DiveField) { invalidate(dives); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesTimeChanged,
+			 [invalidate](timestamp_t, const QVector<dive *> &dives) { invalidate(dives); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylindersReset, invalidate);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightsystemsReset, invalidate);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylinderAdded, [](dive *d, int) { StatsVariable::invalidateCache(d); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylinderRemoved, [](dive *d, int) { StatsVariable::invalidateCache(d); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylinderEdited, [](dive *d, int) { StatsVariable::invalidateCache(d); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightAdded, [](dive *d, int) { StatsVariable::invalidateCache(d); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightRemoved, [](dive *d, int) { StatsVariable::invalidateCache(d); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightEdited, [](dive *d, int) { StatsVariable::invalidateCache(d); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::eventsChanged, [](dive *d) { StatsVariable::invalidateCache(d); });
+}
+
 StatsVariable::~StatsVariable()
 {
 }
 
+StatsVariable::ValueCache &StatsVariable::valueCache() const
+{
+	if (!cache) {
+		connectCacheSignals(); // In case this wasn't done at startup
+		cache = std::make_unique<ValueCache>();
+		cache->valueUnits = prefs.units;
+	} else if (!same_units(cache->valueUnits, prefs.units)) {
+		cache->entries.clear();
+		cache->sortedValid = false;
+		cache->valueUnits = prefs.units;
+	}
+	return *cache;
+}
+
+double StatsVariable::cachedValue(const dive *d) const
+{
+	return valueCache().get(*this, d).v;
+}
+
+void StatsVariable::invalidateCache(const dive *d)
+{
+	for (const StatsVariable *var: stats_variables) {
+		if (!var->cache)
+			continue;
+		var->cache->entries.erase(d);
+		var->cache->sortedValid = false;
+	}
+}
+
+void StatsVariable::clearCache()
+{
+	for (const StatsVariable *var: stats_variables)
+		var->cache.reset();
+}
+
 QString StatsBinner::name() const
 {
 	return QStringLiteral("N/A"); // Some dummy string that should never reach the UI
@@ -360,15 +485,53 @@ double StatsVariable::mean(const std::vector<dive *> &dives) const
 	return res.isValid() ? res.mean : invalid_value<double>();
 }
 
-std::vector<StatsValue> StatsVariable::values(const std::vector<dive *> &dives) const
+std::vector<StatsValue> StatsVariable::unsortedValues(const std::vector<dive *> &dives) const
 {
+	ValueCache &c = valueCache();
 	std::vector<StatsValue> vec;
 	vec.reserve(dives.size());
 	for (dive *d: dives) {
-		double v = toFloat(d);
+		double v = c.get(*this, d).v;
 		if (!is_invalid_value(v))
 			vec.push_back({ v, d });
 	}
+	return vec;
+}
+
+std::vector<StatsValue> StatsVariable::values(const std::vector<dive *> &dives) const
+{
+	// If the dives make up a considerable part of the dive table, pick them
+	// out of the sorted values of all dives instead of sorting their values.
+	ValueCache &c = valueCache();
+	if (!dives.empty() && dives.size() * 8 >= (size_t)dive_table.nr) {
+		if (!c.sortedValid)
+			c.sort(*this);
+		std::vector<char> selected(c.sorted.size(), 0);
+		bool complete = true;
+		for (dive *d: dives) {
+			const ValueCache::Entry &e = c.get(*this, d);
+			if (is_invalid_value(e.v))
+				continue;
+			if (e.rank < 0) {
+				// Not a dive of the dive table (yet)
+				complete = false;
+				break;
+			}
+			selected[e.rank] = 1;
+		}
+		if (complete) {
+			std::vector<StatsValue> vec;
+			vec.reserve(dives.size());
+			for (size_t i = 0; i < c.sorted.size(); ++i) {
+				if (selected[i])
+					vec.push_back(c.sorted[i]);
+			}
+			return vec;
+		}
+		c.sortedValid = false;
+	}
+
+	std::vector<StatsValue> vec = unsortedValues(dives);
 	std::sort(vec.begin(), vec.end(),
 		  [](const StatsValue &v1, const StatsValue &v2)
 		  { return v1.v < v2.v; });
@@ -378,7 +541,7 @@ std::vector<StatsValue> StatsVariable::values(const std::vector<dive *> &dives)
 QString StatsVariable::valueWithUnit(const dive *d) const
 {
 	QLocale loc;
-	double v = toFloat(d);
+	double v = cachedValue(d);
 	if (is_invalid_value(v))
 		return QStringLiteral("-");
 	return QString("%1 %2").arg(loc.toString(v, 'f', decimals()),
@@ -403,12 +566,33 @@ static double q3(const StatsValue *v)
 	return (v[0].v + 3.0*v[1].v) / 4.0;
 }
 
+// Move the elements that are read by quartiles() to their sorted positions.
+// Selecting these few elements is faster than sorting the whole vector.
+static void select_quartiles(std::vector<StatsValue> &vec)
+{
+	int s = (int)vec.size();
+	int idx[] = { 0, s/4 - 1, s/4, s/4 + 1, s/2 - 1, s/2, s - s/4 - 2, s - s/4 - 1, s - s/4, s - 1 };
+	std::sort(std::begin(idx), std::end(idx));
+	int from = 0;
+	for (int i: idx) {
+		if (i < from || i >= s)
+			continue;
+		std::nth_element(vec.begin() + from, vec.begin() + i, vec.end(),
+				 [](const StatsValue &v1, const StatsValue &v2)
+				 { return v1.v < v2.v; });
+		from = i + 1;
+	}
+}
+
 StatsQuartiles StatsVariable::quartiles(const std::vector<dive *> &dives) const
 {
-	return quartiles(values(dives));
+	std::vector<StatsValue> vec = unsortedValues(dives);
+	select_quartiles(vec);
+	return quartiles(vec);
 }
 
-// This expects the value vector to be sorted!
+// This expects the value vector to be sorted, or at least that
+// the elements that are read are at their sorted positions!
 StatsQuartiles StatsVariable::quartiles(const std::vector<StatsValue> &vec)
 {
 	int s = (int)vec.size();
@@ -431,7 +615,8 @@ StatsQuartiles StatsVariable::quartiles(const std::vector<StatsValue> &vec)
 StatsOperationResults StatsVariable::applyOperations(const std::vector<dive *> &dives) const
 {
 	StatsOperationResults res;
-	std::vector<StatsValue> val = values(dives);
+	std::vector<StatsValue> val = unsortedValues(dives);
+	select_quartiles(val);
 
 	double sumTime = 0.0;
 	res.count = (int)val.size();
@@ -487,8 +672,8 @@ std::vector<StatsScatterItem> StatsVariable::scatter(const StatsVariable &t2, co
 	std::vector<StatsScatterItem> res;
 	res.reserve(dives.size());
 	for (dive *d: dives) {
-		double v1 = toFloat(d);
-		double v2 = t2.toFloat(d);
+		double v1 = cachedValue(d);
+		double v2 = t2.cachedValue(d);
 		if (is_invalid_value(v1) || is_invalid_value(v2))
 			continue;
 		res.push_back({ v1, v2, d });
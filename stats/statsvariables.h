@@ -141,9 +141,21 @@ struct StatsVariable {
 	std::vector<StatsValue> values(const std::vector<dive *> &dives) const; // Only for numeric variables
 	QString valueWithUnit(const dive *d) const; // Only for numeric variables
 	std::vector<StatsScatterItem> scatter(const StatsVariable &t2, const std::vector<dive *> &dives) const;
+
+	// The values of numeric variables are cached per dive. The caches are invalidated
+	// by signals of the DiveListNotifier and when the units change.
+	static void connectCacheSignals(); // Call at startup, before the models connect to the DiveListNotifier
+	static void invalidateCache(const dive *d);
+	static void clearCache();
 private:
 	virtual double toFloat(const struct dive *d) const; // For numeric variables - if dive doesn't have that value, returns NaN
+	double cachedValue(const struct dive *d) const; // toFloat() through the value cache
+	std::vector<StatsValue> unsortedValues(const std::vector<dive *> &dives) const;
 	StatsOperationResults applyOperations(const std::vector<dive *> &dives) const;
+
+	struct ValueCache;
+	ValueCache &valueCache() const;
+	mutable std::unique_ptr<ValueCache> cache;
 };
 
 extern const std::vector<const StatsVariable *> stats_variables;
@@ -5,6 +5,7 @@
 #include "map-widget/qmlmapwidgethelper.h"
 #include "qt-models/maplocationmodel.h"
 #include "stats/statsview.h"
+#include "stats/statsvariables.h"
 #include "core/qt-gui.h"
 #include "core/settings/qPref.h"
 #include "core/ssrf.h"
@@ -52,6 +53,8 @@ void init_ui()
 {
 	init_qt_late();
 	register_meta_types();
+	// The statistics caches must be invalidated before the models react to changes
+	StatsVariable::connectCacheSignals();
 #ifndef SUBSURFACE_MOBILE
 	register_qml_types(NULL);
 
@@ -5,12 +5,65 @@
 #include "core/divesite.h"
 #include "core/trip.h"
 #include "core/file.h"
+#include "core/divelist.h"
 
 void TestDiveSiteDuplication::testReadV2()
 {
 	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/TwoTimesTwo.ssrf", &dive_table, &trip_table,
 			    &dive_site_table, &device_table, &filter_preset_table), 0);
 	QCOMPARE(dive_site_table.nr, 2);
+	clear_dive_file_data();
+}
+
+// Reference implementation: the closest site strictly less than distance away, the first one on ties
+static struct dive_site *closest_site(const location_t *loc, unsigned int distance)
+{
+	struct dive_site *res = NULL;
+	for (int i = 0; i < dive_site_table.nr; ++i) {
+		struct dive_site *ds = dive_site_table.dive_sites[i];
+		unsigned int cur_distance;
+		if (dive_site_has_gps_location(ds) && (cur_distance = get_distance(&ds->location, loc)) < distance) {
+			distance = cur_distance;
+			res = ds;
+		}
+	}
+	return res;
+}
+
+void TestDiveSiteDuplication::testProximity()
+{
+	// A grid of sites around the antimeridian and close to the north pole
+	for (int i = 0; i < 20; ++i) {
+		for (int j = 0; j < 20; ++j) {
+			location_t loc = create_location(-0.5 + i * 0.05, 179.5 + j * 0.05);
+			create_dive_site_with_gps("equator", &loc, &dive_site_table);
+			loc = create_location(89.5 + i * 0.025, j * 18.0);
+			create_dive_site_with_gps("pole", &loc, &dive_site_table);
+		}
+	}
+
+	const unsigned int distances[] = { 1, 100, 2000, 10000, 50000, 200000 };
+	for (int i = 0; i < 50; ++i) {
+		location_t loc = create_location(-0.6 + i * 0.025, 179.45 + i * 0.021);
+		location_t polar = create_location(89.4 + i * 0.012, i * 7.3);
+		for (unsigned int distance: distances) {
+			QCOMPARE(get_dive_site_by_gps_proximity(&loc, distance, &dive_site_table), closest_site(&loc, distance));
+			QCOMPARE(get_dive_site_by_gps_proximity(&polar, distance, &dive_site_table), closest_site(&polar, distance));
+		}
+	}
+
+	// Moving a site must be reflected by the lookup functions
+	struct dive_site *ds = dive_site_table.dive_sites[0];
+	location_t old_loc = ds->location;
+	location_t loc = create_location(10.0, 20.0);
+	set_dive_site_location(ds, &loc);
+	QCOMPARE(get_dive_site_by_gps(&loc, &dive_site_table), ds);
+	QCOMPARE(get_dive_site_by_gps_proximity(&loc, 1000, &dive_site_table), ds);
+	QVERIFY(get_dive_site_by_gps(&old_loc, &dive_site_table) != ds);
+	QCOMPARE(get_dive_site_by_gps_proximity(&old_loc, 1000, &dive_site_table), closest_site(&old_loc, 1000));
+
+	clear_dive_file_data();
+	QCOMPARE(get_dive_site_by_gps_proximity(&loc, 1000, &dive_site_table), (struct dive_site *)NULL);
 }
 
 QTEST_GUILESS_MAIN(TestDiveSiteDuplication)
@@ -0,0 +1,424 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testfilter.h"
+#include "core/device.h"
+#include "core/dive.h"
+#include "core/divelist.h"
+#include "core/divesite.h"
+#include "core/file.h"
+#include "core/filterconstraint.h"
+#include "core/filterpreset.h"
+#include "core/fulltext.h"
+#include "core/qthelper.h"
+#include "core/tag.h"
+#include "core/trip.h"
+#include "core/subsurface-qt/divelistnotifier.h"
+#include <functional>
+#include <vector>
+
+// Number of dives for the benchmarks
+static const int nr_benchmark_dives = 20000;
+
+// The dives of the test log and copies thereof. Copied dives own their tags.
+static std::vector<dive *> dives;
+static std::vector<dive *> copies;
+
+void TestFilter::initTestCase()
+{
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/abitofeverything.ssrf", &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	QVERIFY(dive_table.nr > 0);
+	int i;
+	struct dive *d;
+	for_each_dive(i, d)
+		dives.push_back(d);
+	for (int j = 0; (int)(dives.size() + copies.size()) < nr_benchmark_dives; ++j) {
+		struct dive *copy = alloc_dive();
+		copy_dive(get_dive(j % dive_table.nr), copy);
+		copies.push_back(copy);
+	}
+}
+
+void TestFilter::cleanupTestCase()
+{
+	for (dive *d: copies)
+		free_dive(d);
+	copies.clear();
+	dives.clear();
+	clear_dive_file_data();
+}
+
+static const filter_constraint_range_mode range_modes[] = {
+	FILTER_CONSTRAINT_EQUAL, FILTER_CONSTRAINT_LESS, FILTER_CONSTRAINT_GREATER, FILTER_CONSTRAINT_RANGE
+};
+
+static const filter_constraint_string_mode string_modes[] = {
+	FILTER_CONSTRAINT_STARTS_WITH, FILTER_CONSTRAINT_SUBSTRING, FILTER_CONSTRAINT_EXACT
+};
+
+// Ranges in the units used by the dive structure
+static const struct {
+	filter_constraint_type type;
+	int from, to;
+} numerical_ranges[] = {
+	{ FILTER_CONSTRAINT_TIME_OF_DAY, 6 * 3600, 14 * 3600 },
+	{ FILTER_CONSTRAINT_TIME_OF_DAY, 22 * 3600, 2 * 3600 },
+	{ FILTER_CONSTRAINT_YEAR, 2011, 2013 },
+	{ FILTER_CONSTRAINT_RATING, 0, 3 },
+	{ FILTER_CONSTRAINT_WAVESIZE, 0, 2 },
+	{ FILTER_CONSTRAINT_CURRENT, 0, 2 },
+	{ FILTER_CONSTRAINT_VISIBILITY, 3, 5 },
+	{ FILTER_CONSTRAINT_SURGE, 0, 2 },
+	{ FILTER_CONSTRAINT_CHILL, 0, 2 },
+	{ FILTER_CONSTRAINT_DEPTH, 10000, 30000 },
+	{ FILTER_CONSTRAINT_DURATION, 1800, 3600 },
+	{ FILTER_CONSTRAINT_WEIGHT, 0, 6000 },
+	{ FILTER_CONSTRAINT_WATER_TEMP, 288150, 300150 },
+	{ FILTER_CONSTRAINT_AIR_TEMP, 293150, 303150 },
+	{ FILTER_CONSTRAINT_WATER_DENSITY, 10000, 10300 },
+	{ FILTER_CONSTRAINT_SAC, 10000, 20000 },
+	{ FILTER_CONSTRAINT_CYLINDER_SIZE, 10000, 12000 },
+	{ FILTER_CONSTRAINT_CYLINDER_N2, 600, 790 },
+	{ FILTER_CONSTRAINT_CYLINDER_O2, 210, 320 },
+	{ FILTER_CONSTRAINT_CYLINDER_HE, 0, 200 },
+};
+
+static const filter_constraint_type string_types[] = {
+	FILTER_CONSTRAINT_TAGS, FILTER_CONSTRAINT_PEOPLE, FILTER_CONSTRAINT_LOCATION, FILTER_CONSTRAINT_WEIGHT_TYPE,
+	FILTER_CONSTRAINT_CYLINDER_TYPE, FILTER_CONSTRAINT_SUIT, FILTER_CONSTRAINT_NOTES
+};
+
+static const char *strings[] = { "boat", "a", "Linus, Don", "" };
+
+// A constraint for every type, range mode, string mode and negation.
+static std::vector<filter_constraint> testConstraints()
+{
+	std::vector<filter_constraint> res;
+	for (bool negate: { false, true }) {
+		for (filter_constraint_range_mode range_mode: range_modes) {
+			for (filter_constraint_type type: { FILTER_CONSTRAINT_DATE, FILTER_CONSTRAINT_DATE_TIME }) {
+				filter_constraint c(type);
+				c.negate = negate;
+				c.range_mode = range_mode;
+				c.data.timestamp_range.from = dives[dives.size() / 3]->when;
+				c.data.timestamp_range.to = dives[dives.size() * 2 / 3]->when;
+				res.push_back(c);
+			}
+			for (const auto &range: numerical_ranges) {
+				filter_constraint c(range.type);
+				c.negate = negate;
+				c.range_mode = range_mode;
+				c.data.numerical_range.from = range.from;
+				c.data.numerical_range.to = range.to;
+				res.push_back(c);
+			}
+		}
+		for (filter_constraint_string_mode string_mode: string_modes) {
+			for (filter_constraint_type type: string_types) {
+				for (const char *s: strings) {
+					filter_constraint c(type);
+					c.negate = negate;
+					c.string_mode = string_mode;
+					filter_constraint_set_stringlist(c, s);
+					res.push_back(c);
+				}
+			}
+		}
+		for (filter_constraint_type type: { FILTER_CONSTRAINT_DAY_OF_WEEK, FILTER_CONSTRAINT_DIVE_MODE }) {
+			for (uint64_t bits: { 0x2aLLU, 0x3LLU }) {
+				filter_constraint c(type);
+				c.negate = negate;
+				c.data.multiple_choice = bits;
+				res.push_back(c);
+			}
+		}
+		for (filter_constraint_type type: { FILTER_CONSTRAINT_LOGGED, FILTER_CONSTRAINT_PLANNED }) {
+			filter_constraint c(type);
+			c.negate = negate;
+			res.push_back(c);
+		}
+	}
+	return res;
+}
+
+static bool matchDive(const std::vector<filter_constraint> &constraints, const struct dive *d)
+{
+	return std::all_of(constraints.begin(), constraints.end(),
+			   [d] (const filter_constraint &c) { return filter_constraint_match_dive(c, d); });
+}
+
+// The compiled constraints must give the same result as filter_constraint_match_dive()
+void TestFilter::testCompiledConstraints()
+{
+	std::vector<filter_constraint> constraints = testConstraints();
+	std::vector<const dive *> all(dives.begin(), dives.end());
+	all.insert(all.end(), copies.begin(), copies.begin() + dives.size());
+
+	for (const filter_constraint &c: constraints) {
+		std::vector<filter_constraint> single { c };
+		CompiledFilterConstraints compiled(single);
+		for (const dive *d: all) {
+			if (compiled.match_dive(d) != filter_constraint_match_dive(c, d))
+				QFAIL(qPrintable(QString("%1 (negate: %2, range mode: %3, string mode: %4) differs for dive #%5")
+						 .arg(filter_constraint_type_to_string(c.type))
+						 .arg(c.negate)
+						 .arg(filter_constraint_range_mode_to_string(c.range_mode))
+						 .arg(filter_constraint_string_mode_to_string(c.string_mode))
+						 .arg(d->number)));
+		}
+	}
+
+	// Combinations of constraints, which are reordered by cost when compiling
+	for (size_t i = 0; i + 3 <= constraints.size(); i += 3) {
+		std::vector<filter_constraint> combined(constraints.begin() + i, constraints.begin() + i + 3);
+		CompiledFilterConstraints compiled(combined);
+		for (const dive *d: all)
+			QCOMPARE(compiled.match_dive(d), matchDive(combined, d));
+	}
+}
+
+static filter_constraint rangeConstraint(filter_constraint_type type, filter_constraint_range_mode range_mode,
+					 int from, int to, bool negate = false)
+{
+	filter_constraint c(type);
+	c.range_mode = range_mode;
+	c.negate = negate;
+	c.data.numerical_range.from = from;
+	c.data.numerical_range.to = to;
+	return c;
+}
+
+static filter_constraint multipleChoiceConstraint(filter_constraint_type type, uint64_t bits, bool negate = false)
+{
+	filter_constraint c(type);
+	c.negate = negate;
+	c.data.multiple_choice = bits;
+	return c;
+}
+
+void TestFilter::testConstraintNarrows()
+{
+	const filter_constraint_type depth = FILTER_CONSTRAINT_DEPTH;
+	const filter_constraint_type time = FILTER_CONSTRAINT_TIME_OF_DAY;
+	const filter_constraint_type weekday = FILTER_CONSTRAINT_DAY_OF_WEEK;
+
+	// Ranges
+	QVERIFY(filter_constraint_narrows(rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 10000, 30000),
+					  rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 5000, 40000)));
+	QVERIFY(!filter_constraint_narrows(rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 5000, 40000),
+					   rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 10000, 30000)));
+	QVERIFY(!filter_constraint_narrows(rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 5000, 30000),
+					   rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 10000, 40000)));
+	QVERIFY(filter_constraint_narrows(rangeConstraint(depth, FILTER_CONSTRAINT_GREATER, 20000, 0),
+					  rangeConstraint(depth, FILTER_CONSTRAINT_GREATER, 10000, 0)));
+	QVERIFY(!filter_constraint_narrows(rangeConstraint(depth, FILTER_CONSTRAINT_GREATER, 10000, 0),
+					   rangeConstraint(depth, FILTER_CONSTRAINT_GREATER, 20000, 0)));
+	QVERIFY(filter_constraint_narrows(rangeConstraint(depth, FILTER_CONSTRAINT_LESS, 0, 20000),
+					  rangeConstraint(depth, FILTER_CONSTRAINT_LESS, 0, 30000)));
+	QVERIFY(filter_constraint_narrows(rangeConstraint(depth, FILTER_CONSTRAINT_EQUAL, 10000, 0),
+					  rangeConstraint(depth, FILTER_CONSTRAINT_EQUAL, 10000, 0)));
+	QVERIFY(!filter_constraint_narrows(rangeConstraint(depth, FILTER_CONSTRAINT_EQUAL, 10000, 0),
+					   rangeConstraint(depth, FILTER_CONSTRAINT_EQUAL, 20000, 0)));
+
+	// A different range mode, negation or type is never narrowing
+	QVERIFY(!filter_constraint_narrows(rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 10000, 20000),
+					   rangeConstraint(depth, FILTER_CONSTRAINT_GREATER, 5000, 0)));
+	QVERIFY(!filter_constraint_narrows(rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 10000, 30000, true),
+					   rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 5000, 40000)));
+	QVERIFY(!filter_constraint_narrows(rangeConstraint(FILTER_CONSTRAINT_DURATION, FILTER_CONSTRAINT_RANGE, 10000, 30000),
+					   rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 5000, 40000)));
+
+	// Negated ranges narrow if the excluded range grows
+	QVERIFY(filter_constraint_narrows(rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 5000, 40000, true),
+					  rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 10000, 30000, true)));
+	QVERIFY(!filter_constraint_narrows(rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 10000, 30000, true),
+					   rangeConstraint(depth, FILTER_CONSTRAINT_RANGE, 5000, 40000, true)));
+	QVERIFY(filter_constraint_narrows(rangeConstraint(depth, FILTER_CONSTRAINT_GREATER, 10000, 0, true),
+					  rangeConstraint(depth, FILTER_CONSTRAINT_GREATER, 20000, 0, true)));
+
+	// Time-of-day ranges are cyclic: only identical constraints narrow
+	QVERIFY(filter_constraint_narrows(rangeConstraint(time, FILTER_CONSTRAINT_RANGE, 22 * 3600, 2 * 3600),
+					  rangeConstraint(time, FILTER_CONSTRAINT_RANGE, 22 * 3600, 2 * 3600)));
+	QVERIFY(!filter_constraint_narrows(rangeConstraint(time, FILTER_CONSTRAINT_RANGE, 23 * 3600, 1 * 3600),
+					   rangeConstraint(time, FILTER_CONSTRAINT_RANGE, 22 * 3600, 2 * 3600)));
+
+	// Multiple choice
+	QVERIFY(filter_constraint_narrows(multipleChoiceConstraint(weekday, 0x3), multipleChoiceConstraint(weekday, 0x7)));
+	QVERIFY(!filter_constraint_narrows(multipleChoiceConstraint(weekday, 0x7), multipleChoiceConstraint(weekday, 0x3)));
+	QVERIFY(filter_constraint_narrows(multipleChoiceConstraint(weekday, 0x7, true), multipleChoiceConstraint(weekday, 0x3, true)));
+	QVERIFY(!filter_constraint_narrows(multipleChoiceConstraint(weekday, 0x3, true), multipleChoiceConstraint(weekday, 0x7, true)));
+
+	// Strings: only identical constraints narrow
+	filter_constraint boat(FILTER_CONSTRAINT_TAGS), boa(FILTER_CONSTRAINT_TAGS);
+	filter_constraint_set_stringlist(boat, "boat");
+	filter_constraint_set_stringlist(boa, "boa");
+	QVERIFY(filter_constraint_narrows(boat, boat));
+	QVERIFY(!filter_constraint_narrows(boat, boa));
+
+	// Whenever a constraint narrows another one, the matching dives must be a subset
+	std::vector<filter_constraint> constraints = testConstraints();
+	int narrowing = 0;
+	for (const filter_constraint &c: constraints) {
+		for (const filter_constraint &old: constraints) {
+			if (!filter_constraint_narrows(c, old))
+				continue;
+			++narrowing;
+			for (const dive *d: dives) {
+				if (filter_constraint_match_dive(c, d) && !filter_constraint_match_dive(old, d))
+					QFAIL(qPrintable(QString("%1 (negate: %2, range mode: %3) is not narrowing for dive #%4")
+							 .arg(filter_constraint_type_to_string(c.type))
+							 .arg(c.negate)
+							 .arg(filter_constraint_range_mode_to_string(c.range_mode))
+							 .arg(d->number)));
+			}
+		}
+	}
+	QVERIFY(narrowing > (int)constraints.size());
+}
+
+static bool fullTextNarrows(const QString &query, const QString &old, StringFilterMode mode)
+{
+	FullTextQuery q, oldQ;
+	q = query;
+	oldQ = old;
+	return q.narrows(oldQ, mode);
+}
+
+void TestFilter::testFullTextNarrows()
+{
+	QVERIFY(fullTextNarrows("shark point", "shark", StringFilterMode::EXACT));
+	QVERIFY(fullTextNarrows("shark", "sha", StringFilterMode::STARTSWITH));
+	QVERIFY(!fullTextNarrows("shark", "sha", StringFilterMode::EXACT));
+	QVERIFY(fullTextNarrows("shark", "ark", StringFilterMode::SUBSTRING));
+	QVERIFY(!fullTextNarrows("shark", "ark", StringFilterMode::STARTSWITH));
+	QVERIFY(!fullTextNarrows("shark", "shark point", StringFilterMode::EXACT));
+	QVERIFY(!fullTextNarrows("point shark", "shark", StringFilterMode::EXACT));
+}
+
+// When the filter is narrowed, only the shown dives are checked again. This must
+// give the same dives as checking all dives.
+void TestFilter::testIncrementalFilter()
+{
+	std::vector<filter_constraint> constraints = testConstraints();
+	const filter_constraint &extra = constraints[constraints.size() / 2];
+	int checked = 0;
+	for (const filter_constraint &c: constraints) {
+		for (const filter_constraint &old: constraints) {
+			std::vector<filter_constraint> oldList { old };
+			std::vector<filter_constraint> newList { c, extra };
+			if (!filter_constraints_narrow(newList, oldList))
+				continue;
+			++checked;
+			CompiledFilterConstraints oldFilter(oldList), newFilter(newList);
+			for (const dive *d: dives) {
+				bool incremental = oldFilter.match_dive(d) && newFilter.match_dive(d);
+				QCOMPARE(incremental, newFilter.match_dive(d));
+			}
+		}
+	}
+	QVERIFY(checked > 0);
+
+	// Removing or reordering constraints is not narrowing
+	std::vector<filter_constraint> list { constraints[0], constraints[1] };
+	std::vector<filter_constraint> first { constraints[0] };
+	std::vector<filter_constraint> reordered { constraints[1], constraints[0] };
+	QVERIFY(filter_constraints_narrow(list, first));
+	QVERIFY(!filter_constraints_narrow(first, list));
+	QVERIFY(!filter_constraints_narrow(reordered, list));
+}
+
+// Changing a field that a constraint doesn't depend on must not change whether a dive matches
+void TestFilter::testConstraintDependsOn()
+{
+	struct FieldChange {
+		int field;
+		std::function<void(dive *)> change;
+	};
+	auto setString = [](char *&s, const char *value) { free(s); s = copy_string(value); };
+	const FieldChange changes[] = {
+		{ DiveField::DATETIME, [](dive *d) { d->when += 200 * 24 * 3600 + 7 * 3600; } },
+		{ DiveField::DEPTH, [](dive *d) { d->maxdepth.mm += 15000; } },
+		{ DiveField::DURATION, [](dive *d) { d->duration.seconds += 3600; } },
+		{ DiveField::AIR_TEMP, [](dive *d) { d->airtemp.mkelvin += 10000; } },
+		{ DiveField::WATER_TEMP, [](dive *d) { d->watertemp.mkelvin += 10000; } },
+		{ DiveField::DIVESITE, [](dive *d) { d->dive_site = nullptr; } },
+		{ DiveField::DIVEMASTER, [setString](dive *d) { setString(d->divemaster, "Don"); } },
+		{ DiveField::BUDDY, [setString](dive *d) { setString(d->buddy, "Linus"); } },
+		{ DiveField::RATING, [](dive *d) { d->rating = (d->rating + 2) % 6; } },
+		{ DiveField::VISIBILITY, [](dive *d) { d->visibility = (d->visibility + 2) % 6; } },
+		{ DiveField::WAVESIZE, [](dive *d) { d->wavesize = (d->wavesize + 2) % 6; } },
+		{ DiveField::CURRENT, [](dive *d) { d->current = (d->current + 2) % 6; } },
+		{ DiveField::SURGE, [](dive *d) { d->surge = (d->surge + 2) % 6; } },
+		{ DiveField::CHILL, [](dive *d) { d->chill = (d->chill + 2) % 6; } },
+		{ DiveField::SUIT, [setString](dive *d) { setString(d->suit, "a suit"); } },
+		{ DiveField::TAGS, [](dive *d) { taglist_add_tag(&d->tag_list, "boat"); } },
+		{ DiveField::MODE, [](dive *d) { d->dc.divemode = d->dc.divemode == CCR ? OC : CCR; } },
+		{ DiveField::NOTES, [setString](dive *d) { setString(d->notes, "a note"); } },
+		{ DiveField::SALINITY, [](dive *d) { d->user_salinity = 10000; } },
+	};
+
+	std::vector<filter_constraint> constraints = testConstraints();
+	for (const FieldChange &change: changes) {
+		DiveField field(change.field);
+		for (const dive *d: dives) {
+			struct dive *changed = alloc_dive();
+			copy_dive(d, changed);
+			change.change(changed);
+			for (const filter_constraint &c: constraints) {
+				if (!filter_constraint_depends_on(c.type, field))
+					QCOMPARE(filter_constraint_match_dive(c, changed), filter_constraint_match_dive(c, d));
+			}
+			free_dive(changed);
+		}
+	}
+}
+
+void TestFilter::benchmarkMatch_data()
+{
+	QTest::addColumn<bool>("compile");
+	QTest::newRow("compiled") << true;
+	QTest::newRow("uncompiled") << false;
+}
+
+// A typical filter over a large log
+void TestFilter::benchmarkMatch()
+{
+	QFETCH(bool, compile);
+
+	std::vector<filter_constraint> constraints;
+	filter_constraint date(FILTER_CONSTRAINT_DATE);
+	date.range_mode = FILTER_CONSTRAINT_RANGE;
+	date.data.timestamp_range.from = dives.front()->when;
+	date.data.timestamp_range.to = dives.back()->when;
+	constraints.push_back(date);
+	filter_constraint depth(FILTER_CONSTRAINT_DEPTH);
+	depth.range_mode = FILTER_CONSTRAINT_GREATER;
+	depth.data.numerical_range.from = 5000;
+	constraints.push_back(depth);
+	filter_constraint tags(FILTER_CONSTRAINT_TAGS);
+	tags.negate = true;
+	filter_constraint_set_stringlist(tags, "teaching");
+	constraints.push_back(tags);
+	filter_constraint notes(FILTER_CONSTRAINT_NOTES);
+	notes.negate = true;
+	notes.string_mode = FILTER_CONSTRAINT_SUBSTRING;
+	filter_constraint_set_stringlist(notes, "xyz");
+	constraints.push_back(notes);
+
+	std::vector<const dive *> all(dives.begin(), dives.end());
+	all.insert(all.end(), copies.begin(), copies.end());
+	QCOMPARE((int)all.size(), nr_benchmark_dives);
+	QBENCHMARK {
+		int count = 0;
+		if (compile) {
+			CompiledFilterConstraints compiled(constraints);
+			for (const dive *d: all)
+				count += compiled.match_dive(d);
+		} else {
+			for (const dive *d: all)
+				count += matchDive(constraints, d);
+		}
+		QVERIFY(count <= nr_benchmark_dives);
+	}
+}
+
+QTEST_GUILESS_MAIN(TestFilter)
@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTFILTER_H
+#define TESTFILTER_H
+
+#include <QtTest>
+
+class TestFilter : public QObject {
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void testCompiledConstraints();
+	void testConstraintNarrows();
+	void testFullTextNarrows();
+	void testIncrementalFilter();
+	void testConstraintDependsOn();
+	void benchmarkMatch_data();
+	void benchmarkMatch();
+};
+
+#endif
@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testfulltext.h"
+#include "core/dive.h"
+#include "core/divelist.h"
+#include "core/divesite.h"
+#include "core/fulltext.h"
+#include "core/qthelper.h"
+
+Q_DECLARE_METATYPE(StringFilterMode)
+
+static const int nr_dives = 10000;
+static const int words_per_dive = 100;
+
+// Deterministic pseudo-random words made from a few syllables,
+// so that many words share substrings.
+static QString randomWord(unsigned int &seed)
+{
+	static const char *syllables[] = {
+		"ka", "lo", "mi", "ren", "tos", "vu", "bar", "del",
+		"fin", "gor", "hu", "jel", "ple", "qua", "sti", "wen"
+	};
+	QString res;
+	seed = seed * 1103515245 + 12345;
+	int nr = 2 + (seed >> 16) % 3;
+	for (int i = 0; i < nr; ++i) {
+		seed = seed * 1103515245 + 12345;
+		res += syllables[(seed >> 16) % 16];
+	}
+	return res;
+}
+
+void TestFullText::initTestCase()
+{
+	unsigned int seed = 42;
+	for (int i = 0; i < nr_dives; ++i) {
+		struct dive *d = alloc_dive();
+		d->when = 1000000000 + i * 3600;
+		QStringList notes;
+		for (int j = 0; j < words_per_dive; ++j)
+			notes.append(randomWord(seed));
+		d->notes = copy_qstring(notes.join(' '));
+		record_dive_to_table(d, &dive_table);
+	}
+	fulltext_populate();
+}
+
+void TestFullText::cleanupTestCase()
+{
+	fulltext_unregister_all();
+	clear_dive_file_data();
+}
+
+static void addQueries()
+{
+	QTest::addColumn<QString>("query");
+	QTest::addColumn<StringFilterMode>("mode");
+	const char *queries[] = { "kalo", "renta", "enti", "qua", "lo", "kamiren", "xyz", "bar del" };
+	for (const char *query: queries) {
+		QTest::newRow(qPrintable(QString("%1/substring").arg(query))) << QString(query) << StringFilterMode::SUBSTRING;
+		QTest::newRow(qPrintable(QString("%1/startswith").arg(query))) << QString(query) << StringFilterMode::STARTSWITH;
+		QTest::newRow(qPrintable(QString("%1/exact").arg(query))) << QString(query) << StringFilterMode::EXACT;
+	}
+}
+
+// Find the dives matching all words of the query by checking each dive.
+static std::vector<dive *> scanDives(const QString &query, StringFilterMode mode)
+{
+	QStringList words = query.split(' ');
+	std::vector<FullTextQuery> queries(words.size());
+	for (int i = 0; i < words.size(); ++i)
+		queries[i] = words[i];
+
+	std::vector<dive *> res;
+	int i;
+	struct dive *d;
+	for_each_dive(i, d) {
+		if (std::all_of(queries.begin(), queries.end(),
+				[d, mode](const FullTextQuery &q) { return fulltext_dive_matches(d, q, mode); }))
+			res.push_back(d);
+	}
+	return res;
+}
+
+void TestFullText::testFind_data()
+{
+	addQueries();
+}
+
+void TestFullText::testFind()
+{
+	QFETCH(QString, query);
+	QFETCH(StringFilterMode, mode);
+
+	FullTextQuery q;
+	q = query;
+	std::vector<dive *> found = fulltext_find_dives(q, mode).dives;
+	std::vector<dive *> scanned = scanDives(query, mode);
+	std::sort(found.begin(), found.end());
+	std::sort(scanned.begin(), scanned.end());
+	QCOMPARE(found.size(), scanned.size());
+	QVERIFY(found == scanned);
+}
+
+static int countDives(const QString &query)
+{
+	FullTextQuery q;
+	q = query;
+	return (int)fulltext_find_dives(q, StringFilterMode::EXACT).dives.size();
+}
+
+void TestFullText::testSiteRename()
+{
+	struct dive_site *ds = alloc_dive_site_with_name("Blue Hole");
+	register_dive_site(ds);
+	for (int i = 0; i < 3; ++i) {
+		struct dive *d = alloc_dive();
+		d->when = 900000000 + i * 3600;
+		add_dive_to_dive_site(d, ds);
+		record_dive_to_table(d, &dive_table);
+		fulltext_register(d);
+	}
+	QCOMPARE(countDives("blue hole"), 3);
+
+	// Renaming the site only has to update the site's words
+	free(ds->name);
+	ds->name = strdup("Shark Point");
+	fulltext_register_site(ds);
+	QCOMPARE(countDives("blue"), 0);
+	QCOMPARE(countDives("shark point"), 3);
+
+	FullTextQuery q;
+	q = QString("shark");
+	QVERIFY(fulltext_dive_matches(ds->dives.dives[0], q, StringFilterMode::EXACT));
+
+	// Merging in the name of another site must update the words as well
+	struct dive_site *other = alloc_dive_site_with_name("Coral Garden");
+	merge_dive_site(ds, other);
+	free_dive_site(other);
+	QCOMPARE(countDives("coral"), 3);
+	QCOMPARE(countDives("shark"), 3);
+
+	// Remove the dives and the site, so that the other tests see the original dives only
+	while (ds->dives.nr > 0) {
+		struct dive *d = ds->dives.dives[0];
+		unregister_dive(get_divenr(d));
+		unregister_dive_from_dive_site(d);
+		free_dive(d);
+	}
+	delete_dive_site(ds, &dive_site_table);
+	QCOMPARE(dive_table.nr, nr_dives);
+	QCOMPARE(countDives("coral"), 0);
+}
+
+void TestFullText::benchmarkFind_data()
+{
+	addQueries();
+}
+
+void TestFullText::benchmarkFind()
+{
+	QFETCH(QString, query);
+	QFETCH(StringFilterMode, mode);
+
+	FullTextQuery q;
+	q = query;
+	QBENCHMARK {
+		FullTextResult res = fulltext_find_dives(q, mode);
+		int i, count = 0;
+		struct dive *d;
+		for_each_dive(i, d)
+			count += res.dive_matches(d);
+		QVERIFY(count >= 0);
+	}
+}
+
+void TestFullText::benchmarkScan_data()
+{
+	addQueries();
+}
+
+void TestFullText::benchmarkScan()
+{
+	QFETCH(QString, query);
+	QFETCH(StringFilterMode, mode);
+
+	QBENCHMARK {
+		QVERIFY(scanDives(query, mode).size() <= (size_t)nr_dives);
+	}
+}
+
+QTEST_GUILESS_MAIN(TestFullText)
@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTFULLTEXT_H
+#define TESTFULLTEXT_H
+
+#include <QtTest>
+
+class TestFullText : public QObject {
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void testFind_data();
+	void testFind();
+	void testSiteRename();
+	void benchmarkFind_data();
+	void benchmarkFind();
+	void benchmarkScan_data();
+	void benchmarkScan();
+};
+
+#endif
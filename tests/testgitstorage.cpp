@@ -4,6 +4,7 @@
 
 #include "core/device.h"
 #include "core/dive.h"
+#include "core/divelist.h"
 #include "core/divesite.h"
 #include "core/file.h"
 #include "core/qthelper.h"
@@ -12,8 +13,12 @@
 #include "core/settings/qPrefCloudStorage.h"
 #include "core/trip.h"
 #include "core/git-access.h"
+#include "core/git-snapshot.h"
+#include "core/subsurface-qt/divelistnotifier.h"
 
+#include <QDateTime>
 #include <QDir>
+#include <QFileInfo>
 #include <QTextStream>
 #include <QNetworkProxy>
 #include <QTextCodec>
@@ -219,6 +224,164 @@ void TestGitStorage::testGitStorageLocal()
 	QCOMPARE(readin, written);
 }
 
+static QString readFile(const QString &filename)
+{
+	QFile f(filename);
+	f.open(QFile::ReadOnly);
+	QTextStream s(&f);
+	return s.readAll();
+}
+
+void TestGitStorage::testGitParallelLoad()
+{
+	// parsing the dives in parallel gives the same result as parsing them one after the other
+	git_repository *repo;
+	QString testDirName("./gittestparallel");
+	QDir testDir(testDirName);
+	QCOMPARE(testDir.removeRecursively(), true);
+	QCOMPARE(QDir().mkdir(testDirName), true);
+	QCOMPARE(git_repository_init(&repo, qPrintable(testDirName), false), 0);
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/abitofeverything.ssrf", &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	QVERIFY(trip_table.nr > 0);
+	QVERIFY(dive_site_table.nr > 0);
+	QCOMPARE(save_dives(qPrintable(testDirName + "[test]")), 0);
+	clear_dive_file_data();
+
+	git_load_sequential = true;
+	QCOMPARE(parse_file(qPrintable(testDirName + "[test]"), &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	git_load_sequential = false;
+	bool multiple_dcs = false;
+	for (int i = 0; i < dive_table.nr; i++)
+		multiple_dcs |= dive_table.dives[i]->dc.next != nullptr;
+	QVERIFY(multiple_dcs);
+	QCOMPARE(save_dives("./abitofeverythingSequential.ssrf"), 0);
+	clear_dive_file_data();
+
+	QCOMPARE(parse_file(qPrintable(testDirName + "[test]"), &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	QCOMPARE(save_dives("./abitofeverythingParallel.ssrf"), 0);
+	QCOMPARE(readFile("./abitofeverythingParallel.ssrf"), readFile("./abitofeverythingSequential.ssrf"));
+}
+
+static QStringList progressMessages;
+
+static int recordProgress(const char *text)
+{
+	progressMessages.append(text);
+	return 0;
+}
+
+// Load the repository and return whether the dives were parsed from the blobs
+static bool loadParsesBlobs(const QString &repoName)
+{
+	progressMessages.clear();
+	set_git_update_cb(&recordProgress);
+	int ret = parse_file(qPrintable(repoName), &dive_table, &trip_table, &dive_site_table, &device_table, &filter_preset_table);
+	set_git_update_cb(nullptr);
+	if (ret)
+		QTest::qFail("loading the git repository failed", __FILE__, __LINE__);
+	return progressMessages.contains("Load dives from local cache");
+}
+
+void TestGitStorage::testGitSnapshot()
+{
+	// the second load of an unchanged repository is done from the snapshot
+	git_repository *repo;
+	QString testDirName("./gittestsnapshot");
+	QDir testDir(testDirName);
+	QCOMPARE(testDir.removeRecursively(), true);
+	QCOMPARE(QDir().mkdir(testDirName), true);
+	QCOMPARE(git_repository_init(&repo, qPrintable(testDirName), false), 0);
+	char *snapshotName = get_git_snapshot_filename(git_repository_path(repo), "test");
+	QString snapshot(snapshotName);
+	free(snapshotName);
+	git_repository_free(repo);
+	QFile::remove(snapshot);
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	QCOMPARE(save_dives(qPrintable(testDirName + "[test]")), 0);
+	clear_dive_file_data();
+
+	QCOMPARE(loadParsesBlobs(testDirName + "[test]"), true);
+	QCOMPARE(QFile::exists(snapshot), true);
+	QCOMPARE(save_dives("./SampleDivesSnapshotGit.ssrf"), 0);
+	clear_dive_file_data();
+
+	QDateTime written = QFileInfo(snapshot).lastModified();
+	QCOMPARE(loadParsesBlobs(testDirName + "[test]"), false);
+	QCOMPARE(save_dives("./SampleDivesSnapshot.ssrf"), 0);
+	clear_dive_file_data();
+	QCOMPARE(readFile("./SampleDivesSnapshot.ssrf"), readFile("./SampleDivesSnapshotGit.ssrf"));
+	// the snapshot of an unchanged commit is not written again
+	QCOMPARE(QFileInfo(snapshot).lastModified(), written);
+
+	// a corrupt snapshot is ignored and replaced
+	QFile f(snapshot);
+	QCOMPARE(f.resize(f.size() / 2), true);
+	QCOMPARE(loadParsesBlobs(testDirName + "[test]"), true);
+	QCOMPARE(save_dives("./SampleDivesSnapshot.ssrf"), 0);
+	QCOMPARE(readFile("./SampleDivesSnapshot.ssrf"), readFile("./SampleDivesSnapshotGit.ssrf"));
+	clear_dive_file_data();
+	QCOMPARE(loadParsesBlobs(testDirName + "[test]"), false);
+	clear_dive_file_data();
+
+	// the snapshot of a different build is removed, even for another commit:
+	// change the version string, which follows the magic and three integers
+	QVERIFY(f.open(QFile::ReadWrite));
+	QVERIFY(f.seek(8 + 4 * sizeof(int32_t)));
+	QCOMPARE(f.write("?", 1), 1LL);
+	f.close();
+	QCOMPARE(git_snapshot_matches(qPrintable(snapshot), "0000000000000000000000000000000000000000"), false);
+	QCOMPARE(QFile::exists(snapshot), false);
+	QCOMPARE(loadParsesBlobs(testDirName + "[test]"), true);
+	QCOMPARE(QFile::exists(snapshot), true);
+	clear_dive_file_data();
+	QFile::remove(snapshot);
+}
+
+void TestGitStorage::testGitReload()
+{
+	// only the dives that changed are replaced when reloading
+	git_repository *repo;
+	const char *branch;
+	QString testDirName("./gittestreload");
+	QDir testDir(testDirName);
+	QCOMPARE(testDir.removeRecursively(), true);
+	QCOMPARE(QDir().mkdir(testDirName), true);
+	QCOMPARE(git_repository_init(&repo, qPrintable(testDirName), false), 0);
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	QCOMPARE(save_dives(qPrintable(testDirName + "[test]")), 0);
+	clear_dive_file_data();
+	QCOMPARE(parse_file(qPrintable(testDirName + "[test]"), &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	process_loaded_dives();
+	QCOMPARE(save_dives("./SampleDivesReloadGit.ssrf"), 0);
+
+	QVERIFY(dive_table.nr > 1);
+	struct dive *kept = get_dive(0);
+	struct dive *changed = get_dive(1);
+	invalidate_dive_cache(changed);
+	repo = is_git_repository(qPrintable(testDirName + "[test]"), &branch, NULL, false);
+	QVERIFY(repo != nullptr && repo != dummy_git_repository);
+	// the models are reset before the replaced dives are freed
+	int resets = 0, divesAtReset = -1;
+	QMetaObject::Connection c =
+		QObject::connect(&diveListNotifier, &DiveListNotifier::dataReset,
+				 [&resets, &divesAtReset]() { ++resets; divesAtReset = dive_table.nr; });
+	QCOMPARE(reload_git_dive_file_data(repo, branch, &filter_preset_table), 0);
+	QObject::disconnect(c);
+	QCOMPARE(resets, 1);
+	QCOMPARE(divesAtReset, 0);
+	process_loaded_dives();
+	QCOMPARE(get_dive(0), kept);
+	QVERIFY(get_dive(1) != changed);
+	QCOMPARE(save_dives("./SampleDivesReload.ssrf"), 0);
+	QCOMPARE(readFile("./SampleDivesReload.ssrf"), readFile("./SampleDivesReloadGit.ssrf"));
+}
+
 void TestGitStorage::testGitStorageCloud()
 {
 	// test writing and reading back from cloud storage
@@ -2,16 +2,26 @@
 #include "testparse.h"
 #include "core/device.h"
 #include "core/dive.h"
+#include "core/divecomputer.h"
 #include "core/divesite.h"
+#include "core/equipment.h"
 #include "core/errorhelper.h"
+#include "core/event.h"
+#include "core/extradata.h"
 #include "core/trip.h"
 #include "core/file.h"
 #include "core/import-csv.h"
 #include "core/parse.h"
 #include "core/qthelper.h"
+#include "core/sample.h"
+#include "core/stringpool.h"
 #include "core/subsurface-string.h"
+#include "core/tag.h"
 #include "core/xmlparams.h"
 #include <QTextStream>
+#ifndef WIN32
+#include <unistd.h>
+#endif
 
 /* We have to use a macro since QCOMPARE
  * can only be called from a test method
@@ -268,6 +278,191 @@ void TestParse::testParseMerge()
 		     SUBSURFACE_TEST_DATA "/dives/mergedVyperOstc.xml");
 }
 
+void TestParse::testArena()
+{
+	/*
+	 * check that the samples and extra data of a loaded dive are
+	 * moved out of the arena of the parser when they are changed
+	 */
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/ostc.xml", &dive_table, &trip_table, &dive_site_table,
+			    &device_table, &filter_preset_table), 0);
+	struct dive *d = get_dive(0);
+	QVERIFY(d != nullptr);
+	struct divecomputer *dc = &d->dc;
+	QVERIFY(dc->arena != nullptr);
+	QVERIFY(dc->samples > 1);
+
+	int nr = dc->samples, nr_extra_data = 0;
+	struct sample first = dc->sample[0], last = dc->sample[nr - 1];
+	for (struct extra_data *ed = dc->extra_data; ed; ed = ed->next)
+		nr_extra_data++;
+
+	add_extra_data(dc, "test key", "test value");
+	QVERIFY(dc->arena == nullptr);
+	QCOMPARE(dc->samples, nr);
+	QCOMPARE(dc->sample[0].time.seconds, first.time.seconds);
+	QCOMPARE(dc->sample[0].depth.mm, first.depth.mm);
+	QCOMPARE(dc->sample[nr - 1].time.seconds, last.time.seconds);
+	QCOMPARE(dc->sample[nr - 1].depth.mm, last.depth.mm);
+	struct extra_data *ed = dc->extra_data;
+	for (int i = 0; i < nr_extra_data; i++) {
+		QVERIFY(ed != nullptr);
+		ed = ed->next;
+	}
+	QVERIFY(ed != nullptr);
+	QCOMPARE(ed->key, "test key");
+	QCOMPARE(ed->value, "test value");
+	QVERIFY(ed->next == nullptr);
+}
+
+void TestParse::testInternedStrings()
+{
+	/*
+	 * check that the dive computer models and the cylinder
+	 * descriptions of loaded dives are shared
+	 */
+	QVERIFY(intern_string("test") == intern_string(std::string("test").c_str()));
+	QVERIFY(intern_string("test") != intern_string("Test"));
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/ostc.xml", &dive_table, &trip_table, &dive_site_table,
+			    &device_table, &filter_preset_table), 0);
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/vyper.xml", &dive_table, &trip_table, &dive_site_table,
+			    &device_table, &filter_preset_table), 0);
+	QVERIFY(dive_table.nr > 1);
+	for (int i = 0; i < dive_table.nr; i++) {
+		const struct dive *d = get_dive(i);
+		QVERIFY(d->dc.model == intern_string(d->dc.model));
+		for (int j = 0; j < d->cylinders.nr; j++) {
+			const char *description = get_cylinder(d, j)->type.description;
+			QVERIFY(description == intern_string(description));
+		}
+	}
+}
+
+static QString readFileContent(const char *filename)
+{
+	QFile f(filename);
+	f.open(QFile::ReadOnly);
+	return QTextStream(&f).readAll();
+}
+
+void TestParse::testStreamingParser()
+{
+	/*
+	 * check that the streaming parser and the document tree
+	 * give the same dives for all our test files
+	 */
+	QDir dir(QString::fromLatin1(SUBSURFACE_TEST_DATA "/dives"));
+	const QStringList files = dir.entryList(QStringList{ "*.xml", "*.ssrf" }, QDir::Files);
+	QVERIFY(!files.isEmpty());
+
+	for (const QString &file: files) {
+		QByteArray path = dir.filePath(file).toUtf8();
+
+		xml_tree_parser = false;
+		int streamed = parse_file(path.data(), &dive_table, &trip_table, &dive_site_table,
+					  &device_table, &filter_preset_table);
+		QCOMPARE(save_dives("./teststreamed.ssrf"), 0);
+		clear_dive_file_data();
+
+		xml_tree_parser = true;
+		int tree = parse_file(path.data(), &dive_table, &trip_table, &dive_site_table,
+				      &device_table, &filter_preset_table);
+		QCOMPARE(save_dives("./testtree.ssrf"), 0);
+		clear_dive_file_data();
+		xml_tree_parser = false;
+
+		QCOMPARE(streamed, tree);
+		QCOMPARE(readFileContent("./teststreamed.ssrf"), readFileContent("./testtree.ssrf"));
+	}
+}
+
+void TestParse::testStreamingParserError()
+{
+	/*
+	 * a file that is broken halfway through must not leave
+	 * dives or global data behind when the document tree
+	 * is parsed after the streaming parser failed
+	 */
+	QFile f(SUBSURFACE_TEST_DATA "/dives/abitofeverything.ssrf");
+	QVERIFY(f.open(QFile::ReadOnly));
+	QByteArray content = f.readAll();
+	content.truncate(content.size() / 2);
+
+	int nr_event_names = evn_used;
+	int nr_tank_infos = tank_info_table.nr;
+	int nr_tags = 0;
+	for (struct tag_entry *entry = g_tag_list; entry; entry = entry->next)
+		nr_tags++;
+
+	QVERIFY(parse_xml_buffer("broken.ssrf", content.constData(), content.size(), &dive_table, &trip_table,
+				 &dive_site_table, &device_table, &filter_preset_table, NULL) != 0);
+	QCOMPARE(dive_table.nr, 0);
+	QCOMPARE(trip_table.nr, 0);
+	QCOMPARE(dive_site_table.nr, 0);
+	QCOMPARE(evn_used, nr_event_names);
+	QCOMPARE(tank_info_table.nr, nr_tank_infos);
+	for (struct tag_entry *entry = g_tag_list; entry; entry = entry->next)
+		nr_tags--;
+	QCOMPARE(nr_tags, 0);
+}
+
+// Read a file of the given size with readfile_mapped() and check that the
+// buffer has the content of the file, is zero-terminated and can be freed
+static void checkReadFileMapped(int size, bool expect_mapped)
+{
+	const char *filename = "./testreadfilemapped.bin";
+	QByteArray content(size, 0);
+	struct memblock mem, reread;
+
+	for (int i = 0; i < size; i++)
+		content[i] = 'a' + i % 26;
+	QFile f(filename);
+	QVERIFY(f.open(QFile::WriteOnly | QFile::Truncate));
+	QCOMPARE(f.write(content), (qint64)size);
+	f.close();
+
+	QCOMPARE(readfile_mapped(filename, &mem), size);
+	QCOMPARE(mem.size, (size_t)size);
+	QCOMPARE(mem.mapped != 0, expect_mapped);
+	if (size) {
+		QVERIFY(mem.buffer != NULL);
+		QVERIFY(memcmp(mem.buffer, content.constData(), size) == 0);
+		QCOMPARE(((const char *)mem.buffer)[size], '\0');
+
+		// The buffer may be modified without changing the file
+		((char *)mem.buffer)[0] = 'X';
+		QCOMPARE(readfile(filename, &reread), size);
+		QCOMPARE(((const char *)reread.buffer)[0], 'a');
+		free_memblock(&reread);
+	}
+
+	free_memblock(&mem);
+	QVERIFY(mem.buffer == NULL);
+	QCOMPARE(mem.size, (size_t)0);
+	QCOMPARE(mem.mapped, (size_t)0);
+	QVERIFY(QFile::remove(filename));
+}
+
+void TestParse::testReadFileMapped()
+{
+#ifndef WIN32
+	int pagesize = (int)sysconf(_SC_PAGESIZE);
+	QVERIFY(pagesize > 1);
+	checkReadFileMapped(1, true);
+	checkReadFileMapped(pagesize - 1, true);
+	checkReadFileMapped(pagesize + 1, true);
+	// There is no room for the terminator in the mapping
+	checkReadFileMapped(pagesize, false);
+	checkReadFileMapped(2 * pagesize, false);
+	checkReadFileMapped(0, false);
+#else
+	// Files are never mapped
+	checkReadFileMapped(1, false);
+	checkReadFileMapped(4096, false);
+	checkReadFileMapped(0, false);
+#endif
+}
+
 int TestParse::parseCSVmanual(int units, std::string file)
 {
 	verbose = 1;
@@ -24,6 +24,11 @@ private slots:
 	void testParseNewFormat();
 	void testParseDLD();
 	void testParseMerge();
+	void testArena();
+	void testInternedStrings();
+	void testStreamingParser();
+	void testStreamingParserError();
+	void testReadFileMapped();
 
 	int parseCSVmanual(int, std::string);
 	void exportSubsurfaceCSV();
@@ -1,17 +1,40 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "testparseperformance.h"
 #include "core/device.h"
+#include "core/dive.h"
+#include "core/divelist.h"
 #include "core/divesite.h"
 #include "core/trip.h"
 #include "core/file.h"
+#include "core/fulltext.h"
 #include "core/git-access.h"
+#include "core/packedsamples.h"
+#include "core/profilebatch.h"
+#include "core/sample.h"
 #include "core/settings/qPrefProxy.h"
 #include "core/settings/qPrefCloudStorage.h"
+#include <QDir>
 #include <QFile>
 #include <QDebug>
 #include <QNetworkProxy>
 
 #define LARGE_TEST_REPO "https://github.com/Subsurface/large-anonymous-sample-data"
+#define LARGE_SSRF_FILE SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf"
+
+// Load the large sample log for the benchmarks of the code that works on a loaded log.
+// Returns false if the file is missing or the test failed.
+static bool loadLargeLog()
+{
+	if (!QFile::exists(LARGE_SSRF_FILE)) {
+		qDebug() << "missing large sample data file - available at " LARGE_TEST_REPO;
+		return false;
+	}
+	if (parse_file(LARGE_SSRF_FILE, &dive_table, &trip_table, &dive_site_table, &device_table, &filter_preset_table) != 0) {
+		QTest::qFail("parsing " LARGE_SSRF_FILE " failed", __FILE__, __LINE__);
+		return false;
+	}
+	return true;
+}
 
 void TestParsePerformance::initTestCase()
 {
@@ -57,14 +80,14 @@ void TestParsePerformance::cleanup()
 void TestParsePerformance::parseSsrf()
 {
 	// parsing of a V2 file should work
-	QFile largeSsrfFile(SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf");
+	QFile largeSsrfFile(LARGE_SSRF_FILE);
 	if (!largeSsrfFile.exists()) {
 		qDebug() << "missing large sample data file - available at " LARGE_TEST_REPO;
 		qDebug() << "clone the repo, uncompress the file and copy it to " SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf";
 		return;
 	}
 	QBENCHMARK {
-		parse_file(SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf", &dive_table, &trip_table,
+		parse_file(LARGE_SSRF_FILE, &dive_table, &trip_table,
 			   &dive_site_table, &device_table, &filter_preset_table);
 	}
 }
@@ -87,4 +110,134 @@ void TestParsePerformance::parseGit()
 	}
 }
 
+// Loading and closing the log, which releases the samples and the extra
+// data of the dive computers with the arenas of the loader.
+void TestParsePerformance::loadClose()
+{
+	if (!loadLargeLog())
+		return;
+	clear_dive_file_data();
+
+	QBENCHMARK {
+		QVERIFY(loadLargeLog());
+		clear_dive_file_data();
+	}
+}
+
+void TestParsePerformance::profileBatch()
+{
+	if (!loadLargeLog())
+		return;
+	sort_dive_table(&dive_table);
+	std::vector<const dive *> dives(dive_table.dives, dive_table.dives + dive_table.nr);
+
+	QBENCHMARK {
+		// Start from scratch - don't measure the cached tissue states of the previous run
+		for (int i = 0; i < dive_table.nr; ++i)
+			invalidate_dive_cache(dive_table.dives[i]);
+		ProfileBatch batch(dives);
+		std::vector<ProfileSummary> res = batch.run();
+		QCOMPARE(batch.progress(), dive_table.nr);
+		QCOMPARE((int)res.size(), dive_table.nr);
+	}
+}
+
+void TestParsePerformance::saveGit()
+{
+	if (!loadLargeLog())
+		return;
+	git_libgit2_init();
+	git_repository *repo;
+	QDir testDir("./gittestsaveperformance");
+	QCOMPARE(testDir.removeRecursively(), true);
+	QCOMPARE(QDir().mkdir(testDir.path()), true);
+	QCOMPARE(git_repository_init(&repo, qPrintable(testDir.path()), false), 0);
+	git_repository_free(repo);
+
+	QBENCHMARK {
+		// Write all dives, as after a bulk edit
+		for (int i = 0; i < dive_table.nr; ++i)
+			invalidate_dive_cache(dive_table.dives[i]);
+		QCOMPARE(save_dives(qPrintable(testDir.path() + "[test]")), 0);
+	}
+}
+
+void TestParsePerformance::populateFulltext()
+{
+	if (!loadLargeLog())
+		return;
+
+	QBENCHMARK {
+		// Start from scratch, as after loading a file
+		fulltext_unregister_all();
+		fulltext_populate();
+	}
+	fulltext_unregister_all();
+}
+
+void TestParsePerformance::compressSamples()
+{
+	if (!loadLargeLog())
+		return;
+
+	size_t raw = 0, packed = 0;
+	for (int i = 0; i < dive_table.nr; ++i) {
+		struct divecomputer *dc;
+		for_each_dc(dive_table.dives[i], dc)
+			raw += dc->alloc_samples * sizeof(struct sample);
+	}
+
+	QBENCHMARK {
+		packed = 0;
+		for (int i = 0; i < dive_table.nr; ++i) {
+			struct divecomputer *dc;
+			for_each_dc(dive_table.dives[i], dc) {
+				compress_dc_samples(dc);
+				packed += packed_samples_size(dc->packed_samples);
+			}
+		}
+		for (int i = 0; i < dive_table.nr; ++i)
+			expand_dive_samples(dive_table.dives[i]);
+	}
+	QVERIFY(packed * 2 < raw);
+}
+
+void TestParsePerformance::tableInsertRemove_data()
+{
+	QTest::addColumn<bool>("bulk");
+	QTest::newRow("single") << false;
+	QTest::newRow("bulk") << true;
+}
+
+void TestParsePerformance::tableInsertRemove()
+{
+	QFETCH(bool, bulk);
+	if (!loadLargeLog())
+		return;
+	sort_dive_table(&dive_table);
+
+	// Import and delete every fourth dive, as when importing into the middle of the log
+	std::vector<dive *> dives;
+	for (int i = 0; i < dive_table.nr; i += 4)
+		dives.push_back(dive_table.dives[i]);
+	remove_many_from_dive_table(&dive_table, dives.data(), (int)dives.size());
+	int nr = dive_table.nr;
+
+	QBENCHMARK {
+		if (bulk) {
+			add_many_to_dive_table(&dive_table, dives.data(), (int)dives.size());
+			remove_many_from_dive_table(&dive_table, dives.data(), (int)dives.size());
+		} else {
+			for (dive *d: dives)
+				insert_dive(&dive_table, d);
+			for (dive *d: dives)
+				remove_dive(d, &dive_table);
+		}
+	}
+	QCOMPARE(dive_table.nr, nr);
+
+	// Return the dives to the table, so that they are freed
+	add_many_to_dive_table(&dive_table, dives.data(), (int)dives.size());
+}
+
 QTEST_GUILESS_MAIN(TestParsePerformance)
@@ -13,6 +13,13 @@ private slots:
 
 	void parseSsrf();
 	void parseGit();
+	void loadClose();
+	void profileBatch();
+	void saveGit();
+	void populateFulltext();
+	void compressSamples();
+	void tableInsertRemove_data();
+	void tableInsertRemove();
 };
 
 #endif
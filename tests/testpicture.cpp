@@ -7,7 +7,9 @@
 #include "core/picture.h"
 #include "core/trip.h"
 #include "core/file.h"
+#include "core/thumbnailstore.h"
 #include <QString>
+#include <QTemporaryDir>
 #include <core/qthelper.h>
 
 void TestPicture::initTestCase()
@@ -64,4 +66,62 @@ void TestPicture::addPicture()
 	QCOMPARE(localFilePath(pic2->filename), QString(PIC2_NAME));
 }
 
+void TestPicture::thumbnailStore()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString path = dir.path() + "/";
+
+	{
+		ThumbnailStore store(path);
+		QVERIFY(store.get("a.jpg").data.isEmpty());
+		store.put("a.jpg", "thumbnail a", 1);
+		store.put("b.jpg", "thumbnail b", 2);
+		store.put("a.jpg", "new thumbnail a", 3);
+		QCOMPARE(store.get("a.jpg").data, QByteArray("new thumbnail a"));
+		QCOMPARE(store.get("a.jpg").mtime, (qint64)3);
+
+		QVector<ThumbnailStore::Entry> entries = store.getMany({ "b.jpg", "c.jpg", "a.jpg" });
+		QCOMPARE(entries.size(), 3);
+		QCOMPARE(entries[0].data, QByteArray("thumbnail b"));
+		QVERIFY(entries[1].data.isEmpty());
+		QCOMPARE(entries[2].data, QByteArray("new thumbnail a"));
+	}
+
+	// Reopen from the index. Thumbnails added after the index was saved
+	// are found by reading the end of the data file.
+	{
+		ThumbnailStore store(path);
+		QCOMPARE(store.get("a.jpg").data, QByteArray("new thumbnail a"));
+		QCOMPARE(store.get("b.jpg").mtime, (qint64)2);
+		store.saveIndex();
+		store.put("c.jpg", "thumbnail c", 4);
+	}
+	QVERIFY(QFile::remove(path + "thumbnails.idx"));
+	{
+		ThumbnailStore store(path);
+		QCOMPARE(store.get("c.jpg").data, QByteArray("thumbnail c"));
+		store.compact();
+		QCOMPARE(store.get("a.jpg").data, QByteArray("new thumbnail a"));
+		QCOMPARE(store.get("b.jpg").data, QByteArray("thumbnail b"));
+		QCOMPARE(store.get("c.jpg").data, QByteArray("thumbnail c"));
+	}
+
+	// A partially written record is cut off
+	{
+		QFile file(path + "thumbnails.dat");
+		QVERIFY(file.open(QIODevice::Append));
+		file.write("garbage");
+	}
+	{
+		ThumbnailStore store(path);
+		QCOMPARE(store.get("c.jpg").data, QByteArray("thumbnail c"));
+		store.put("d.jpg", "thumbnail d", 5);
+	}
+	{
+		ThumbnailStore store(path);
+		QCOMPARE(store.get("d.jpg").data, QByteArray("thumbnail d"));
+	}
+}
+
 QTEST_GUILESS_MAIN(TestPicture)
@@ -9,13 +9,22 @@
 #include "core/units.h"
 #include "core/applicationstate.h"
 #include <QDebug>
+#include <math.h>
 
 #define DEBUG 1
 
 // testing the dive plan algorithm
 struct decostop stoptable[60];
 struct deco_state test_deco_state;
-extern bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, int timestep, struct decostop *decostoptable, struct deco_state **cached_datap, bool is_planner, bool show_disclaimer);
+extern bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, const struct deco_config *config, int timestep, struct decostop *decostoptable, struct deco_state **cached_datap, bool is_planner, bool show_disclaimer);
+// The planner gets the settings of the deco model from the UI thread
+static const struct deco_config *test_deco_config()
+{
+	static struct deco_config config;
+	init_deco_config(&config, in_planner());
+	return &config;
+}
+
 void setupPrefs()
 {
 	copy_prefs(&default_prefs, &prefs);
@@ -420,7 +429,7 @@ void TestPlan::testMetric()
 	struct diveplan testPlan = {};
 	setupPlan(&testPlan);
 
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -461,7 +470,7 @@ void TestPlan::testImperial()
 	struct diveplan testPlan = {};
 	setupPlan(&testPlan);
 
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -502,7 +511,7 @@ void TestPlan::testVpmbMetric45m30minTx()
 	setupPlanVpmb45m30mTx(&testPlan);
 	setAppState(ApplicationState::PlanDive);
 
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -533,7 +542,7 @@ void TestPlan::testVpmbMetric60m10minTx()
 	setupPlanVpmb60m10mTx(&testPlan);
 	setAppState(ApplicationState::PlanDive);
 
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -564,7 +573,7 @@ void TestPlan::testVpmbMetric60m30minAir()
 	setupPlanVpmb60m30minAir(&testPlan);
 	setAppState(ApplicationState::PlanDive);
 
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -595,7 +604,7 @@ void TestPlan::testVpmbMetric60m30minEan50()
 	setupPlanVpmb60m30minEan50(&testPlan);
 	setAppState(ApplicationState::PlanDive);
 
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -632,7 +641,7 @@ void TestPlan::testVpmbMetric60m30minTx()
 	setupPlanVpmb60m30minTx(&testPlan);
 	setAppState(ApplicationState::PlanDive);
 
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -669,7 +678,7 @@ void TestPlan::testVpmbMetric100m60min()
 	setupPlanVpmb100m60min(&testPlan);
 	setAppState(ApplicationState::PlanDive);
 
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -713,7 +722,7 @@ void TestPlan::testMultipleGases()
 	setupPlanSeveralGases(&testPlan);
 	setAppState(ApplicationState::PlanDive);
 
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -739,7 +748,7 @@ void TestPlan::testVpmbMetricMultiLevelAir()
 	setupPlanVpmbMultiLevelAir(&testPlan);
 	setAppState(ApplicationState::PlanDive);
 
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -770,7 +779,7 @@ void TestPlan::testVpmbMetric100m10min()
 	setupPlanVpmb100m10min(&testPlan);
 	setAppState(ApplicationState::PlanDive);
 
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -817,7 +826,7 @@ void TestPlan::testVpmbMetricRepeat()
 	setupPlanVpmb30m20min(&testPlan);
 	setAppState(ApplicationState::PlanDive);
 
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -838,7 +847,7 @@ void TestPlan::testVpmbMetricRepeat()
 	int firstDiveRunTimeSeconds = displayed_dive.dc.duration.seconds;
 
 	setupPlanVpmb100mTo70m30min(&testPlan);
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -875,7 +884,7 @@ void TestPlan::testVpmbMetricRepeat()
 	QVERIFY(compareDecoTime(displayed_dive.dc.duration.seconds, 127u * 60u + 20u, 127u * 60u + 20u));
 
 	setupPlanVpmb30m20min(&testPlan);
-	plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+	plan(&test_deco_state, &testPlan, &displayed_dive, test_deco_config(), 60, stoptable, &cache, 1, 0);
 
 #if DEBUG
 	free(displayed_dive.notes);
@@ -896,4 +905,78 @@ void TestPlan::testVpmbMetricRepeat()
 	QCOMPARE(finalDiveRunTimeSeconds, firstDiveRunTimeSeconds);
 }
 
+// Straight-forward tissue loading as it was done before the factors were cached
+// and the loop was made vectorizable. Used as reference for test and benchmark.
+static void referenceSegment(double tissue_n2[16], double tissue_he[16], double pn2, double phe, int period)
+{
+	static const double he_halflife[] = { 1.88, 3.02, 4.72, 6.99,
+					      10.21, 14.48, 20.53, 29.11,
+					      41.20, 55.19, 70.69, 90.34,
+					      115.29, 147.42, 188.24, 240.03 };
+	for (int ci = 0; ci < 16; ci++) {
+		tissue_n2[ci] += (pn2 - tissue_n2[ci]) * (1.0 - exp(-period * 1.155245301e-02 / buehlmann_N2_t_halflife[ci]));
+		tissue_he[ci] += (phe - tissue_he[ci]) * (1.0 - exp(-period * 1.155245301e-02 / he_halflife[ci]));
+	}
+}
+
+static const struct gasmix trimix2135 = { {210}, {350} };
+
+void TestPlan::testTissueLoading()
+{
+	struct deco_state ds;
+	struct deco_config config;
+	struct gas_pressures pressures;
+	double tissue_n2[16], tissue_he[16];
+
+	setupPrefs();
+	init_deco_config(&config, false);
+	set_deco_config_gf(&config, 100, 100);
+	clear_deco(&ds, 1.013, &config);
+	memcpy(tissue_n2, ds.tissue_n2_sat, sizeof(tissue_n2));
+	memcpy(tissue_he, ds.tissue_he_sat, sizeof(tissue_he));
+	fill_pressures(&pressures, 5.0 - 0.0627, trimix2135, 0.0, OC);
+	for (int period: { 1, 20, 20, 60, 1, 3600 }) {
+		add_segment(&ds, 5.0, trimix2135, period, 0, OC, 0);
+		referenceSegment(tissue_n2, tissue_he, pressures.n2, pressures.he, period);
+		for (int ci = 0; ci < 16; ci++) {
+			QVERIFY(fabs(ds.tissue_n2_sat[ci] - tissue_n2[ci]) < 1e-9);
+			QVERIFY(fabs(ds.tissue_he_sat[ci] - tissue_he[ci]) < 1e-9);
+		}
+	}
+}
+
+void TestPlan::benchmarkTissueLoading_data()
+{
+	QTest::addColumn<bool>("reference");
+	QTest::newRow("reference") << true;
+	QTest::newRow("add_segment") << false;
+}
+
+// Simulate a one hour dive with one second samples and a ceiling calculation every 20 seconds
+void TestPlan::benchmarkTissueLoading()
+{
+	QFETCH(bool, reference);
+	struct deco_state ds;
+	struct deco_config config;
+	struct gas_pressures pressures;
+
+	setupPrefs();
+	init_deco_config(&config, false);
+	clear_deco(&ds, 1.013, &config);
+	fill_pressures(&pressures, 5.0 - 0.0627, trimix2135, 0.0, OC);
+	QBENCHMARK {
+		for (int t = 0; t < 3600; t++) {
+			if (reference)
+				referenceSegment(ds.tissue_n2_sat, ds.tissue_he_sat, pressures.n2, pressures.he, t % 20 ? 1 : 20);
+			else
+				add_segment(&ds, 5.0, trimix2135, t % 20 ? 1 : 20, 0, OC, 0);
+			if (t % 20 == 0) {
+				for (int ci = 0; ci < 16; ci++)
+					ds.tissue_inertgas_saturation[ci] = ds.tissue_n2_sat[ci] + ds.tissue_he_sat[ci];
+				tissue_tolerance_calc(&ds, &displayed_dive, 5.0);
+			}
+		}
+	}
+}
+
 QTEST_GUILESS_MAIN(TestPlan)
@@ -19,6 +19,9 @@ private slots:
 	void testVpmbMetric100m10min();
 	void testVpmbMetricRepeat();
 	void testMultipleGases();
+	void testTissueLoading();
+	void benchmarkTissueLoading_data();
+	void benchmarkTissueLoading();
 };
 
 #endif // TESTPLAN_H
@@ -1,10 +1,20 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "testprofile.h"
+#include "core/deco.h"
 #include "core/device.h"
+#include "core/dive.h"
+#include "core/divelist.h"
 #include "core/divesite.h"
+#include "core/event.h"
+#include "core/eventindex.h"
 #include "core/trip.h"
 #include "core/file.h"
+#include "core/packedsamples.h"
+#include "core/profile.h"
+#include "core/sample.h"
 #include "core/save-profiledata.h"
+#include <climits>
+#include <vector>
 
 // This test compares the content of struct profile against a known reference version for a list
 // of dives to prevent accidental regressions. Thus is you change anything in the profile this
@@ -29,4 +39,238 @@ void TestProfile::testProfileExport()
 
 }
 
+static void compareTissues(const struct deco_state &ds1, const struct deco_state &ds2)
+{
+	for (int ci = 0; ci < 16; ci++) {
+		QCOMPARE(ds1.tissue_n2_sat[ci], ds2.tissue_n2_sat[ci]);
+		QCOMPARE(ds1.tissue_he_sat[ci], ds2.tissue_he_sat[ci]);
+	}
+}
+
+// Calculate the tissue state without using any cached state of previous dives
+static int uncachedDecompression(struct deco_state *ds, struct dive *dive, const struct deco_config *config)
+{
+	int i;
+	struct dive *d;
+
+	for_each_dive(i, d)
+		invalidate_dive_cache(d);
+	return init_decompression(ds, dive, config);
+}
+
+// Compare the calculation of the tissue states of all dives, using the cache in its
+// current state, against the calculation from scratch. The first pass may have to
+// update the cache, the second pass only reads it.
+static void compareCachedDecompression(const struct deco_config *config)
+{
+	int i;
+	struct dive *d;
+	std::vector<struct deco_state> states[2];
+	std::vector<int> surface_times[2];
+
+	for (int pass = 0; pass < 2; pass++) {
+		states[pass].resize(dive_table.nr);
+		surface_times[pass].resize(dive_table.nr);
+		for_each_dive(i, d)
+			surface_times[pass][i] = init_decompression(&states[pass][i], d, config);
+	}
+
+	for_each_dive(i, d) {
+		struct deco_state ds;
+		int surface_time = uncachedDecompression(&ds, d, config);
+		for (int pass = 0; pass < 2; pass++) {
+			QCOMPARE(surface_times[pass][i], surface_time);
+			compareTissues(states[pass][i], ds);
+		}
+	}
+}
+
+// The tissue states of previous dives are cached. Make sure that the cached
+// calculation gives the same result as a calculation from scratch.
+void TestProfile::testRepetitiveDiveCache()
+{
+	int i;
+	struct dive *d;
+	struct deco_config config;
+
+	clear_dive_file_data();
+	QCOMPARE(parse_file("../dives/abitofeverything.ssrf", &dive_table, &trip_table, &dive_site_table, &device_table, &filter_preset_table), 0);
+	QVERIFY(dive_table.nr >= 2);
+
+	init_deco_config(&config, false);
+	for_each_dive(i, d)
+		invalidate_dive_cache(d);
+	compareCachedDecompression(&config);
+
+	// Changing a dive must be reflected in the following dives. Only
+	// the changed dive is invalidated, as done by the edit commands.
+	d = get_dive(0);
+	d->when -= 3600;
+	invalidate_dive_cache(d);
+	compareCachedDecompression(&config);
+
+	// Restore the dive for the following tests
+	d = get_dive(0);
+	d->when += 3600;
+	invalidate_dive_cache(d);
+	compareCachedDecompression(&config);
+}
+
+// Leaving out the optional channels must not change the other data
+void TestProfile::testPlotChannels()
+{
+	int i;
+	struct dive *d;
+	struct deco_config config;
+	struct plot_info full, minimal;
+
+	init_deco_config(&config, false);
+	init_plot_info(&full);
+	init_plot_info(&minimal);
+	for_each_dive(i, d) {
+		create_plot_info_config(d, &d->dc, &full, false, nullptr, &config, PLOT_CHANNELS_ALL);
+		create_plot_info_config(d, &d->dc, &minimal, false, nullptr, &config, 0);
+		QVERIFY(full.tissues != nullptr);
+		QVERIFY(full.gas_depths != nullptr);
+		QVERIFY(minimal.tissues == nullptr);
+		QVERIFY(minimal.gas_depths == nullptr);
+		QCOMPARE(minimal.nr, full.nr);
+		for (int j = 0; j < full.nr; j++) {
+			QCOMPARE(minimal.entry[j].depth, full.entry[j].depth);
+			QCOMPARE(minimal.entry[j].ceiling, full.entry[j].ceiling);
+			QCOMPARE(minimal.entry[j].tts_calc, full.entry[j].tts_calc);
+			QCOMPARE(minimal.entry[j].cns, full.entry[j].cns);
+			QCOMPARE(minimal.entry[j].density, full.entry[j].density);
+			QCOMPARE(minimal.entry[j].surface_gf, full.entry[j].surface_gf);
+		}
+	}
+	free_plot_info_data(&full);
+	free_plot_info_data(&minimal);
+}
+
+// The lookups using the event index must give the same result as walking the event list
+void TestProfile::testEventIndex()
+{
+	int i;
+	struct dive *d;
+	struct divecomputer *dc;
+
+	for_each_dive(i, d) {
+		for_each_dc(d, dc) {
+			for (int j = 0; j < dc->samples; j++) {
+				int t = dc->sample[j].time.seconds;
+				for (int time = t - 1; time <= t + 1; time++) {
+					const struct event *ev = NULL, *evd = NULL;
+					enum divemode_t divemode = UNDEF_COMP_TYPE;
+					struct gasmix gasmix = get_gasmix(d, dc, time, &ev, gasmix_air);
+					QVERIFY(same_gasmix(get_gasmix_at_time(d, dc, duration_t{ time }), gasmix));
+					QCOMPARE(get_divemode_at_time(dc, time), get_current_divemode(dc, time, &evd, &divemode));
+				}
+			}
+		}
+	}
+
+	// Adding an event must invalidate the index
+	d = alloc_dive();
+	copy_dive(get_dive(0), d);
+	int nr = count_dc_events(&d->dc);
+	const struct event *ev = add_event(&d->dc, 3600, SAMPLE_EVENT_BOOKMARK, 0, 0, "testindex");
+	QCOMPARE(count_dc_events(&d->dc), nr + 1);
+	QCOMPARE(get_last_dc_event_at(&d->dc, get_event_name_id("testindex"), 7200), ev);
+	QVERIFY(get_last_dc_event_at(&d->dc, get_event_name_id("testindex"), 3599) == nullptr);
+	free_dive(d);
+}
+
+// The profile of dives with compressed samples must not change
+void TestProfile::testCompressedSamples()
+{
+	int i;
+	struct dive *d;
+	struct divecomputer *dc;
+
+	for_each_dive(i, d) {
+		for_each_dc(d, dc) {
+			compress_dc_samples(dc);
+			QVERIFY(dc->samples == 0 || (dc->packed_samples && !dc->sample));
+		}
+	}
+	save_profiledata("exportprofilecompressed.csv", false);
+	QFile org("../dives/exportprofilereference.csv");
+	org.open(QFile::ReadOnly);
+	QFile out("exportprofilecompressed.csv");
+	out.open(QFile::ReadOnly);
+	QCOMPARE(QTextStream(&out).readAll(), QTextStream(&org).readAll());
+
+	// The profile decompressed the samples
+	for_each_dive(i, d) {
+		for_each_dc(d, dc)
+			QVERIFY(!dc->packed_samples);
+	}
+}
+
+// Pack and unpack the samples and compare the result byte by byte. The padding
+// of the samples is zeroed by prepare_sample() and unpack_samples().
+static bool packRoundTrip(const struct sample *samples, int nr)
+{
+	struct packed_samples *packed = pack_samples(samples, nr);
+	if (!packed || packed_samples_nr(packed) != nr)
+		return false;
+	std::vector<struct sample> unpacked(nr);
+	unpack_samples(packed, unpacked.data());
+	free_packed_samples(packed);
+	return memcmp(unpacked.data(), samples, nr * sizeof(struct sample)) == 0;
+}
+
+// The packing must be lossless for every field, not only for those that
+// end up in the profile.
+void TestProfile::testPackSamples()
+{
+	int i;
+	struct dive *d;
+	struct divecomputer *dc;
+
+	for_each_dive(i, d) {
+		expand_dive_samples(d);
+		for_each_dc(d, dc) {
+			if (dc->samples)
+				QVERIFY(packRoundTrip(dc->sample, dc->samples));
+		}
+	}
+
+	// The test log doesn't use all fields, therefore vary all of them,
+	// up and down and with extreme values.
+	struct divecomputer synthetic = {};
+	for (int j = 0; j < 1000; ++j) {
+		struct sample *s = prepare_sample(&synthetic);
+		QVERIFY(s);
+		int v = (j * 7919) % 1001 - 500;
+		s->time.seconds = j * 10;
+		s->stoptime.seconds = v * 60;
+		s->ndl.seconds = j % 3 ? -1 : v;
+		s->tts.seconds = INT_MAX - j;
+		s->rbt.seconds = INT_MIN + j;
+		s->depth.mm = 30000 + v * 37;
+		s->stopdepth.mm = j % 2 ? 3000 : 6000;
+		s->temperature.mkelvin = j % 5 ? UINT_MAX - j : 0;
+		s->pressure[0].mbar = 200000 - j * 150;
+		s->pressure[1].mbar = v * 1000;
+		s->setpoint.mbar = 1300 + v;
+		s->o2sensor[0].mbar = 65535 - j;
+		s->o2sensor[1].mbar = j * 13 % 65536;
+		s->o2sensor[2].mbar = j % 7;
+		s->bearing.degrees = v % 361;
+		s->sensor[0] = j % 256;
+		s->sensor[1] = 255 - j % 256;
+		s->cns = j * 65;
+		s->heartbeat = 60 + v % 100;
+		s->sac.mliter = v * 50;
+		s->in_deco = j % 4 == 0;
+		s->manually_entered = j % 9 == 0;
+		finish_sample(&synthetic);
+	}
+	QVERIFY(packRoundTrip(synthetic.sample, synthetic.samples));
+	QVERIFY(packRoundTrip(synthetic.sample, 1));
+	free_dc_contents(&synthetic);
+}
+
 QTEST_GUILESS_MAIN(TestProfile)
@@ -9,6 +9,11 @@ class TestProfile : public QObject {
 	Q_OBJECT
 private slots:
 	void testProfileExport();
+	void testRepetitiveDiveCache();
+	void testPlotChannels();
+	void testEventIndex();
+	void testCompressedSamples();
+	void testPackSamples();
 };
 
 #endif
@@ -2,6 +2,7 @@
 #include "testrenumber.h"
 #include "core/device.h"
 #include "core/dive.h"
+#include "core/divelist.h"
 #include "core/divesite.h"
 #include "core/trip.h"
 #include "core/file.h"
@@ -41,4 +42,19 @@ void TestRenumber::testMergeAndAppend()
 		QCOMPARE(d->number, 2);
 }
 
+void TestRenumber::testUniqIdLookup()
+{
+	// After merging, the id indexes must refer to the dives and trips of the tables
+	int i;
+	struct dive *d;
+	for_each_dive(i, d) {
+		QCOMPARE(get_dive_by_uniq_id(d->id), d);
+		QCOMPARE(get_idx_by_uniq_id(d->id), i);
+		QCOMPARE(get_divenr(d), i);
+		if (d->divetrip)
+			QCOMPARE(get_trip_by_uniq_id(d->divetrip->id), d->divetrip);
+	}
+	QCOMPARE(get_divenr(NULL), -1);
+}
+
 QTEST_GUILESS_MAIN(TestRenumber)
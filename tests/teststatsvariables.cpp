@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "teststatsvariables.h"
+#include "core/device.h"
+#include "core/dive.h"
+#include "core/divelist.h"
+#include "core/divesite.h"
+#include "core/file.h"
+#include "core/filterpreset.h"
+#include "core/pref.h"
+#include "core/trip.h"
+#include "core/subsurface-qt/divelistnotifier.h"
+#include "stats/statsvariables.h"
+
+static const StatsVariable *findVariable(const QString &name)
+{
+	for (const StatsVariable *var: stats_variables) {
+		if (var->name() == name)
+			return var;
+	}
+	return nullptr;
+}
+
+static double value(const StatsVariable *var, dive *d)
+{
+	std::vector<StatsValue> values = var->values(std::vector<dive *>{ d });
+	return values.empty() ? -1.0 : values[0].v;
+}
+
+void TestStatsVariables::initTestCase()
+{
+	// As in the application, the caches are connected before anyone else
+	// connects to the DiveListNotifier.
+	StatsVariable::connectCacheSignals();
+	prefs.units.length = units::METERS;
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/abitofeverything.ssrf", &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	QVERIFY(dive_table.nr > 0);
+}
+
+void TestStatsVariables::cleanupTestCase()
+{
+	clear_dive_file_data();
+}
+
+void TestStatsVariables::testDiveChanged()
+{
+	const StatsVariable *var = findVariable("Max. Depth");
+	QVERIFY(var);
+	struct dive *d = get_dive(0);
+	d->maxdepth.mm = 10000;
+	StatsVariable::clearCache();
+	QCOMPARE(value(var, d), 10.0);
+
+	// A handler that is connected later, like the models of the dive list,
+	// must see the new value when it is notified of the change.
+	double seen = -1.0;
+	QMetaObject::Connection c =
+		QObject::connect(&diveListNotifier, &DiveListNotifier::divesChanged,
+				 [&seen, var](const QVector<dive *> &dives, DiveField) { seen = value(var, dives[0]); });
+	d->maxdepth.mm = 20000;
+	emit diveListNotifier.divesChanged(QVector<dive *>{ d }, DiveField::DEPTH);
+	QObject::disconnect(c);
+	QCOMPARE(seen, 20.0);
+	QCOMPARE(value(var, d), 20.0);
+}
+
+void TestStatsVariables::testDataReset()
+{
+	const StatsVariable *var = findVariable("Max. Depth");
+	QVERIFY(var);
+	struct dive *d = get_dive(0);
+	d->maxdepth.mm = 10000;
+	StatsVariable::clearCache();
+	QCOMPARE(value(var, d), 10.0);
+
+	// After a reset, new dives may be allocated at the addresses of the
+	// old ones. Therefore, no cached value may survive the reset.
+	d->maxdepth.mm = 30000;
+	emit diveListNotifier.dataReset();
+	QCOMPARE(value(var, d), 30.0);
+}
+
+QTEST_GUILESS_MAIN(TestStatsVariables)
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTSTATSVARIABLES_H
+#define TESTSTATSVARIABLES_H
+
+#include <QtTest>
+
+class TestStatsVariables : public QObject {
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void testDiveChanged();
+	void testDataReset();
+};
+
+#endif
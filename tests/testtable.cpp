@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testtable.h"
+#include "testtablehelper.h"
+#include <algorithm>
+#include <vector>
+
+// The batch functions of core/table.h must give the same result as
+// adding or removing the items one by one.
+
+static std::vector<test_item> makeItems(const std::vector<int> &keys, int first_id)
+{
+	std::vector<test_item> items;
+	for (int key: keys)
+		items.push_back(test_item{ key, first_id++, 0, 0 });
+	return items;
+}
+
+// The index after all items that are not greater than the given item
+static int linearInsertionIndex(const struct test_table *table, const struct test_item *item)
+{
+	int i;
+	for (i = 0; i < table->nr; i++) {
+		if (item->key < table->items[i]->key)
+			break;
+	}
+	return i;
+}
+
+static void addSingle(struct test_table *table, struct test_item *item)
+{
+	int idx = test_table_get_insertion_index(table, item);
+	QCOMPARE(idx, linearInsertionIndex(table, item));
+	add_to_test_table(table, idx, item);
+}
+
+static void compareTables(const struct test_table *table1, const struct test_table *table2)
+{
+	QCOMPARE(table1->nr, table2->nr);
+	for (int i = 0; i < table1->nr; i++) {
+		QCOMPARE(table1->items[i]->key, table2->items[i]->key);
+		QCOMPARE(table1->items[i]->id, table2->items[i]->id);
+	}
+}
+
+void TestTable::testInsertionIndex()
+{
+	struct test_table table = { 0 };
+	std::vector<test_item> items = makeItems({ 5, 1, 3, 3, 9, 1, 7, 3, 0, 9, 5 }, 0);
+
+	for (test_item &item: items)
+		addSingle(&table, &item);
+
+	// Sorted by key, and items with the same key in the order they were added
+	QCOMPARE(table.nr, (int)items.size());
+	for (int i = 1; i < table.nr; i++) {
+		QVERIFY(table.items[i - 1]->key <= table.items[i]->key);
+		if (table.items[i - 1]->key == table.items[i]->key)
+			QVERIFY(table.items[i - 1]->id < table.items[i]->id);
+	}
+	for (const test_item &item: items) {
+		QCOMPARE(item.added, 1);
+		QCOMPARE(item.removed, 0);
+	}
+
+	free_test_table(&table);
+}
+
+// Add the sorted keys of batch to a table with the keys of initial,
+// in one go and one by one
+static void compareAddMany(const std::vector<int> &initial, const std::vector<int> &batch)
+{
+	struct test_table table = { 0 }, reference = { 0 };
+	std::vector<test_item> initial_items = makeItems(initial, 0);
+	std::vector<test_item> reference_initial_items = makeItems(initial, 0);
+	std::vector<test_item> batch_items = makeItems(batch, (int)initial.size());
+	std::vector<test_item> reference_batch_items = makeItems(batch, (int)initial.size());
+	std::vector<test_item *> batch_ptrs;
+
+	for (test_item &item: initial_items)
+		addSingle(&table, &item);
+	for (test_item &item: reference_initial_items)
+		addSingle(&reference, &item);
+
+	for (test_item &item: batch_items)
+		batch_ptrs.push_back(&item);
+	add_many_to_test_table(&table, batch_ptrs.data(), (int)batch_ptrs.size());
+	for (test_item &item: reference_batch_items)
+		addSingle(&reference, &item);
+
+	compareTables(&table, &reference);
+	for (const test_item &item: initial_items)
+		QCOMPARE(item.added, 1);
+	for (const test_item &item: batch_items) {
+		QCOMPARE(item.added, 1);
+		QCOMPARE(item.removed, 0);
+	}
+
+	free_test_table(&table);
+	free_test_table(&reference);
+}
+
+void TestTable::testAddMany()
+{
+	// Front, back, duplicate keys in the table and in the batch
+	compareAddMany({ 1, 3, 3, 5, 7 }, { 0, 0, 3, 5, 5, 8, 9 });
+	compareAddMany({ 1, 3, 3, 5, 7 }, { 3, 3 });
+	compareAddMany({ 1, 3, 3, 5, 7 }, { 7, 7, 7 });
+	compareAddMany({ 1, 3, 3, 5, 7 }, { 0 });
+	compareAddMany({ 1, 3, 3, 5, 7 }, {});
+	compareAddMany({}, { 2, 2, 4 });
+	// Enough items to make the table grow
+	std::vector<int> initial, batch;
+	for (int i = 0; i < 100; i++) {
+		initial.push_back(i / 3 * 2);
+		batch.push_back(i / 2);
+	}
+	compareAddMany(initial, batch);
+}
+
+// Remove the items at the given indexes (and an item that is not in the table),
+// in one go and one by one
+static void compareRemoveMany(const std::vector<int> &indexes)
+{
+	const std::vector<int> keys = { 0, 1, 2, 2, 2, 3, 4, 5, 5, 6 };
+	struct test_table table = { 0 }, reference = { 0 };
+	std::vector<test_item> items = makeItems(keys, 0);
+	std::vector<test_item> reference_items = makeItems(keys, 0);
+	test_item missing = { 2, (int)keys.size(), 0, 0 }, reference_missing = missing;
+	std::vector<test_item *> remove, reference_remove;
+
+	for (test_item &item: items)
+		addSingle(&table, &item);
+	for (test_item &item: reference_items)
+		addSingle(&reference, &item);
+
+	for (int idx: indexes) {
+		remove.push_back(&items[idx]);
+		reference_remove.push_back(&reference_items[idx]);
+	}
+	remove.push_back(&missing);
+	reference_remove.push_back(&reference_missing);
+
+	remove_many_from_test_table(&table, remove.data(), (int)remove.size());
+	for (test_item *item: reference_remove)
+		remove_test_item(item, &reference);
+
+	compareTables(&table, &reference);
+	for (size_t i = 0; i < items.size(); i++) {
+		bool removed = std::find(indexes.begin(), indexes.end(), (int)i) != indexes.end();
+		QCOMPARE(items[i].removed, removed ? 1 : 0);
+		QCOMPARE(items[i].removed, reference_items[i].removed);
+	}
+	QCOMPARE(missing.removed, 0);
+
+	free_test_table(&table);
+	free_test_table(&reference);
+}
+
+void TestTable::testRemoveMany()
+{
+	compareRemoveMany({ 0 });
+	compareRemoveMany({ 9 });
+	compareRemoveMany({ 3 });
+	// Items with the same key, in any order
+	compareRemoveMany({ 4, 2 });
+	compareRemoveMany({ 9, 0, 3, 7 });
+	compareRemoveMany({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+	compareRemoveMany({});
+}
+
+QTEST_GUILESS_MAIN(TestTable)
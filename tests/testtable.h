@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTTABLE_H
+#define TESTTABLE_H
+
+#include <QtTest>
+
+class TestTable : public QObject {
+	Q_OBJECT
+private slots:
+	void testInsertionIndex();
+	void testAddMany();
+	void testRemoveMany();
+};
+
+#endif
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testtablehelper.h"
+#include "core/table.h"
+
+#include <stdbool.h>
+
+static bool test_item_less_than(const struct test_item *a, const struct test_item *b)
+{
+	return a->key < b->key;
+}
+
+static void test_table_added(struct test_table *table, struct test_item *item)
+{
+	item->added++;
+}
+
+static void test_table_removed(struct test_table *table, struct test_item *item)
+{
+	item->removed++;
+}
+
+static MAKE_GROW_TABLE(test_table, struct test_item *, items)
+MAKE_GET_INSERTION_INDEX(test_table, struct test_item *, items, test_item_less_than)
+MAKE_ADD_TO_HOOKED(test_table, struct test_item *, items, test_table_added)
+MAKE_ADD_MANY_HOOKED(test_table, struct test_item *, items, test_item_less_than, test_table_added)
+static MAKE_REMOVE_FROM_HOOKED(test_table, items, test_table_removed)
+MAKE_REMOVE_MANY_HOOKED(test_table, struct test_item *, items, test_table_removed)
+static MAKE_GET_IDX(test_table, struct test_item *, items)
+MAKE_REMOVE(test_table, struct test_item *, test_item)
+
+/* The items belong to the caller */
+void free_test_table(struct test_table *table)
+{
+	free(table->items);
+	table->items = NULL;
+	table->nr = table->allocated = 0;
+}
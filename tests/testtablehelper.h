@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: GPL-2.0
+// A table instantiated from the macros in core/table.h for TestTable.
+// The macros generate C code, therefore the table lives in a C file.
+#ifndef TESTTABLEHELPER_H
+#define TESTTABLEHELPER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Items are ordered by key only, so that different items can compare equal.
+// The hooks count how often an item entered and left a table.
+struct test_item {
+	int key;
+	int id;
+	int added;
+	int removed;
+};
+
+struct test_table {
+	int nr, allocated;
+	struct test_item **items;
+};
+
+extern int test_table_get_insertion_index(struct test_table *table, struct test_item *item);
+extern void add_to_test_table(struct test_table *table, int idx, struct test_item *item);
+extern void add_many_to_test_table(struct test_table *table, struct test_item **items, int nr);
+extern void remove_many_from_test_table(struct test_table *table, struct test_item **items, int nr);
+extern int remove_test_item(const struct test_item *item, struct test_table *table);
+extern void free_test_table(struct test_table *table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif